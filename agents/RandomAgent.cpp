@@ -40,6 +40,6 @@ RandomAgent::RandomAgent(OSystem* _osystem, RomSettings* _settings) :
 }
 
 Action RandomAgent::act() {
-  return choice(&available_actions);
+  return choice(p_osystem->rng(), &available_actions);
 }
 
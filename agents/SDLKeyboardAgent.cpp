@@ -57,7 +57,7 @@ Action SDLKeyboardAgent::act() {
       return waitForKeypress();
   } 
   else // Default to random agent 
-    return choice(&available_actions);
+    return choice(p_osystem->rng(), &available_actions);
 }
 
 
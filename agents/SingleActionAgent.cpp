@@ -44,10 +44,10 @@ SingleActionAgent::SingleActionAgent(OSystem* _osystem, RomSettings* _settings)
 
 Action SingleActionAgent::act() {
 
-  double r = double(rand()) / double(RAND_MAX); 
+  double r = p_osystem->rng().nextDouble();
 
   if (r < epsilon)
-    return choice(&available_actions);
+    return choice(p_osystem->rng(), &available_actions);
   else
     return agent_action; 
 }
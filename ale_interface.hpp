@@ -38,6 +38,7 @@
 #include <vector>
 #include <memory>
 #include <cassert>
+#include <stdint.h>
 
 namespace ale {
 
@@ -47,6 +48,7 @@ class Event;
 class Settings;
 struct RomSettings;
 class StellaEnvironment;
+class TransitionCache;
 
 
 // Define possible actions
@@ -174,12 +176,82 @@ class ALERAM {
 };
 
 
+// Describes how screens are turned into compact observations: the screen is
+// cropped, converted to grayscale or RGB, and resized in a single pass.
+struct ScreenPreprocessing {
+
+    enum Interpolation {
+        AREA,     // Average of the covered source pixels (bilinear when upscaling)
+        BILINEAR  // Interpolation between the nearest two source pixels per axis
+    };
+
+    ScreenPreprocessing() :
+        crop_top(0), crop_left(0), crop_height(0), crop_width(0),
+        output_height(84), output_width(84),
+        grayscale(true), max_pool(false), interpolation(AREA) {}
+
+    /** Region of the screen to keep; a zero height or width extends the region
+        to the bottom or right edge of the screen. */
+    int crop_top;
+    int crop_left;
+    int crop_height;
+    int crop_width;
+
+    /** Dimensions of the resulting observation. */
+    int output_height;
+    int output_width;
+
+    /** Whether to produce one luminance channel rather than interleaved RGB. */
+    bool grayscale;
+
+    /** Whether each channel is the maximum over the last two frames. */
+    bool max_pool;
+
+    Interpolation interpolation;
+};
+
+
+// A read-only view of the stacked observations of an environment. Frame i of
+// the stack (oldest first) starts at base + offset + i * frame_size; all depth
+// frames are contiguous. The view is valid until the next act(), resetGame() or
+// change of configuration.
+struct FrameStackView {
+    const uint8_t *base;
+    size_t offset;
+    size_t frame_size;
+    int depth;
+
+    const uint8_t *frame(int i) const { return base + offset + i * frame_size; }
+};
+
+
+// The outcome of ALEInterface::rollout().
+struct RolloutResult {
+    reward_t reward;           // Sum of the rewards
+    double discounted_reward;  // Sum of the reward of each action times discount^index
+    int steps;                 // Number of actions applied
+    int frames;                // Number of frames emulated
+    bool terminal;             // Whether the rollout stopped at the end of the episode
+};
+
+
+// Counts kept by the fast processor while skipping idle loops (settings cpu=fast and
+// idle_loop_skip=true). All zero with the other processors.
+struct IdleLoopStats {
+    uint64_t instructions;          // Instructions emulated, the skipped ones included
+    uint64_t skipped_instructions;  // Instructions accounted for without running them
+    uint64_t skipped_cycles;        // CPU cycles accounted for without running them
+    uint64_t skips;                 // Number of times a loop was fast-forwarded
+};
+
+
 // This class provides a simplified interface to ALE.
 class ALEInterface {
 
     public:
 
-        /** create an ALEInterface. This routine is not threadsafe! 
+        /** create an ALEInterface. Instances share no mutable state, so they may be
+            created and used on different threads (each by one thread at a time).
             One also has the option of creating a single Atari session
             that will randomly (uniform) alternate between a number of
             different ROM files. The syntax is:  
@@ -197,9 +269,79 @@ class ALEInterface {
 
         /** Applies an action to the game and returns the reward. It is the user's responsibility
             to check if the game has ended and reset when necessary - this method will keep pressing
-            buttons on the game over screen. */
+            buttons on the game over screen. With frame skipping, the action is repeated and the
+            summed reward is returned. */
         reward_t act(Action action);
 
+        /** Applies up to 'n' actions as act() would, stopping early if the game ends, and
+            writes the outcome to 'result'. The screen, RAM and frame stack are only updated
+            once, at the end; the screen is only drawn when 'render' is set, and then only
+            the frames observed after the last action, or after the action during which the
+            game ended. */
+        void rollout(const Action *actions, size_t n, RolloutResult *result,
+                     double discount = 1.0, bool render = false);
+
+        /** Restores a compact snapshot (see restoreFrom()) and performs a rollout from it. */
+        void rolloutFrom(const void *snapshot, size_t size, const Action *actions, size_t n,
+                         RolloutResult *result, double discount = 1.0, bool render = false);
+
+        /** Sets the number of frames each action is repeated for (default 1). Repetition stops
+            early if the game ends. Only the last frame is processed into the screen and RAM. */
+        void setFrameSkip(int frame_skip);
+
+        /** Sets the probability, per emulated frame, that the previous action is applied instead
+            of the requested one (default 0). */
+        void setRepeatActionProbability(float probability);
+
+        /** When enabled, the screen holds the per-pixel brightest of the last two frames. */
+        void setMaxPoolFrames(bool max_pool);
+
+        /** Reseeds the random number stream of this instance, which draws sticky actions
+            and stochastic starts. Each instance has its own stream, so a seeded instance
+            behaves the same whichever thread runs it. The streams come from std::mt19937;
+            runs with a given seed do not repeat those of versions that used the shared
+            generators (rand() and Stella's LCG). */
+        void setRandomSeed(uint32_t seed);
+
+        /** Enables or disables drawing the screen (default enabled). Emulation is unaffected,
+            but getScreen() is no longer updated; use this when only the RAM is observed. */
+        void setScreenRendering(bool render);
+
+        /** When enabled (the default), the emulator state reached by resetGame() is computed
+            once and restored on later resets; with use_environment_distribution, all the
+            random start states are precomputed on the first reset. Disable it to emulate
+            every reset from scratch. */
+        void setCacheResetStates(bool cache);
+
+        /** Looks the outcome of act() up in a shared cache of transitions, and stores the
+            outcomes it has to emulate. The cache is only used when act() is fully determined
+            by the emulator state, i.e. with screen rendering disabled (cached transitions hold
+            no screen), no sticky actions, and away from the episode frame limit. The cache
+            is not owned and must outlive its use; NULL (the default) disables it. */
+        void setTransitionCache(TransitionCache *cache);
+
+        /** When enabled, snapshots from serializeInto() and getSnapshot() also hold the last
+            two frames, so that getScreen() and the observations are valid right after a
+            restore without emulating another frame. This adds a few kilobytes per snapshot,
+            and their size then varies. Disabled by default. */
+        void setSnapshotScreens(bool include);
+
+        /** Keeps a history of at least the last 'max_frames' emulated frames for rewind(): a
+            compact snapshot every 'interval' frames (most of them stored as deltas) and the
+            actions applied in between, in a ring of bounded size. 0 frames (the default)
+            disables it. Resets and restored states start a new history. */
+        void setRewindBuffer(int max_frames, int interval = 60);
+
+        /** Returns to the state of 'frames' emulated frames ago (e.g. steps x frame skip) by
+            restoring the latest snapshot before it and replaying the recorded actions. The
+            history after that frame is dropped. Returns false, changing nothing, if the
+            history does not go back that far. */
+        bool rewind(int frames);
+
+        /** Number of frames rewind() can currently go back. The oldest one or two recorded
+            frames are not counted, as they are replayed to draw the screen of the target. */
+        int rewindableFrames() const;
+
         /** Returns the vector of legal actions. */
         ActionVect getLegalActionSet();
 
@@ -227,6 +369,39 @@ class ALEInterface {
         /** Returns a handle to the current game screen. */
         const ALEScreen &getScreen() const;
 
+        /** Writes the current screen into a caller-provided buffer without any intermediate
+            copy. getScreenPalette() writes height x width palette indices (as getScreen()),
+            getScreenRGB() height x width x 3 interleaved RGB values and getScreenGrayscale()
+            height x width luminance values. */
+        void getScreenPalette(uint8_t *buffer) const;
+        void getScreenRGB(uint8_t *buffer) const;
+        void getScreenGrayscale(uint8_t *buffer) const;
+
+        /** Sets how getPreprocessedScreen() crops, converts and resizes the screen. */
+        void setScreenPreprocessing(const ScreenPreprocessing &config);
+
+        /** Size in bytes of a preprocessed screen. */
+        size_t preprocessedScreenSize() const;
+
+        /** Writes the current screen, preprocessed, into a caller-provided buffer of
+            preprocessedScreenSize() bytes (rows x columns x channels). */
+        void getPreprocessedScreen(uint8_t *buffer) const;
+
+        /** Keeps the last 'depth' preprocessed screens, updated by every act(); 0 (the
+            default) disables stacking. After resetGame() the stack holds copies of the
+            first screen of the episode. */
+        void setFrameStacking(int depth);
+
+        /** Size in bytes of the stacked observation (depth x preprocessedScreenSize()). */
+        size_t stackedObservationSize() const;
+
+        /** Returns the stacked observation without copying it. */
+        FrameStackView getStackedObservationView() const;
+
+        /** Copies the stacked observation, oldest frame first, into a caller-provided
+            buffer of stackedObservationSize() bytes. */
+        void getStackedObservation(uint8_t *buffer) const;
+
         /** Writes the screen out to a PNG. */
         bool screenToPNG(const std::string &filename);
 
@@ -242,12 +417,40 @@ class ALEInterface {
             to the emulator system). */
         bool loadState();
 
-        /** Gets a state as a string. */
+        /** Gets a state as a string, in the compact snapshot format of serializeInto(). */
         std::string getSnapshot() const;
 
-        /** Sets the state from a string*/
+        /** Sets the state from a string returned by getSnapshot(), in either the compact
+            format or the older one. Throws std::invalid_argument, leaving the emulator as it
+            was, if the snapshot is corrupt. */
         void restoreSnapshot(const std::string& snapshot);
 
+        /** Size in bytes of a compact snapshot of the current state. It only depends on the
+            ROM, so buffers can be sized once. With setSnapshotScreens(), it is the largest
+            size a snapshot may take, as the screens are compressed. */
+        size_t snapshotSize() const;
+
+        /** Writes a compact snapshot into a caller-provided buffer and returns its size. The
+            snapshot holds a versioned header identifying the ROM, followed by the packed
+            emulator state. Throws std::invalid_argument if the buffer is too small. */
+        size_t serializeInto(void *buffer, size_t size) const;
+
+        /** Restores the state from a compact snapshot. Throws std::invalid_argument if the
+            snapshot is malformed or was taken with a different ROM, and then leaves the
+            emulator as it was. */
+        void restoreFrom(const void *buffer, size_t size);
+
+        /** Returns a 64-bit hash of the emulator state (RAM, CPU, TIA, cartridge banks and
+            RAM, and the game's score and terminal flags). Equal states hash the same
+            whatever their frame number, and different states collide with negligible
+            probability, so the hash can key transposition tables and novelty archives.
+            Hashes only compare within a ROM and library version. */
+        uint64_t stateHash() const;
+
+        /** Returns how much emulation idle loop skipping saved since the ROM was loaded;
+            skipped_instructions / instructions is the game's hit rate. */
+        IdleLoopStats idleLoopStats() const;
+
         /** OSystem accessor. */
         const OSystem &osystem() const;
         
@@ -272,6 +475,346 @@ class ALEInterface {
         /** Assignment is explicitly disallowed. */
         ALEInterface &operator=(const ALEInterface &);
 
+        // Batches share steps between their instances
+        friend class VectorALE;
+
+        class Impl;
+        Impl *m_pimpl;
+};
+
+
+// Steps a batch of independent emulators running the same ROM in parallel.
+// Per-environment outputs are written into caller-provided contiguous arrays.
+class VectorALE {
+
+    public:
+
+        /** Creates num_envs emulators for the given ROM. Work is spread over
+            num_threads threads, counting the calling thread; '0' uses one
+            thread per hardware core. */
+        VectorALE(const std::string &rom_file, size_t num_envs, size_t num_threads = 0);
+
+        /** Unloads all emulators and stops the worker threads. */
+        ~VectorALE();
+
+        /** Returns the number of environments in the batch. */
+        size_t numEnvironments() const;
+
+        /** Screen dimensions shared by all environments. */
+        int screenHeight() const;
+        int screenWidth() const;
+
+        /** Size of the RAM of each environment, in bytes. */
+        size_t ramSize() const;
+
+        /** When enabled, an environment whose episode ended on the previous call
+            to step() is reset before its next action is applied. The terminal
+            flag and screen of the final frame are thus always reported once. */
+        void setAutoReset(bool auto_reset);
+
+        /** Experimental. When enabled, step() emulates each group of environments that are
+            in the same emulator state (as told by ALEInterface::stateHash()), show the same
+            frames and take the same action only once; the others of the group restore the
+            successor state and copy the screen instead. Their outputs are the same as if
+            each had been emulated. Comparing the frames costs a hash of the two frame
+            buffers per environment and step.
+            Environments split from their group as soon as their actions or states differ,
+            and join one again whenever they match. This pays off when many environments
+            follow the same trajectory, e.g. from a common start state under a deterministic
+            policy. Environments with sticky actions, at the episode frame limit, or with a
+            display are always emulated on their own. Whole steps are shared rather than
+            emulating the environments side by side with SIMD: the TIA is touched by nearly
+            every instruction, so such lanes would diverge almost at once. Disabled by default. */
+        void setLockstep(bool lockstep);
+
+        /** Reseeds every environment; environment i receives its own stream derived
+            from the seed and i. */
+        void setRandomSeed(uint32_t seed);
+
+        /** Resets a single environment. */
+        void resetGame(size_t index);
+
+        /** Resets all environments. */
+        void resetAll();
+
+        /** Preprocesses the screens returned by step() and getObservations() (see
+            ALEInterface::getPreprocessedScreen); until then they are raw screens. */
+        void setScreenPreprocessing(const ScreenPreprocessing &config);
+
+        /** Returns step() and getObservations() to raw screens. */
+        void clearScreenPreprocessing();
+
+        /** Size in bytes of the observation of each environment: height x width for raw
+            screens, or the preprocessed size. */
+        size_t observationSize() const;
+
+        /** Applies actions[i] to environment i for every environment, in parallel.
+            Results go to rewards (N entries), terminals (N entries), screens
+            (N x observationSize() bytes) and ram (N x ramSize() bytes); any of the
+            output arrays may be NULL if it is not needed. */
+        void step(const Action *actions, reward_t *rewards, unsigned char *terminals,
+                  pixel_t *screens, byte_t *ram);
+
+        /** Copies the current screens into an N x height x width array. */
+        void getScreens(pixel_t *screens) const;
+
+        /** Writes the current observations, as returned by step(), into an
+            N x observationSize() array. */
+        void getObservations(uint8_t *observations) const;
+
+        /** Enables frame stacking of the given depth in every environment (see
+            ALEInterface::setFrameStacking). */
+        void setFrameStacking(int depth);
+
+        /** Copies the stacked observations into an N x stacked observation size array. */
+        void getStackedObservations(uint8_t *observations) const;
+
+        /** Converts the current screens into an N x height x width x 3 RGB array or an
+            N x height x width grayscale array. */
+        void getScreensRGB(uint8_t *screens) const;
+        void getScreensGrayscale(uint8_t *screens) const;
+
+        /** Copies the current RAM contents into an N x ramSize() array. */
+        void getRAMs(byte_t *ram) const;
+
+        /** Upper bound on the bytes snapshotAll() writes. */
+        size_t snapshotArenaSize() const;
+
+        /** Saves every environment, in parallel, as compact snapshots (see
+            ALEInterface::serializeInto()) laid end to end in 'arena'. Snapshot i takes up
+            bytes offsets[i] to offsets[i + 1], so 'offsets' needs N + 1 entries; returns the
+            total size. Throws std::invalid_argument if the arena is too small. */
+        size_t snapshotAll(void *arena, size_t size, size_t *offsets) const;
+
+        /** Restores every environment, in parallel, from an arena filled by snapshotAll(). */
+        void restoreAll(const void *arena, const size_t *offsets);
+
+        /** Restores every environment, in parallel, to the same snapshot. */
+        void broadcast(const void *snapshot, size_t size);
+
+        /** Copies the state of one environment to all the others. */
+        void broadcastFrom(size_t index);
+
+        /** Access to an individual environment. */
+        ALEInterface &environment(size_t index);
+        const ALEInterface &environment(size_t index) const;
+
+    private:
+
+        /** Copying is explicitly disallowed. */
+        VectorALE(const VectorALE &);
+
+        /** Assignment is explicitly disallowed. */
+        VectorALE &operator=(const VectorALE &);
+
+        class Impl;
+        Impl *m_pimpl;
+};
+
+
+// The bytes of a compact snapshot (see ALEInterface::serializeInto()) that differ from
+// those of a base snapshot of the same ROM. Consecutive states usually differ in a few
+// RAM bytes and registers, so deltas are a small fraction of a full snapshot.
+class StateDelta {
+
+    public:
+
+        /** Creates an empty delta, which changes nothing. */
+        StateDelta();
+
+        /** Records how 'target' differs from 'base'; both are snapshots of 'size' bytes.
+            Throws std::invalid_argument if they hold screens (see
+            ALEInterface::setSnapshotScreens()), whose size varies. */
+        StateDelta(const void *base, const void *target, size_t size);
+
+        /** Writes 'base' with the recorded changes applied into 'out', which may be 'base'
+            itself. Throws std::invalid_argument if 'size' is not that of the snapshots the
+            delta was made from. */
+        void apply(const void *base, void *out, size_t size) const;
+
+        /** Size of the snapshots the delta applies to. */
+        size_t snapshotSize() const { return m_snapshot_size; }
+
+        /** Number of bytes taken up by the encoded changes. */
+        size_t encodedSize() const { return m_runs.size(); }
+
+        /** Returns true if the delta changes nothing. */
+        bool empty() const { return m_runs.empty(); }
+
+    private:
+        size_t m_snapshot_size;
+        std::vector<uint8_t> m_runs; // Changed runs: offset gap, length and bytes
+};
+
+
+// A sequence of snapshots of the same ROM, e.g. a trajectory. Every keyframe_interval-th
+// snapshot is stored in full and the others as deltas from their predecessor, so
+// materializing a snapshot applies at most keyframe_interval - 1 deltas.
+class DeltaChain {
+
+    public:
+
+        /** Creates an empty chain; an interval of 1 stores every snapshot in full. */
+        explicit DeltaChain(size_t keyframe_interval = 32);
+
+        /** Appends a snapshot. All the snapshots of a chain must have the same size, so they
+            cannot hold screens (see ALEInterface::setSnapshotScreens()); throws
+            std::invalid_argument if they do, or if the size differs. */
+        void push(const void *snapshot, size_t size);
+
+        /** Writes the index-th snapshot into 'out', which holds 'size' bytes. */
+        void materialize(size_t index, void *out, size_t size) const;
+
+        /** Keeps the first 'length' snapshots only. */
+        void truncate(size_t length);
+
+        /** Removes all the snapshots. */
+        void clear();
+
+        /** Number of snapshots in the chain. */
+        size_t size() const { return m_offsets.size() - 1; }
+
+        /** Size of each snapshot, or 0 while the chain is empty. */
+        size_t snapshotSize() const { return m_snapshot_size; }
+
+        size_t keyframeInterval() const { return m_keyframe_interval; }
+
+        /** Number of bytes taken up by the keyframes and deltas. */
+        size_t encodedSize() const { return m_data.size(); }
+
+    private:
+        size_t m_keyframe_interval;
+        size_t m_snapshot_size;
+        std::vector<uint8_t> m_data;    // Keyframes and deltas, back to back
+        std::vector<size_t> m_offsets;  // Start of each snapshot in m_data, plus the end
+        std::vector<uint8_t> m_last;    // The last snapshot, which the next delta is taken from
+};
+
+
+// A bounded cache of emulator transitions: the compact snapshot reached from a state by
+// an action, with the reward collected on the way. Emulation is deterministic, so tree
+// searches that revisit (state, action) pairs can restore their outcome instead of
+// emulating it again. Any number of ALEInterfaces, in any threads, may share a cache.
+class TransitionCache {
+
+    public:
+
+        struct Transition {
+            reward_t reward; // Reward summed over the emulated frames
+            int frames;      // Number of frames emulated
+            bool terminal;   // Whether the game was over afterwards
+        };
+
+        /** Creates a cache of 'capacity' transitions (rounded up to sets of 8), split into
+            'num_shards' shards. Lookups take no lock: a lookup racing an insertion into the
+            same slot retries, or misses. Insertions into a shard take its lock. Each key
+            maps to a set of 8 slots, and a full set evicts the transition that was not
+            looked up lately (CLOCK). */
+        explicit TransitionCache(size_t capacity, size_t num_shards = 16);
+
+        ~TransitionCache();
+
+        /** Copies the snapshot and outcome stored under 'key' and returns true, or returns
+            false if there are none. All the snapshots of a cache must have the same size,
+            i.e. come from the same ROM; throws std::invalid_argument otherwise.
+
+            'key' and 'check' are two independent hashes of the source state and actions.
+            The key places the transition and the check must match as well, so a wrong
+            successor is only returned if two sources collide on both, i.e. 128 bits,
+            rather than on the key alone. */
+        bool lookup(uint64_t key, uint64_t check, void *snapshot, size_t size,
+                    Transition &transition);
+
+        /** Stores a transition under 'key' and 'check', replacing any previous one stored
+            under 'key'. */
+        void insert(uint64_t key, uint64_t check, const void *snapshot, size_t size,
+                    const Transition &transition);
+
+        /** Removes all the transitions; the counters are kept. */
+        void clear();
+
+        /** Maximum number of transitions held. */
+        size_t capacity() const;
+
+        /** Number of transitions held. */
+        size_t size() const;
+
+        /** Number of successful and failed lookups so far. */
+        uint64_t hits() const;
+        uint64_t misses() const;
+
+    private:
+
+        /** Copying is explicitly disallowed. */
+        TransitionCache(const TransitionCache &);
+
+        /** Assignment is explicitly disallowed. */
+        TransitionCache &operator=(const TransitionCache &);
+
+        class Impl;
+        Impl *m_pimpl;
+};
+
+
+// An archive of compact snapshots on disk, keyed by e.g. ALEInterface::stateHash(). Each
+// key is stored once, in append-only segment files within a directory, optionally zlib
+// compressed. Reads go through read-only memory maps (on Windows, records are read into
+// memory instead), so archives may be far larger than memory, and any number of processes
+// may open the same directory: records are appended atomically, and refresh() picks up
+// those written by others since. Damaged records are skipped with a warning. Like
+// ALEInterface, a store is meant to be used from one thread at a time.
+class SnapshotStore {
+
+    public:
+
+        /** Opens the store in 'directory', creating it if needed, and indexes the records
+            already there. New segments are started once they reach 'segment_size' bytes.
+            Throws std::runtime_error if the directory cannot be used. */
+        explicit SnapshotStore(const std::string &directory, bool compress = false,
+                               size_t segment_size = 256 << 20);
+
+        /** Unmaps the segments; views become invalid. */
+        ~SnapshotStore();
+
+        /** Appends a snapshot under 'key' and returns true, or returns false if the key is
+            already stored (in this process or, as of the last refresh(), another). */
+        bool put(uint64_t key, const void *snapshot, size_t size);
+
+        /** Returns true if a snapshot is stored under 'key'. */
+        bool contains(uint64_t key) const;
+
+        /** Size of the snapshot stored under 'key', or 0 if there is none. */
+        size_t snapshotSize(uint64_t key) const;
+
+        /** Copies (or decompresses) the snapshot stored under 'key' into 'buffer' and
+            returns its size, or returns 0 if there is none. Throws std::invalid_argument
+            if the buffer is too small, and std::runtime_error if the record is corrupt. */
+        size_t get(uint64_t key, void *buffer, size_t size) const;
+
+        /** Returns the snapshot stored under 'key' in place, e.g. for restoreFrom(), and sets
+            'size'; NULL if there is none. Compressed snapshots cannot be read in place, so
+            with compression this always returns NULL: use get() instead. The memory stays
+            valid while the store is open. */
+        const void *view(uint64_t key, size_t &size) const;
+
+        /** Indexes the records appended by other processes since the last call; returns
+            how many new snapshots they held. */
+        size_t refresh();
+
+        /** Number of snapshots stored. */
+        size_t size() const;
+
+        /** Waits for the appended records to reach the disk. */
+        void sync();
+
+    private:
+
+        /** Copying is explicitly disallowed. */
+        SnapshotStore(const SnapshotStore &);
+
+        /** Assignment is explicitly disallowed. */
+        SnapshotStore &operator=(const SnapshotStore &);
+
         class Impl;
         Impl *m_pimpl;
 };
@@ -0,0 +1,94 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  state_benchmark.cpp
+ *
+ *  Measures how fast emulator states are cloned and restored, through the
+ *  state stack, which holds raw states, string snapshots and compact snapshots
+ *  in caller buffers.
+ *
+ *  Usage: state_benchmark [iterations] [rom]
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "tests/test_support.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+void report(const char *name, Clock::time_point start, int iterations) {
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  printf("%-28s %8.3f us\n", name, seconds * 1e6 / iterations);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+  test::TempDir dir;
+  std::string rom = argc > 2 ? argv[2] : dir.write("pong.bin", test::gameRom());
+
+  ALEInterface ale(rom);
+  ale.setRandomSeed(0);
+  ale.resetGame();
+
+  // Clone a state from the middle of an episode
+  ActionVect actions = ale.getMinimalActionSet();
+  std::mt19937 rng(0);
+  for (int i = 0; i < 1000 && !ale.gameOver(); i++) ale.act(actions[rng() % actions.size()]);
+
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < iterations; i++) ale.saveState();
+  report("saveState", start, iterations);
+
+  start = Clock::now();
+  for (int i = 0; i < iterations; i++) ale.loadState();
+  report("loadState", start, iterations);
+
+  std::string snapshot;
+  start = Clock::now();
+  for (int i = 0; i < iterations; i++) snapshot = ale.getSnapshot();
+  report("getSnapshot", start, iterations);
+
+  start = Clock::now();
+  for (int i = 0; i < iterations; i++) ale.restoreSnapshot(snapshot);
+  report("restoreSnapshot", start, iterations);
+
+  std::vector<char> buffer(ale.snapshotSize());
+  size_t size = 0;
+  start = Clock::now();
+  for (int i = 0; i < iterations; i++) size = ale.serializeInto(&buffer[0], buffer.size());
+  report("serializeInto", start, iterations);
+
+  start = Clock::now();
+  for (int i = 0; i < iterations; i++) ale.restoreFrom(&buffer[0], size);
+  report("restoreFrom", start, iterations);
+
+  printf("snapshot sizes: %zu bytes (string), %zu bytes (compact)\n", snapshot.size(), size);
+  return 0;
+}
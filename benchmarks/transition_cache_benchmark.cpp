@@ -0,0 +1,123 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  transition_cache_benchmark.cpp
+ *
+ *  Measures transition cache lookups and insertions, alone and with reader
+ *  threads running alongside an inserting thread.
+ *
+ *  Usage: transition_cache_benchmark [reader threads] [snapshot size]
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t CAPACITY = 1 << 16;
+const int OPERATIONS = 1000000;
+
+double elapsed(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+uint64_t keyOf(uint64_t i) { return i * 0x9E3779B97F4A7C15ULL; }
+
+// The second hash of a source, which lookups compare after the key
+uint64_t checkOf(uint64_t key) { return ~key; }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t readers = argc > 1 ? atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+  size_t size = argc > 2 ? atoi(argv[2]) : 443;
+
+  TransitionCache cache(CAPACITY);
+  std::vector<char> snapshot(size, 1);
+  TransitionCache::Transition transition = {0, 4, false};
+
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < OPERATIONS; i++) {
+    uint64_t key = keyOf(i % CAPACITY);
+    cache.insert(key, checkOf(key), &snapshot[0], size, transition);
+  }
+  printf("insert               %8.1f ns\n", elapsed(start) * 1e9 / OPERATIONS);
+
+  // Look up keys of a smaller set, which all fit
+  std::mt19937 rng(0);
+  start = Clock::now();
+  for (int i = 0; i < OPERATIONS; i++) {
+    uint64_t key = keyOf(rng() % (CAPACITY / 2));
+    cache.lookup(key, checkOf(key), &snapshot[0], size, transition);
+  }
+  printf("lookup (hit)         %8.1f ns\n", elapsed(start) * 1e9 / OPERATIONS);
+
+  start = Clock::now();
+  for (int i = 0; i < OPERATIONS; i++) {
+    uint64_t key = keyOf(CAPACITY * 4 + i);
+    cache.lookup(key, checkOf(key), &snapshot[0], size, transition);
+  }
+  printf("lookup (miss)        %8.1f ns\n", elapsed(start) * 1e9 / OPERATIONS);
+
+  // Readers look up while one thread keeps inserting
+  std::atomic<bool> done(false);
+  std::atomic<uint64_t> lookups(0);
+  std::vector<std::thread> threads;
+  for (size_t r = 0; r < readers; r++) {
+    threads.push_back(std::thread([&, r]() {
+      std::vector<char> out(size);
+      TransitionCache::Transition found;
+      std::mt19937 thread_rng(static_cast<unsigned>(r));
+      uint64_t count = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        uint64_t key = keyOf(thread_rng() % CAPACITY);
+        cache.lookup(key, checkOf(key), &out[0], size, found);
+        count++;
+      }
+      lookups += count;
+    }));
+  }
+
+  start = Clock::now();
+  uint64_t inserts = 0;
+  while (elapsed(start) < 1.0) {
+    for (int i = 0; i < 1000; i++, inserts++) {
+      uint64_t key = keyOf(inserts % CAPACITY);
+      cache.insert(key, checkOf(key), &snapshot[0], size, transition);
+    }
+  }
+  done = true;
+  for (size_t r = 0; r < threads.size(); r++) threads[r].join();
+  double seconds = elapsed(start);
+
+  printf("%zu readers + 1 writer: %.2f M lookups/s, %.2f M inserts/s\n", readers,
+         lookups / seconds / 1e6, inserts / seconds / 1e6);
+  return 0;
+}
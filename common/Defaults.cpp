@@ -37,6 +37,8 @@ namespace ale {
 void setDefaultSettings(Settings &settings) {
     // General settings
     settings.setString("random_seed", "time");
+    settings.setString("cpu", "low");
+    settings.setBool("idle_loop_skip", false);
 
     // Controller settings
     settings.setString("game_controller", "internal");
@@ -54,8 +56,17 @@ void setDefaultSettings(Settings &settings) {
     settings.setBool("restricted_action_set", false);
     settings.setBool("use_starting_actions", true);
     settings.setBool("use_environment_distribution", false);
+    settings.setBool("cache_reset_states", true);
     settings.setString("random_seed", "time");
     settings.setBool("disable_color_averaging", false);
+    settings.setInt("frame_skip", 1);
+    settings.setFloat("repeat_action_probability", 0.0f);
+    settings.setBool("max_pool_frames", false);
+    settings.setBool("render_screen", true);
+    settings.setBool("render_skipped_frames", false);
+    settings.setBool("snapshot_screens", false);
+    settings.setInt("rewind_frames", 0);
+    settings.setInt("rewind_interval", 60);
 
     // Display Settings
     settings.setBool("display_screen", false);
@@ -47,7 +47,7 @@ SoundNull::~SoundNull()
 bool SoundNull::load(Deserializer& in)
 {
   std::string soundDevice = "TIASound";
-  if(in.getString() != soundDevice)
+  if(!in.expectString(soundDevice))
     return false;
 
   uInt8 reg;
@@ -437,7 +437,7 @@ bool SoundSDL::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != device)
+    if(!in.expectString(device))
       return false;
 
     uInt8 reg1 = 0, reg2 = 0, reg3 = 0, reg4 = 0, reg5 = 0, reg6 = 0;
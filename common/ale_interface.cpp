@@ -2,6 +2,7 @@
 
 #include "emucore/FSNode.hxx"
 #include "emucore/OSystem.hxx"
+#include "emucore/m6502/src/M6502Fast.hxx"
 #include "os_dependent/SettingsWin32.hxx"
 #include "os_dependent/OSystemWin32.hxx"
 #include "os_dependent/SettingsUNIX.hxx"
@@ -11,6 +12,7 @@
 #include "common/display_screen.h"
 #include "environment/stella_environment.hpp"
 #include "games/RomSettings.hpp"
+#include "common/thread_pool.hpp"
 
 #include <stdexcept>
 #include <cstring>
@@ -19,6 +21,7 @@
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <random>
 
 
 namespace ale {
@@ -83,15 +86,6 @@ void createOSystem(
       throw std::runtime_error("unknown error");
     }
 
-    // seed random number generator
-    if (theOSystem->settings().getString("random_seed") == "time") {
-      srand((unsigned)time(0));
-    } else {
-      int seed = theOSystem->settings().getInt("random_seed");
-      assert(seed >= 0);
-      srand((unsigned)seed);
-    }
-
     theOSystem->console().setPalette("standard");
 }
 
@@ -148,7 +142,7 @@ class ALEInterface::Impl {
 
     public:
 
-        // create an ALEInterface. This routine is not threadsafe!
+        // create an ALEInterface
         Impl(const std::string &rom_file);
         ~Impl();
 
@@ -163,6 +157,33 @@ class ALEInterface::Impl {
         // buttons on the game over screen.
         reward_t act(Action action);
 
+        // Applies a sequence of actions, observing only the end
+        void rollout(const Action *actions, size_t n, RolloutResult *result,
+                     double discount, bool render);
+
+        // Action repeat, sticky actions and max-pooling configuration
+        void setFrameSkip(int frame_skip);
+        void setRepeatActionProbability(float probability);
+        void setMaxPoolFrames(bool max_pool);
+        void setScreenRendering(bool render);
+
+        // Enables or disables restoring cached start states on reset
+        void setCacheResetStates(bool cache);
+
+        // Sets the cache of transitions consulted by act()
+        void setTransitionCache(TransitionCache *cache);
+
+        // Whether snapshots include the frame buffers
+        void setSnapshotScreens(bool include);
+
+        // History of recent states
+        void setRewindBuffer(int max_frames, int interval);
+        bool rewind(int frames);
+        int rewindableFrames() const;
+
+        // Reseeds the random number stream of the environment
+        void setRandomSeed(uint32_t seed);
+
         // Returns the vector of legal actions.
         ActionVect getLegalActionSet();
 
@@ -190,6 +211,22 @@ class ALEInterface::Impl {
         // Returns the current game screen
         const ALEScreen &getScreen() const;
 
+        // Writes the current game screen into a caller-provided buffer
+        void getScreenPalette(uint8_t *buffer) const;
+        void getScreenRGB(uint8_t *buffer) const;
+        void getScreenGrayscale(uint8_t *buffer) const;
+
+        // Preprocessed screen configuration and access
+        void setScreenPreprocessing(const ScreenPreprocessing &config);
+        size_t preprocessedScreenSize() const;
+        void getPreprocessedScreen(uint8_t *buffer) const;
+
+        // Frame stacking configuration and access
+        void setFrameStacking(int depth);
+        size_t stackedObservationSize() const;
+        FrameStackView getStackedObservationView() const;
+        void getStackedObservation(uint8_t *buffer) const;
+
         // Writes a screen out to PNG
         bool screenToPNG(const std::string &filename);
 
@@ -208,6 +245,22 @@ class ALEInterface::Impl {
         // restores state from a string
         void restoreSnapshot(const std::string& snapshot);
 
+        // Compact snapshots in caller-provided memory
+        size_t snapshotSize() const;
+        size_t serializeInto(void *buffer, size_t size) const;
+        void restoreFrom(const void *buffer, size_t size);
+
+        // Hashes the current state
+        ::uint64_t stateHash() const;
+
+        // Steps shared by instances in the same state (see VectorALE::setLockstep())
+        bool lockstepKey(Action action, unsigned long long &key) const;
+        void followStep(const Impl &leader, const void *snapshot, size_t size, int frames);
+        size_t serializeEmulatorInto(void *buffer, size_t size) const;
+
+        // Counts of the fast processor's idle loop skipping
+        IdleLoopStats idleLoopStats() const;
+
         // accessors
         const OSystem &osystem() const;
         const Settings &settings() const;
@@ -234,8 +287,8 @@ class ALEInterface::Impl {
         // Loads and initializes a game. After this call the game should be ready to play.
         void loadROM(const std::string &rom_file);
 
-        std::auto_ptr<Emulator> m_emu;
-        std::auto_ptr<RomSettings> m_rom_settings;
+        std::unique_ptr<Emulator> m_emu;
+        std::unique_ptr<RomSettings> m_rom_settings;
 
         reward_t m_episode_score; // Score accumulated throughout the course of an episode
         bool m_display_active;    // Should the screen be displayed or not
@@ -313,19 +366,79 @@ void ALEInterface::Impl::saveState() {
 
 std::string ALEInterface::Impl::getSnapshot() const{
 
-    const ALEState* state = m_emu->environment->cloneState();
-    std::string snapshot = state->getStateAsString();
-    m_emu->environment->destroyState(state);
+    std::string snapshot(snapshotSize(), '\0');
+    snapshot.resize(serializeInto(&snapshot[0], snapshot.size()));
     return snapshot;
 }
 
 void ALEInterface::Impl::restoreSnapshot(const std::string &snapshot) {
 
+    if (ALEState::isSnapshot(snapshot.data(), snapshot.size())) {
+        restoreFrom(snapshot.data(), snapshot.size());
+        return;
+    }
+
+    // Snapshots from before the compact format
     ALEState state(snapshot);
 
     m_emu->environment->restoreState(state);
 }
 
+size_t ALEInterface::Impl::snapshotSize() const {
+
+    return m_emu->environment->snapshotSize();
+}
+
+size_t ALEInterface::Impl::serializeInto(void *buffer, size_t size) const {
+
+    return m_emu->environment->serializeInto(buffer, size);
+}
+
+void ALEInterface::Impl::restoreFrom(const void *buffer, size_t size) {
+
+    m_emu->environment->restoreFrom(buffer, size);
+}
+
+::uint64_t ALEInterface::Impl::stateHash() const {
+
+    return m_emu->environment->stateHash();
+}
+
+bool ALEInterface::Impl::lockstepKey(Action action, unsigned long long &key) const {
+
+    // Displayed steps are drawn by each instance
+    return !m_display_active && m_emu->environment->lockstepKey(action, key);
+}
+
+void ALEInterface::Impl::followStep(const Impl &leader, const void *snapshot, size_t size,
+                                    int frames) {
+
+    m_emu->environment->followStep(*leader.m_emu->environment, snapshot, size, frames);
+}
+
+size_t ALEInterface::Impl::serializeEmulatorInto(void *buffer, size_t size) const {
+
+    return m_emu->environment->serializeEmulatorInto(buffer, size);
+}
+
+
+IdleLoopStats ALEInterface::Impl::idleLoopStats() const {
+
+    IdleLoopStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    const M6502Fast *cpu = dynamic_cast<const M6502Fast *>(
+        &m_emu->osystem->console().system().m6502());
+    if (cpu != NULL) {
+        const M6502Fast::IdleLoopStatistics &counts = cpu->idleLoopStatistics();
+        stats.instructions = counts.instructions;
+        stats.skipped_instructions = counts.skippedInstructions;
+        stats.skipped_cycles = counts.skippedCycles;
+        stats.skips = counts.skips;
+    }
+    return stats;
+}
+
 
 const ALERAM &ALEInterface::Impl::getRAM() const {
     return m_emu->environment->getRAM();
@@ -337,6 +450,63 @@ const ALEScreen &ALEInterface::Impl::getScreen() const {
 }
 
 
+void ALEInterface::Impl::getScreenPalette(uint8_t *buffer) const {
+    m_emu->environment->getScreenPalette(buffer);
+}
+
+
+void ALEInterface::Impl::getScreenRGB(uint8_t *buffer) const {
+    m_emu->environment->getScreenRGB(buffer);
+}
+
+
+void ALEInterface::Impl::getScreenGrayscale(uint8_t *buffer) const {
+    m_emu->environment->getScreenGrayscale(buffer);
+}
+
+
+void ALEInterface::Impl::setScreenPreprocessing(const ScreenPreprocessing &config) {
+    m_emu->environment->setScreenPreprocessing(config);
+}
+
+
+size_t ALEInterface::Impl::preprocessedScreenSize() const {
+    return m_emu->environment->preprocessedScreenSize();
+}
+
+
+void ALEInterface::Impl::getPreprocessedScreen(uint8_t *buffer) const {
+    m_emu->environment->getPreprocessedScreen(buffer);
+}
+
+
+void ALEInterface::Impl::setFrameStacking(int depth) {
+    m_emu->environment->setFrameStackDepth(depth);
+}
+
+
+size_t ALEInterface::Impl::stackedObservationSize() const {
+    return m_emu->environment->getFrameStack().size();
+}
+
+
+FrameStackView ALEInterface::Impl::getStackedObservationView() const {
+    const FrameStack &stack = m_emu->environment->getFrameStack();
+
+    FrameStackView view;
+    view.base = stack.base();
+    view.offset = stack.offset();
+    view.frame_size = stack.frameSize();
+    view.depth = stack.depth();
+    return view;
+}
+
+
+void ALEInterface::Impl::getStackedObservation(uint8_t *buffer) const {
+    m_emu->environment->getFrameStack().copyTo(buffer);
+}
+
+
 void ALEInterface::Impl::setMaxNumFrames(int newMax) {
     m_max_num_frames = newMax;
 }
@@ -384,12 +554,8 @@ int ALEInterface::Impl::lives() const {
 
 reward_t ALEInterface::Impl::act(Action action) {
 
-    m_emu->environment->act(action, PLAYER_B_NOOP);
-    reward_t reward = m_rom_settings->getReward();
-
-    // sanity check rewards
-    assert(reward <= m_rom_settings->maxReward());
-    assert(reward >= m_rom_settings->minReward());
+    // the environment sanity checks the reward of every emulated frame
+    reward_t reward = m_emu->environment->act(action, PLAYER_B_NOOP);
 
     if (m_display_active)
         m_emu->osystem->p_display_screen->display_screen(m_emu->osystem->console().mediaSource());
@@ -398,6 +564,82 @@ reward_t ALEInterface::Impl::act(Action action) {
 }
 
 
+void ALEInterface::Impl::rollout(const Action *actions, size_t n, RolloutResult *result,
+                                 double discount, bool render) {
+
+    m_emu->environment->rollout(actions, n, *result, discount, render);
+
+    if (m_display_active)
+        m_emu->osystem->p_display_screen->display_screen(m_emu->osystem->console().mediaSource());
+}
+
+
+void ALEInterface::Impl::setFrameSkip(int frame_skip) {
+
+    m_emu->environment->setFrameSkip(frame_skip);
+}
+
+
+void ALEInterface::Impl::setRepeatActionProbability(float probability) {
+
+    m_emu->environment->setRepeatActionProbability(probability);
+}
+
+
+void ALEInterface::Impl::setMaxPoolFrames(bool max_pool) {
+
+    m_emu->environment->setMaxPoolFrames(max_pool);
+}
+
+
+void ALEInterface::Impl::setRandomSeed(uint32_t seed) {
+
+    m_emu->environment->setRandomSeed(seed);
+}
+
+
+void ALEInterface::Impl::setScreenRendering(bool render) {
+
+    m_emu->environment->setScreenRendering(render);
+}
+
+
+void ALEInterface::Impl::setCacheResetStates(bool cache) {
+
+    m_emu->environment->setCacheResetStates(cache);
+}
+
+
+void ALEInterface::Impl::setTransitionCache(TransitionCache *cache) {
+
+    m_emu->environment->setTransitionCache(cache);
+}
+
+
+void ALEInterface::Impl::setSnapshotScreens(bool include) {
+
+    m_emu->environment->setSnapshotScreens(include);
+}
+
+
+void ALEInterface::Impl::setRewindBuffer(int max_frames, int interval) {
+
+    m_emu->environment->setRewindBuffer(max_frames, interval);
+}
+
+
+bool ALEInterface::Impl::rewind(int frames) {
+
+    return m_emu->environment->rewind(frames);
+}
+
+
+int ALEInterface::Impl::rewindableFrames() const {
+
+    return m_emu->environment->rewindableFrames();
+}
+
+
 ALEInterface::Impl::Impl(const std::string &rom_file) :
     m_episode_score(0),
     m_display_active(false)
@@ -487,6 +729,30 @@ void ALEInterface::restoreSnapshot(const std::string& snapshot) {
     m_pimpl->restoreSnapshot(snapshot);
 }
 
+
+size_t ALEInterface::snapshotSize() const {
+    return m_pimpl->snapshotSize();
+}
+
+
+size_t ALEInterface::serializeInto(void *buffer, size_t size) const {
+    return m_pimpl->serializeInto(buffer, size);
+}
+
+
+void ALEInterface::restoreFrom(const void *buffer, size_t size) {
+    m_pimpl->restoreFrom(buffer, size);
+}
+
+
+::uint64_t ALEInterface::stateHash() const {
+    return m_pimpl->stateHash();
+}
+
+IdleLoopStats ALEInterface::idleLoopStats() const {
+    return m_pimpl->idleLoopStats();
+}
+
 const ALERAM &ALEInterface::getRAM() const {
     return m_pimpl->getRAM();
 }
@@ -497,6 +763,56 @@ const ALEScreen &ALEInterface::getScreen() const {
 }
 
 
+void ALEInterface::getScreenPalette(uint8_t *buffer) const {
+    m_pimpl->getScreenPalette(buffer);
+}
+
+
+void ALEInterface::getScreenRGB(uint8_t *buffer) const {
+    m_pimpl->getScreenRGB(buffer);
+}
+
+
+void ALEInterface::getScreenGrayscale(uint8_t *buffer) const {
+    m_pimpl->getScreenGrayscale(buffer);
+}
+
+
+void ALEInterface::setScreenPreprocessing(const ScreenPreprocessing &config) {
+    m_pimpl->setScreenPreprocessing(config);
+}
+
+
+size_t ALEInterface::preprocessedScreenSize() const {
+    return m_pimpl->preprocessedScreenSize();
+}
+
+
+void ALEInterface::getPreprocessedScreen(uint8_t *buffer) const {
+    m_pimpl->getPreprocessedScreen(buffer);
+}
+
+
+void ALEInterface::setFrameStacking(int depth) {
+    m_pimpl->setFrameStacking(depth);
+}
+
+
+size_t ALEInterface::stackedObservationSize() const {
+    return m_pimpl->stackedObservationSize();
+}
+
+
+FrameStackView ALEInterface::getStackedObservationView() const {
+    return m_pimpl->getStackedObservationView();
+}
+
+
+void ALEInterface::getStackedObservation(uint8_t *buffer) const {
+    m_pimpl->getStackedObservation(buffer);
+}
+
+
 void ALEInterface::setMaxNumFrames(int newMax) {
     m_pimpl->setMaxNumFrames(newMax);
 }
@@ -542,6 +858,74 @@ reward_t ALEInterface::act(Action action) {
 }
 
 
+void ALEInterface::rollout(const Action *actions, size_t n, RolloutResult *result,
+                           double discount, bool render) {
+    m_pimpl->rollout(actions, n, result, discount, render);
+}
+
+
+void ALEInterface::rolloutFrom(const void *snapshot, size_t size, const Action *actions,
+                               size_t n, RolloutResult *result, double discount, bool render) {
+    m_pimpl->restoreFrom(snapshot, size);
+    m_pimpl->rollout(actions, n, result, discount, render);
+}
+
+
+void ALEInterface::setFrameSkip(int frame_skip) {
+    m_pimpl->setFrameSkip(frame_skip);
+}
+
+
+void ALEInterface::setRepeatActionProbability(float probability) {
+    m_pimpl->setRepeatActionProbability(probability);
+}
+
+
+void ALEInterface::setMaxPoolFrames(bool max_pool) {
+    m_pimpl->setMaxPoolFrames(max_pool);
+}
+
+
+void ALEInterface::setRandomSeed(uint32_t seed) {
+    m_pimpl->setRandomSeed(seed);
+}
+
+
+void ALEInterface::setScreenRendering(bool render) {
+    m_pimpl->setScreenRendering(render);
+}
+
+
+void ALEInterface::setCacheResetStates(bool cache) {
+    m_pimpl->setCacheResetStates(cache);
+}
+
+
+void ALEInterface::setTransitionCache(TransitionCache *cache) {
+    m_pimpl->setTransitionCache(cache);
+}
+
+
+void ALEInterface::setSnapshotScreens(bool include) {
+    m_pimpl->setSnapshotScreens(include);
+}
+
+
+void ALEInterface::setRewindBuffer(int max_frames, int interval) {
+    m_pimpl->setRewindBuffer(max_frames, interval);
+}
+
+
+bool ALEInterface::rewind(int frames) {
+    return m_pimpl->rewind(frames);
+}
+
+
+int ALEInterface::rewindableFrames() const {
+    return m_pimpl->rewindableFrames();
+}
+
+
 ALEInterface::ALEInterface(const std::string &rom_file) :
     m_pimpl(new ALEInterface::Impl(rom_file))
 {
@@ -570,6 +954,593 @@ void ALEInterface::getVersion(int &major, int &minor) const {
     return m_pimpl->getVersion(major, minor);
 }
 
+
+/* --------------------------------------------------------------------------------------------------*/
+
+// There is no point in having more threads than environments
+static size_t poolSize(size_t num_envs, size_t num_threads) {
+
+    if (num_threads == 0)
+        num_threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+
+    return std::max<size_t>(std::min(num_threads, num_envs), 1);
+}
+
+
+class VectorALE::Impl {
+
+    public:
+
+        Impl(const std::string &rom_file, size_t num_envs, size_t num_threads);
+        ~Impl();
+
+        size_t numEnvironments() const { return m_envs.size(); }
+
+        int screenHeight() const { return m_screen_height; }
+        int screenWidth() const { return m_screen_width; }
+        size_t ramSize() const { return m_envs[0]->getRAM().size(); }
+
+        void setAutoReset(bool auto_reset) { m_auto_reset = auto_reset; }
+        void setLockstep(bool lockstep) { m_lockstep = lockstep; }
+
+        void setRandomSeed(uint32_t seed);
+
+        void setScreenPreprocessing(const ScreenPreprocessing &config);
+        void clearScreenPreprocessing() { m_preprocess = false; }
+        size_t observationSize() const;
+
+        void resetGame(size_t index);
+        void resetAll();
+
+        void step(const Action *actions, reward_t *rewards, unsigned char *terminals,
+                  pixel_t *screens, byte_t *ram);
+
+        void getScreens(pixel_t *screens) const;
+        void getObservations(uint8_t *observations) const;
+        void getScreensRGB(uint8_t *screens) const;
+        void getScreensGrayscale(uint8_t *screens) const;
+        void setFrameStacking(int depth);
+        void getStackedObservations(uint8_t *observations) const;
+        void getRAMs(byte_t *ram) const;
+
+        size_t snapshotArenaSize() const;
+        size_t snapshotAll(void *arena, size_t size, size_t *offsets) const;
+        void restoreAll(const void *arena, const size_t *offsets);
+        void broadcast(const void *snapshot, size_t size);
+        void broadcastFrom(size_t index);
+
+        ALEInterface &environment(size_t index);
+
+    private:
+
+        // Number of pixels in a single screen
+        size_t screenSize() const { return static_cast<size_t>(m_screen_height * m_screen_width); }
+
+        // Copies the screen of environment i into its slot of the batch array
+        void copyScreen(size_t index, pixel_t *screens) const;
+
+        // Writes the observation of environment i into its slot of the batch array
+        void copyObservation(size_t index, uint8_t *observations) const;
+
+        // Copies the RAM of environment i into its slot of the batch array
+        void copyRAM(size_t index, byte_t *ram) const;
+
+        // Restores environment i, noting whether it restored a finished episode
+        void restoreEnvironment(size_t index, const void *snapshot, size_t size);
+
+        // As step(), emulating each group of environments in the same state only once
+        void stepLockstep(const Action *actions, reward_t *rewards, unsigned char *terminals,
+                          pixel_t *screens, byte_t *ram);
+
+        std::vector<ALEInterface*> m_envs;
+        std::vector<unsigned char> m_needs_reset; // Episode ended on the last step
+        bool m_auto_reset;
+
+        bool m_lockstep; // Whether environments in the same state share their steps
+        std::vector<std::pair<unsigned long long, size_t> > m_lockstep_keys; // Sorted by key
+        std::vector<size_t> m_leaders;       // Environment each one takes its step from
+        std::vector<unsigned char> m_led;    // Whether others take their step from it
+        std::vector<reward_t> m_step_rewards;
+        std::vector<int> m_step_frames;
+        std::vector<size_t> m_step_sizes;    // Size of each leader's snapshot in m_snapshots
+
+        int m_screen_height;
+        int m_screen_width;
+
+        bool m_preprocess; // Whether observations are preprocessed screens
+
+        mutable std::vector<std::vector<char> > m_snapshots; // Per-environment scratch
+
+        mutable ThreadPool m_pool;
+};
+
+
+VectorALE::Impl::Impl(const std::string &rom_file, size_t num_envs, size_t num_threads) :
+    m_needs_reset(num_envs, 0),
+    m_auto_reset(false),
+    m_lockstep(false),
+    m_leaders(num_envs),
+    m_led(num_envs),
+    m_step_rewards(num_envs),
+    m_step_frames(num_envs),
+    m_step_sizes(num_envs),
+    m_preprocess(false),
+    m_pool(poolSize(num_envs, num_threads))
+{
+    if (num_envs == 0)
+        throw std::invalid_argument("VectorALE requires at least one environment");
+
+    // Emulators share no state, so they are created in parallel too
+    m_envs.assign(num_envs, NULL);
+    try {
+        m_pool.parallelFor(num_envs, [&](size_t i) {
+            m_envs[i] = new ALEInterface(rom_file);
+        });
+    }
+    catch (...) {
+        for (size_t i = 0; i < m_envs.size(); i++)
+            delete m_envs[i];
+        throw;
+    }
+
+    m_screen_height = m_envs[0]->getScreen().height();
+    m_screen_width = m_envs[0]->getScreen().width();
+}
+
+
+VectorALE::Impl::~Impl() {
+
+    for (size_t i = 0; i < m_envs.size(); i++)
+        delete m_envs[i];
+}
+
+
+void VectorALE::Impl::setRandomSeed(uint32_t seed) {
+
+    // Spread the seeds so that neighbouring environments are not correlated
+    std::seed_seq sequence = { seed };
+    std::vector<uint32_t> seeds(m_envs.size());
+    sequence.generate(seeds.begin(), seeds.end());
+
+    for (size_t i = 0; i < m_envs.size(); i++)
+        m_envs[i]->setRandomSeed(seeds[i]);
+}
+
+
+void VectorALE::Impl::resetGame(size_t index) {
+
+    environment(index).resetGame();
+    m_needs_reset[index] = 0;
+}
+
+
+void VectorALE::Impl::resetAll() {
+
+    m_pool.parallelFor(m_envs.size(), [this](size_t i) {
+        m_envs[i]->resetGame();
+        m_needs_reset[i] = 0;
+    });
+}
+
+
+void VectorALE::Impl::step(const Action *actions, reward_t *rewards, unsigned char *terminals,
+                           pixel_t *screens, byte_t *ram) {
+
+    if (m_lockstep) {
+        stepLockstep(actions, rewards, terminals, screens, ram);
+        return;
+    }
+
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        ALEInterface &env = *m_envs[i];
+
+        if (m_auto_reset && m_needs_reset[i])
+            env.resetGame();
+
+        reward_t reward = env.act(actions[i]);
+        bool terminal = env.gameOver();
+        m_needs_reset[i] = terminal;
+
+        if (rewards != NULL) rewards[i] = reward;
+        if (terminals != NULL) terminals[i] = terminal;
+        if (screens != NULL) copyObservation(i, screens);
+        if (ram != NULL) copyRAM(i, ram);
+    });
+}
+
+
+void VectorALE::Impl::stepLockstep(const Action *actions, reward_t *rewards,
+                                   unsigned char *terminals, pixel_t *screens, byte_t *ram) {
+
+    const size_t n = m_envs.size();
+    m_lockstep_keys.resize(n);
+    m_pool.parallelFor(n, [&](size_t i) {
+        if (m_auto_reset && m_needs_reset[i])
+            m_envs[i]->resetGame();
+
+        // Environments whose step depends on more than the key keep to themselves
+        unsigned long long key = 0;
+        bool shared = m_envs[i]->m_pimpl->lockstepKey(actions[i], key);
+        m_lockstep_keys[i] = std::make_pair(shared ? key : 0, shared ? i : n + i);
+    });
+
+    // The first environment of each run of equal keys leads the others
+    std::sort(m_lockstep_keys.begin(), m_lockstep_keys.end());
+    for (size_t k = 0; k < n; k++) {
+        size_t i = m_lockstep_keys[k].second;
+        if (i >= n) {
+            i -= n;
+            m_leaders[i] = i;
+        }
+        else if (k > 0 && m_lockstep_keys[k - 1].first == m_lockstep_keys[k].first &&
+                 m_lockstep_keys[k - 1].second < n)
+            m_leaders[i] = m_leaders[m_lockstep_keys[k - 1].second];
+        else
+            m_leaders[i] = i;
+        m_led[i] = 0;
+    }
+    for (size_t i = 0; i < n; i++)
+        if (m_leaders[i] != i) m_led[m_leaders[i]] = 1;
+
+    m_snapshots.resize(n);
+    m_pool.parallelFor(n, [&](size_t i) {
+        if (m_leaders[i] != i) return;
+
+        ALEInterface &env = *m_envs[i];
+        int frame_number = env.getFrameNumber();
+        m_step_rewards[i] = env.act(actions[i]);
+        m_step_frames[i] = env.getFrameNumber() - frame_number;
+
+        if (m_led[i]) {
+            std::vector<char> &buffer = m_snapshots[i];
+            buffer.resize(env.snapshotSize());
+            m_step_sizes[i] = env.m_pimpl->serializeEmulatorInto(&buffer[0], buffer.size());
+        }
+    });
+
+    m_pool.parallelFor(n, [&](size_t i) {
+        size_t leader = m_leaders[i];
+        if (leader != i) {
+            m_envs[i]->m_pimpl->followStep(*m_envs[leader]->m_pimpl, &m_snapshots[leader][0],
+                                           m_step_sizes[leader], m_step_frames[leader]);
+            m_step_rewards[i] = m_step_rewards[leader];
+        }
+    });
+
+    m_pool.parallelFor(n, [&](size_t i) {
+        bool terminal = m_envs[i]->gameOver();
+        m_needs_reset[i] = terminal;
+
+        if (rewards != NULL) rewards[i] = m_step_rewards[i];
+        if (terminals != NULL) terminals[i] = terminal;
+        if (screens != NULL) copyObservation(i, screens);
+        if (ram != NULL) copyRAM(i, ram);
+    });
+}
+
+
+void VectorALE::Impl::getScreens(pixel_t *screens) const {
+
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        copyScreen(i, screens);
+    });
+}
+
+
+void VectorALE::Impl::getObservations(uint8_t *observations) const {
+
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        copyObservation(i, observations);
+    });
+}
+
+
+void VectorALE::Impl::setScreenPreprocessing(const ScreenPreprocessing &config) {
+
+    for (size_t i = 0; i < m_envs.size(); i++)
+        m_envs[i]->setScreenPreprocessing(config);
+    m_preprocess = true;
+}
+
+
+size_t VectorALE::Impl::observationSize() const {
+
+    return m_preprocess ? m_envs[0]->preprocessedScreenSize() : screenSize();
+}
+
+
+void VectorALE::Impl::setFrameStacking(int depth) {
+
+    for (size_t i = 0; i < m_envs.size(); i++)
+        m_envs[i]->setFrameStacking(depth);
+}
+
+
+void VectorALE::Impl::getStackedObservations(uint8_t *observations) const {
+
+    const size_t stack_size = m_envs[0]->stackedObservationSize();
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        m_envs[i]->getStackedObservation(observations + i * stack_size);
+    });
+}
+
+
+void VectorALE::Impl::getScreensRGB(uint8_t *screens) const {
+
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        m_envs[i]->getScreenRGB(screens + i * screenSize() * 3);
+    });
+}
+
+
+void VectorALE::Impl::getScreensGrayscale(uint8_t *screens) const {
+
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        m_envs[i]->getScreenGrayscale(screens + i * screenSize());
+    });
+}
+
+
+void VectorALE::Impl::getRAMs(byte_t *ram) const {
+
+    for (size_t i = 0; i < m_envs.size(); i++)
+        copyRAM(i, ram);
+}
+
+
+size_t VectorALE::Impl::snapshotArenaSize() const {
+
+    size_t total = 0;
+    for (size_t i = 0; i < m_envs.size(); i++)
+        total += m_envs[i]->snapshotSize();
+    return total;
+}
+
+
+size_t VectorALE::Impl::snapshotAll(void *arena, size_t size, size_t *offsets) const {
+
+    // Snapshot sizes are only known once written, so serialize into per-environment
+    //  buffers first and then pack them into the arena
+    m_snapshots.resize(m_envs.size());
+    std::vector<size_t> sizes(m_envs.size());
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        std::vector<char> &buffer = m_snapshots[i];
+        buffer.resize(m_envs[i]->snapshotSize());
+        sizes[i] = m_envs[i]->serializeInto(&buffer[0], buffer.size());
+    });
+
+    offsets[0] = 0;
+    for (size_t i = 0; i < m_envs.size(); i++)
+        offsets[i + 1] = offsets[i] + sizes[i];
+    if (offsets[m_envs.size()] > size)
+        throw std::invalid_argument("snapshot arena is too small");
+
+    char *out = static_cast<char*>(arena);
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        memcpy(out + offsets[i], &m_snapshots[i][0], sizes[i]);
+    });
+
+    return offsets[m_envs.size()];
+}
+
+
+void VectorALE::Impl::restoreAll(const void *arena, const size_t *offsets) {
+
+    const char *in = static_cast<const char*>(arena);
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        restoreEnvironment(i, in + offsets[i], offsets[i + 1] - offsets[i]);
+    });
+}
+
+
+void VectorALE::Impl::broadcast(const void *snapshot, size_t size) {
+
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        restoreEnvironment(i, snapshot, size);
+    });
+}
+
+
+void VectorALE::Impl::broadcastFrom(size_t index) {
+
+    ALEInterface &source = environment(index);
+    std::vector<char> snapshot(source.snapshotSize());
+    size_t size = source.serializeInto(&snapshot[0], snapshot.size());
+
+    m_pool.parallelFor(m_envs.size(), [&](size_t i) {
+        if (i != index)
+            restoreEnvironment(i, &snapshot[0], size);
+    });
+}
+
+
+ALEInterface &VectorALE::Impl::environment(size_t index) {
+
+    if (index >= m_envs.size())
+        throw std::out_of_range("VectorALE environment index out of range");
+
+    return *m_envs[index];
+}
+
+
+void VectorALE::Impl::copyScreen(size_t index, pixel_t *screens) const {
+
+    m_envs[index]->getScreenPalette(screens + index * screenSize());
+}
+
+
+void VectorALE::Impl::copyObservation(size_t index, uint8_t *observations) const {
+
+    if (m_preprocess)
+        m_envs[index]->getPreprocessedScreen(observations + index * observationSize());
+    else
+        copyScreen(index, observations);
+}
+
+
+void VectorALE::Impl::copyRAM(size_t index, byte_t *ram) const {
+
+    const ALERAM &env_ram = m_envs[index]->getRAM();
+    memcpy(ram + index * env_ram.size(), env_ram.array(), env_ram.size());
+}
+
+
+void VectorALE::Impl::restoreEnvironment(size_t index, const void *snapshot, size_t size) {
+
+    m_envs[index]->restoreFrom(snapshot, size);
+    m_needs_reset[index] = m_envs[index]->gameOver();
+}
+
+
+/* begin PIMPL wrapper */
+
+VectorALE::VectorALE(const std::string &rom_file, size_t num_envs, size_t num_threads) :
+    m_pimpl(new VectorALE::Impl(rom_file, num_envs, num_threads))
+{
+}
+
+
+VectorALE::~VectorALE() {
+    delete m_pimpl;
+}
+
+
+size_t VectorALE::numEnvironments() const {
+    return m_pimpl->numEnvironments();
+}
+
+
+int VectorALE::screenHeight() const {
+    return m_pimpl->screenHeight();
+}
+
+
+int VectorALE::screenWidth() const {
+    return m_pimpl->screenWidth();
+}
+
+
+size_t VectorALE::ramSize() const {
+    return m_pimpl->ramSize();
+}
+
+
+void VectorALE::setAutoReset(bool auto_reset) {
+    m_pimpl->setAutoReset(auto_reset);
+}
+
+
+void VectorALE::setLockstep(bool lockstep) {
+    m_pimpl->setLockstep(lockstep);
+}
+
+
+void VectorALE::setRandomSeed(uint32_t seed) {
+    m_pimpl->setRandomSeed(seed);
+}
+
+
+void VectorALE::resetGame(size_t index) {
+    m_pimpl->resetGame(index);
+}
+
+
+void VectorALE::resetAll() {
+    m_pimpl->resetAll();
+}
+
+
+void VectorALE::step(const Action *actions, reward_t *rewards, unsigned char *terminals,
+                     pixel_t *screens, byte_t *ram) {
+    m_pimpl->step(actions, rewards, terminals, screens, ram);
+}
+
+
+void VectorALE::getScreens(pixel_t *screens) const {
+    m_pimpl->getScreens(screens);
+}
+
+
+void VectorALE::setScreenPreprocessing(const ScreenPreprocessing &config) {
+    m_pimpl->setScreenPreprocessing(config);
+}
+
+
+void VectorALE::clearScreenPreprocessing() {
+    m_pimpl->clearScreenPreprocessing();
+}
+
+
+size_t VectorALE::observationSize() const {
+    return m_pimpl->observationSize();
+}
+
+
+void VectorALE::getObservations(uint8_t *observations) const {
+    m_pimpl->getObservations(observations);
+}
+
+
+void VectorALE::setFrameStacking(int depth) {
+    m_pimpl->setFrameStacking(depth);
+}
+
+
+void VectorALE::getStackedObservations(uint8_t *observations) const {
+    m_pimpl->getStackedObservations(observations);
+}
+
+
+void VectorALE::getScreensRGB(uint8_t *screens) const {
+    m_pimpl->getScreensRGB(screens);
+}
+
+
+void VectorALE::getScreensGrayscale(uint8_t *screens) const {
+    m_pimpl->getScreensGrayscale(screens);
+}
+
+
+void VectorALE::getRAMs(byte_t *ram) const {
+    m_pimpl->getRAMs(ram);
+}
+
+
+size_t VectorALE::snapshotArenaSize() const {
+    return m_pimpl->snapshotArenaSize();
+}
+
+
+size_t VectorALE::snapshotAll(void *arena, size_t size, size_t *offsets) const {
+    return m_pimpl->snapshotAll(arena, size, offsets);
+}
+
+
+void VectorALE::restoreAll(const void *arena, const size_t *offsets) {
+    m_pimpl->restoreAll(arena, offsets);
+}
+
+
+void VectorALE::broadcast(const void *snapshot, size_t size) {
+    m_pimpl->broadcast(snapshot, size);
+}
+
+
+void VectorALE::broadcastFrom(size_t index) {
+    m_pimpl->broadcastFrom(index);
+}
+
+
+ALEInterface &VectorALE::environment(size_t index) {
+    return m_pimpl->environment(index);
+}
+
+
+const ALEInterface &VectorALE::environment(size_t index) const {
+    return m_pimpl->environment(index);
+}
+
+
 const ALEScreen &ALEScreen::operator=(const ALEScreen &rhs) {
 
     // If array dimensions are mistmatched, must reallocate the array
@@ -323,12 +323,13 @@ void ExportScreen::init_custom_palette(void) {
       }
     }
   }
-  std::random_shuffle(v_custom_palette.begin(), v_custom_palette.end() );
+  Random& rng = p_osystem->rng();
+  shuffle(rng, &v_custom_palette);
   // add CUSTOM_PALLETE_SIZE random colors
   for (int i = 0; i < CUSTOM_PALETTE_SIZE; i++) {
-    r = rand_range(0, 256);
-    g = rand_range(0, 256);
-    b = rand_range(0, 256);
+    r = rand_range(rng, 0, 256);
+    g = rand_range(rng, 0, 256);
+    b = rand_range(rng, 0, 256);
     std::vector<int> rand_color;
     rand_color.push_back(r);
     rand_color.push_back(g);
@@ -34,8 +34,10 @@
 #define __RANDOM_TOOLS_H__
 
 #include <vector>
+#include <algorithm>
 #include <cstdlib> 
 #include "emucore/m6502/src/bspf/src/bspf.hxx"
+#include "emucore/Random.hxx"
 
 namespace ale {
 
@@ -43,23 +45,32 @@ namespace ale {
     Returns a random integer within the [lowest, highest] range.
     Code taken from here: http://www.daniweb.com/forums/thread1769.html
  ******************************************************************** */
-inline int rand_range(int lowest, int highest) {
+inline int rand_range(Random &rng, int lowest, int highest) {
     int range = highest - lowest + 1;
-    return (rand() % range) + lowest; 
+    return (rng.next() % range) + lowest; 
 }
 
 /* *********************************************************************
     Returns a random element of the given vector
  ******************************************************************** */
 template <class T> 
-inline T choice(const std::vector<T>* p_vec) {
+inline T choice(Random &rng, const std::vector<T>* p_vec) {
     assert(p_vec->size() > 0);
-    unsigned int index = rand_range(0, int(p_vec->size()) - 1);
+    unsigned int index = rand_range(rng, 0, int(p_vec->size()) - 1);
     assert(index >= 0);
     assert(index < p_vec->size());
     return (*p_vec)[index];
 }
 
+/* *********************************************************************
+    Shuffles the given vector in place
+ ******************************************************************** */
+template <class T> 
+inline void shuffle(Random &rng, std::vector<T>* p_vec) {
+    for (int i = int(p_vec->size()) - 1; i > 0; i--)
+        std::swap((*p_vec)[i], (*p_vec)[rand_range(rng, 0, i)]);
+}
+
 } // namespace ale
 
 #endif // __RANDOM_TOOLS_H__
@@ -0,0 +1,142 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  thread_pool.cpp
+ *
+ *  A fixed-size pool of worker threads used to run data-parallel loops.
+ **************************************************************************** */
+
+#include "thread_pool.hpp"
+
+using namespace ale;
+
+
+ThreadPool::ThreadPool(size_t num_threads) :
+    m_job(NULL),
+    m_job_size(0),
+    m_next_index(0),
+    m_pending_workers(0),
+    m_generation(0),
+    m_shutdown(false)
+{
+    if (num_threads == 0) {
+        num_threads = std::thread::hardware_concurrency();
+        if (num_threads == 0) num_threads = 1;
+    }
+
+    // The calling thread does its share of the work, so spawn one fewer worker
+    for (size_t i = 1; i < num_threads; i++)
+        m_workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+
+ThreadPool::~ThreadPool() {
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_work_ready.notify_all();
+
+    for (size_t i = 0; i < m_workers.size(); i++)
+        m_workers[i].join();
+}
+
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)> &fn) {
+
+    // Nothing to gain from waking the workers up
+    if (m_workers.empty() || n <= 1) {
+        for (size_t i = 0; i < n; i++)
+            fn(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(m_submit_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &fn;
+        m_job_size = n;
+        m_next_index = 0;
+        m_pending_workers = m_workers.size();
+        m_error = std::exception_ptr();
+        m_generation++;
+    }
+    m_work_ready.notify_all();
+
+    runJob(fn, n);
+
+    // Wait for the stragglers; 'fn' must outlive every worker's use of it
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_pending_workers > 0)
+            m_work_done.wait(lock);
+        m_job = NULL;
+        error = m_error;
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+
+void ThreadPool::workerLoop() {
+
+    unsigned long last_generation = 0;
+
+    while (true) {
+        const std::function<void(size_t)> *job;
+        size_t job_size;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!m_shutdown && m_generation == last_generation)
+                m_work_ready.wait(lock);
+
+            if (m_shutdown) return;
+
+            last_generation = m_generation;
+            job = m_job;
+            job_size = m_job_size;
+        }
+
+        runJob(*job, job_size);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_pending_workers == 0)
+                m_work_done.notify_one();
+        }
+    }
+}
+
+
+void ThreadPool::runJob(const std::function<void(size_t)> &fn, size_t n) {
+
+    for (size_t i = m_next_index++; i < n; i = m_next_index++) {
+        try {
+            fn(i);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error) m_error = std::current_exception();
+        }
+    }
+}
@@ -0,0 +1,88 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  thread_pool.hpp
+ *
+ *  A fixed-size pool of worker threads used to run data-parallel loops,
+ *  e.g. stepping a batch of emulators.
+ **************************************************************************** */
+
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ale {
+
+class ThreadPool {
+  public:
+    /** Creates a pool with the given number of threads, counting the calling
+      *  thread. A pool of size zero picks the number of hardware threads; a
+      *  pool of size one runs everything on the calling thread. */
+    explicit ThreadPool(size_t num_threads);
+
+    /** Stops and joins the worker threads. */
+    ~ThreadPool();
+
+    /** Returns the number of threads work is spread over, including the caller. */
+    size_t size() const { return m_workers.size() + 1; }
+
+    /** Calls fn(i) for every i in [0, n) and returns once all calls have
+      *  completed. The calling thread takes part in the work. If any call throws,
+      *  the first exception is rethrown here once the loop has drained. Calls from
+      *  several threads at once are serialized. */
+    void parallelFor(size_t n, const std::function<void(size_t)> &fn);
+
+  private:
+    /** Main loop of each worker thread. */
+    void workerLoop();
+
+    /** Claims and runs indices of the current job until none are left. */
+    void runJob(const std::function<void(size_t)> &fn, size_t n);
+
+    /** Copying is explicitly disallowed. */
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+  private:
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_submit_mutex; // Serializes concurrent calls to parallelFor()
+    std::mutex m_mutex; // Protects the job description below
+    std::condition_variable m_work_ready;
+    std::condition_variable m_work_done;
+
+    const std::function<void(size_t)> *m_job; // The loop body currently being run
+    size_t m_job_size; // Number of iterations in the current job
+    std::atomic<size_t> m_next_index; // Next iteration to hand out
+    size_t m_pending_workers; // Workers that have not yet finished the current job
+    unsigned long m_generation; // Incremented for every new job
+    bool m_shutdown;
+
+    std::exception_ptr m_error; // First exception thrown by the current job
+};
+
+} // namespace ale
+
+#endif // __THREAD_POOL_HPP__
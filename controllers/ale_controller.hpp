@@ -39,6 +39,8 @@
 #include "emucore/m6502/src/System.hxx"
 #include "environment/stella_environment.hpp"
 
+#include <memory>
+
 namespace ale {
 
 class ALEController {
@@ -59,7 +61,7 @@ class ALEController {
 
   protected:
     OSystem* m_osystem;
-    std::auto_ptr<RomSettings> m_settings;
+    std::unique_ptr<RomSettings> m_settings;
     StellaEnvironment m_environment;
 };
 
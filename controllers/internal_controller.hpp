@@ -37,6 +37,8 @@
 #include "ale_controller.hpp"
 #include "agents/PlayerAgent.hpp"
 
+#include <memory>
+
 namespace ale {
 
 class InternalController : public ALEController {
@@ -61,8 +63,8 @@ class InternalController : public ALEController {
     int m_episode_score; // Keeping track of score
     int m_episode_number; // Keeping track of episode 
 
-    std::auto_ptr<PlayerAgent> m_agent_left; // Agents 
-    std::auto_ptr<PlayerAgent> m_agent_right; 
+    std::unique_ptr<PlayerAgent> m_agent_left; // Agents 
+    std::unique_ptr<PlayerAgent> m_agent_right; 
 };
 
 } // namespace ale
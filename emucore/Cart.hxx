@@ -25,6 +25,7 @@ class Cartridge;
 class System;
 class Properties;
 class Settings;
+class Random;
 
 } // namespace ale
 
@@ -52,10 +53,11 @@ class Cartridge : public Device
       @param size     The size of the ROM image
       @param props    The properties associated with the game
       @param settings The settings associated with the system
+      @param rng      The generator used to initialize any cartridge RAM
       @return   Pointer to the new cartridge object allocated on the heap
     */
     static Cartridge* create(const uInt8* image, uInt32 size,
-        const Properties& props, const Settings& settings);
+        const Properties& props, const Settings& settings, Random& rng);
 
     /**
       Create a new cartridge
@@ -70,7 +72,7 @@ class Cartridge : public Device
     /**
       Query some information about this cartridge.
     */
-    static const std::string& about() { return myAboutString; }
+    const std::string& about() const { return myAboutString; }
 
     /**
       Save the internal (patched) ROM image.
@@ -129,7 +131,7 @@ class Cartridge : public Device
     // by the debugger, when disassembling/dumping ROM.
     bool bankLocked;
 
-  private:
+  public:
     /**
       Try to auto-detect the bankswitching type of the cartridge
 
@@ -139,6 +141,7 @@ class Cartridge : public Device
     */
     static std::string autodetectType(const uInt8* image, uInt32 size);
 
+  private:
     /**
       Search the image for the specified byte signature
 
@@ -196,7 +199,7 @@ class Cartridge : public Device
 
   private:
     // Contains info about this cartridge in std::string format
-    static std::string myAboutString;
+    std::string myAboutString;
 
     // Copy constructor isn't supported by cartridges so make it private
     Cartridge(const Cartridge&);
@@ -21,6 +21,7 @@
 #include "m6502/src/System.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "Cart2K.hxx"
 
 using namespace ale;
@@ -55,6 +56,7 @@ void Cartridge2K::reset()
 void Cartridge2K::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myImage, sizeof(myImage));
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -115,7 +117,7 @@ bool Cartridge2K::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
   }
   catch(const char* msg)
@@ -132,6 +134,12 @@ bool Cartridge2K::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Cartridge2K::copyRaw(RawState&)
+{
+  // I have no state
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Cartridge2K::bank(uInt16 bank)
 {
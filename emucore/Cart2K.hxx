@@ -92,6 +92,14 @@ class Cartridge2K : public Cartridge
     */
     virtual bool load(Deserializer& in);
 
+    /**
+      Saves, loads or measures the raw state of this device, as the
+      RawState's direction asks.
+
+      @param state The raw state to copy the fields to or from
+    */
+    virtual void copyRaw(RawState& state);
+
     /**
       Install pages for the specified bank in the system.
 
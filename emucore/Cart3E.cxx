@@ -23,12 +23,13 @@
 #include "TIA.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "Cart3E.hxx"
 
 using namespace ale;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Cartridge3E::Cartridge3E(const uInt8* image, uInt32 size)
+Cartridge3E::Cartridge3E(const uInt8* image, uInt32 size, Random& rng)
   : mySize(size)
 {
   // Allocate array for the ROM image
@@ -41,10 +42,9 @@ Cartridge3E::Cartridge3E(const uInt8* image, uInt32 size)
   }
 
   // Initialize RAM with random values
-  class Random random;
   for(uInt32 i = 0; i < 32768; ++i)
   {
-    myRam[i] = random.next();
+    myRam[i] = rng.next();
   }
 }
 
@@ -71,6 +71,7 @@ void Cartridge3E::reset()
 void Cartridge3E::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myImage, mySize);
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -155,8 +156,7 @@ bool Cartridge3E::save(Serializer& out)
 
     // Output RAM
     out.putInt(32768);
-    for(uInt32 addr = 0; addr < 32768; ++addr)
-      out.putInt(myRam[addr]);
+    out.putBytes(myRam, 32768);
   }
   catch(const char* msg)
   {
@@ -179,15 +179,14 @@ bool Cartridge3E::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
     myCurrentBank = (uInt16) in.getInt();
 
     // Input RAM
-    uInt32 limit = (uInt32) in.getInt();
-    for(uInt32 addr = 0; addr < limit; ++addr)
-      myRam[addr] = (uInt8) in.getInt();
+    in.expectLength(sizeof(myRam));
+    in.getBytes(myRam, sizeof(myRam));
   }
   catch(const char* msg)
   {
@@ -206,6 +205,17 @@ bool Cartridge3E::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Cartridge3E::copyRaw(RawState& state)
+{
+  state.copy(myCurrentBank);
+  state.copyBytes(myRam, 32768);
+
+  // Now, go to the current bank
+  if(state.direction() == RawState::Load)
+    bank(myCurrentBank);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Cartridge3E::bank(uInt16 bank)
 { 
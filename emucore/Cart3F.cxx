@@ -22,6 +22,7 @@
 #include "TIA.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "Cart3F.hxx"
 
 using namespace ale;
@@ -63,6 +64,7 @@ void Cartridge3F::reset()
 void Cartridge3F::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myImage, mySize);
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -155,7 +157,7 @@ bool Cartridge3F::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
     myCurrentBank = (uInt16) in.getInt();
@@ -177,6 +179,16 @@ bool Cartridge3F::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Cartridge3F::copyRaw(RawState& state)
+{
+  state.copy(myCurrentBank);
+
+  // Now, go to the current bank
+  if(state.direction() == RawState::Load)
+    bank(myCurrentBank);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Cartridge3F::bank(uInt16 bank)
 { 
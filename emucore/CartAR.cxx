@@ -30,7 +30,7 @@
 using namespace ale;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-CartridgeAR::CartridgeAR(const uInt8* image, uInt32 size, bool fastbios)
+CartridgeAR::CartridgeAR(const uInt8* image, uInt32 size, bool fastbios, Random& rng)
   : my6502(0)
 {
   uInt32 i;
@@ -41,10 +41,9 @@ CartridgeAR::CartridgeAR(const uInt8* image, uInt32 size, bool fastbios)
   memcpy(myLoadImages, image, size);
 
   // Initialize RAM with random values
-  class Random random;
   for(i = 0; i < 6 * 1024; ++i)
   {
-    myImage[i] = random.next();
+    myImage[i] = rng.next();
   }
 
   // Initialize SC BIOS ROM
@@ -296,7 +295,7 @@ void CartridgeAR::bankConfiguration(uInt8 configuration)
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void CartridgeAR::initializeROM(bool fastbios)
 {
-  static uInt8 dummyROMCode[] = {
+  static const uInt8 dummyROMCode[] = {
     0xa5, 0xfa, 0x85, 0x80, 0x4c, 0x18, 0xf8, 0xff, 
     0xff, 0xff, 0x78, 0xd8, 0xa0, 0x0, 0xa2, 0x0, 
     0x94, 0x0, 0xe8, 0xd0, 0xfb, 0x4c, 0x50, 0xf8, 
@@ -336,11 +335,6 @@ void CartridgeAR::initializeROM(bool fastbios)
     0x4c
   };
 
-  // If fastbios is enabled, set the wait time between vertical bars
-  // to 0 (default is 8), which is stored at address 189 of the bios
-  if(fastbios)
-    dummyROMCode[189] = 0x0;
-
   uInt32 size = sizeof(dummyROMCode);
 
   // Initialize ROM with illegal 6502 opcode that causes a real 6502 to jam
@@ -355,6 +349,12 @@ void CartridgeAR::initializeROM(bool fastbios)
     myImage[3 * 2048 + j] = dummyROMCode[j];
   }
 
+  // If fastbios is enabled, set the wait time between vertical bars
+  // to 0 (default is 8), which is stored at address 189 of the bios.
+  // The shared BIOS code itself is left untouched
+  if(fastbios)
+    myImage[3 * 2048 + 189] = 0x0;
+
   // Finally set 6502 vectors to point to initial load code at 0xF80A of BIOS
   myImage[3 * 2048 + 2044] = 0x0A;
   myImage[3 * 2048 + 2045] = 0xF8;
@@ -450,19 +450,16 @@ bool CartridgeAR::save(Serializer& out)
 
     // The 6K of RAM and 2K of ROM contained in the Supercharger
     out.putInt(8192);
-    for(i = 0; i < 8192; ++i)
-      out.putInt(myImage[i]);
+    out.putBytes(myImage, 8192);
 
     // The 256 byte header for the current 8448 byte load
     out.putInt(256);
-    for(i = 0; i < 256; ++i)
-      out.putInt(myHeader[i]);
+    out.putBytes(myHeader, 256);
 
     // All of the 8448 byte loads associated with the game 
     // Note that the size of this array is myNumberOfLoadImages * 8448
     out.putInt(myNumberOfLoadImages * 8448);
-    for(i = 0; i < (uInt32) myNumberOfLoadImages * 8448; ++i)
-      out.putInt(myLoadImages[i]);
+    out.putBytes(myLoadImages, (uInt32) myNumberOfLoadImages * 8448);
 
     // Indicates how many 8448 loads there are
     out.putInt(myNumberOfLoadImages);
@@ -506,34 +503,34 @@ bool CartridgeAR::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
-    uInt32 i, limit;
+    uInt32 i;
 
     // Indicates the offest within the image for the corresponding bank
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
-      myImageOffset[i] = (uInt32) in.getInt();
+    in.expectLength(2);
+    // (each is followed by a 2K bank within the image)
+    for(i = 0; i < 2; ++i)
+      myImageOffset[i] = in.getIndex(sizeof(myImage) - 2048 + 1);
 
     // The 6K of RAM and 2K of ROM contained in the Supercharger
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
-      myImage[i] = (uInt8) in.getInt();
+    in.expectLength(sizeof(myImage));
+    in.getBytes(myImage, sizeof(myImage));
 
     // The 256 byte header for the current 8448 byte load
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
-      myHeader[i] = (uInt8) in.getInt();
+    in.expectLength(sizeof(myHeader));
+    in.getBytes(myHeader, sizeof(myHeader));
 
     // All of the 8448 byte loads associated with the game 
     // Note that the size of this array is myNumberOfLoadImages * 8448
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
-      myLoadImages[i] = (uInt8) in.getInt();
+    in.expectLength(myNumberOfLoadImages * 8448);
+    in.getBytes(myLoadImages, (uInt32) myNumberOfLoadImages * 8448);
 
-    // Indicates how many 8448 loads there are
-    myNumberOfLoadImages = (uInt8) in.getInt();
+    // Indicates how many 8448 loads there are, which were allocated for
+    // the game when it was loaded
+    if((uInt8) in.getInt() != myNumberOfLoadImages)
+      throw "Deserializer: data corruption";
 
     // Indicates if the RAM is write enabled
     myWriteEnabled = in.getBool();
@@ -23,6 +23,7 @@ namespace ale {
 
 class M6502High;
 class System;
+class Random;
 class Serializer;
 class Deserializer;
 
@@ -54,8 +55,9 @@ class CartridgeAR : public Cartridge
       @param image     Pointer to the ROM image
       @param size      The size of the ROM image
       @param fastbios  Whether or not to quickly execute the BIOS code
+      @param rng       The generator used to initialize the cartridge RAM
     */
-    CartridgeAR(const uInt8* image, uInt32 size, bool fastbios);
+    CartridgeAR(const uInt8* image, uInt32 size, bool fastbios, Random& rng);
 
     /**
       Destructor
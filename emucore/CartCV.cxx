@@ -22,12 +22,13 @@
 #include "Random.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "CartCV.hxx"
 
 using namespace ale;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-CartridgeCV::CartridgeCV(const uInt8* image, uInt32 size)
+CartridgeCV::CartridgeCV(const uInt8* image, uInt32 size, Random& rng)
 {
   uInt32 addr;
   if(size == 2048)
@@ -39,10 +40,9 @@ CartridgeCV::CartridgeCV(const uInt8* image, uInt32 size)
     }
 
     // Initialize RAM with random values
-    class Random random;
     for(uInt32 i = 0; i < 1024; ++i)
     {
-      myRAM[i] = random.next();
+      myRAM[i] = rng.next();
     }
   }
   else if(size == 4096)
@@ -85,6 +85,7 @@ void CartridgeCV::reset()
 void CartridgeCV::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myImage, sizeof(myImage));
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -144,8 +145,7 @@ bool CartridgeCV::save(Serializer& out)
 
     // Output RAM
     out.putInt(1024);
-    for(uInt32 addr = 0; addr < 1024; ++addr)
-      out.putInt(myRAM[addr]);
+    out.putBytes(myRAM, 1024);
   }
   catch(const char* msg)
   {
@@ -168,13 +168,12 @@ bool CartridgeCV::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
     // Input RAM
-    uInt32 limit = (uInt32) in.getInt();
-    for(uInt32 addr = 0; addr < limit; ++addr)
-      myRAM[addr] = (uInt8) in.getInt();
+    in.expectLength(sizeof(myRAM));
+    in.getBytes(myRAM, sizeof(myRAM));
   }
   catch(const char* msg)
   {
@@ -190,6 +189,12 @@ bool CartridgeCV::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartridgeCV::copyRaw(RawState& state)
+{
+  state.copyBytes(myRAM, 1024);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void CartridgeCV::bank(uInt16 bank)
 {
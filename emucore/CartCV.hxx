@@ -22,6 +22,7 @@
 namespace ale {
 
 class System;
+class Random;
 class Serializer;
 class Deserializer;
 
@@ -49,8 +50,9 @@ class CartridgeCV : public Cartridge
       Create a new cartridge using the specified image
 
       @param image Pointer to the ROM image
+      @param rng   The generator used to initialize the cartridge RAM
     */
-    CartridgeCV(const uInt8* image, uInt32 size);
+    CartridgeCV(const uInt8* image, uInt32 size, Random& rng);
 
     /**
       Destructor
@@ -94,6 +96,14 @@ class CartridgeCV : public Cartridge
     */
     virtual bool load(Deserializer& in);
 
+    /**
+      Saves, loads or measures the raw state of this device, as the
+      RawState's direction asks.
+
+      @param state The raw state to copy the fields to or from
+    */
+    virtual void copyRaw(RawState& state);
+
     /**
       Install pages for the specified bank in the system.
 
@@ -100,6 +100,7 @@ void CartridgeDPC::systemCyclesReset()
 void CartridgeDPC::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myProgramImage, sizeof(myProgramImage));
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -445,13 +446,11 @@ bool CartridgeDPC::save(Serializer& out)
 
     // The top registers for the data fetchers
     out.putInt(8);
-    for(i = 0; i < 8; ++i)
-      out.putInt(myTops[i]);
+    out.putBytes(myTops, 8);
 
     // The bottom registers for the data fetchers
     out.putInt(8);
-    for(i = 0; i < 8; ++i)
-      out.putInt(myBottoms[i]);
+    out.putBytes(myBottoms, 8);
 
     // The counter registers for the data fetchers
     out.putInt(8);
@@ -460,8 +459,7 @@ bool CartridgeDPC::save(Serializer& out)
 
     // The flag registers for the data fetchers
     out.putInt(8);
-    for(i = 0; i < 8; ++i)
-      out.putInt(myFlags[i]);
+    out.putBytes(myFlags, 8);
 
     // The music mode flags for the data fetchers
     out.putInt(3);
@@ -495,37 +493,34 @@ bool CartridgeDPC::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
-    uInt32 i, limit;
+    uInt32 i;
 
     // Indicates which bank is currently active
-    myCurrentBank = (uInt16) in.getInt();
+    myCurrentBank = (uInt16) in.getIndex(bankCount());
 
     // The top registers for the data fetchers
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
-      myTops[i] = (uInt8) in.getInt();
+    in.expectLength(sizeof(myTops));
+    in.getBytes(myTops, sizeof(myTops));
 
     // The bottom registers for the data fetchers
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
-      myBottoms[i] = (uInt8) in.getInt();
+    in.expectLength(sizeof(myBottoms));
+    in.getBytes(myBottoms, sizeof(myBottoms));
 
     // The counter registers for the data fetchers
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
+    in.expectLength(8);
+    for(i = 0; i < 8; ++i)
       myCounters[i] = (uInt16) in.getInt();
 
     // The flag registers for the data fetchers
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
-      myFlags[i] = (uInt8) in.getInt();
+    in.expectLength(sizeof(myFlags));
+    in.getBytes(myFlags, sizeof(myFlags));
 
     // The music mode flags for the data fetchers
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
+    in.expectLength(3);
+    for(i = 0; i < 3; ++i)
       myMusicMode[i] = in.getBool();
 
     // The random number generator register
@@ -21,6 +21,7 @@
 #include "m6502/src/System.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "CartE0.hxx"
 
 using namespace ale;
@@ -59,6 +60,7 @@ void CartridgeE0::reset()
 void CartridgeE0::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myImage, sizeof(myImage));
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -232,12 +234,12 @@ bool CartridgeE0::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
-    uInt32 limit = (uInt32) in.getInt();
-    for(uInt32 i = 0; i < limit; ++i)
-      myCurrentSlice[i] = (uInt16) in.getInt();
+    in.expectLength(4);
+    for(uInt32 i = 0; i < 4; ++i)
+      myCurrentSlice[i] = (uInt16) in.getIndex(8);
   }
   catch(const char* msg)
   {
@@ -253,6 +255,12 @@ bool CartridgeE0::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartridgeE0::copyRaw(RawState& state)
+{
+  state.copy(myCurrentSlice);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void CartridgeE0::bank(uInt16 bank)
 {
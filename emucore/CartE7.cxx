@@ -22,12 +22,13 @@
 #include "Random.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "CartE7.hxx"
 
 using namespace ale;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-CartridgeE7::CartridgeE7(const uInt8* image)
+CartridgeE7::CartridgeE7(const uInt8* image, Random& rng)
 {
   // Copy the ROM image into my buffer
   for(uInt32 addr = 0; addr < 16384; ++addr)
@@ -36,10 +37,9 @@ CartridgeE7::CartridgeE7(const uInt8* image)
   }
 
   // Initialize RAM with random values
-  class Random random;
   for(uInt32 i = 0; i < 2048; ++i)
   {
-    myRAM[i] = random.next();
+    myRAM[i] = rng.next();
   }
 }
 
@@ -66,6 +66,7 @@ void CartridgeE7::reset()
 void CartridgeE7::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myImage, sizeof(myImage));
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -189,8 +190,7 @@ bool CartridgeE7::save(Serializer& out)
 
     // The 2048 bytes of RAM
     out.putInt(2048);
-    for(i = 0; i < 2048; ++i)
-      out.putInt(myRAM[i]);
+    out.putBytes(myRAM, 2048);
   }
   catch(const char* msg)
   {
@@ -213,21 +213,18 @@ bool CartridgeE7::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
-    uInt32 i, limit;
+    in.expectLength(2);
+    for(uInt32 i = 0; i < 2; ++i)
+      myCurrentSlice[i] = (uInt16) in.getIndex(8);
 
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
-      myCurrentSlice[i] = (uInt16) in.getInt();
-
-    myCurrentRAM = (uInt16) in.getInt();
+    myCurrentRAM = (uInt16) in.getIndex(4);
 
     // The 2048 bytes of RAM
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
-      myRAM[i] = (uInt8) in.getInt();
+    in.expectLength(sizeof(myRAM));
+    in.getBytes(myRAM, sizeof(myRAM));
   }
   catch(const char* msg)
   {
@@ -247,6 +244,21 @@ bool CartridgeE7::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartridgeE7::copyRaw(RawState& state)
+{
+  state.copy(myCurrentSlice);
+  state.copy(myCurrentRAM);
+  state.copyBytes(myRAM, 2048);
+
+  // Set up the previously used banks for the RAM and segment
+  if(state.direction() == RawState::Load)
+  {
+    bankRAM(myCurrentRAM);
+    bank(myCurrentSlice[0]);
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void CartridgeE7::bank(uInt16 slice)
 { 
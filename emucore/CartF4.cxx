@@ -22,6 +22,7 @@
 #include "Random.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "CartF4.hxx"
 
 using namespace ale;
@@ -58,6 +59,7 @@ void CartridgeF4::reset()
 void CartridgeF4::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myImage, sizeof(myImage));
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -135,12 +137,12 @@ bool CartridgeF4::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
     {
       return false;
     }
 
-    myCurrentBank = (uInt16)in.getInt();
+    myCurrentBank = (uInt16) in.getIndex(bankCount());
   }
   catch(const char* msg)
   {
@@ -159,6 +161,16 @@ bool CartridgeF4::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartridgeF4::copyRaw(RawState& state)
+{
+  state.copy(myCurrentBank);
+
+  // Remember what bank we were in
+  if(state.direction() == RawState::Load)
+    bank(myCurrentBank);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void CartridgeF4::bank(uInt16 bank)
 { 
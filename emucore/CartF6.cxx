@@ -21,6 +21,7 @@
 #include "m6502/src/System.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "CartF6.hxx"
 
 using namespace ale;
@@ -57,6 +58,7 @@ void CartridgeF6::reset()
 void CartridgeF6::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myImage, sizeof(myImage));
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -177,10 +179,10 @@ bool CartridgeF6::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
-    myCurrentBank = (uInt16) in.getInt();
+    myCurrentBank = (uInt16) in.getIndex(bankCount());
   }
   catch(const char* msg)
   {
@@ -199,6 +201,16 @@ bool CartridgeF6::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartridgeF6::copyRaw(RawState& state)
+{
+  state.copy(myCurrentBank);
+
+  // Remember what bank we were in
+  if(state.direction() == RawState::Load)
+    bank(myCurrentBank);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void CartridgeF6::bank(uInt16 bank)
 { 
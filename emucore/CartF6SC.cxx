@@ -22,12 +22,13 @@
 #include "Random.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "CartF6SC.hxx"
 
 using namespace ale;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-CartridgeF6SC::CartridgeF6SC(const uInt8* image)
+CartridgeF6SC::CartridgeF6SC(const uInt8* image, Random& rng)
 {
   // Copy the ROM image into my buffer
   for(uInt32 addr = 0; addr < 16384; ++addr)
@@ -36,10 +37,9 @@ CartridgeF6SC::CartridgeF6SC(const uInt8* image)
   }
 
   // Initialize RAM with random values
-  class Random random;
   for(uInt32 i = 0; i < 128; ++i)
   {
-    myRAM[i] = random.next();
+    myRAM[i] = rng.next();
   }
 }
 
@@ -65,6 +65,7 @@ void CartridgeF6SC::reset()
 void CartridgeF6SC::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myImage, sizeof(myImage));
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -191,8 +192,7 @@ bool CartridgeF6SC::save(Serializer& out)
 
     // The 128 bytes of RAM
     out.putInt(128);
-    for(uInt32 i = 0; i < 128; ++i)
-      out.putInt(myRAM[i]);
+    out.putBytes(myRAM, 128);
 
   }
   catch(const char* msg)
@@ -216,15 +216,14 @@ bool CartridgeF6SC::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
-    myCurrentBank = (uInt16) in.getInt();
+    myCurrentBank = (uInt16) in.getIndex(bankCount());
 
     // The 128 bytes of RAM
-    uInt32 limit = (uInt32) in.getInt();
-    for(uInt32 i = 0; i < limit; ++i)
-      myRAM[i] = (uInt8) in.getInt();
+    in.expectLength(sizeof(myRAM));
+    in.getBytes(myRAM, sizeof(myRAM));
   }
   catch(const char* msg)
   {
@@ -243,6 +242,17 @@ bool CartridgeF6SC::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartridgeF6SC::copyRaw(RawState& state)
+{
+  state.copy(myCurrentBank);
+  state.copyBytes(myRAM, 128);
+
+  // Remember what bank we were in
+  if(state.direction() == RawState::Load)
+    bank(myCurrentBank);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void CartridgeF6SC::bank(uInt16 bank)
 { 
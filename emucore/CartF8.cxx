@@ -21,6 +21,7 @@
 #include "m6502/src/System.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "CartF8.hxx"
 
 using namespace ale;
@@ -61,6 +62,7 @@ void CartridgeF8::reset()
 void CartridgeF8::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myImage, sizeof(myImage));
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -161,10 +163,10 @@ bool CartridgeF8::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
-    myCurrentBank = (uInt16) in.getInt();
+    myCurrentBank = (uInt16) in.getIndex(bankCount());
   }
   catch(const char* msg)
   {
@@ -183,6 +185,16 @@ bool CartridgeF8::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartridgeF8::copyRaw(RawState& state)
+{
+  state.copy(myCurrentBank);
+
+  // Remember what bank we were in
+  if(state.direction() == RawState::Load)
+    bank(myCurrentBank);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void CartridgeF8::bank(uInt16 bank)
 { 
@@ -22,6 +22,7 @@
 namespace ale {
 
 class System;
+class Random;
 class Serializer;
 class Deserializer;
 
@@ -46,8 +47,9 @@ class CartridgeF8SC : public Cartridge
       Create a new cartridge using the specified image
 
       @param image Pointer to the ROM image
+      @param rng   The generator used to initialize the cartridge RAM
     */
-    CartridgeF8SC(const uInt8* image);
+    CartridgeF8SC(const uInt8* image, Random& rng);
  
     /**
       Destructor
@@ -91,6 +93,14 @@ class CartridgeF8SC : public Cartridge
     */
     virtual bool load(Deserializer& in);
 
+    /**
+      Saves, loads or measures the raw state of this device, as the
+      RawState's direction asks.
+
+      @param state The raw state to copy the fields to or from
+    */
+    virtual void copyRaw(RawState& state);
+
     /**
       Install pages for the specified bank in the system.
 
@@ -21,6 +21,7 @@
 #include "m6502/src/System.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "CartFE.hxx"
 
 using namespace ale;
@@ -114,7 +115,7 @@ bool CartridgeFE::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
   }
   catch(const char* msg)
@@ -131,6 +132,12 @@ bool CartridgeFE::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartridgeFE::copyRaw(RawState&)
+{
+  // I have no state
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void CartridgeFE::bank(uInt16 b)
 {
@@ -21,6 +21,7 @@
 #include "m6502/src/System.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "CartMB.hxx"
 
 using namespace ale;
@@ -58,6 +59,7 @@ void CartridgeMB::reset()
 void CartridgeMB::install(System& system)
 {
   mySystem = &system;
+  mySystem->addReadOnlyMemory(myImage, sizeof(myImage));
   uInt16 shift = mySystem->pageShift();
   uInt16 mask = mySystem->pageMask();
 
@@ -157,7 +159,7 @@ bool CartridgeMB::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
     myCurrentBank = (uInt16) in.getInt();
@@ -180,6 +182,19 @@ bool CartridgeMB::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartridgeMB::copyRaw(RawState& state)
+{
+  state.copy(myCurrentBank);
+
+  // Remember what bank we were in
+  if(state.direction() == RawState::Load)
+  {
+    --myCurrentBank;
+    incbank();
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void CartridgeMB::bank(uInt16 bank)
 {
@@ -22,12 +22,13 @@
 #include "Random.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "CartMC.hxx"
 
 using namespace ale;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-CartridgeMC::CartridgeMC(const uInt8* image, uInt32 size)
+CartridgeMC::CartridgeMC(const uInt8* image, uInt32 size, Random& rng)
   : mySlot3Locked(false)
 {
   uInt32 i;
@@ -39,10 +40,9 @@ CartridgeMC::CartridgeMC(const uInt8* image, uInt32 size)
   myRAM = new uInt8[32 * 1024];
 
   // Initialize RAM with random values
-  class Random random;
   for(i = 0; i < 32 * 1024; ++i)
   {
-    myRAM[i] = random.next();
+    myRAM[i] = rng.next();
   }
 
   // Allocate array for the ROM image
@@ -233,13 +233,11 @@ bool CartridgeMC::save(Serializer& out)
 
     // The currentBlock array
     out.putInt(4);
-    for(i = 0; i < 4; ++i)
-      out.putInt(myCurrentBlock[i]);
+    out.putBytes(myCurrentBlock, 4);
 
     // The 32K of RAM
     out.putInt(32 * 1024);
-    for(i = 0; i < 32 * 1024; ++i)
-      out.putInt(myRAM[i]);
+    out.putBytes(myRAM, 32 * 1024);
   }
   catch(const char* msg)
   {
@@ -263,20 +261,16 @@ bool CartridgeMC::load(Deserializer& in)
 
   try
   {
-    uInt32 limit;
-
-    if(in.getString() != cart)
+    if(!in.expectString(cart))
       return false;
 
     // The currentBlock array
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
-      myCurrentBlock[i] = (uInt8) in.getInt();
+    in.expectLength(sizeof(myCurrentBlock));
+    in.getBytes(myCurrentBlock, sizeof(myCurrentBlock));
 
     // The 32K of RAM
-    limit = (uInt32) in.getInt();
-    for(i = 0; i < limit; ++i)
-      myRAM[i] = (uInt8) in.getInt();
+    in.expectLength(32 * 1024);
+    in.getBytes(myRAM, 32 * 1024);
   }
   catch(const char* msg)
   {
@@ -292,6 +286,13 @@ bool CartridgeMC::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartridgeMC::copyRaw(RawState& state)
+{
+  state.copy(myCurrentBlock);
+  state.copyBytes(myRAM, 32 * 1024);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void CartridgeMC::bank(uInt16 b)
 {
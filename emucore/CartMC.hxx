@@ -22,6 +22,7 @@
 namespace ale {
 
 class System;
+class Random;
 class Serializer;
 class Deserializer;
 
@@ -153,8 +154,9 @@ class CartridgeMC : public Cartridge
 
       @param image Pointer to the ROM image
       @param size The size of the ROM image
+      @param rng  The generator used to initialize the cartridge RAM
     */
-    CartridgeMC(const uInt8* image, uInt32 size);
+    CartridgeMC(const uInt8* image, uInt32 size, Random& rng);
  
     /**
       Destructor
@@ -198,6 +200,14 @@ class CartridgeMC : public Cartridge
     */
     virtual bool load(Deserializer& in);
 
+    /**
+      Saves, loads or measures the raw state of this device, as the
+      RawState's direction asks.
+
+      @param state The raw state to copy the fields to or from
+    */
+    virtual void copyRaw(RawState& state);
+
     /**
       Install pages for the specified bank in the system.
 
@@ -20,6 +20,7 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <mutex>
 
 #include "AtariVox.hxx"
 #include "Booster.hxx"
@@ -31,13 +32,16 @@
 //ALE #include "EventHandler.hxx"
 #include "Joystick.hxx"
 #include "Keyboard.hxx"
+#include "m6502/src/M6502FastBus.hxx"
 #include "m6502/src/M6502Hi.hxx"
 #include "m6502/src/M6502Low.hxx"
+#include "m6502/src/M6502Recompiled.hxx"
 #include "M6532.hxx"
 #include "MediaSrc.hxx"
 #include "Paddles.hxx"
 #include "Props.hxx"
 #include "PropsSet.hxx"
+#include "Random.hxx"
 #include "Settings.hxx" 
 //ALE #include "Sound.hxx"
 #include "Switches.hxx"
@@ -55,7 +59,8 @@ using namespace ale;
 Console::Console(OSystem* osystem, Cartridge* cart, const Properties& props)
   : myOSystem(osystem),
     myProperties(props),
-    myUserPaletteDefined(false)
+    myUserPaletteDefined(false),
+    myColorLoss(false)
 {
   myControllers[0] = 0;
   myControllers[1] = 0;
@@ -64,12 +69,6 @@ Console::Console(OSystem* osystem, Cartridge* cart, const Properties& props)
   mySystem = 0;
   myEvent = 0;
   
-  std::string seedStr = myOSystem->settings().getString("random_seed").c_str();
-  if (seedStr == "time")
-    Random::seed(time(NULL));
-  else
-    Random::seed(atoi(seedStr.c_str()));
-
   // Attach the event subsystem to the current console
   //ALE  myEvent = myOSystem->eventHandler().event();
   myEvent = myOSystem->event();
@@ -155,19 +154,30 @@ Console::Console(OSystem* osystem, Cartridge* cart, const Properties& props)
   myControllers[0]->setSystem(mySystem);
   myControllers[1]->setSystem(mySystem);
 
+  M6532* m6532 = new M6532(*this);
+
+  TIA *tia = new TIA(*this, myOSystem->settings());
+  tia->setSound(myOSystem->sound());
+
   M6502* m6502;
-  if(myOSystem->settings().getString("cpu") == "low") {
+  const std::string& cpu = myOSystem->settings().getString("cpu");
+  if(cpu == "low") {
     m6502 = new M6502Low(1);
   }
+  else if(cpu == "fast") {
+    // Prefer code recompiled from this very ROM
+    M6502Fast* fast = M6502Recompiled::create(myProperties.get(Cartridge_MD5),
+        1, *cart, *tia, *m6532);
+    if(fast == 0) {
+      fast = new M6502FastBus<DeviceBus>(1);
+    }
+    fast->setIdleLoopSkipping(myOSystem->settings().getBool("idle_loop_skip"));
+    m6502 = fast;
+  }
   else {
     m6502 = new M6502High(1);
   }
 
-  M6532* m6532 = new M6532(*this);
-
-  TIA *tia = new TIA(*this, myOSystem->settings());
-  tia->setSound(myOSystem->sound());
-
   mySystem->attach(m6502);
   mySystem->attach(m6532);
   mySystem->attach(tia);
@@ -345,16 +355,18 @@ void Console::setPalette(const std::string& type)
 {
   // Look at all the palettes, since we don't know which one is
   // currently active
-  uInt32* palettes[3][3] = {
-    { &ourNTSCPalette[0],    &ourPALPalette[0],    &ourSECAMPalette[0]    },
-    { &ourNTSCPaletteZ26[0], &ourPALPaletteZ26[0], &ourSECAMPaletteZ26[0] },
+  computeBuiltinPalettes();
+  uInt32 (*builtin)[256] = ourBuiltinPalettes[myColorLoss ? 1 : 0];
+  const uInt32* palettes[3][3] = {
+    { builtin[0], builtin[1], builtin[2] },
+    { builtin[3], builtin[4], builtin[5] },
     { 0, 0, 0 }
   };
   if(myUserPaletteDefined)
   {
-    palettes[2][0] = &ourUserNTSCPalette[0];
-    palettes[2][1] = &ourUserPALPalette[0];
-    palettes[2][2] = &ourUserSECAMPalette[0];
+    palettes[2][0] = &myUserNTSCPalette[0];
+    palettes[2][1] = &myUserPALPalette[0];
+    palettes[2][2] = &myUserSECAMPalette[0];
   }
 
   // See which format we should be using
@@ -462,8 +474,9 @@ void Console::initializeAudio()
 */
 void Console::fry() const
 {
-  for (int ZPmem=0; ZPmem<0x100; ZPmem += rand() % 4)
-    mySystem->poke(ZPmem, mySystem->peek(ZPmem) & (uInt8)rand() % 256);
+  Random& rng = myOSystem->rng();
+  for (int ZPmem=0; ZPmem<0x100; ZPmem += rng.next() % 4)
+    mySystem->poke(ZPmem, mySystem->peek(ZPmem) & (uInt8)rng.next() % 256);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -586,13 +599,13 @@ void Console::loadUserPalette()
   {
     in.read((char*)pixbuf, 3);
     uInt32 pixel = ((int)pixbuf[0] << 16) + ((int)pixbuf[1] << 8) + (int)pixbuf[2];
-    ourUserNTSCPalette[(i<<1)] = pixel;
+    myUserNTSCPalette[(i<<1)] = pixel;
   }
   for(int i = 0; i < 128; i++)  // PAL palette
   {
     in.read((char*)pixbuf, 3);
     uInt32 pixel = ((int)pixbuf[0] << 16) + ((int)pixbuf[1] << 8) + (int)pixbuf[2];
-    ourUserPALPalette[(i<<1)] = pixel;
+    myUserPALPalette[(i<<1)] = pixel;
   }
 
   uInt32 secam[16];  // All 8 24-bit pixels, plus 8 colorloss pixels
@@ -603,7 +616,7 @@ void Console::loadUserPalette()
     secam[(i<<1)]   = pixel;
     secam[(i<<1)+1] = 0;
   }
-  uInt32* ptr = ourUserSECAMPalette;
+  uInt32* ptr = myUserSECAMPalette;
   for(int i = 0; i < 16; ++i)
   {
     uInt32* s = secam;
@@ -618,43 +631,57 @@ void Console::loadUserPalette()
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Console::setColorLossPalette(bool loss)
 {
-  // Look at all the palettes, since we don't know which one is
-  // currently active
-  uInt32* palette[9] = {
-    &ourNTSCPalette[0],    &ourPALPalette[0],    &ourSECAMPalette[0],
-    &ourNTSCPaletteZ26[0], &ourPALPaletteZ26[0], &ourSECAMPaletteZ26[0],
-    0, 0, 0
-  };
+  // The built-in palettes are shared, and come with and without color-loss
+  myColorLoss = loss;
+
   if(myUserPaletteDefined)
   {
-    palette[6] = &ourUserNTSCPalette[0];
-    palette[7] = &ourUserPALPalette[0];
-    palette[8] = &ourUserSECAMPalette[0];
+    fillPalette(myUserNTSCPalette, myUserNTSCPalette, loss);
+    fillPalette(myUserPALPalette, myUserPALPalette, loss);
+    fillPalette(myUserSECAMPalette, myUserSECAMPalette, loss);
   }
+}
 
-  for(int i = 0; i < 9; ++i)
-  {
-    if(palette[i] == 0)
-      continue;
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Console::computeBuiltinPalettes()
+{
+  // Consoles may be created on several threads at once
+  static std::once_flag computed;
+
+  std::call_once(computed, []() {
+    const uInt32* sources[6] = {
+      &ourNTSCPalette[0],    &ourPALPalette[0],    &ourSECAMPalette[0],
+      &ourNTSCPaletteZ26[0], &ourPALPaletteZ26[0], &ourSECAMPaletteZ26[0]
+    };
+    for(int i = 0; i < 6; ++i)
+    {
+      fillPalette(sources[i], ourBuiltinPalettes[0][i], false);
+      fillPalette(sources[i], ourBuiltinPalettes[1][i], true);
+    }
+  });
+}
 
-    // If color-loss is enabled, fill the odd numbered palette entries
-    // with gray values (calculated using the standard RGB -> grayscale
-    // conversion formula)
-    for(int j = 0; j < 128; ++j)
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Console::fillPalette(const uInt32* source, uInt32* palette, bool loss)
+{
+  // If color-loss is enabled, fill the odd numbered palette entries
+  // with gray values (calculated using the standard RGB -> grayscale
+  // conversion formula)
+  for(int j = 0; j < 128; ++j)
+  {
+    uInt32 pixel = source[(j<<1)];
+    palette[(j<<1)] = pixel;
+    if(loss)
     {
-      uInt32 pixel = palette[i][(j<<1)];
-      if(loss)
-      {
-        uInt8 r = (pixel >> 16) & 0xff;
-        uInt8 g = (pixel >> 8)  & 0xff;
-        uInt8 b = (pixel >> 0)  & 0xff;
-        uInt8 sum = (uInt8) (((float)r * 0.2989) +
-                             ((float)g * 0.5870) +
-                             ((float)b * 0.1140));
-        pixel = (sum << 16) + (sum << 8) + sum;
-      }
-      palette[i][(j<<1)+1] = pixel;
+      uInt8 r = (pixel >> 16) & 0xff;
+      uInt8 g = (pixel >> 8)  & 0xff;
+      uInt8 b = (pixel >> 0)  & 0xff;
+      uInt8 sum = (uInt8) (((float)r * 0.2989) +
+                           ((float)g * 0.5870) +
+                           ((float)b * 0.1140));
+      pixel = (sum << 16) + (sum << 8) + sum;
     }
+    palette[(j<<1)+1] = pixel;
   }
 }
 
@@ -680,7 +707,7 @@ uInt32 Console::getFrameRate() const
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-uInt32 Console::ourNTSCPalette[256] = {
+const uInt32 Console::ourNTSCPalette[256] = {
   0x000000, 0, 0x4a4a4a, 0, 0x6f6f6f, 0, 0x8e8e8e, 0,
   0xaaaaaa, 0, 0xc0c0c0, 0, 0xd6d6d6, 0, 0xececec, 0,
   0x484800, 0, 0x69690f, 0, 0x86861d, 0, 0xa2a22a, 0,
@@ -716,7 +743,7 @@ uInt32 Console::ourNTSCPalette[256] = {
 };
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-uInt32 Console::ourPALPalette[256] = {
+const uInt32 Console::ourPALPalette[256] = {
   0x000000, 0, 0x2b2b2b, 0, 0x525252, 0, 0x767676, 0,
   0x979797, 0, 0xb6b6b6, 0, 0xd2d2d2, 0, 0xececec, 0,
   0x000000, 0, 0x2b2b2b, 0, 0x525252, 0, 0x767676, 0,
@@ -752,7 +779,7 @@ uInt32 Console::ourPALPalette[256] = {
 };
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-uInt32 Console::ourSECAMPalette[256] = {
+const uInt32 Console::ourSECAMPalette[256] = {
   0x000000, 0, 0x2121ff, 0, 0xf03c79, 0, 0xff50ff, 0, 
   0x7fff00, 0, 0x7fffff, 0, 0xffff3f, 0, 0xffffff, 0, 
   0x000000, 0, 0x2121ff, 0, 0xf03c79, 0, 0xff50ff, 0, 
@@ -788,7 +815,7 @@ uInt32 Console::ourSECAMPalette[256] = {
 };
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-uInt32 Console::ourNTSCPaletteZ26[256] = {
+const uInt32 Console::ourNTSCPaletteZ26[256] = {
   0x000000, 0, 0x505050, 0, 0x646464, 0, 0x787878, 0,
   0x8c8c8c, 0, 0xa0a0a0, 0, 0xb4b4b4, 0, 0xc8c8c8, 0,
   0x445400, 0, 0x586800, 0, 0x6c7c00, 0, 0x809000, 0,
@@ -824,7 +851,7 @@ uInt32 Console::ourNTSCPaletteZ26[256] = {
 }; 
   
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-uInt32 Console::ourPALPaletteZ26[256] = {
+const uInt32 Console::ourPALPaletteZ26[256] = {
   0x000000, 0, 0x4c4c4c, 0, 0x606060, 0, 0x747474, 0,
   0x888888, 0, 0x9c9c9c, 0, 0xb0b0b0, 0, 0xc4c4c4, 0,
   0x000000, 0, 0x4c4c4c, 0, 0x606060, 0, 0x747474, 0,
@@ -860,7 +887,7 @@ uInt32 Console::ourPALPaletteZ26[256] = {
 }; 
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-uInt32 Console::ourSECAMPaletteZ26[256] = {
+const uInt32 Console::ourSECAMPaletteZ26[256] = {
   0x000000, 0, 0x2121ff, 0, 0xf03c79, 0, 0xff3cff, 0, 
   0x7fff00, 0, 0x7fffff, 0, 0xffff3f, 0, 0xffffff, 0, 
   0x000000, 0, 0x2121ff, 0, 0xf03c79, 0, 0xff3cff, 0, 
@@ -895,15 +922,6 @@ uInt32 Console::ourSECAMPaletteZ26[256] = {
   0x7fff00, 0, 0x7fffff, 0, 0xffff3f, 0, 0xffffff, 0
 };
 
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-uInt32 Console::ourUserNTSCPalette[256]  = { 0 }; // filled from external file
-
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-uInt32 Console::ourUserPALPalette[256]   = { 0 }; // filled from external file
-
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-uInt32 Console::ourUserSECAMPalette[256] = { 0 }; // filled from external file
-
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Console::Console(const Console& console)
   : myOSystem(console.myOSystem)
@@ -920,3 +938,6 @@ Console& Console::operator = (const Console&)
 
   return *this;
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 Console::ourBuiltinPalettes[2][6][256];
@@ -247,6 +247,18 @@ class Console
     */
     void setColorLossPalette(bool state);
 
+    /**
+      Builds ourBuiltinPalettes, once for all consoles.
+    */
+    static void computeBuiltinPalettes();
+
+    /**
+      Copies the even entries of 'source' into 'palette' (which may be the
+      same table) and fills the odd entries with the same colors, or with
+      their gray values for PAL color-loss.
+    */
+    static void fillPalette(const uInt32* source, uInt32* palette, bool loss);
+
     /**
       Returns a pointer to the palette data for the palette currently defined
       by the ROM properties.
@@ -302,20 +314,29 @@ class Console
     // Contains info about this console in std::string format
     std::string myAboutString;
 
-    // Table of RGB values for NTSC, PAL and SECAM
-    static uInt32 ourNTSCPalette[256];
-    static uInt32 ourPALPalette[256];
-    static uInt32 ourSECAMPalette[256];
+    // Indicates whether the palettes show PAL color-loss
+    bool myColorLoss;
+
+    // Table of RGB values for NTSC, PAL and SECAM; only the even entries
+    // are given, see ourBuiltinPalettes
+    static const uInt32 ourNTSCPalette[256];
+    static const uInt32 ourPALPalette[256];
+    static const uInt32 ourSECAMPalette[256];
 
     // Table of RGB values for NTSC, PAL and SECAM - Z26 version
-    static uInt32 ourNTSCPaletteZ26[256];
-    static uInt32 ourPALPaletteZ26[256];
-    static uInt32 ourSECAMPaletteZ26[256];
-
-    // Table of RGB values for NTSC, PAL and SECAM - user-defined
-    static uInt32 ourUserNTSCPalette[256];
-    static uInt32 ourUserPALPalette[256];
-    static uInt32 ourUserSECAMPalette[256];
+    static const uInt32 ourNTSCPaletteZ26[256];
+    static const uInt32 ourPALPaletteZ26[256];
+    static const uInt32 ourSECAMPaletteZ26[256];
+
+    // The six tables above with their odd entries filled in, without and
+    // with PAL color-loss; built once and shared by every console
+    static uInt32 ourBuiltinPalettes[2][6][256];
+
+    // Table of RGB values for NTSC, PAL and SECAM - user-defined, loaded
+    // by each console from the palette file
+    uInt32 myUserNTSCPalette[256];
+    uInt32 myUserPALPalette[256];
+    uInt32 myUserSECAMPalette[256];
 };
 
 } // namespace ale
@@ -17,15 +17,28 @@
 //============================================================================
 
 #include "Deserializer.hxx"
-#include <sstream>
+
+#include <cstring>
 
 
 using namespace ale;
 
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Deserializer::Deserializer(const std::string stream_str):
-myStream(stream_str) {
+Deserializer::Deserializer(const std::string& stream_str, Serializer::Format format):
+  myData(stream_str.data()),
+  mySize(stream_str.size()),
+  myPosition(0),
+  myFormat(format) {
+    
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Deserializer::Deserializer(const char* data, size_t size, Serializer::Format format):
+  myData(data),
+  mySize(size),
+  myPosition(0),
+  myFormat(format) {
     
 }
 
@@ -35,43 +48,58 @@ myStream(stream_str) {
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Deserializer::close(void)
 {
-  myStream.clear();
+  myPosition = mySize;
 }
 
 
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-int Deserializer::getInt(void)
+std::string Deserializer::getString(void)
 {
-  if(myStream.eof())
-    throw "Deserializer: end of file";
+  // Compact data leaves the device tags out
+  if(myFormat == Serializer::Compact)
+    return std::string();
+
+  int len = getInt();
+  if(len < 0)
+    throw "Deserializer: data corruption";
+  require((size_t)len);
 
-  int val = 0;
-  unsigned char buf[4];
-  myStream.read((char*)buf, 4);
-  for(int i = 0; i < 4; ++i)
-    val += (int)(buf[i]) << (i<<3);
+  std::string str(myData + myPosition, (size_t)len);
+  myPosition += (size_t)len;
 
-  return val;
+  return str;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-std::string Deserializer::getString(void)
+bool Deserializer::expectString(const std::string& str)
 {
+  if(myFormat == Serializer::Compact)
+    return true;
+
   int len = getInt();
-  std::string str;
-  str.resize((std::string::size_type)len);
-  myStream.read(&str[0], (std::streamsize)len);
+  if(len < 0)
+    throw "Deserializer: data corruption";
+  require((size_t)len);
 
-  if(myStream.bad())
-    throw "Deserializer: file read failed";
+  bool equal = (size_t)len == str.size() &&
+               memcmp(myData + myPosition, str.data(), str.size()) == 0;
+  myPosition += (size_t)len;
 
-  return str;
+  return equal;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bool Deserializer::getBool(void)
 {
+  if(myFormat == Serializer::Compact)
+  {
+    uInt8 b = getByte();
+    if(b > 1)
+      throw "Deserializer: data corruption";
+    return b == 1;
+  }
+
   bool result = false;
 
   int b = getInt();
@@ -84,3 +112,41 @@ bool Deserializer::getBool(void)
 
   return result;
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Deserializer::getBytes(uInt8* values, uInt32 count)
+{
+  if(myFormat == Serializer::Compact)
+  {
+    require(count);
+    memcpy(values, myData + myPosition, count);
+    myPosition += count;
+    return;
+  }
+
+  require(4 * (size_t)count);
+
+  const unsigned char* in = (const unsigned char*)myData + myPosition;
+  for(uInt32 i = 0; i < count; ++i)
+    values[i] = in[4 * i];
+
+  myPosition += 4 * (size_t)count;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Deserializer::expectLength(uInt32 count)
+{
+  // A corrupt length would read past the end of the array
+  if((uInt32)getInt() != count)
+    throw "Deserializer: data corruption";
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 Deserializer::getIndex(uInt32 count)
+{
+  uInt32 index = (uInt32)getInt();
+  if(index >= count)
+    throw "Deserializer: data corruption";
+
+  return index;
+}
@@ -19,8 +19,9 @@
 #ifndef DESERIALIZER_HXX
 #define DESERIALIZER_HXX
 
-#include <sstream>
+#include <string>
 #include "m6502/src/bspf/src/bspf.hxx"
+#include "Serializer.hxx"
 
 namespace ale {
 
@@ -38,17 +39,21 @@ namespace ale {
  Revised for ALE on Sep 20, 2009
  The new version uses a std::stringstream (not a file stream)
  
- TODO: don't copy the whole streams. 
+ The data is now read in place from a memory buffer, which must outlive
+ the Deserializer, in either of the Serializer's formats.
  */
 class Deserializer {
     public:
         /**
-         Creates a new Deserializer device.
+         Creates a new Deserializer device reading from the given data.
          */
-        Deserializer(const std::string stream_str);
+        Deserializer(const std::string& stream_str,
+                     Serializer::Format format = Serializer::Legacy);
+        Deserializer(const char* data, size_t size,
+                     Serializer::Format format = Serializer::Legacy);
         
         void close(void);
-
+        
         /**
          Reads an int value from the current input stream.
          
@@ -63,6 +68,14 @@ class Deserializer {
          */
         std::string getString(void);
         
+        /**
+         Reads a std::string from the current input stream and compares it
+         to the given one, without allocating.
+         
+         @result Whether the string read equals 'str'.
+         */
+        bool expectString(const std::string& str);
+        
         /**
          Reads a boolean value from the current input stream.
          
@@ -70,10 +83,54 @@ class Deserializer {
          */
         bool getBool(void);
         
+        /**
+         Reads a byte value from the current input stream.
+         
+         @result The byte value which has been read from the stream.
+         */
+        uInt8 getByte(void);
+        
+        /**
+         Reads an array of byte values written by Serializer::putBytes().
+         
+         @param values The array to read the values into.
+         @param count  The number of values to read.
+         */
+        void getBytes(uInt8* values, uInt32 count);
+        
+        /**
+         Reads the length written before an array of values and checks that
+         it is 'count', the size of the array they are read into.
+         
+         @param count The number of values expected.
+         */
+        void expectLength(uInt32 count);
+        
+        /**
+         Reads an integer that indexes an array, such as a bank number, and
+         checks that it is below 'count', the size of the array.
+         
+         @param count The number of elements in the array.
+         @return The index read from the input stream.
+         */
+        uInt32 getIndex(uInt32 count);
+        
         bool isOpen(void) {return true;}
+        
+        // Number of bytes read so far
+        size_t position(void) const { return myPosition; }
+        
+    private:
+        // Makes sure that 'size' more bytes can be read
+        void require(size_t size);
+        
     private:
-        // The stream to get the deserialized data from.
-        std::stringstream myStream;
+        // The data to deserialize, and the position of the next value in it.
+        const char* myData;
+        size_t mySize;
+        size_t myPosition;
+        
+        Serializer::Format myFormat;
         
         enum {
             TruePattern  = 0xfab1fab2,
@@ -81,6 +138,40 @@ class Deserializer {
         };
     };
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline void Deserializer::require(size_t size)
+{
+  if(mySize - myPosition < size)
+    throw "Deserializer: end of file";
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline int Deserializer::getInt(void)
+{
+  require(4);
+
+  const unsigned char* buf = (const unsigned char*)myData + myPosition;
+  myPosition += 4;
+
+  int val = 0;
+  for(int i = 0; i < 4; ++i)
+    val += (int)(buf[i]) << (i<<3);
+
+  return val;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline uInt8 Deserializer::getByte(void)
+{
+  if(myFormat == Serializer::Compact)
+  {
+    require(1);
+    return (uInt8) myData[myPosition++];
+  }
+
+  return (uInt8) getInt();
+}
+
 } // namespace ale
 
 #endif
@@ -24,6 +24,7 @@
 #include "Switches.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "m6502/src/System.hxx"
 
 using namespace ale;
@@ -213,6 +214,57 @@ uInt8 M6532::peek(uInt16 addr)
   }
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 M6532::stablePeekCycles(uInt16 addr, uInt32 cycle)
+{
+  switch(addr & 0x07)
+  {
+    case 0x00:    // Ports and data direction registers only change
+    case 0x01:    // when they are written to
+    case 0x02:
+    case 0x03:
+    {
+      return 0xFFFFFFFF;
+    }
+
+    case 0x04:    // Timer Output
+    case 0x06:
+    {
+      uInt32 delta = (cycle - 1) - myCyclesWhenTimerSet;
+      Int32 timer = (Int32)myTimer - (Int32)(delta >> myIntervalShift) - 1;
+
+      // Once the timer has expired reading it has side effects
+      if(timer < 0)
+      {
+        return 0;
+      }
+
+      // Otherwise it holds until the next interval starts
+      return (((delta >> myIntervalShift) + 1) << myIntervalShift) - delta;
+    }
+
+    case 0x05:    // Interrupt Flag
+    case 0x07:
+    {
+      uInt32 delta = (cycle - 1) - myCyclesWhenTimerSet;
+      Int32 timer = (Int32)myTimer - (Int32)(delta >> myIntervalShift) - 1;
+
+      // The flag is raised when the timer expires, and then only cleared
+      // by reading or setting the timer
+      if((timer >= 0) && !myTimerReadAfterInterrupt)
+      {
+        return (myTimer << myIntervalShift) - delta;
+      }
+      return 0xFFFFFFFF;
+    }
+
+    default:
+    {
+      return 0;
+    }
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void M6532::poke(uInt16 addr, uInt8 value)
 {
@@ -326,8 +378,7 @@ bool M6532::save(Serializer& out)
 
     // Output the RAM
     out.putInt(128);
-    for(uInt32 t = 0; t < 128; ++t)
-      out.putInt(myRAM[t]);
+    out.putBytes(myRAM, 128);
 
     out.putInt(myTimer);
     out.putInt(myIntervalShift);
@@ -358,13 +409,12 @@ bool M6532::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != device)
+    if(!in.expectString(device))
       return false;
 
     // Input the RAM
-    uInt32 limit = (uInt32) in.getInt();
-    for(uInt32 t = 0; t < limit; ++t)
-      myRAM[t] = (uInt8) in.getInt();
+    in.expectLength(sizeof(myRAM));
+    in.getBytes(myRAM, sizeof(myRAM));
 
     myTimer = (uInt32) in.getInt();
     myIntervalShift = (uInt32) in.getInt();
@@ -389,6 +439,21 @@ bool M6532::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6532::copyRaw(RawState& state)
+{
+  state.copyBytes(myRAM, 128);
+
+  state.copy(myTimer);
+  state.copy(myIntervalShift);
+  state.copy(myCyclesWhenTimerSet);
+  state.copy(myCyclesWhenInterruptReset);
+  state.copy(myTimerReadAfterInterrupt);
+
+  state.copy(myDDRA);
+  state.copy(myDDRB);
+}
+
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 M6532::M6532(const M6532& c)
@@ -99,6 +99,14 @@ class M6532 : public Device
     */
     virtual bool load(Deserializer& in);
 
+    /**
+      Saves, loads or measures the raw state of this device, as the
+      RawState's direction asks.
+
+      @param state The raw state to copy the fields to or from
+    */
+    virtual void copyRaw(RawState& state);
+
    public:
     /**
       Get the byte at the specified address
@@ -115,6 +123,19 @@ class M6532 : public Device
     */
     virtual void poke(uInt16 address, uInt8 value);
 
+    /**
+      Answer for how many system cycles, starting with the specified
+      one, peeking the address keeps returning the value it returns at
+      that cycle, and changes the device no more than the last of those
+      peeks alone would.  Devices that cannot tell answer 0, which is
+      always safe.
+
+      @param address The address to peek
+      @param cycle The system cycle to start from
+      @return The number of system cycles
+    */
+    virtual uInt32 stablePeekCycles(uInt16 address, uInt32 cycle);
+
   private:
     // Reference to the console
     const Console& myConsole;
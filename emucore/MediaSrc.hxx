@@ -72,6 +72,22 @@ class MediaSource
     */
     virtual uInt8* previousFrameBuffer() const = 0;
 
+    /**
+      Enables or disables drawing into the frame buffer.  While disabled,
+      frames are still fully emulated (including collision detection) but
+      the frame buffer contents are not updated.
+
+      @param enabled  Whether subsequent frames should be rendered
+    */
+    virtual void enableRendering(bool enabled) = 0;
+
+    /**
+      Answers whether frames are currently being rendered
+
+      @return true if the frame buffer is being drawn into
+    */
+    virtual bool renderingEnabled() const = 0;
+
   public:
     /**
       Answers the height of the frame buffer
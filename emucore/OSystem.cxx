@@ -21,6 +21,8 @@
 #include <fstream>
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
+#include <random>
 
 //ALE  #include "MediaFactory.hxx"
 
@@ -303,6 +305,9 @@ bool OSystem::createConsole(const std::string& romfile)
   // Do a little error checking; it shouldn't be necessary
   if(myConsole) deleteConsole();
 
+  // Everything random about the new console derives from the seed
+  seedRandomGenerator();
+
   bool retval = false, showmessage = false;
 
   // If a blank ROM has been given, we reload the current one (assuming one exists)
@@ -330,7 +335,9 @@ bool OSystem::createConsole(const std::string& romfile)
     if(queryConsoleInfo(image, size, md5, &cart, props))
     {
       // Create an instance of the 2600 game console
-      mySettings->setString("cpu", "low");
+      // Default to the low compatibility processor, which ALE has always used
+      if(mySettings->getString("cpu") == "")
+        mySettings->setString("cpu", "low");
       myConsole = new Console(this, cart, props);
       //ALE  myEventHandler->reset(EventHandler::S_EMULATE);
       //ALE  createFrameBuffer(false);  // Takes care of initializeVideo()
@@ -547,6 +554,20 @@ std::string OSystem::getROMInfo(const std::string& romfile)
   return buf.str();
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void OSystem::seedRandomGenerator()
+{
+  const std::string& seed = mySettings->getString("random_seed");
+  if(seed == "time")
+  {
+    // Systems created within the same second must not share a seed
+    std::random_device device;
+    myRandom.seed(device());
+  }
+  else
+    myRandom.seed((uInt32) atoi(seed.c_str()));
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bool OSystem::queryConsoleInfo(const uInt8* image, uInt32 size,
                                const std::string& md5,
@@ -592,7 +613,7 @@ bool OSystem::queryConsoleInfo(const uInt8* image, uInt32 size,
     s = mySettings->getString("hmove");
     if(s != "") props.set(Emulation_HmoveBlanks, s);
 
-  *cart = Cartridge::create(image, size, props, *mySettings);
+  *cart = Cartridge::create(image, size, props, *mySettings, myRandom);
   if(!*cart)
     return false;
 
@@ -38,6 +38,7 @@ class VideoDialog;
 #include "Sound.hxx"
 #include "common/SoundNull.hxx"
 #include "Settings.hxx"
+#include "Random.hxx"
 #include "Console.hxx"
 #include "Event.hxx"  //ALE 
 //ALE  #include "Font.hxx"
@@ -135,6 +136,15 @@ class OSystem
     */
     inline PropertiesSet& propSet() const { return *myPropSet; }
 
+    /**
+      Get the random number generator of the system. It is reseeded from
+      the 'random_seed' setting whenever a console is created, and is
+      never shared with other systems.
+
+      @return The random number generator
+    */
+    inline Random& rng() { return myRandom; }
+
     /**
       Get the console of the system.
 
@@ -427,6 +437,9 @@ class OSystem
 
     // Pointer to the (currently defined) Console object
     Console* myConsole;
+
+    // Random number generator of this system
+    Random myRandom;
     
 
     
@@ -522,6 +535,12 @@ class OSystem
     */
     void createSound();
 
+    /**
+      Reseeds the random number generator from the 'random_seed' setting;
+      'time' picks a fresh nondeterministic seed for every system.
+    */
+    void seedRandomGenerator();
+
     /**
       Query valid info for creating a valid console.
 
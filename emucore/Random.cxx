@@ -16,41 +16,32 @@
 // $Id: Random.cxx,v 1.4 2007/01/01 18:04:49 stephena Exp $
 //============================================================================
 
-#include <time.h>
 #include "Random.hxx"
 
 using namespace ale;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Random::seed(uInt32 value)
+Random::Random(uInt32 value)
+  : myGenerator(value)
 {
-  ourSeed = value;
-  ourSeeded = true;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Random::Random()
+void Random::seed(uInt32 value)
 {
-  // If we haven't been seeded then seed ourself
-  if(!ourSeeded)
-  {
-    std::cerr << "random seed " << std::endl;
-    ourSeed = (uInt32)time(0);
-    ourSeeded = true;
-  }
-
-  myValue = ourSeed;
+  myGenerator.seed(value);
 }
- 
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 uInt32 Random::next()
 {
-  return (myValue = (myValue * 2416 + 374441) % 1771875);
+  return static_cast<uInt32>(myGenerator());
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-uInt32 Random::ourSeed = 0;
-
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-bool Random::ourSeeded = false;
-
+double Random::nextDouble()
+{
+  // Scale rather than use std::uniform_real_distribution, whose output
+  // differs between standard libraries
+  return next() / 4294967296.0;
+}
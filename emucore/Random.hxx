@@ -19,14 +19,18 @@
 #ifndef RANDOM_HXX
 #define RANDOM_HXX
 
+#include <random>
+
 #include "m6502/src/bspf/src/bspf.hxx"
 
 namespace ale {
 
 /**
-  This is a quick-and-dirty random number generator.  It is based on 
-  information in Chapter 7 of "Numerical Recipes in C".  It's a simple 
-  linear congruential generator.
+  A seedable random number generator. Each emulator instance owns its own
+  generators, so that instances running on different threads neither race
+  nor depend on each other's draws: a given seed always yields the same
+  sequence. The sequences differ from those of the linear congruential
+  generator this class used to be.
 
   @author  Bradford W. Mott
   @version $Id: Random.hxx,v 1.4 2007/01/01 18:04:49 stephena Exp $
@@ -35,20 +39,20 @@ class Random
 {
   public:
     /**
-      Class method which allows you to set the seed that'll be used
-      for created new instances of this class
+      Create a new random number generator
 
       @param value The value to seed the random number generator with
     */
-    static void seed(uInt32 value);
+    explicit Random(uInt32 value = 0);
 
   public:
     /**
-      Create a new random number generator
+      Restart the sequence of random numbers from the given seed
+
+      @param value The value to seed the random number generator with
     */
-    Random();
-    
-  public:
+    void seed(uInt32 value);
+
     /**
       Answer the next random number from the random number generator
 
@@ -56,19 +60,19 @@ class Random
     */
     uInt32 next();
 
-  private:
-    // Indicates the next random number
-    uInt32 myValue;
+    /**
+      Answer the next random number, uniformly distributed in [0, 1)
 
-  private:
-    // Seed to use for creating new random number generators
-    static uInt32 ourSeed;
+      @return A random number
+    */
+    double nextDouble();
 
-    // Indicates if seed has been set or not
-    static bool ourSeeded;
+  private:
+    // The underlying generator; its output is specified by the standard,
+    // so sequences are the same on every platform
+    std::mt19937 myGenerator;
 };
 
 } // namespace ale
 
 #endif
-
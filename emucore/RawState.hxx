@@ -0,0 +1,136 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2007 by Bradford W. Mott and the Stella team
+//
+// See the file "license" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+//============================================================================
+
+#ifndef RAWSTATE_HXX
+#define RAWSTATE_HXX
+
+#include <cstring>
+#include "m6502/src/bspf/src/bspf.hxx"
+#include "Serializer.hxx"
+#include "Deserializer.hxx"
+
+namespace ale {
+
+/**
+  Copies the state of the emulator to or from a preallocated buffer, in
+  raw form: each field is copied as it is in memory, without tags, byte
+  order conversion or bounds checks.  Raw states are meant for clones
+  that never leave the process; they are only valid for the console
+  they were saved from.
+
+  Each device lists its fields once, in copyRaw(), which both saves and
+  loads them, as direction() asks.  A first pass with direction Measure
+  gives the size of the buffer; it stays the same for a console.
+*/
+class RawState
+{
+  public:
+    enum Direction {
+      Measure,  // Only count the bytes
+      Save,     // Copy the fields to the buffer
+      Load      // Copy the fields from the buffer
+    };
+
+    /**
+      Create a raw state copying in the given direction
+
+      @param direction The direction of the copies
+      @param buffer    The buffer, large enough for the state (unused
+                       when measuring)
+    */
+    RawState(Direction direction, uInt8* buffer = 0)
+      : myDirection(direction),
+        myBuffer(buffer),
+        mySize(0)
+    {
+    }
+
+    // The direction of the copies
+    Direction direction() const { return myDirection; }
+
+    // Number of bytes copied so far
+    uInt32 size() const { return mySize; }
+
+    /**
+      Copy a field
+
+      @param field The field to copy
+    */
+    template<typename T>
+    void copy(T& field)
+    {
+      if(myDirection == Save)
+        memcpy(myBuffer + mySize, &field, sizeof(T));
+      else if(myDirection == Load)
+        memcpy(&field, myBuffer + mySize, sizeof(T));
+      mySize += sizeof(T);
+    }
+
+    /**
+      Copy an array of bytes
+
+      @param fields The bytes to copy
+      @param count  The number of bytes
+    */
+    void copyBytes(uInt8* fields, uInt32 count)
+    {
+      if(myDirection == Save)
+        memcpy(myBuffer + mySize, fields, count);
+      else if(myDirection == Load)
+        memcpy(fields, myBuffer + mySize, count);
+      mySize += count;
+    }
+
+    /**
+      Copy an object that has no raw layout of its own through its save()
+      and load() methods, in the Compact format.  Such states still go
+      through the raw buffer, and are as fast as Compact snapshots.
+
+      @param object The object to copy
+    */
+    template<class Object>
+    void copySerialized(Object& object)
+    {
+      if(myDirection == Load)
+      {
+        // The Compact data is as long as when it was saved, which the
+        // Deserializer does not need to know up front
+        Deserializer in((const char*)myBuffer + mySize, ~(size_t)0 >> 1,
+                        Serializer::Compact);
+        if(!object.load(in))
+          throw "RawState: corrupt state";
+        mySize += (uInt32)in.position();
+      }
+      else
+      {
+        Serializer out(myDirection == Save ? myBuffer + mySize : 0,
+                       ~(size_t)0 >> 1, Serializer::Compact);
+        if(!object.save(out))
+          throw "RawState: state could not be saved";
+        mySize += (uInt32)out.size();
+      }
+    }
+
+  private:
+    Direction myDirection;
+    uInt8* myBuffer;
+    uInt32 mySize;
+};
+
+} // namespace ale
+
+#endif
@@ -18,14 +18,26 @@
 
 #include "Serializer.hxx"
 
-
 using namespace ale;
 
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Serializer::Serializer(void) {
-    myStream.clear();
-    
+Serializer::Serializer(size_t capacity, Format format):
+  myOwnsBuffer(true),
+  myExternal(0),
+  myCapacity(0),
+  mySize(0),
+  myFormat(format) {
+    myBuffer.reserve(capacity);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Serializer::Serializer(void* buffer, size_t capacity, Format format):
+  myOwnsBuffer(false),
+  myExternal((char*)buffer),
+  myCapacity(capacity),
+  mySize(0),
+  myFormat(format) {
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -38,36 +50,42 @@ Serializer::~Serializer(void)
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::close(void)
 {
-    myStream.clear();
+    myBuffer.clear();
 }
 
 
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Serializer::putInt(int value)
-{
-    unsigned char buf[4];
-    for(int i = 0; i < 4; ++i)
-        buf[i] = (value >> (i<<3)) & 0xff;
-    
-    myStream.write((char*)buf, 4);
-    if(myStream.bad())
-        throw "Serializer: file write failed";
-}
-
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::putString(const std::string& str)
 {
+    // Strings only tag the devices, which compact data does without
+    if(myFormat == Compact)
+        return;
+
     int len = static_cast<int>(str.length());
     putInt(len);
-    myStream.write(str.data(), (std::streamsize)len);
-    
-    if(myStream.bad())
-        throw "Serializer: file write failed";
+    write(str.data(), str.length());
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Serializer::putBool(bool b)
+void Serializer::putBytes(const uInt8* values, uInt32 count)
 {
-    putInt(b ? TruePattern: FalsePattern);
-}
+    if(myFormat == Compact)
+    {
+        write((const char*)values, count);
+    }
+    else if(myOwnsBuffer)
+    {
+        // Each byte takes up a whole int, its high bytes zero
+        size_t start = myBuffer.size();
+        myBuffer.resize(start + 4 * (size_t)count, '\0');
 
+        char* out = &myBuffer[start];
+        for(uInt32 i = 0; i < count; ++i)
+            out[4 * i] = (char)values[i];
+    }
+    else
+    {
+        for(uInt32 i = 0; i < count; ++i)
+            putInt(values[i]);
+    }
+}
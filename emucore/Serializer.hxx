@@ -19,7 +19,8 @@
 #ifndef SERIALIZER_HXX
 #define SERIALIZER_HXX
 
-#include <sstream>
+#include <cstring>
+#include <string>
 #include "m6502/src/bspf/src/bspf.hxx"
 
 namespace ale {
@@ -38,15 +39,37 @@ namespace ale {
   
   Revised for ALE on Sep 20, 2009
   The new version uses a std::stringstream (not a file stream)
+
+  The data is now appended to an in-memory byte buffer, which can be
+  reserved up front, or written to a caller-provided buffer.  In the
+  Compact format, bytes and booleans take a single byte and strings
+  (which only tag devices) are left out.
 */
 class Serializer
 {
   public:
+    enum Format {
+      Legacy,  // Every value takes an int, as in Stella's state files
+      Compact  // Values are packed and device tags are left out
+    };
+
+    /**
+      Creates a new Serializer device writing to its own buffer.
+
+      @param capacity  The number of bytes to reserve for the data
+      @param format    The layout of the serialized data
+    */
+    Serializer(size_t capacity = 0, Format format = Legacy);
+
     /**
-      Creates a new Serializer device.
+      Creates a new Serializer device writing to the given buffer; writing
+      past its end throws.  With a NULL buffer, the data is only measured.
 
+      @param buffer    The buffer to write to
+      @param capacity  The size of the buffer, in bytes
+      @param format    The layout of the serialized data
     */
-    Serializer(void);
+    Serializer(void* buffer, size_t capacity, Format format);
 
     /**
       Destructor
@@ -82,14 +105,55 @@ class Serializer
     */
     void putBool(bool b);
 
-    // Accessor for myStream
-    // TODO: don't copy the whole streams. 
-    std::string get_str(void) const {
-        return myStream.str();
+    /**
+      Writes a byte value to the current output stream.
+
+      @param value The byte value to write to the output stream.
+    */
+    void putByte(uInt8 value);
+
+    /**
+      Writes an array of byte values to the current output stream, as
+      'count' calls to putByte() would.
+
+      @param values The byte values to write to the output stream.
+      @param count  The number of values to write.
+    */
+    void putBytes(const uInt8* values, uInt32 count);
+
+    // The layout of the serialized data
+    Format format(void) const { return myFormat; }
+
+    // Number of bytes written so far
+    size_t size(void) const {
+        return myOwnsBuffer ? myBuffer.size() : mySize;
     }
+
+    // Accessor for the serialized data, when written to our own buffer
+    const std::string& get_str(void) const {
+        return myBuffer;
+    }
+
+    // Hands the serialized data over to 'str' without copying it
+    void swap_str(std::string& str) {
+        myBuffer.swap(str);
+    }
+
+  private:
+    // Appends raw bytes to the output
+    void write(const char* data, size_t size);
+
   private:
-    // The stream to send the serialized data to.
-    std::stringstream myStream;
+    // The buffer to send the serialized data to, if we own it.
+    std::string myBuffer;
+    bool myOwnsBuffer;
+
+    // Otherwise, the caller's buffer (NULL to only measure the data)
+    char* myExternal;
+    size_t myCapacity;
+    size_t mySize;
+
+    Format myFormat;
 
     enum {
       TruePattern  = 0xfab1fab2,
@@ -97,6 +161,55 @@ class Serializer
     };
 };
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline void Serializer::write(const char* data, size_t size)
+{
+  if(myOwnsBuffer)
+  {
+    myBuffer.append(data, size);
+    return;
+  }
+
+  if(myExternal != 0)
+  {
+    if(myCapacity - mySize < size)
+      throw "Serializer: buffer too small";
+    memcpy(myExternal + mySize, data, size);
+  }
+  mySize += size;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline void Serializer::putInt(int value)
+{
+  char buf[4];
+  for(int i = 0; i < 4; ++i)
+    buf[i] = (char)((value >> (i<<3)) & 0xff);
+
+  write(buf, 4);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline void Serializer::putBool(bool b)
+{
+  if(myFormat == Compact)
+  {
+    char c = b ? 1 : 0;
+    write(&c, 1);
+  }
+  else
+    putInt(b ? TruePattern: FalsePattern);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline void Serializer::putByte(uInt8 value)
+{
+  if(myFormat == Compact)
+    write((const char*)&value, 1);
+  else
+    putInt(value);
+}
+
 } // namespace ale
 
 #endif
@@ -20,12 +20,14 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <mutex>
 #include <stdint.h>
 
 #include "Console.hxx"
 #include "Control.hxx"
 #include "Serializer.hxx"
 #include "Deserializer.hxx"
+#include "RawState.hxx"
 #include "Settings.hxx"
 #include "Sound.hxx"
 #include "TIA.hxx"
@@ -98,17 +100,8 @@ TIA::TIA(const Console& console, Settings& settings)
     }
   }
 
-  for(i = 0; i < 640; ++i)
-    ourDisabledMaskTable[i] = 0;
-
-  // Compute all of the mask tables
-  computeBallMaskTable();
-  computeCollisionTable();
-  computeMissleMaskTable();
-  computePlayerMaskTable();
-  computePlayerPositionResetWhenTable();
-  computePlayerReflectTable();
-  computePlayfieldMaskTable();
+  // Compute all of the mask tables, once for all instances
+  computeTables();
 
   // Init stats counters
   myFrameCounter = 0;
@@ -408,7 +401,7 @@ bool TIA::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != device)
+    if(!in.expectString(device))
       return false;
 
     myClockWhenFrameStarted = (Int32) in.getInt();
@@ -456,22 +449,28 @@ bool TIA::load(Deserializer& in)
     myRESMP0 = in.getBool();
     myRESMP1 = in.getBool();
     myCollision = (uInt16) in.getInt();
-    myPOSP0 = (Int16) in.getInt();
-    myPOSP1 = (Int16) in.getInt();
-    myPOSM0 = (Int16) in.getInt();
-    myPOSM1 = (Int16) in.getInt();
-    myPOSBL = (Int16) in.getInt();
+    myPOSP0 = (Int16) in.getIndex(160);
+    myPOSP1 = (Int16) in.getIndex(160);
+    myPOSM0 = (Int16) in.getIndex(160);
+    myPOSM1 = (Int16) in.getIndex(160);
+    myPOSBL = (Int16) in.getIndex(160);
 
     myCurrentGRP0 = (uInt8) in.getInt();
     myCurrentGRP1 = (uInt8) in.getInt();
 
-// pointers
-//  myCurrentBLMask = ourBallMaskTable[0][0];
-//  myCurrentM0Mask = ourMissleMaskTable[0][0][0];
-//  myCurrentM1Mask = ourMissleMaskTable[0][0][0];
-//  myCurrentP0Mask = ourPlayerMaskTable[0][0][0];
-//  myCurrentP1Mask = ourPlayerMaskTable[0][0][0];
-//  myCurrentPFMask = ourPlayfieldTable[0];
+    // The mask pointers are not saved; rebuild them from the registers just
+    // loaded, as HMOVE does, rather than keeping those of the previous state
+    myCurrentPFMask = ourPlayfieldTable[myCTRLPF & 0x01];
+    myCurrentBLMask = &ourBallMaskTable[myPOSBL & 0x03]
+        [(myCTRLPF & 0x30) >> 4][160 - (myPOSBL & 0xFC)];
+    myCurrentP0Mask = &ourPlayerMaskTable[myPOSP0 & 0x03]
+        [0][myNUSIZ0 & 0x07][160 - (myPOSP0 & 0xFC)];
+    myCurrentP1Mask = &ourPlayerMaskTable[myPOSP1 & 0x03]
+        [0][myNUSIZ1 & 0x07][160 - (myPOSP1 & 0xFC)];
+    myCurrentM0Mask = &ourMissleMaskTable[myPOSM0 & 0x03]
+        [myNUSIZ0 & 0x07][(myNUSIZ0 & 0x30) >> 4][160 - (myPOSM0 & 0xFC)];
+    myCurrentM1Mask = &ourMissleMaskTable[myPOSM1 & 0x03]
+        [myNUSIZ1 & 0x07][(myNUSIZ1 & 0x30) >> 4][160 - (myPOSM1 & 0xFC)];
 
     myLastHMOVEClock = (Int32) in.getInt();
     myHMOVEBlankEnabled = in.getBool();
@@ -501,6 +500,88 @@ bool TIA::load(Deserializer& in)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void TIA::copyRaw(RawState& state)
+{
+  state.copy(myClockWhenFrameStarted);
+  state.copy(myClockStartDisplay);
+  state.copy(myClockStopDisplay);
+  state.copy(myClockAtLastUpdate);
+  state.copy(myClocksToEndOfScanLine);
+  state.copy(myScanlineCountForLastFrame);
+  state.copy(myCurrentScanline);
+  state.copy(myVSYNCFinishClock);
+
+  state.copy(myEnabledObjects);
+
+  state.copy(myVSYNC);
+  state.copy(myVBLANK);
+  state.copy(myNUSIZ0);
+  state.copy(myNUSIZ1);
+
+  state.copy(myCOLUP0);
+  state.copy(myCOLUP1);
+  state.copy(myCOLUPF);
+  state.copy(myCOLUBK);
+
+  state.copy(myCTRLPF);
+  state.copy(myPlayfieldPriorityAndScore);
+  state.copy(myREFP0);
+  state.copy(myREFP1);
+  state.copy(myPF);
+  state.copy(myGRP0);
+  state.copy(myGRP1);
+  state.copy(myDGRP0);
+  state.copy(myDGRP1);
+  state.copy(myENAM0);
+  state.copy(myENAM1);
+  state.copy(myENABL);
+  state.copy(myDENABL);
+  state.copy(myHMP0);
+  state.copy(myHMP1);
+  state.copy(myHMM0);
+  state.copy(myHMM1);
+  state.copy(myHMBL);
+  state.copy(myVDELP0);
+  state.copy(myVDELP1);
+  state.copy(myVDELBL);
+  state.copy(myRESMP0);
+  state.copy(myRESMP1);
+  state.copy(myCollision);
+  state.copy(myPOSP0);
+  state.copy(myPOSP1);
+  state.copy(myPOSM0);
+  state.copy(myPOSM1);
+  state.copy(myPOSBL);
+
+  state.copy(myCurrentGRP0);
+  state.copy(myCurrentGRP1);
+
+  // The mask pointers point into the tables shared by every TIA, so
+  // they are copied as they are rather than rebuilt as in load()
+  state.copy(myCurrentPFMask);
+  state.copy(myCurrentBLMask);
+  state.copy(myCurrentP0Mask);
+  state.copy(myCurrentP1Mask);
+  state.copy(myCurrentM0Mask);
+  state.copy(myCurrentM1Mask);
+
+  state.copy(myLastHMOVEClock);
+  state.copy(myHMOVEBlankEnabled);
+  state.copy(myM0CosmicArkMotionEnabled);
+  state.copy(myM0CosmicArkCounter);
+
+  state.copy(myDumpEnabled);
+  state.copy(myDumpDisabledCycle);
+
+  // The sound has no raw layout of its own
+  state.copySerialized(*mySound);
+
+  // Reset TIA bits to be on
+  if(state.direction() == RawState::Load)
+    enableBits(true);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void TIA::update()
 {
@@ -627,6 +708,26 @@ void TIA::setSound(Sound& sound)
   mySound = &sound;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void TIA::computeTables()
+{
+  // The tables are shared by every TIA, possibly created on several threads
+  static std::once_flag computed;
+
+  std::call_once(computed, []() {
+    for(uInt32 i = 0; i < 640; ++i)
+      ourDisabledMaskTable[i] = 0;
+
+    computeBallMaskTable();
+    computeCollisionTable();
+    computeMissleMaskTable();
+    computePlayerMaskTable();
+    computePlayerPositionResetWhenTable();
+    computePlayerReflectTable();
+    computePlayfieldMaskTable();
+  });
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void TIA::computeBallMaskTable()
 {
@@ -1980,6 +2081,23 @@ uInt8 TIA::peek(uInt16 addr)
   }
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 TIA::stablePeekCycles(uInt16 addr, uInt32)
+{
+  // Only the fire buttons hold still: the collision latches change as
+  // the frame is drawn and the paddle capacitors charge over time.
+  // Drawing is merely caught up with by the next access.
+  switch(addr & 0x000f)
+  {
+    case 0x0C:    // INPT4
+    case 0x0D:    // INPT5
+      return 0xFFFFFFFF;
+
+    default:
+      return 0;
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void TIA::poke(uInt16 addr, uInt8 value)
 {
@@ -2923,6 +3041,13 @@ inline void TIA::updateFrameScanlineFast(uInt32 clocksToUpdate, uInt32 hpos)
   // Calculate the ending frame pointer value
   uInt8* ending = myFramePointer + clocksToUpdate;
 
+  // See if we're in the vertical blank region; as in updateFrameScanline(),
+  // no collisions are registered there
+  if(myVBLANK & 0x02)
+  {
+  }
+  // Handle all other possible combinations
+  else
   {
     switch(myEnabledObjects | myPlayfieldPriorityAndScore)
     {
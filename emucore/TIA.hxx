@@ -119,6 +119,14 @@ class TIA : public Device , public MediaSource
     */
     virtual bool load(Deserializer& in);
 
+    /**
+      Saves, loads or measures the raw state of this device, as the
+      RawState's direction asks.
+
+      @param state The raw state to copy the fields to or from
+    */
+    virtual void copyRaw(RawState& state);
+
   public:
     /**
       Get the byte at the specified address
@@ -135,6 +143,19 @@ class TIA : public Device , public MediaSource
     */
     virtual void poke(uInt16 address, uInt8 value);
 
+    /**
+      Answer for how many system cycles, starting with the specified
+      one, peeking the address keeps returning the value it returns at
+      that cycle, and changes the device no more than the last of those
+      peeks alone would.  Devices that cannot tell answer 0, which is
+      always safe.
+
+      @param address The address to peek
+      @param cycle The system cycle to start from
+      @return The number of system cycles
+    */
+    virtual uInt32 stablePeekCycles(uInt16 address, uInt32 cycle);
+
   public:
     /**
       This method should be called at an interval corresponding to
@@ -156,6 +177,20 @@ class TIA : public Device , public MediaSource
     */
     uInt8* previousFrameBuffer() const { return myPreviousFrameBuffer; }
 
+    /**
+      Enables or disables drawing into the frame buffer
+
+      @param enabled  Whether subsequent frames should be rendered
+    */
+    void enableRendering(bool enabled) { fastUpdate = !enabled; }
+
+    /**
+      Answers whether frames are currently being rendered
+
+      @return true if the frame buffer is being drawn into
+    */
+    bool renderingEnabled() const { return !fastUpdate; }
+
     /**
       Answers the height of the frame buffer
 
@@ -222,26 +257,29 @@ class TIA : public Device , public MediaSource
     void enableBits(bool mode) { for(uInt8 i = 0; i < 6; ++i) myBitEnabled[i] = mode; }
 
   private:
+    // Compute all of the static tables below, the first time it is called
+    static void computeTables();
+
     // Compute the ball mask table
-    void computeBallMaskTable();
+    static void computeBallMaskTable();
 
     // Compute the collision decode table
-    void computeCollisionTable();
+    static void computeCollisionTable();
 
     // Compute the missle mask table
-    void computeMissleMaskTable();
+    static void computeMissleMaskTable();
 
     // Compute the player mask table
-    void computePlayerMaskTable();
+    static void computePlayerMaskTable();
 
     // Compute the player position reset when table
-    void computePlayerPositionResetWhenTable();
+    static void computePlayerPositionResetWhenTable();
 
     // Compute the player reflect table
-    void computePlayerReflectTable();
+    static void computePlayerReflectTable();
 
     // Compute playfield mask table
-    void computePlayfieldMaskTable();
+    static void computePlayfieldMaskTable();
 
   private:
     // Update the current frame buffer up to one scanline
@@ -533,6 +571,7 @@ class TIA : public Device , public MediaSource
 
   /** ALE-specific */
   private:
+    // When set, frames are emulated without drawing into the frame buffer
     bool fastUpdate;
    
     // Updates the frame's scanline but not the frame buffer 
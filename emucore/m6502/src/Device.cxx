@@ -17,6 +17,7 @@
 //============================================================================
 
 #include "Device.hxx"
+#include "emucore/RawState.hxx"
 
 using namespace ale;
 
@@ -37,3 +38,16 @@ void Device::systemCyclesReset()
   // By default I do nothing when my system resets its cycle counter
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 Device::stablePeekCycles(uInt16, uInt32)
+{
+  // By default I make no promises about my peeks
+  return 0;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Device::copyRaw(RawState& state)
+{
+  // By default I go through my serialized state
+  state.copySerialized(*this);
+}
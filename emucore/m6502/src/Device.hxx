@@ -24,6 +24,7 @@ namespace ale {
 class System;
 class Serializer;
 class Deserializer;
+class RawState;
 
 } // namespace ale
 
@@ -95,6 +96,15 @@ class Device
     */
     virtual bool load(Deserializer& in) = 0;
 
+    /**
+      Saves, loads or measures the raw state of this device, as the
+      RawState's direction asks.  Devices without a raw layout of their
+      own are copied through save() and load().
+
+      @param state The raw state to copy the fields to or from
+    */
+    virtual void copyRaw(RawState& state);
+
   public:
     /**
       Get the byte at the specified address
@@ -111,6 +121,19 @@ class Device
     */
     virtual void poke(uInt16 address, uInt8 value) = 0;
 
+    /**
+      Answer for how many system cycles, starting with the specified
+      one, peeking the address keeps returning the value it returns at
+      that cycle, and changes the device no more than the last of those
+      peeks alone would.  Devices that cannot tell answer 0, which is
+      always safe.
+
+      @param address The address to peek
+      @param cycle The system cycle to start from
+      @return The number of system cycles
+    */
+    virtual uInt32 stablePeekCycles(uInt16 address, uInt32 cycle);
+
   protected:
     /// Pointer to the system the device is installed in or the null pointer
     System* mySystem;
@@ -16,7 +16,10 @@
 // $Id: M6502.cxx,v 1.21 2007/01/01 18:04:50 stephena Exp $
 //============================================================================
 
+#include <mutex>
+
 #include "M6502.hxx"
+#include "emucore/RawState.hxx"
 
 using namespace ale;
 
@@ -28,14 +31,10 @@ M6502::M6502(uInt32 systemCyclesPerProcessorCycle)
 {
 
   // Compute the BCD lookup table
-  uInt16 t;
-  for(t = 0; t < 256; ++t)
-  {
-    ourBCDTable[0][t] = ((t >> 4) * 10) + (t & 0x0f);
-    ourBCDTable[1][t] = (((t % 100) / 10) << 4) | (t % 10);
-  }
+  computeBCDTable();
 
   // Compute the System Cycle table
+  uInt16 t;
   for(t = 0; t < 256; ++t)
   {
     myInstructionSystemCycleTable[t] = ourInstructionProcessorCycleTable[t] *
@@ -51,6 +50,21 @@ M6502::M6502(uInt32 systemCyclesPerProcessorCycle)
   PSPointer = (uint64_t *)p;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502::computeBCDTable()
+{
+  // The table is shared by every processor, possibly created on several threads
+  static std::once_flag computed;
+
+  std::call_once(computed, []() {
+    for(uInt16 t = 0; t < 256; ++t)
+    {
+      ourBCDTable[0][t] = ((t >> 4) * 10) + (t & 0x0f);
+      ourBCDTable[1][t] = (((t % 100) / 10) << 4) | (t % 10);
+    }
+  });
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 M6502::~M6502()
 {
@@ -81,6 +95,11 @@ void M6502::reset()
   PC = (uInt16)mySystem->peek(0xfffc) | ((uInt16)mySystem->peek(0xfffd) << 8);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502::pageAccessChanged(uInt16)
+{
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void M6502::irq()
 {
@@ -93,6 +112,27 @@ void M6502::nmi()
   myExecutionStatus |= NonmaskableInterruptBit;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502::copyRaw(RawState& state)
+{
+  state.copy(A);    // Accumulator
+  state.copy(X);    // X index register
+  state.copy(Y);    // Y index register
+  state.copy(SP);   // Stack Pointer
+  state.copy(IR);   // Instruction register
+  state.copy(PC);   // Program Counter
+
+  state.copy(N);     // N flag for processor status register
+  state.copy(V);     // V flag for processor status register
+  state.copy(B);     // B flag for processor status register
+  state.copy(D);     // D flag for processor status register
+  state.copy(I);     // I flag for processor status register
+  state.copy(notZ);  // Z flag complement for processor status register
+  state.copy(C);     // C flag for processor status register
+
+  state.copy(myExecutionStatus);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 M6502::AddressingMode M6502::addressingMode(uInt8 opcode) const
 {
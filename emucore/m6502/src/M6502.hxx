@@ -27,6 +27,7 @@ class D6502;
 class M6502;
 class Serializer;
 class Deserializer;
+class RawState;
 class Debugger;
 class CpuDebug;
 class Expression;
@@ -105,6 +106,14 @@ class M6502
     */
     virtual void irq();
 
+    /**
+      Invoked by the system whenever the access methods of a page
+      change, e.g. on a cartridge bank switch.
+
+      @param page The page whose access methods changed
+    */
+    virtual void pageAccessChanged(uInt16 page);
+
     /**
       Request a non-maskable interrupt
     */
@@ -126,6 +135,14 @@ class M6502
     */
     virtual bool load(Deserializer& in) = 0;
 
+    /**
+      Saves, loads or measures the raw state of this processor, as the
+      RawState's direction asks: the registers that save() writes.
+
+      @param state The raw state to copy the registers to or from
+    */
+    virtual void copyRaw(RawState& state);
+
     /**
       Get a null terminated string which is the processor's name (i.e. "M6532")
 
@@ -282,6 +299,9 @@ class M6502
     int myTotalInstructionCount;
     
   private:
+    /// Compute ourBCDTable, the first time it is called
+    static void computeBCDTable();
+
     uint64_t PSLockupTable[256];
     uint64_t *PSPointer;
 };
@@ -0,0 +1,469 @@
+//============================================================================
+//
+// MM     MM  6666  555555  0000   2222
+// MMMM MMMM 66  66 55     00  00 22  22
+// MM MMM MM 66     55     00  00     22
+// MM  M  MM 66666  55555  00  00  22222  --  "A 6502 Microprocessor Emulator"
+// MM     MM 66  66     55 00  00 22
+// MM     MM 66  66 55  55 00  00 22
+// MM     MM  6666   5555   0000  222222
+//
+// Copyright (c) 1995-2007 by Bradford W. Mott and the Stella team
+//
+// See the file "license" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+//============================================================================
+
+#include <cstring>
+
+#include "M6502Fast.hxx"
+#include "emucore/RawState.hxx"
+
+using namespace ale;
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+M6502Fast::M6502Fast(uInt32 systemCyclesPerProcessorCycle)
+    : M6502Low(systemCyclesPerProcessorCycle),
+      myAddressMask(0),
+      myPageShift(0),
+      myPageMask(0),
+      myPageCode(0),
+      myUnresolvedPage(0),
+      myUncachedPage(0),
+      myIdleLoopSkipping(false),
+      myExecution(0)
+{
+  memset(&myIdleLoopStatistics, 0, sizeof(myIdleLoopStatistics));
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+M6502Fast::~M6502Fast()
+{
+  forgetDecodedCode();
+
+  delete[] myPageCode;
+  delete[] myUnresolvedPage;
+  delete[] myUncachedPage;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline uInt8 M6502Fast::peek(uInt16 address)
+{
+  myLastAccessWasRead = true;
+  return mySystem->peek(address);
+}
+
+inline uInt8 M6502Fast::peekWithPC()
+{
+  myLastAccessWasRead = true;
+  return mySystem->peek(PC++);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline void M6502Fast::poke(uInt16 address, uInt8 value)
+{
+  mySystem->poke(address, value);
+  myLastAccessWasRead = false;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502Fast::install(System& system)
+{
+  M6502Low::install(system);
+
+  uInt16 pages = system.numberOfPages();
+  uInt16 pageSize = 1 << system.pageShift();
+
+  myPageShift = system.pageShift();
+  myPageMask = system.pageMask();
+  myAddressMask = (uInt16)(((uInt32)pages << myPageShift) - 1);
+
+  // Both placeholder pages have no handlers, so that their instructions
+  // are always looked up by decode()
+  myUnresolvedPage = new Instruction[pageSize];
+  myUncachedPage = new Instruction[pageSize];
+  memset(myUnresolvedPage, 0, pageSize * sizeof(Instruction));
+  memset(myUncachedPage, 0, pageSize * sizeof(Instruction));
+
+  myPageCode = new Instruction*[pages];
+  for(uInt16 page = 0; page < pages; ++page)
+  {
+    myPageCode[page] = myUnresolvedPage;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502Fast::pageAccessChanged(uInt16 page)
+{
+  if(myPageCode != 0)
+  {
+    myPageCode[page] = myUnresolvedPage;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502Fast::reset()
+{
+  M6502Low::reset();
+
+  // What idle loops did before is no longer relevant
+  ++myExecution;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool M6502Fast::load(Deserializer& in)
+{
+  ++myExecution;
+
+  return M6502Low::load(in);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502Fast::copyRaw(RawState& state)
+{
+  if(state.direction() == RawState::Load)
+  {
+    ++myExecution;
+  }
+
+  M6502Low::copyRaw(state);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502Fast::setIdleLoopSkipping(bool enable)
+{
+  if(enable == myIdleLoopSkipping)
+  {
+    return;
+  }
+  myIdleLoopSkipping = enable;
+
+  // Branches are only looked at when they are decoded
+  forgetDecodedCode();
+  if(myPageCode != 0)
+  {
+    for(uInt16 page = 0; page <= (myAddressMask >> myPageShift); ++page)
+    {
+      myPageCode[page] = myUnresolvedPage;
+    }
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502Fast::forgetDecodedCode()
+{
+  for(std::map<const uInt8*, Instruction*>::iterator i = myDecodedPages.begin();
+      i != myDecodedPages.end(); ++i)
+  {
+    delete[] i->second;
+  }
+  myDecodedPages.clear();
+  myIdleLoops.clear();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 M6502Fast::operandSize(uInt8 opcode)
+{
+  // JSR fetches its own operand, between its stack accesses
+  if(opcode == 0x20)
+  {
+    return 0;
+  }
+
+  switch(ourAddressingModeTable[opcode])
+  {
+    case Absolute:
+    case AbsoluteX:
+    case AbsoluteY:
+    case Indirect:
+      return 2;
+
+    case Immediate:
+    case Relative:
+    case Zero:
+    case ZeroX:
+    case ZeroY:
+    case IndirectX:
+    case IndirectY:
+      return 1;
+
+    default:
+      return 0;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const M6502Fast::Instruction* M6502Fast::decode(const void* const* handlers)
+{
+  uInt16 page = (PC & myAddressMask) >> myPageShift;
+  uInt16 offset = PC & myPageMask;
+
+  if(myPageCode[page] == myUnresolvedPage)
+  {
+    const uInt8* base = mySystem->getPageAccess(page).directPeekBase;
+    uInt32 pageSize = myPageMask + 1;
+
+    if((base == 0) || !mySystem->isReadOnlyMemory(base, pageSize))
+    {
+      myPageCode[page] = myUncachedPage;
+    }
+    else
+    {
+      Instruction*& code = myDecodedPages[base];
+      if(code == 0)
+      {
+        code = new Instruction[pageSize];
+        memset(code, 0, pageSize * sizeof(Instruction));
+      }
+      myPageCode[page] = code;
+    }
+  }
+
+  if(myPageCode[page] == myUncachedPage)
+  {
+    return 0;
+  }
+
+  const uInt8* bytes = mySystem->getPageAccess(page).directPeekBase + offset;
+  uInt8 opcode = bytes[0];
+  uInt32 size = 1 + operandSize(opcode);
+
+  // Illegal instructions and those whose operand lies on the next page
+  // are left to the fetching code
+  if((ourAddressingModeTable[opcode] == Invalid) ||
+      (offset + size > (uInt32)myPageMask + 1))
+  {
+    return 0;
+  }
+
+  Instruction& instruction = myPageCode[page][offset];
+  instruction.opcode = opcode;
+  instruction.lastByte = bytes[size - 1];
+  instruction.operand = (size > 1) ? bytes[1] : 0;
+  if(size > 2)
+  {
+    instruction.operand |= (uInt16)bytes[2] << 8;
+  }
+
+  instruction.loop = 0;
+  if(myIdleLoopSkipping && (ourAddressingModeTable[opcode] == Relative))
+  {
+    instruction.loop = findIdleLoop(bytes - offset, offset);
+  }
+
+  // Without threading any non-null handler will do.  Branches closing
+  // idle loops get the handler after the opcodes' ones.
+  static const char ourSwitchHandler = 0;
+  instruction.handler = (handlers == 0) ? &ourSwitchHandler :
+      handlers[(instruction.loop != 0) ? 256 : opcode];
+
+  return &instruction;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt16 M6502Fast::findIdleLoop(const uInt8* code, uInt16 offset)
+{
+  // The loop starts on the same page, before the branch
+  Int32 start = (Int32)offset + 2 + (Int8)code[offset + 1];
+  if((start < 0) || (start >= offset) || (myIdleLoops.size() == 0xFFFE))
+  {
+    return 0;
+  }
+
+  IdleLoop loop;
+  memset(&loop, 0, sizeof(loop));
+
+  uInt16 target = PC + 2 + (Int8)code[offset + 1];
+  uInt32 cycles = (((PC + 2) ^ target) & 0xff00) ?
+      mySystemCyclesPerProcessorCycle << 1 : mySystemCyclesPerProcessorCycle;
+
+  uInt32 address = start;
+  while(address < offset)
+  {
+    uInt8 opcode = code[address];
+
+    // Only instructions that change nothing but registers and flags
+    switch(opcode)
+    {
+      case 0x18: case 0x38: case 0x58: case 0x78:   // Flags
+      case 0xb8: case 0xd8: case 0xf8:
+      case 0x8a: case 0x98: case 0xa8: case 0xaa:   // Transfers
+      case 0xba: case 0xea:
+      case 0x88: case 0xc8: case 0xca: case 0xe8:   // Index arithmetic
+      case 0x0a: case 0x2a: case 0x4a: case 0x6a:   // Shifts of A
+      case 0x09: case 0x29: case 0x49: case 0x69:   // Immediate
+      case 0xa0: case 0xa2: case 0xa9: case 0xc0:
+      case 0xc9: case 0xe0: case 0xe9:
+      case 0x05: case 0x24: case 0x25: case 0x45:   // Zero page
+      case 0x65: case 0xa4: case 0xa5: case 0xa6:
+      case 0xc4: case 0xc5: case 0xe4: case 0xe5:
+      case 0x0d: case 0x2c: case 0x2d: case 0x4d:   // Absolute
+      case 0x6d: case 0xac: case 0xad: case 0xae:
+      case 0xcc: case 0xcd: case 0xec: case 0xed:
+        break;
+
+      default:
+        return 0;
+    }
+
+    if(++loop.instructions == 8)
+    {
+      return 0;
+    }
+
+    cycles += myInstructionSystemCycleTable[opcode];
+
+    if((ourAddressingModeTable[opcode] == Zero) ||
+        (ourAddressingModeTable[opcode] == Absolute))
+    {
+      if(loop.reads == 4)
+      {
+        return 0;
+      }
+
+      loop.readAddress[loop.reads] = code[address + 1];
+      if(ourAddressingModeTable[opcode] == Absolute)
+      {
+        loop.readAddress[loop.reads] |= (uInt16)code[address + 2] << 8;
+      }
+      loop.readCycles[loop.reads++] = cycles;
+    }
+
+    address += 1 + operandSize(opcode);
+  }
+
+  // The last instruction must end right before the branch
+  if(address != offset)
+  {
+    return 0;
+  }
+
+  loop.cycles = cycles + myInstructionSystemCycleTable[code[offset]];
+  loop.instructions++;
+
+  myIdleLoops.push_back(loop);
+  return (uInt16)myIdleLoops.size();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 M6502Fast::skipIdleLoop(const Instruction& branch, uInt32 number)
+{
+  IdleLoop& loop = myIdleLoops[branch.loop - 1];
+  uInt32 cycles = mySystem->cycles();
+  uInt8 ps = PS();
+
+  // The last iteration left everything as it found it.  It must have
+  // run in this call to execute, since inputs change between calls.
+  bool unchanged = loop.taken && (loop.execution == myExecution) &&
+      (cycles - loop.lastCycles == loop.cycles) &&
+      (A == loop.lastA) && (X == loop.lastX) && (Y == loop.lastY) &&
+      (SP == loop.lastSP) && (ps == loop.lastPS);
+
+  // Bits 6 and 7 of a branch's opcode select the flag it tests and
+  // bit 5 the value it branches on
+  bool flag;
+  switch(branch.opcode >> 6)
+  {
+    case 0: flag = N; break;
+    case 1: flag = V; break;
+    case 2: flag = C; break;
+    default: flag = !notZ; break;
+  }
+  bool taken = (flag == ((branch.opcode & 0x20) != 0));
+
+  loop.taken = taken;
+  loop.execution = myExecution;
+  loop.lastCycles = cycles;
+  loop.lastA = A;
+  loop.lastX = X;
+  loop.lastY = Y;
+  loop.lastSP = SP;
+  loop.lastPS = ps;
+
+  if(!unchanged || !taken)
+  {
+    return 0;
+  }
+
+  // So will the next ones, as long as every read returns what it did
+  // in the last iteration.  Memory cannot change, since the loop does
+  // not write and nothing else does while it runs.
+  uInt32 iterations = number / loop.instructions;
+  for(uInt32 i = 0; (i < loop.reads) && (iterations != 0); ++i)
+  {
+    uInt16 address = loop.readAddress[i];
+    const System::PageAccess& access =
+        mySystem->getPageAccess((address & myAddressMask) >> myPageShift);
+    if(access.directPeekBase != 0)
+    {
+      continue;
+    }
+
+    uInt32 read = cycles - loop.cycles + loop.readCycles[i];
+    uInt32 stable = access.device->stablePeekCycles(address, read);
+    if(stable == 0)
+    {
+      return 0;
+    }
+    if((stable - 1) / loop.cycles < iterations)
+    {
+      iterations = (stable - 1) / loop.cycles;
+    }
+  }
+
+  if(iterations == 0)
+  {
+    return 0;
+  }
+
+  // Devices are peeked once more, in the last iteration, as a peek may
+  // catch up with the time elapsed (the TIA draws the frame so far)
+  uInt32 end = cycles + iterations * loop.cycles;
+  for(uInt32 i = 0; i < loop.reads; ++i)
+  {
+    uInt16 address = loop.readAddress[i];
+    const System::PageAccess& access =
+        mySystem->getPageAccess((address & myAddressMask) >> myPageShift);
+    if(access.directPeekBase == 0)
+    {
+      mySystem->incrementCycles(end - loop.cycles + loop.readCycles[i] -
+          mySystem->cycles());
+      access.device->peek(address);
+    }
+  }
+  mySystem->incrementCycles(end - mySystem->cycles());
+  loop.lastCycles = end;
+
+  myIdleLoopStatistics.skips++;
+  myIdleLoopStatistics.skippedInstructions += iterations * loop.instructions;
+  myIdleLoopStatistics.skippedCycles += iterations * loop.cycles;
+
+  return iterations * loop.instructions;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502Fast::executeFetched()
+{
+  uInt16 operandAddress = 0;
+  uInt8 operand = 0;
+
+  // Fetch instruction at the program counter
+  IR = peekWithPC();
+
+  // Update system cycles
+  mySystem->incrementCycles(myInstructionSystemCycleTable[IR]); 
+
+  // Call code to execute the instruction
+  switch(IR)
+  {
+    // 6502 instruction emulation is generated by an M4 macro file
+    #include "M6502Low.ins"
+
+    default:
+      // Oops, illegal instruction executed so set fatal error flag
+      myExecutionStatus |= FatalErrorBit;
+      std::cerr << "Illegal Instruction! " 
+        << std::hex << (int) IR << std::endl;
+  }
+}
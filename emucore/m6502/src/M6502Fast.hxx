@@ -0,0 +1,281 @@
+//============================================================================
+//
+// MM     MM  6666  555555  0000   2222
+// MMMM MMMM 66  66 55     00  00 22  22
+// MM MMM MM 66     55     00  00     22
+// MM  M  MM 66666  55555  00  00  22222  --  "A 6502 Microprocessor Emulator"
+// MM     MM 66  66     55 00  00 22
+// MM     MM 66  66 55  55 00  00 22
+// MM     MM  6666   5555   0000  222222
+//
+// Copyright (c) 1995-2007 by Bradford W. Mott and the Stella team
+//
+// See the file "license" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+//============================================================================
+
+#ifndef M6502FAST_HXX
+#define M6502FAST_HXX
+
+namespace ale {
+
+class M6502Fast;
+
+}
+
+#include <map>
+#include <vector>
+
+#include "bspf/src/bspf.hxx"
+#include "M6502Low.hxx"
+
+namespace ale {
+
+/**
+  This class provides a 6502 microprocessor emulator that behaves
+  exactly like M6502Low, and shares its saved state, but does not fetch
+  code from cartridge ROM through the system.  Instead, instructions are
+  decoded once into a cache of handlers and operands for each block of
+  ROM a page maps, and executed with threaded dispatch.  The cache is
+  keyed by the memory a page maps, so it survives bank switches: a
+  page whose access methods change is simply looked up again.
+
+  Code in RAM, on pages accessed through devices or crossing a page
+  boundary is run the same way as M6502Low does.
+
+  Optionally, idle loops are skipped: short loops closed by a backward
+  branch whose body only changes registers and reads memory at fixed
+  addresses, the way games poll the timer or a fire button.  Once an
+  iteration of such a loop leaves the processor as it found it, the
+  following ones do too for as long as the devices read promise to
+  answer the same (see Device::stablePeekCycles), so those iterations
+  are accounted for in one step.
+
+  This class holds the cache; M6502FastBus runs the decoded code.
+  Threaded dispatch relies on the labels as values extension of GCC
+  and Clang; other compilers dispatch through a switch.
+*/
+class M6502Fast : public M6502Low
+{
+  protected:
+    /**
+      Create a new predecoding 6502 microprocessor with the specified
+      cycle multiplier.
+
+      @param systemCyclesPerProcessorCycle The cycle multiplier
+    */
+    M6502Fast(uInt32 systemCyclesPerProcessorCycle);
+
+  public:
+    /**
+      Destructor
+    */
+    virtual ~M6502Fast();
+
+  public:
+    /**
+      Install the processor in the specified system.  Invoked by the
+      system when the processor is attached to it.
+
+      @param system The system the processor should install itself in
+    */
+    virtual void install(System& system);
+
+    /**
+      Forget which decoded code the page maps.
+
+      @param page The page whose access methods changed
+    */
+    virtual void pageAccessChanged(uInt16 page);
+
+    /**
+      Reset CPU to its power-on state
+    */
+    virtual void reset();
+
+    /**
+      Loads the current state of this device from the given Deserializer.
+
+      @param in The deserializer device to load from.
+      @return The result of the load.  True on success, false on failure.
+    */
+    virtual bool load(Deserializer& in);
+
+    /**
+      Saves, loads or measures the raw state of this processor, as the
+      RawState's direction asks.
+
+      @param state The raw state to copy the registers to or from
+    */
+    virtual void copyRaw(RawState& state);
+
+  public:
+    /**
+      Counts of instructions and idle loop skips since the processor
+      was created
+    */
+    struct IdleLoopStatistics
+    {
+      uint64_t instructions;        // Emulated, the skipped ones included
+      uint64_t skippedInstructions;
+      uint64_t skippedCycles;       // System cycles
+      uint64_t skips;               // Times a loop was fast-forwarded
+    };
+
+    /**
+      Enable or disable skipping idle loops
+
+      @param enable true iff idle loops should be skipped
+    */
+    void setIdleLoopSkipping(bool enable);
+
+    /**
+      Answer the counts of instructions and idle loop skips
+
+      @return The statistics
+    */
+    const IdleLoopStatistics& idleLoopStatistics() const
+    {
+      return myIdleLoopStatistics;
+    }
+
+  protected:
+    /*
+      Get the byte at the specified address 
+
+      @return The byte at the specified address
+    */
+    inline uInt8 peek(uInt16 address);
+    inline uInt8 peekWithPC();
+    
+    /**
+      Change the byte at the specified address to the given value
+
+      @param address The address where the value should be stored
+      @param value The value to be stored at the address
+    */
+    inline void poke(uInt16 address, uInt8 value);
+
+    /**
+      Fetch the instruction at the program counter through the system
+      and execute it, as M6502Low does.
+    */
+    void executeFetched();
+
+  protected:
+    /**
+      An instruction decoded from ROM
+    */
+    struct Instruction
+    {
+      const void* handler;  // Code emulating the opcode, or null until decoded
+      uInt16 operand;       // Operand bytes, low byte first
+      uInt8 opcode;
+      uInt8 lastByte;       // Last byte of the instruction, left on the data bus
+      uInt16 loop;          // One plus the index of the idle loop the branch
+                            // closes, or zero
+    };
+
+    /**
+      A loop that may be idle, and what it did when last run
+    */
+    struct IdleLoop
+    {
+      uInt32 cycles;        // System cycles per iteration
+      uInt32 instructions;  // Instructions per iteration, the branch included
+      uInt32 reads;
+      uInt16 readAddress[4];
+      uInt32 readCycles[4]; // System cycles from reaching the branch to
+                            // each read in the next iteration
+
+      // Processor state when the branch was last reached, valid only
+      // if the branch was taken during the same execution
+      bool taken;
+      uInt32 execution;
+      uInt32 lastCycles;
+      uInt8 lastA, lastX, lastY, lastSP, lastPS;
+    };
+
+    /**
+      Decode the instruction at the program counter, if it can be cached.
+
+      @param handlers The handler of each opcode, or null without threading
+      @return The decoded instruction, or null if it must be fetched
+    */
+    const Instruction* decode(const void* const* handlers);
+
+    /**
+      Number of operand bytes decoded ahead of an instruction's handler
+
+      @param opcode The opcode of the instruction
+      @return The number of operand bytes
+    */
+    static uInt32 operandSize(uInt8 opcode);
+
+    /**
+      Look for an idle loop closed by the branch at the program counter
+
+      @param code The memory the branch's page maps
+      @param offset The offset of the branch in the page
+      @return One plus the index of the loop found, or zero
+    */
+    uInt16 findIdleLoop(const uInt8* code, uInt16 offset);
+
+    /**
+      Called when the branch closing an idle loop is reached.  Skips as
+      many of the loop's iterations as provably change nothing but the
+      cycle count, within the given number of instructions.
+
+      @param branch The branch closing the loop
+      @param number The number of instructions left to execute
+      @return The number of instructions skipped
+    */
+    uInt32 skipIdleLoop(const Instruction& branch, uInt32 number);
+
+  private:
+    /**
+      Discard all decoded instructions and idle loops
+    */
+    void forgetDecodedCode();
+
+  protected:
+    // Mask to apply to an address before looking up its page
+    uInt16 myAddressMask;
+
+    // Amount to shift an address by to determine what page it's on
+    uInt16 myPageShift;
+
+    // Mask to apply to an address to obtain its page offset
+    uInt16 myPageMask;
+
+    // Decoded instructions of the memory each page maps, or one of the
+    // two pages below
+    Instruction** myPageCode;
+
+    // Stands for pages that have not been looked up since they changed
+    Instruction* myUnresolvedPage;
+
+    // Stands for pages whose code is fetched through the system
+    Instruction* myUncachedPage;
+
+    // Decoded instructions, by the memory they were decoded from
+    std::map<const uInt8*, Instruction*> myDecodedPages;
+
+    // Indicates if idle loops are skipped
+    bool myIdleLoopSkipping;
+
+    // Idle loops found in the decoded instructions
+    std::vector<IdleLoop> myIdleLoops;
+
+    // Counts calls to execute, and resets and loads, which make what
+    // idle loops did before irrelevant
+    uInt32 myExecution;
+
+    // Counts of instructions and idle loop skips
+    IdleLoopStatistics myIdleLoopStatistics;
+};
+
+} // namespace ale
+
+#endif
@@ -0,0 +1,303 @@
+//============================================================================
+//
+// MM     MM  6666  555555  0000   2222
+// MMMM MMMM 66  66 55     00  00 22  22
+// MM MMM MM 66     55     00  00     22
+// MM  M  MM 66666  55555  00  00  22222  --  "A 6502 Microprocessor Emulator"
+// MM     MM 66  66     55 00  00 22
+// MM     MM 66  66 55  55 00  00 22
+// MM     MM  6666   5555   0000  222222
+//
+// Copyright (c) 1995-2005 by Bradford W. Mott and the Stella team
+//
+// See the file "license" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+//============================================================================
+
+/**
+  Code to handle addressing modes and branch instructions for the
+  predecoded 6502 emulator.  The opcode and operand bytes have already
+  been read from the decoded instruction cache: PC points past the
+  opcode and instructionOperand holds the operand bytes (low byte first).
+  Each addressing mode steps PC past its operand itself, so that the
+  next instruction's address does not wait on the cache.  Only the
+  data accesses of each instruction reach the system.
+
+  M6502Fast.ins is generated from this file and M6502.m4 with
+
+    m4 M6502Fast.m4 M6502.m4 | sed -e 's/^case 0x\(..\):/M6502_FAST_OPCODE(0x\L\1)/' \
+        -e 's/^break;/M6502_FAST_NEXT/' > M6502Fast.ins
+*/
+
+#ifndef NOTSAMEPAGE
+  #define NOTSAMEPAGE(_addr1, _addr2) (((_addr1) ^ (_addr2)) & 0xff00)
+#endif
+
+define(M6502_IMPLIED, `{
+}')
+
+define(M6502_IMMEDIATE_READ, `{
+  operandAddress = PC++;
+  operand = (uInt8)instructionOperand;
+}')
+
+define(M6502_ABSOLUTE_READ, `{
+  PC += 2;
+  operandAddress = instructionOperand;
+  operand = peek(operandAddress);
+}')
+
+define(M6502_ABSOLUTE_WRITE, `{
+  PC += 2;
+  operandAddress = instructionOperand;
+}')
+
+define(M6502_ABSOLUTE_READMODIFYWRITE, `{
+  PC += 2;
+  operandAddress = instructionOperand;
+  operand = peek(operandAddress);
+}')
+
+define(M6502_ABSOLUTEX_READ, `{
+  PC += 2;
+  operandAddress = instructionOperand;
+
+  // See if we need to add one cycle for indexing across a page boundary
+  if(NOTSAMEPAGE(operandAddress, operandAddress + X))
+  {
+    mySystem->incrementCycles(mySystemCyclesPerProcessorCycle);
+  }
+
+  operandAddress += X;
+  operand = peek(operandAddress);
+}')
+
+define(M6502_ABSOLUTEX_WRITE, `{
+  PC += 2;
+  operandAddress = instructionOperand + X;
+}')
+
+define(M6502_ABSOLUTEX_READMODIFYWRITE, `{
+  PC += 2;
+  operandAddress = instructionOperand + X;
+  operand = peek(operandAddress);
+}')
+
+define(M6502_ABSOLUTEY_READ, `{
+  PC += 2;
+  operandAddress = instructionOperand;
+
+  // See if we need to add one cycle for indexing across a page boundary
+  if(NOTSAMEPAGE(operandAddress, operandAddress + Y))
+  {
+    mySystem->incrementCycles(mySystemCyclesPerProcessorCycle);
+  }
+
+  operandAddress += Y;
+  operand = peek(operandAddress);
+}')
+
+define(M6502_ABSOLUTEY_WRITE, `{
+  PC += 2;
+  operandAddress = instructionOperand + Y;
+}')
+
+define(M6502_ABSOLUTEY_READMODIFYWRITE, `{
+  PC += 2;
+  operandAddress = instructionOperand + Y;
+  operand = peek(operandAddress);
+}')
+
+define(M6502_ZERO_READ, `{
+  PC += 1;
+  operandAddress = instructionOperand;
+  operand = peek(operandAddress);
+}')
+
+define(M6502_ZERO_WRITE, `{
+  PC += 1;
+  operandAddress = instructionOperand;
+}')
+
+define(M6502_ZERO_READMODIFYWRITE, `{
+  PC += 1;
+  operandAddress = instructionOperand;
+  operand = peek(operandAddress);
+}')
+
+define(M6502_ZEROX_READ, `{
+  PC += 1;
+  operandAddress = (uInt8)(instructionOperand + X);
+  operand = peek(operandAddress); 
+}')
+
+define(M6502_ZEROX_WRITE, `{
+  PC += 1;
+  operandAddress = (uInt8)(instructionOperand + X);
+}')
+
+define(M6502_ZEROX_READMODIFYWRITE, `{
+  PC += 1;
+  operandAddress = (uInt8)(instructionOperand + X);
+  operand = peek(operandAddress);
+}')
+
+define(M6502_ZEROY_READ, `{
+  PC += 1;
+  operandAddress = (uInt8)(instructionOperand + Y);
+  operand = peek(operandAddress); 
+}')
+
+define(M6502_ZEROY_WRITE, `{
+  PC += 1;
+  operandAddress = (uInt8)(instructionOperand + Y);
+}')
+
+define(M6502_ZEROY_READMODIFYWRITE, `{
+  PC += 1;
+  operandAddress = (uInt8)(instructionOperand + Y);
+  operand = peek(operandAddress);
+}')
+
+define(M6502_INDIRECT, `{
+  PC += 2;
+  uInt16 addr = instructionOperand;
+
+  // Simulate the error in the indirect addressing mode!
+  uInt16 high = NOTSAMEPAGE(addr, addr + 1) ? (addr & 0xff00) : (addr + 1);
+
+  operandAddress = peek(addr) | ((uInt16)peek(high) << 8);
+}')
+
+define(M6502_INDIRECTX_READ, `{
+  PC += 1;
+  uInt8 pointer = instructionOperand + X;
+  operandAddress = peek(pointer) | ((uInt16)peek(pointer + 1) << 8);
+  operand = peek(operandAddress);
+}')
+
+define(M6502_INDIRECTX_WRITE, `{
+  PC += 1;
+  uInt8 pointer = instructionOperand + X;
+  operandAddress = peek(pointer) | ((uInt16)peek(pointer + 1) << 8);
+}')
+
+define(M6502_INDIRECTX_READMODIFYWRITE, `{
+  PC += 1;
+  uInt8 pointer = instructionOperand + X;
+  operandAddress = peek(pointer) | ((uInt16)peek(pointer + 1) << 8);
+  operand = peek(operandAddress);
+}')
+
+define(M6502_INDIRECTY_READ, `{
+  PC += 1;
+  uInt8 pointer = instructionOperand;
+  operandAddress = (uInt16)peek(pointer) | ((uInt16)peek(pointer + 1) << 8); 
+
+  if(NOTSAMEPAGE(operandAddress, operandAddress + Y))
+  {
+    mySystem->incrementCycles(mySystemCyclesPerProcessorCycle);
+  }
+
+  operandAddress += Y;
+  operand = peek(operandAddress);
+}')
+
+define(M6502_INDIRECTY_WRITE, `{
+  PC += 1;
+  uInt8 pointer = instructionOperand;
+  operandAddress = (uInt16)peek(pointer) | ((uInt16)peek(pointer + 1) << 8); 
+  operandAddress += Y;
+}')
+
+define(M6502_INDIRECTY_READMODIFYWRITE, `{
+  PC += 1;
+  uInt8 pointer = instructionOperand;
+  operandAddress = (uInt16)peek(pointer) | ((uInt16)peek(pointer + 1) << 8); 
+  operandAddress += Y;
+  operand = peek(operandAddress);
+}')
+
+
+define(M6502_BCC, `{
+  if(!C)
+  {
+    uInt16 address = PC + (Int8)operand;
+    mySystem->incrementCycles(NOTSAMEPAGE(PC, address) ?
+        mySystemCyclesPerProcessorCycle << 1 : mySystemCyclesPerProcessorCycle);
+    PC = address;
+  }
+}')
+
+define(M6502_BCS, `{
+  if(C)
+  {
+    uInt16 address = PC + (Int8)operand;
+    mySystem->incrementCycles(NOTSAMEPAGE(PC, address) ?
+        mySystemCyclesPerProcessorCycle << 1 : mySystemCyclesPerProcessorCycle);
+    PC = address;
+  }
+}')
+
+define(M6502_BEQ, `{
+  if(!notZ)
+  {
+    uInt16 address = PC + (Int8)operand;
+    mySystem->incrementCycles(NOTSAMEPAGE(PC, address) ?
+        mySystemCyclesPerProcessorCycle << 1 : mySystemCyclesPerProcessorCycle);
+    PC = address;
+  }
+}')
+
+define(M6502_BMI, `{
+  if(N)
+  {
+    uInt16 address = PC + (Int8)operand;
+    mySystem->incrementCycles(NOTSAMEPAGE(PC, address) ?
+        mySystemCyclesPerProcessorCycle << 1 : mySystemCyclesPerProcessorCycle);
+    PC = address;
+  }
+}')
+
+define(M6502_BNE, `{
+  if(notZ)
+  {
+    uInt16 address = PC + (Int8)operand;
+    mySystem->incrementCycles(NOTSAMEPAGE(PC, address) ?
+        mySystemCyclesPerProcessorCycle << 1 : mySystemCyclesPerProcessorCycle);
+    PC = address;
+  }
+}')
+
+define(M6502_BPL, `{
+  if(!N)
+  {
+    uInt16 address = PC + (Int8)operand;
+    mySystem->incrementCycles(NOTSAMEPAGE(PC, address) ?
+        mySystemCyclesPerProcessorCycle << 1 : mySystemCyclesPerProcessorCycle);
+    PC = address;
+  }
+}')
+
+define(M6502_BVC, `{
+  if(!V)
+  {
+    uInt16 address = PC + (Int8)operand;
+    mySystem->incrementCycles(NOTSAMEPAGE(PC, address) ?
+        mySystemCyclesPerProcessorCycle << 1 : mySystemCyclesPerProcessorCycle);
+    PC = address;
+  }
+}')
+
+define(M6502_BVS, `{
+  if(V)
+  {
+    uInt16 address = PC + (Int8)operand;
+    mySystem->incrementCycles(NOTSAMEPAGE(PC, address) ?
+        mySystemCyclesPerProcessorCycle << 1 : mySystemCyclesPerProcessorCycle);
+    PC = address;
+  }
+}')
+
+
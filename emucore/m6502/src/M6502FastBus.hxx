@@ -0,0 +1,336 @@
+//============================================================================
+//
+// MM     MM  6666  555555  0000   2222
+// MMMM MMMM 66  66 55     00  00 22  22
+// MM MMM MM 66     55     00  00     22
+// MM  M  MM 66666  55555  00  00  22222  --  "A 6502 Microprocessor Emulator"
+// MM     MM 66  66     55 00  00 22
+// MM     MM 66  66 55  55 00  00 22
+// MM     MM  6666   5555   0000  222222
+//
+// Copyright (c) 1995-2007 by Bradford W. Mott and the Stella team
+//
+// See the file "license" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+//============================================================================
+
+#ifndef M6502FASTBUS_HXX
+#define M6502FASTBUS_HXX
+
+namespace ale {
+
+class Device;
+template<class Bus> class M6502FastBus;
+
+}
+
+#include "bspf/src/bspf.hxx"
+#include "Device.hxx"
+#include "M6502Fast.hxx"
+
+namespace ale {
+
+/**
+  A bus that reaches every device through its virtual methods
+*/
+class DeviceBus
+{
+  public:
+    uInt8 peek(Device& device, uInt16 address)
+    {
+      return device.peek(address);
+    }
+
+    void poke(Device& device, uInt16 address, uInt8 value)
+    {
+      device.poke(address, value);
+    }
+};
+
+/**
+  The predecoding 6502 microprocessor emulator, with its execution loop
+  instantiated for a bus.  Data accesses that reach a device go through
+  the bus, which may call the devices it knows without virtual dispatch
+  so that their code can be inlined into the loop.  A bus provides
+
+    uInt8 peek(Device& device, uInt16 address);
+    void poke(Device& device, uInt16 address, uInt8 value);
+
+  Consoles use DeviceBus.  The processors xitari_recompile generates
+  from a ROM bring a bus that calls their cartridge, the TIA and the
+  M6532 directly (see M6502RecompiledBus).
+*/
+template<class Bus>
+class M6502FastBus : public M6502Fast
+{
+  public:
+    /**
+      Create a new predecoding 6502 microprocessor with the specified
+      cycle multiplier, reaching devices through the given bus.
+
+      @param systemCyclesPerProcessorCycle The cycle multiplier
+      @param bus The bus to reach devices through
+    */
+    M6502FastBus(uInt32 systemCyclesPerProcessorCycle, const Bus& bus = Bus())
+      : M6502Fast(systemCyclesPerProcessorCycle),
+        myBus(bus)
+    {
+    }
+
+    /**
+      Destructor
+    */
+    virtual ~M6502FastBus()
+    {
+    }
+
+  public:
+    /**
+      Execute instructions until the specified number of instructions
+      is executed, someone stops execution, or an error occurs.  Answers
+      true iff execution stops normally.
+
+      @param number Indicates the number of instructions to execute
+      @return true iff execution stops normally
+    */
+    virtual bool execute(uInt32 number);
+
+  protected:
+    /*
+      Get the byte at the specified address 
+
+      @return The byte at the specified address
+    */
+    inline uInt8 peek(uInt16 address)
+    {
+      myLastAccessWasRead = true;
+      return mySystem->peek(address, myBus);
+    }
+
+    /**
+      Change the byte at the specified address to the given value
+
+      @param address The address where the value should be stored
+      @param value The value to be stored at the address
+    */
+    inline void poke(uInt16 address, uInt8 value)
+    {
+      mySystem->poke(address, value, myBus);
+      myLastAccessWasRead = false;
+    }
+
+  private:
+    // Bus the devices are reached through
+    Bus myBus;
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Start executing a decoded instruction: account for what fetching it
+// would have done.  The handler steps PC past the operand.
+#define M6502_FAST_BEGIN \
+  IR = instruction->opcode; \
+  mySystem->incrementCycles(myInstructionSystemCycleTable[IR]); \
+  mySystem->setDataBusState(instruction->lastByte); \
+  myLastAccessWasRead = true; \
+  instructionOperand = instruction->operand; \
+  ++PC;
+
+#if defined(__GNUC__)
+  // Each instruction jumps straight to the handler of the next one,
+  // unless that one still has to be decoded or execution should stop
+  #define M6502_FAST_OPCODE(n) op_##n:
+  #define M6502_FAST_NEXT \
+    if(myExecutionStatus || (number == 0)) \
+      break; \
+    instruction = &myPageCode[(PC & myAddressMask) >> myPageShift][PC & myPageMask]; \
+    if(instruction->handler == 0) \
+      continue; \
+    --number; \
+    M6502_FAST_BEGIN \
+    goto *instruction->handler;
+#else
+  #define M6502_FAST_OPCODE(n) case n:
+  #define M6502_FAST_NEXT continue;
+#endif
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+template<class Bus>
+bool M6502FastBus<Bus>::execute(uInt32 number)
+{
+#if defined(__GNUC__)
+  static const void* const ourHandlers[257] = {
+    &&op_0x00, &&op_0x01, 0,         &&op_0x03,   // 0x0?
+    &&op_0x04, &&op_0x05, &&op_0x06, &&op_0x07,
+    &&op_0x08, &&op_0x09, &&op_0x0a, &&op_0x0b,
+    &&op_0x0c, &&op_0x0d, &&op_0x0e, &&op_0x0f,
+
+    &&op_0x10, &&op_0x11, 0,         &&op_0x13,   // 0x1?
+    &&op_0x14, &&op_0x15, &&op_0x16, &&op_0x17,
+    &&op_0x18, &&op_0x19, &&op_0x1a, &&op_0x1b,
+    &&op_0x1c, &&op_0x1d, &&op_0x1e, &&op_0x1f,
+
+    &&op_0x20, &&op_0x21, 0,         &&op_0x23,   // 0x2?
+    &&op_0x24, &&op_0x25, &&op_0x26, &&op_0x27,
+    &&op_0x28, &&op_0x29, &&op_0x2a, &&op_0x2b,
+    &&op_0x2c, &&op_0x2d, &&op_0x2e, &&op_0x2f,
+
+    &&op_0x30, &&op_0x31, 0,         &&op_0x33,   // 0x3?
+    &&op_0x34, &&op_0x35, &&op_0x36, &&op_0x37,
+    &&op_0x38, &&op_0x39, &&op_0x3a, &&op_0x3b,
+    &&op_0x3c, &&op_0x3d, &&op_0x3e, &&op_0x3f,
+
+    &&op_0x40, &&op_0x41, 0,         &&op_0x43,   // 0x4?
+    &&op_0x44, &&op_0x45, &&op_0x46, &&op_0x47,
+    &&op_0x48, &&op_0x49, &&op_0x4a, &&op_0x4b,
+    &&op_0x4c, &&op_0x4d, &&op_0x4e, &&op_0x4f,
+
+    &&op_0x50, &&op_0x51, 0,         &&op_0x53,   // 0x5?
+    &&op_0x54, &&op_0x55, &&op_0x56, &&op_0x57,
+    &&op_0x58, &&op_0x59, &&op_0x5a, &&op_0x5b,
+    &&op_0x5c, &&op_0x5d, &&op_0x5e, &&op_0x5f,
+
+    &&op_0x60, &&op_0x61, 0,         &&op_0x63,   // 0x6?
+    &&op_0x64, &&op_0x65, &&op_0x66, &&op_0x67,
+    &&op_0x68, &&op_0x69, &&op_0x6a, &&op_0x6b,
+    &&op_0x6c, &&op_0x6d, &&op_0x6e, &&op_0x6f,
+
+    &&op_0x70, &&op_0x71, 0,         &&op_0x73,   // 0x7?
+    &&op_0x74, &&op_0x75, &&op_0x76, &&op_0x77,
+    &&op_0x78, &&op_0x79, &&op_0x7a, &&op_0x7b,
+    &&op_0x7c, &&op_0x7d, &&op_0x7e, &&op_0x7f,
+
+    &&op_0x80, &&op_0x81, &&op_0x82, &&op_0x83,   // 0x8?
+    &&op_0x84, &&op_0x85, &&op_0x86, &&op_0x87,
+    &&op_0x88, &&op_0x89, &&op_0x8a, &&op_0x8b,
+    &&op_0x8c, &&op_0x8d, &&op_0x8e, &&op_0x8f,
+
+    &&op_0x90, &&op_0x91, 0,         &&op_0x93,   // 0x9?
+    &&op_0x94, &&op_0x95, &&op_0x96, &&op_0x97,
+    &&op_0x98, &&op_0x99, &&op_0x9a, &&op_0x9b,
+    &&op_0x9c, &&op_0x9d, &&op_0x9e, &&op_0x9f,
+
+    &&op_0xa0, &&op_0xa1, &&op_0xa2, &&op_0xa3,   // 0xa?
+    &&op_0xa4, &&op_0xa5, &&op_0xa6, &&op_0xa7,
+    &&op_0xa8, &&op_0xa9, &&op_0xaa, &&op_0xab,
+    &&op_0xac, &&op_0xad, &&op_0xae, &&op_0xaf,
+
+    &&op_0xb0, &&op_0xb1, 0,         &&op_0xb3,   // 0xb?
+    &&op_0xb4, &&op_0xb5, &&op_0xb6, &&op_0xb7,
+    &&op_0xb8, &&op_0xb9, &&op_0xba, &&op_0xbb,
+    &&op_0xbc, &&op_0xbd, &&op_0xbe, &&op_0xbf,
+
+    &&op_0xc0, &&op_0xc1, &&op_0xc2, &&op_0xc3,   // 0xc?
+    &&op_0xc4, &&op_0xc5, &&op_0xc6, &&op_0xc7,
+    &&op_0xc8, &&op_0xc9, &&op_0xca, &&op_0xcb,
+    &&op_0xcc, &&op_0xcd, &&op_0xce, &&op_0xcf,
+
+    &&op_0xd0, &&op_0xd1, 0,         &&op_0xd3,   // 0xd?
+    &&op_0xd4, &&op_0xd5, &&op_0xd6, &&op_0xd7,
+    &&op_0xd8, &&op_0xd9, &&op_0xda, &&op_0xdb,
+    &&op_0xdc, &&op_0xdd, &&op_0xde, &&op_0xdf,
+
+    &&op_0xe0, &&op_0xe1, &&op_0xe2, &&op_0xe3,   // 0xe?
+    &&op_0xe4, &&op_0xe5, &&op_0xe6, &&op_0xe7,
+    &&op_0xe8, &&op_0xe9, &&op_0xea, &&op_0xeb,
+    &&op_0xec, &&op_0xed, &&op_0xee, &&op_0xef,
+
+    &&op_0xf0, &&op_0xf1, 0,         &&op_0xf3,   // 0xf?
+    &&op_0xf4, &&op_0xf5, &&op_0xf6, &&op_0xf7,
+    &&op_0xf8, &&op_0xf9, &&op_0xfa, &&op_0xfb,
+    &&op_0xfc, &&op_0xfd, &&op_0xfe, &&op_0xff,
+
+    &&idle_loop
+  };
+#else
+  static const void* const* const ourHandlers = 0;
+#endif
+
+  // Clear all of the execution status bits except for the fatal error bit
+  myExecutionStatus &= FatalErrorBit;
+
+  const Instruction* instruction;
+  uInt16 instructionOperand;
+  uInt16 operandAddress = 0;
+  uInt8 operand = 0;
+  uInt32 requested = number;
+  ++myExecution;
+
+  while(!myExecutionStatus && (number != 0))
+  {
+    instruction = &myPageCode[(PC & myAddressMask) >> myPageShift][PC & myPageMask];
+    if((instruction->handler == 0) && ((instruction = decode(ourHandlers)) == 0))
+    {
+      --number;
+      executeFetched();
+      continue;
+    }
+
+    --number;
+    M6502_FAST_BEGIN
+
+#if defined(__GNUC__)
+    goto *instruction->handler;
+
+    // A branch closing an idle loop
+    idle_loop:
+      number -= skipIdleLoop(*instruction, number);
+      goto *ourHandlers[IR];
+
+    // Decoded 6502 instruction emulation is generated by an M4 macro file
+    #include "M6502Fast.ins"
+#else
+    if(instruction->loop != 0)
+    {
+      number -= skipIdleLoop(*instruction, number);
+    }
+
+    switch(IR)
+    {
+      // Decoded 6502 instruction emulation is generated by an M4 macro file
+      #include "M6502Fast.ins"
+    }
+#endif
+  }
+
+  myIdleLoopStatistics.instructions += requested - number;
+
+  // See if we need to handle an interrupt
+  if((myExecutionStatus & MaskableInterruptBit) || 
+      (myExecutionStatus & NonmaskableInterruptBit))
+  {
+    // Yes, so handle the interrupt
+    interruptHandler();
+  }
+
+  // See if execution has been stopped
+  if(myExecutionStatus & StopExecutionBit)
+  {
+    // Yes, so answer that everything finished fine
+    return true;
+  }
+
+  // See if a fatal error has occured
+  if(myExecutionStatus & FatalErrorBit)
+  {
+    // Yes, so answer that something when wrong
+    return false;
+  }
+
+  // See if we've executed the specified number of instructions
+  if(number == 0)
+  {
+    // Yes, so answer that everything finished fine
+    return true;
+  }
+
+  return false;
+}
+
+#undef M6502_FAST_BEGIN
+#undef M6502_FAST_OPCODE
+#undef M6502_FAST_NEXT
+
+} // namespace ale
+
+#endif
@@ -211,7 +211,7 @@ bool M6502High::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != CPU)
+    if(!in.expectString(CPU))
       return false;
 
     A = (uInt8) in.getInt();    // Accumulator
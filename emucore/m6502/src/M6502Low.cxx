@@ -216,7 +216,7 @@ bool M6502Low::load(Deserializer& in)
 
   try
   {
-    if(in.getString() != CPU)
+    if(!in.expectString(CPU))
       return false;
 
     A = (uInt8) in.getInt();    // Accumulator
@@ -0,0 +1,71 @@
+//============================================================================
+//
+// MM     MM  6666  555555  0000   2222
+// MMMM MMMM 66  66 55     00  00 22  22
+// MM MMM MM 66     55     00  00     22
+// MM  M  MM 66666  55555  00  00  22222  --  "A 6502 Microprocessor Emulator"
+// MM     MM 66  66     55 00  00 22
+// MM     MM 66  66 55  55 00  00 22
+// MM     MM  6666   5555   0000  222222
+//
+// Copyright (c) 1995-2007 by Bradford W. Mott and the Stella team
+//
+// See the file "license" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+//============================================================================
+
+#include <cstring>
+#include <vector>
+
+#include "M6502Recompiled.hxx"
+#include "emucore/Cart.hxx"
+
+using namespace ale;
+
+namespace {
+
+struct RecompiledProcessor
+{
+  const char* md5;
+  const char* cartridge;
+  M6502Recompiled::Factory factory;
+};
+
+std::vector<RecompiledProcessor>& recompiledProcessors()
+{
+  static std::vector<RecompiledProcessor> ourProcessors;
+  return ourProcessors;
+}
+
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502Recompiled::add(const char* md5, const char* cartridge, Factory factory)
+{
+  RecompiledProcessor processor;
+  processor.md5 = md5;
+  processor.cartridge = cartridge;
+  processor.factory = factory;
+  recompiledProcessors().push_back(processor);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+M6502Fast* M6502Recompiled::create(const std::string& md5,
+    uInt32 systemCyclesPerProcessorCycle, Cartridge& cartridge,
+    TIA& tia, M6532& riot)
+{
+  const std::vector<RecompiledProcessor>& processors = recompiledProcessors();
+  for(uInt32 i = 0; i < processors.size(); ++i)
+  {
+    // The code was laid out for one type of cartridge
+    if((md5 == processors[i].md5) &&
+        (strcmp(cartridge.name(), processors[i].cartridge) == 0))
+    {
+      return processors[i].factory(systemCyclesPerProcessorCycle,
+          cartridge, tia, riot);
+    }
+  }
+
+  return 0;
+}
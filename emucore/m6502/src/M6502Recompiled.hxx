@@ -0,0 +1,173 @@
+//============================================================================
+//
+// MM     MM  6666  555555  0000   2222
+// MMMM MMMM 66  66 55     00  00 22  22
+// MM MMM MM 66     55     00  00     22
+// MM  M  MM 66666  55555  00  00  22222  --  "A 6502 Microprocessor Emulator"
+// MM     MM 66  66     55 00  00 22
+// MM     MM 66  66 55  55 00  00 22
+// MM     MM  6666   5555   0000  222222
+//
+// Copyright (c) 1995-2007 by Bradford W. Mott and the Stella team
+//
+// See the file "license" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+//============================================================================
+
+#ifndef M6502RECOMPILED_HXX
+#define M6502RECOMPILED_HXX
+
+namespace ale {
+
+class Cartridge;
+class M6532;
+class TIA;
+class M6502Recompiled;
+template<class Bus> class M6502RecompiledBus;
+
+}
+
+#include <string>
+
+#include "bspf/src/bspf.hxx"
+#include "M6502FastBus.hxx"
+
+namespace ale {
+
+/**
+  Registry of the processors generated ahead of time from particular
+  ROMs by the xitari_recompile tool.  The tool turns the code it finds
+  in a ROM into straight-line C++ that runs the same instruction bodies
+  as M6502Fast, with the opcodes, operands and cycle counts as
+  constants, and jumps between the blocks it knows directly.  The
+  generated library registers its processors with
+  registerRecompiledProcessors(); consoles then pick them by the MD5
+  of their cartridge.
+*/
+class M6502Recompiled
+{
+  public:
+    /**
+      Creates a processor for the console of the given cartridge
+    */
+    typedef M6502Fast* (*Factory)(uInt32 systemCyclesPerProcessorCycle,
+        Cartridge& cartridge, TIA& tia, M6532& riot);
+
+    /**
+      Register the processor recompiled from a ROM
+
+      @param md5 The MD5 of the ROM
+      @param cartridge The name of the cartridge class it was compiled for
+      @param factory Creates the processor
+    */
+    static void add(const char* md5, const char* cartridge, Factory factory);
+
+    /**
+      Create the processor recompiled from the cartridge's ROM, if one
+      was registered for the cartridge's MD5 and type.
+
+      @param md5 The MD5 of the cartridge's ROM
+      @param systemCyclesPerProcessorCycle The cycle multiplier
+      @param cartridge The cartridge of the console
+      @param tia  The TIA of the console
+      @param riot The M6532 of the console
+      @return Pointer to the new processor allocated on the heap, or
+              the null pointer if there is none
+    */
+    static M6502Fast* create(const std::string& md5,
+        uInt32 systemCyclesPerProcessorCycle, Cartridge& cartridge,
+        TIA& tia, M6532& riot);
+};
+
+/**
+  Registers every processor in the library generated by
+  xitari_recompile.  Only defined when linking with that library.
+*/
+void registerRecompiledProcessors();
+
+/**
+  Base of the processors generated by xitari_recompile.  Finds the
+  compiled code of the ROM bytes the program counter maps; code the
+  tool did not find, or that is not in ROM, is left to M6502FastBus.
+*/
+template<class Bus>
+class M6502RecompiledBus : public M6502FastBus<Bus>
+{
+  protected:
+    /**
+      Create a new recompiled 6502 microprocessor
+
+      @param systemCyclesPerProcessorCycle The cycle multiplier
+      @param bus The bus to reach devices through
+      @param blocks One plus the index of the code compiled for each
+                    byte of the ROM, or zero
+      @param size The size of the ROM in bytes
+    */
+    M6502RecompiledBus(uInt32 systemCyclesPerProcessorCycle, const Bus& bus,
+        const uInt16* blocks, uInt32 size)
+      : M6502FastBus<Bus>(systemCyclesPerProcessorCycle, bus),
+        myBlocks(blocks),
+        myImage(0),
+        myImageSize(size)
+    {
+    }
+
+    /**
+      Answer the compiled code for the instruction at the program
+      counter
+
+      @return One plus the index of the code, or zero if there is none
+    */
+    uInt16 compiledBlock()
+    {
+      uInt16 page = (this->PC & this->myAddressMask) >> this->myPageShift;
+      const uInt8* base = this->mySystem->getPageAccess(page).directPeekBase;
+      if(base == 0)
+      {
+        return 0;
+      }
+
+      // The cartridge tags its image as read only once installed
+      if(myImage == 0)
+      {
+        uInt32 size = 0;
+        const uInt8* image = this->mySystem->readOnlyMemoryBlock(base, size);
+        if((image == 0) || (size != myImageSize))
+        {
+          return 0;
+        }
+        myImage = image;
+      }
+
+      const uInt8* byte = base + (this->PC & this->myPageMask);
+      if((byte < myImage) || (byte >= myImage + myImageSize))
+      {
+        return 0;
+      }
+      return myBlocks[byte - myImage];
+    }
+
+    /**
+      Execute the instruction at the program counter, which was not
+      compiled, with the predecoding processor
+    */
+    void interpret()
+    {
+      M6502FastBus<Bus>::execute(1);
+    }
+
+  private:
+    // One plus the index of the code compiled for each byte of the ROM
+    const uInt16* myBlocks;
+
+    // The cartridge's image of the ROM, once found
+    const uInt8* myImage;
+
+    // Size of the ROM in bytes
+    uInt32 myImageSize;
+};
+
+} // namespace ale
+
+#endif
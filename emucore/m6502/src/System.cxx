@@ -25,6 +25,7 @@
 #include "emucore/TIA.hxx"
 #include "emucore/Serializer.hxx"
 #include "emucore/Deserializer.hxx"
+#include "emucore/RawState.hxx"
 
 using namespace ale;
 
@@ -35,6 +36,7 @@ System::System(uInt16 n, uInt16 m)
     myPageMask((1 << m) - 1),
     myNumberOfPages(1 << (n - m)),
     myNumberOfDevices(0),
+    myNumberOfReadOnlyMemories(0),
     myM6502(0),
     myTIA(0),
     myCycles(0),
@@ -151,7 +153,7 @@ bool System::load(Deserializer& in)
 {
   try
   {
-    if(in.getString() != "System")
+    if(!in.expectString("System"))
       return false;
 
     myCycles = (uInt32) in.getInt();
@@ -193,6 +195,49 @@ void System::setPageAccess(uInt16 page, const PageAccess& access)
   assert(access.device != 0);
 
   myPageAccessTable[page] = access;
+
+  // Code decoded from the page may no longer be what it maps
+  if(myM6502 != 0)
+  {
+    myM6502->pageAccessChanged(page);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void System::addReadOnlyMemory(const uInt8* memory, uInt32 size)
+{
+  assert(myNumberOfReadOnlyMemories < 8);
+
+  myReadOnlyMemory[myNumberOfReadOnlyMemories][0] = memory;
+  myReadOnlyMemory[myNumberOfReadOnlyMemories][1] = memory + size;
+  ++myNumberOfReadOnlyMemories;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool System::isReadOnlyMemory(const uInt8* memory, uInt32 size) const
+{
+  for(uInt32 i = 0; i < myNumberOfReadOnlyMemories; ++i)
+  {
+    if((memory >= myReadOnlyMemory[i][0]) && (memory + size <= myReadOnlyMemory[i][1]))
+      return true;
+  }
+
+  return false;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const uInt8* System::readOnlyMemoryBlock(const uInt8* memory, uInt32& size) const
+{
+  for(uInt32 i = 0; i < myNumberOfReadOnlyMemories; ++i)
+  {
+    if((memory >= myReadOnlyMemory[i][0]) && (memory < myReadOnlyMemory[i][1]))
+    {
+      size = (uInt32)(myReadOnlyMemory[i][1] - myReadOnlyMemory[i][0]);
+      return myReadOnlyMemory[i][0];
+    }
+  }
+
+  return 0;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -255,7 +300,7 @@ bool System::loadState(const std::string& md5sum, Deserializer& in)
   {
     // Look at the beginning of the state file.  It should contain the md5sum
     // of the current cartridge.  If it doesn't, this state file is invalid.
-    if(in.getString() != md5sum)
+    if(!in.expectString(md5sum))
       return false;
 
     // First load state for this system
@@ -285,6 +330,18 @@ bool System::loadState(const std::string& md5sum, Deserializer& in)
   return true;  // success
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void System::copyRawState(RawState& state)
+{
+  // There are no tags: the console the state is loaded into is the same
+  state.copy(myCycles);
+
+  myM6502->copyRaw(state);
+
+  for(uInt32 i = 0; i < myNumberOfDevices; ++i)
+    myDevices[i]->copyRaw(state);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 System::System(const System& s)
   : myAddressMask(s.myAddressMask),
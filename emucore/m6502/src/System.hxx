@@ -27,6 +27,7 @@ class TIA;
 class NullDevice;
 class Serializer;
 class Deserializer;
+class RawState;
 
 } // namespace ale
 
@@ -46,11 +47,10 @@ namespace ale {
   In general the addressing space will be 8192 (2^13) bytes for a 
   6507 based system and 65536 (2^16) bytes for a 6502 based system.
 
-  TODO: To allow for dynamic code generation we probably need to
-        add a tag to each page that indicates if it is read only
-        memory.  We also need to notify the processor anytime a
-        page access method is changed so that it can clear the
-        dynamic code for that page of memory.
+  To allow for predecoded or dynamic code, devices tag the memory
+  that never changes (i.e. cartridge ROM) as read only, and the
+  processor is notified anytime a page access method is changed so
+  that it can drop the code it decoded for that page.
 
   @author  Bradford W. Mott
   @version $Id: System.hxx,v 1.16 2007/01/01 18:04:51 stephena Exp $
@@ -142,6 +142,15 @@ class System
     */
     bool loadState(const std::string& md5sum, Deserializer& in);
 
+    /**
+      Saves, loads or measures the raw state of Stella, as the RawState's
+      direction asks.  Calls copyRaw on every device and CPU attached to
+      this system.
+
+      @param state The raw state to copy the fields to or from
+    */
+    void copyRawState(RawState& state);
+
   public:
     /**
       Answer the 6502 microprocessor attached to the system.  If a
@@ -245,6 +254,17 @@ class System
     */  
     uInt8 getDataBusState() const;
 
+    /**
+      Change the state of the data bus, as a read of the given value
+      would.  Used by processors that fetch code without peek().
+
+      @param value The value last read
+    */
+    void setDataBusState(uInt8 value)
+    {
+      myDataBusState = value;
+    }
+
     /**
       Get the byte at the specified address.  No masking of the
       address occurs before it's sent to the device mapped at
@@ -299,6 +319,64 @@ class System
 
     }
 
+    /**
+      Get the byte at the specified address, as peek() does, but
+      reach the device mapped at the address through the given bus,
+      which may call the devices it knows without virtual dispatch.
+
+      @param addr The address to read
+      @param bus The bus to reach the device through
+      @return The byte at the specified address
+    */
+    template<class Bus>
+    uInt8 peek(uInt16 addr, Bus& bus) {
+
+      PageAccess& access = myPageAccessTable[(addr & myAddressMask) >> myPageShift];
+
+      uInt8 result;
+
+      // See if this page uses direct accessing or not
+      if(access.directPeekBase != 0)
+      {
+        result = *(access.directPeekBase + (addr & myPageMask));
+      }
+      else
+      {
+        result = bus.peek(*access.device, addr);
+      }
+
+      myDataBusState = result;
+
+      return result;
+    }
+
+    /**
+      Change the byte at the specified address to the given value, as
+      poke() does, but reach the device mapped at the address through
+      the given bus.
+
+      @param addr The address where the value should be stored
+      @param value The value to be stored at the address
+      @param bus The bus to reach the device through
+    */
+    template<class Bus>
+    void poke(uInt16 addr, uInt8 value, Bus& bus) {
+
+      PageAccess& access = myPageAccessTable[(addr & myAddressMask) >> myPageShift];
+
+      // See if this page uses direct accessing or not
+      if(access.directPokeBase != 0)
+      {
+        *(access.directPokeBase + (addr & myPageMask)) = value;
+      }
+      else
+      {
+        bus.poke(*access.device, addr, value);
+      }
+
+      myDataBusState = value;
+    }
+
     /**
       Lock/unlock the data bus. When the bus is locked, peek() and
       poke() don't update the bus state. The bus should be unlocked
@@ -355,6 +433,36 @@ class System
       @return The accessing methods used by the page
     */
     const PageAccess& getPageAccess(uInt16 page);
+
+    /**
+      Tag a block of memory that devices may map for direct peeks as
+      read only: its contents never change while the system exists.
+
+      @param memory The first byte of the block
+      @param size The size of the block in bytes
+    */
+    void addReadOnlyMemory(const uInt8* memory, uInt32 size);
+
+    /**
+      Answer true iff the given bytes all lie in memory tagged as read
+      only by addReadOnlyMemory().
+
+      @param memory The first byte to check
+      @param size The number of bytes to check
+      @return true iff the bytes are read only
+    */
+    bool isReadOnlyMemory(const uInt8* memory, uInt32 size) const;
+
+    /**
+      Answer the block of memory tagged as read only by
+      addReadOnlyMemory() that contains the given byte.
+
+      @param memory The byte to look for
+      @param size Set to the size of the block in bytes
+      @return The first byte of the block, or the null pointer if the
+              byte is not read only
+    */
+    const uInt8* readOnlyMemoryBlock(const uInt8* memory, uInt32& size) const;
  
   private:
     // Mask to apply to an address before accessing memory
@@ -378,6 +486,12 @@ class System
     // Number of devices attached to the system
     uInt32 myNumberOfDevices;
 
+    // Blocks of memory tagged as read only, as [begin, end) pairs
+    const uInt8* myReadOnlyMemory[8][2];
+
+    // Number of blocks of memory tagged as read only
+    uInt32 myNumberOfReadOnlyMemories;
+
     // 6502 processor attached to the system or the null pointer
     M6502* myM6502;
 
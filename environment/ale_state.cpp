@@ -31,11 +31,15 @@
 #include "emucore/Event.hxx"
 #include "emucore/OSystem.hxx"
 #include "emucore/Deserializer.hxx"
+#include "emucore/RawState.hxx"
 #include "games/RomSettings.hpp"
 #include "common/Constants.h"
 #include "archive_binary_in.hpp"
 #include "archive_binary_out.hpp"
 
+#include <cstring>
+#include <stdexcept>
+
 
 using namespace ale;
 
@@ -44,7 +48,8 @@ ALEState::ALEState():
   m_left_paddle(PADDLE_DEFAULT_VALUE),
   m_right_paddle(PADDLE_DEFAULT_VALUE),
   m_frame_number(0),
-  m_episode_frame_number(0)
+  m_episode_frame_number(0),
+  m_serialized_size(0)
 {
 }
 
@@ -53,7 +58,8 @@ ALEState::ALEState(const ALEState &rhs, const std::string &serialized):
   m_right_paddle(rhs.m_right_paddle),
   m_frame_number(rhs.m_frame_number),
   m_episode_frame_number(rhs.m_episode_frame_number),
-  m_serialized_state(serialized)
+  m_serialized_state(serialized),
+  m_serialized_size(serialized.size())
 {
 }
 
@@ -64,8 +70,14 @@ void ALEState::load(OSystem* osystem, RomSettings* settings, const std::string &
   // Deserialize the stored std::string into the emulator state
   Deserializer deser(rhs.m_serialized_state);
   
-  osystem->console().system().loadState(md5, deser);
-  settings->loadState(deser);
+  try {
+    if (!osystem->console().system().loadState(md5, deser))
+      throw std::invalid_argument("state is corrupt or was saved with a different ROM");
+    settings->loadState(deser);
+  }
+  catch (const char *) {
+    throw std::invalid_argument("state is corrupt");
+  }
  
   // Copy over other member variables
   m_left_paddle = rhs.m_left_paddle; 
@@ -75,14 +87,18 @@ void ALEState::load(OSystem* osystem, RomSettings* settings, const std::string &
 }
 
 ALEState ALEState::save(OSystem* osystem, RomSettings* settings, const std::string &md5) {
-  // Use the emulator's built-in serialization to save the state
-  Serializer ser;
+  // Use the emulator's built-in serialization to save the state, reserving as much
+  //  room as the previous state took
+  Serializer ser(m_serialized_size);
   
   osystem->console().system().saveState(md5, ser);
   settings->saveState(ser);
+  m_serialized_size = ser.get_str().size();
 
-  // Now make a copy of this state, also storing the emulator serialization
-  return ALEState(*this, ser.get_str());
+  // Now make a copy of this state, handing it the emulator serialization
+  ALEState state(*this, std::string());
+  ser.swap_str(state.m_serialized_state);
+  return state;
 }
 
 /* ***************************************************************************
@@ -502,6 +518,222 @@ ALEState::ALEState(const std::string &ale_state_string) {
         % m_frame_number
         % m_episode_frame_number
         % m_serialized_state;
+
+    m_serialized_size = m_serialized_state.size();
+}
+
+
+/** Identifies a ROM by the first 64 bits of its md5 */
+static unsigned long long romId(const std::string &md5) {
+  unsigned long long id = 0;
+  for (size_t i = 0; i < 16 && i < md5.size(); i++) {
+    char c = md5[i];
+    int digit = (c >= '0' && c <= '9') ? c - '0' :
+                (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+                (c >= 'A' && c <= 'F') ? c - 'A' + 10 : c & 0x0f;
+    id = (id << 4) | static_cast<unsigned long long>(digit);
+  }
+  return id;
 }
 
+/** Writes the emulator and ROM state; the header is written separately */
+static void saveSnapshotPayload(OSystem* osystem, RomSettings* settings, Serializer &ser) {
+  try {
+    if (!osystem->console().system().saveState("", ser))
+      throw std::invalid_argument("snapshot buffer is too small");
+    settings->saveState(ser);
+  }
+  catch (const char *) {
+    throw std::invalid_argument("snapshot buffer is too small");
+  }
+}
 
+size_t ALEState::snapshotSize(OSystem* osystem, RomSettings* settings) const {
+  // Measure the payload without writing it anywhere
+  Serializer ser(NULL, 0, Serializer::Compact);
+  saveSnapshotPayload(osystem, settings, ser);
+  return SNAPSHOT_HEADER_SIZE + ser.size();
+}
+
+size_t ALEState::saveSnapshot(OSystem* osystem, RomSettings* settings, const std::string &md5,
+                              void *buffer, size_t size) const {
+  if (size < SNAPSHOT_HEADER_SIZE)
+    throw std::invalid_argument("snapshot buffer is too small");
+
+  char* data = static_cast<char*>(buffer);
+  Serializer payload(data + SNAPSHOT_HEADER_SIZE, size - SNAPSHOT_HEADER_SIZE, Serializer::Compact);
+  saveSnapshotPayload(osystem, settings, payload);
+
+  unsigned long long rom_id = romId(md5);
+  Serializer header(data, SNAPSHOT_HEADER_SIZE, Serializer::Compact);
+  header.putInt(SNAPSHOT_MAGIC);
+  header.putInt(SNAPSHOT_VERSION);
+  header.putInt(static_cast<int>(rom_id & 0xffffffff));
+  header.putInt(static_cast<int>(rom_id >> 32));
+  header.putInt(m_left_paddle);
+  header.putInt(m_right_paddle);
+  header.putInt(m_frame_number);
+  header.putInt(m_episode_frame_number);
+  header.putInt(static_cast<int>(payload.size()));
+
+  return SNAPSHOT_HEADER_SIZE + payload.size();
+}
+
+size_t ALEState::loadSnapshot(OSystem* osystem, RomSettings* settings, const std::string &md5,
+                            const void *buffer, size_t size) {
+  if (!isSnapshot(buffer, size))
+    throw std::invalid_argument("not a snapshot");
+
+  const char* data = static_cast<const char*>(buffer);
+  Deserializer header(data, SNAPSHOT_HEADER_SIZE, Serializer::Compact);
+  header.getInt(); // magic
+  if (header.getInt() > SNAPSHOT_VERSION)
+    throw std::invalid_argument("snapshot was written by a newer version");
+
+  unsigned long long rom_id = static_cast<uInt32>(header.getInt());
+  rom_id |= static_cast<unsigned long long>(static_cast<uInt32>(header.getInt())) << 32;
+  if (rom_id != romId(md5))
+    throw std::invalid_argument("snapshot was taken with a different ROM");
+
+  int left_paddle = header.getInt();
+  int right_paddle = header.getInt();
+  int frame_number = header.getInt();
+  int episode_frame_number = header.getInt();
+  size_t payload_size = static_cast<uInt32>(header.getInt());
+  if (payload_size > size - SNAPSHOT_HEADER_SIZE)
+    throw std::invalid_argument("snapshot is truncated");
+
+  Deserializer payload(data + SNAPSHOT_HEADER_SIZE, payload_size, Serializer::Compact);
+  try {
+    if (!osystem->console().system().loadState("", payload))
+      throw std::invalid_argument("snapshot is corrupt");
+    settings->loadState(payload);
+  }
+  catch (const char *) {
+    throw std::invalid_argument("snapshot is corrupt");
+  }
+
+  m_left_paddle = left_paddle;
+  m_right_paddle = right_paddle;
+  m_frame_number = frame_number;
+  m_episode_frame_number = episode_frame_number;
+
+  return SNAPSHOT_HEADER_SIZE + payload_size;
+}
+
+bool ALEState::isSnapshot(const void *buffer, size_t size) {
+  if (size < SNAPSHOT_HEADER_SIZE)
+    return false;
+
+  Deserializer header(static_cast<const char*>(buffer), 4, Serializer::Compact);
+  return static_cast<uInt32>(header.getInt()) == SNAPSHOT_MAGIC;
+}
+
+/** The payload size, the last field of a snapshot's header */
+static size_t payloadSize(const void *buffer) {
+  Deserializer header(static_cast<const char*>(buffer) + SNAPSHOT_HEADER_SIZE - 4, 4,
+                      Serializer::Compact);
+  return static_cast<uInt32>(header.getInt());
+}
+
+bool ALEState::hasScreens(const void *buffer, size_t size) {
+  return isSnapshot(buffer, size) && size - SNAPSHOT_HEADER_SIZE > payloadSize(buffer);
+}
+
+size_t ALEState::snapshotEnd(const void *buffer, size_t size) {
+  if (!isSnapshot(buffer, size))
+    throw std::invalid_argument("not a snapshot");
+  size_t payload_size = payloadSize(buffer);
+  if (payload_size > size - SNAPSHOT_HEADER_SIZE)
+    throw std::invalid_argument("snapshot is truncated");
+  return SNAPSHOT_HEADER_SIZE + payload_size;
+}
+
+/** Copies the emulator and ROM state in the direction of 'state' */
+static void copyRawState(OSystem* osystem, RomSettings* settings, RawState &state) {
+  osystem->console().system().copyRawState(state);
+  settings->copyRaw(state);
+}
+
+size_t ALEState::rawSize(OSystem* osystem, RomSettings* settings) const {
+  RawState state(RawState::Measure);
+  int fields[4];
+  state.copy(fields);
+  copyRawState(osystem, settings, state);
+  return state.size();
+}
+
+void ALEState::saveRaw(OSystem* osystem, RomSettings* settings, void *buffer) const {
+  RawState state(RawState::Save, static_cast<uInt8*>(buffer));
+  int fields[4] = { m_left_paddle, m_right_paddle, m_frame_number, m_episode_frame_number };
+  state.copy(fields);
+  copyRawState(osystem, settings, state);
+}
+
+void ALEState::loadRaw(OSystem* osystem, RomSettings* settings, const void *buffer) {
+  // Loading only reads from the buffer
+  RawState state(RawState::Load, static_cast<uInt8*>(const_cast<void*>(buffer)));
+  int fields[4];
+  state.copy(fields);
+  copyRawState(osystem, settings, state);
+
+  m_left_paddle = fields[0];
+  m_right_paddle = fields[1];
+  m_frame_number = fields[2];
+  m_episode_frame_number = fields[3];
+}
+
+static const unsigned long long HASH_PRIME_1 = 0x9e3779b185ebca87ULL;
+static const unsigned long long HASH_PRIME_2 = 0xc2b2ae3d27d4eb4fULL;
+
+static inline unsigned long long rotateLeft(unsigned long long x, int bits) {
+  return (x << bits) | (x >> (64 - bits));
+}
+
+static inline unsigned long long hashWord(unsigned long long h, unsigned long long word) {
+  h ^= rotateLeft(word * HASH_PRIME_2, 31) * HASH_PRIME_1;
+  return rotateLeft(h, 27) * HASH_PRIME_1 + HASH_PRIME_2;
+}
+
+/** Hashes a buffer a word at a time, finishing with a full avalanche */
+unsigned long long ALEState::hashBytes(const void *buffer, size_t size, unsigned long long h) {
+  const char *data = static_cast<const char*>(buffer);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    unsigned long long word;
+    memcpy(&word, data + i, 8);
+    h = hashWord(h, word);
+  }
+
+  unsigned long long tail = 0;
+  memcpy(&tail, data + i, size - i);
+  h = hashWord(h, tail ^ (static_cast<unsigned long long>(size) << 56));
+
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+unsigned long long ALEState::stateHash(OSystem* osystem, RomSettings* settings,
+                                       std::vector<char> &scratch) const {
+  // The packed state has the same size throughout a game, so this only measures once
+  if (scratch.empty())
+    scratch.resize(snapshotSize(osystem, settings) - SNAPSHOT_HEADER_SIZE);
+
+  Serializer ser(&scratch[0], scratch.size(), Serializer::Compact);
+  try {
+    saveSnapshotPayload(osystem, settings, ser);
+  }
+  catch (const std::invalid_argument &) {
+    scratch.assign(snapshotSize(osystem, settings) - SNAPSHOT_HEADER_SIZE, 0);
+    return stateHash(osystem, settings, scratch);
+  }
+
+  unsigned long long h = HASH_PRIME_2;
+  h = hashWord(h, static_cast<uInt32>(m_left_paddle) |
+                  static_cast<unsigned long long>(static_cast<uInt32>(m_right_paddle)) << 32);
+  return hashBytes(&scratch[0], ser.size(), h);
+}
@@ -48,6 +48,11 @@ namespace ale {
 #define PADDLE_MAX 790196 
 #define PADDLE_DEFAULT_VALUE (((PADDLE_MAX - PADDLE_MIN) / 2) + PADDLE_MIN)
 
+// Layout of compact snapshots: "XSNP", the format version, then the header fields
+#define SNAPSHOT_MAGIC 0x504E5358
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_SIZE 36
+
 
 class ALEState {
  public:
@@ -59,7 +64,8 @@ class ALEState {
   /** Constructs an ALEState from a string returned by ALEState::getStateAsString(). */
   explicit ALEState(const std::string &ale_state_string);
 
-  /** Restores the environment to a previously saved state. */ 
+  /** Restores the environment to a previously saved state. Throws std::invalid_argument if
+  *  it is corrupt or was saved with another ROM, possibly after restoring part of it. */ 
   void load(OSystem* osystem, RomSettings* settings, const std::string &md5, const ALEState &rhs);
 
   /** Returns a "copy" of the current state, including the information necessary to restore
@@ -88,6 +94,59 @@ class ALEState {
   /** Gets a state as a string. */
   std::string getStateAsString() const;
 
+  /** Compact snapshots of the emulator: a fixed header (format version, ROM id, paddles
+  *  and frame numbers) followed by the packed emulator and ROM state. They are written
+  *  to and read from caller-provided memory; nothing is allocated. */
+  size_t snapshotSize(OSystem* osystem, RomSettings* settings) const;
+
+  /** Writes a compact snapshot of the emulator, with this state's paddles and frame
+  *  numbers, and returns its size. Throws std::invalid_argument if 'size' is too small. */
+  size_t saveSnapshot(OSystem* osystem, RomSettings* settings, const std::string &md5,
+                      void *buffer, size_t size) const;
+
+  /** Restores the emulator, and this state's paddles and frame numbers, from a compact
+  *  snapshot, and returns the number of bytes read; anything after that belongs to the
+  *  caller. Throws std::invalid_argument if it is malformed or was taken with another ROM;
+  *  a payload found corrupt part-way through may have been partly restored. */
+  size_t loadSnapshot(OSystem* osystem, RomSettings* settings, const std::string &md5,
+                    const void *buffer, size_t size);
+
+  /** Returns true if the data starts like a compact snapshot (rather than a string from
+  *  getStateAsString()). */
+  static bool isSnapshot(const void *buffer, size_t size);
+
+  /** Returns true if a compact snapshot is followed by the screens of
+  *  StellaEnvironment::setSnapshotScreens(), which make its size vary. */
+  static bool hasScreens(const void *buffer, size_t size);
+
+  /** Returns the number of bytes of a compact snapshot that loadSnapshot() reads, from its
+  *  header alone. Throws std::invalid_argument if it is not a snapshot or is truncated. */
+  static size_t snapshotEnd(const void *buffer, size_t size);
+
+  /** Raw states: the emulator and ROM state copied field by field as it is in memory (see
+  *  RawState), with this state's paddles and frame numbers, into a preallocated buffer of
+  *  rawSize() bytes. They are faster to save and restore than snapshots, but are only
+  *  valid in this process, for the console they were saved from. */
+  size_t rawSize(OSystem* osystem, RomSettings* settings) const;
+
+  /** Writes a raw state of the emulator to 'buffer', which holds rawSize() bytes. */
+  void saveRaw(OSystem* osystem, RomSettings* settings, void *buffer) const;
+
+  /** Restores the emulator, and this state's paddles and frame numbers, from a raw state
+  *  written by saveRaw() for the same console. */
+  void loadRaw(OSystem* osystem, RomSettings* settings, const void *buffer);
+
+  /** Returns a 64-bit hash of the emulator and ROM state and of this state's paddles,
+  *  i.e. of everything that determines how the game proceeds; frame numbers are left
+  *  out so that a position reached at different times hashes the same. The packed
+  *  state is written to 'scratch', which is grown as needed and can be reused. */
+  unsigned long long stateHash(OSystem* osystem, RomSettings* settings,
+                               std::vector<char> &scratch) const;
+
+  /** Returns a 64-bit hash of 'size' bytes continuing from 'seed', as stateHash() does
+  *  for the packed state. */
+  static unsigned long long hashBytes(const void *buffer, size_t size, unsigned long long seed);
+
  protected:
 
   // Let StellaEnvironment access these methods: they are needed for emulation purposes
@@ -105,6 +164,10 @@ class ALEState {
   /** Updates the paddle position by a delta amount. */
   void updatePaddlePositions(Event* event_obj, int delta_x, int delta_y);
 
+  /** Overrides the frame number, e.g. when restoring a state from a previous episode */
+  void setFrameNumber(int frame_number) { m_frame_number = frame_number; }
+  void setEpisodeFrameNumber(int frame_number) { m_episode_frame_number = frame_number; }
+
   /** Calculates the Paddle resistance, based on the given x val */
   int calcPaddleResistance(int x_val);
 
@@ -116,6 +179,7 @@ class ALEState {
   int m_episode_frame_number; // Number of frames since last reset 
 
   std::string m_serialized_state; // The stored environment state, if this is a saved state
+  size_t m_serialized_size; // Size of the last state saved from this one, to preallocate the next
 };
 
 } // namespace ale
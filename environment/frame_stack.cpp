@@ -0,0 +1,73 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  frame_stack.cpp
+ *
+ *  A ring buffer holding the most recent observations of an environment.
+ **************************************************************************** */
+
+#include "frame_stack.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace ale;
+
+FrameStack::FrameStack():
+  m_frame_size(0),
+  m_depth(0),
+  m_head(0),
+  m_empty(true) {
+}
+
+void FrameStack::configure(size_t frame_size, int depth) {
+  if (depth < 0)
+    throw std::invalid_argument("frame stack depth must not be negative");
+
+  m_frame_size = frame_size;
+  m_depth = depth;
+  m_head = 0;
+  m_empty = true;
+
+  // Keep one byte so that base() is always valid
+  m_buffer.assign(2 * m_frame_size * m_depth + 1, 0);
+}
+
+uInt8* FrameStack::beginFrame() {
+  int next = m_head + 1 == m_depth ? 0 : m_head + 1;
+  return &m_buffer[next * m_frame_size];
+}
+
+void FrameStack::endFrame() {
+  m_head = m_head + 1 == m_depth ? 0 : m_head + 1;
+
+  uInt8* frame = &m_buffer[m_head * m_frame_size];
+  // The mirror slot keeps the window of the last 'depth' frames contiguous
+  memcpy(frame + m_depth * m_frame_size, frame, m_frame_size);
+
+  if (m_empty) {
+    // Pad the window with copies of the first frame
+    for (int slot = 1; slot < m_depth; slot++)
+      memcpy(frame + slot * m_frame_size, frame, m_frame_size);
+    m_empty = false;
+  }
+}
+
+void FrameStack::copyTo(uInt8 *buffer) const {
+  memcpy(buffer, frames(), size());
+}
@@ -0,0 +1,81 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  frame_stack.hpp
+ *
+ *  A ring buffer holding the most recent observations of an environment.
+ **************************************************************************** */
+
+#ifndef __FRAME_STACK_HPP__
+#define __FRAME_STACK_HPP__
+
+#include "emucore/m6502/src/bspf/src/bspf.hxx"
+
+#include <vector>
+
+namespace ale {
+
+/** Keeps the last 'depth' frames in a buffer of twice that many slots. Every frame
+  *  is written to two slots, 'depth' apart, so that the stacked frames are always
+  *  contiguous, oldest first, without ever moving the older frames. */
+class FrameStack {
+  public:
+    FrameStack();
+
+    /** Sets the frame size and depth; a depth of 0 disables the stack. Clears it. */
+    void configure(size_t frame_size, int depth);
+
+    bool enabled() const { return m_depth > 0; }
+    int depth() const { return m_depth; }
+    size_t frameSize() const { return m_frame_size; }
+
+    /** Number of bytes in the stacked frames. */
+    size_t size() const { return m_frame_size * m_depth; }
+
+    /** Forgets all frames; the next frame pushed then fills the whole stack, as
+      *  happens at the start of an episode. */
+    void clear() { m_empty = true; }
+
+    /** Returns the slot the next frame is to be written into; call endFrame()
+      *  once it is written. */
+    uInt8* beginFrame();
+    void endFrame();
+
+    /** The underlying buffer of 2 x depth frames, and the byte offset within it
+      *  of the oldest stacked frame. */
+    const uInt8* base() const { return &m_buffer[0]; }
+    size_t offset() const { return (m_head + 1) * m_frame_size; }
+
+    /** The stacked frames, oldest first, as one contiguous block of size() bytes. */
+    const uInt8* frames() const { return base() + offset(); }
+
+    /** Copies the stacked frames into a caller-provided buffer of size() bytes. */
+    void copyTo(uInt8 *buffer) const;
+
+  private:
+    size_t m_frame_size;
+    int m_depth;
+    int m_head; // Slot of the newest frame, in [0, depth)
+    bool m_empty;
+
+    std::vector<uInt8> m_buffer;
+};
+
+} // namespace ale
+
+#endif // __FRAME_STACK_HPP__
@@ -34,79 +34,83 @@
 #include "phosphor_blend.hpp"
 #include "emucore/Console.hxx"
 
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
 using namespace ale;
 
+// Taken from default Stella settings
+static const int PHOSPHOR_BLEND_RATIO = 77;
+
 PhosphorBlend::PhosphorBlend(OSystem * osystem):
     m_osystem(osystem) {
-  
-  // Taken from default Stella settings
-  m_phosphor_blend_ratio = 77;
-
-  makeAveragePalette();
 }
 
 void PhosphorBlend::process(ALEScreen& screen) {
+  if (!m_blend_table) {
+    ExportScreen* es = m_osystem->p_export_screen;
+
+    std::vector<uInt32> palette(256);
+    for (int c = 0; c < 256; c++) {
+      int r, g, b;
+      es->get_rgb_from_palette(c, r, g, b);
+      palette[c] = (r << 16) | (g << 8) | b;
+    }
+    m_blend_table = getBlendTable(palette);
+  }
+
   Console& console = m_osystem->console();
 
   // Fetch current and previous frame buffers from the emulator
-  uInt8 * current_buffer  = console.mediaSource().currentFrameBuffer();
-  uInt8 * previous_buffer = console.mediaSource().previousFrameBuffer();
-
-  // Process each pixel in turn
-  for (size_t i = 0; i < screen.arraySize(); i++) { 
-    int cv = current_buffer[i];
-    int pv = previous_buffer[i];
-    
-    // Find out the corresponding rgb color 
-    uInt32 rgb = m_avg_palette[cv][pv];
-
-    // Set the corresponding pixel in the array
-    screen.getArray()[i] = rgbToNTSC(rgb);
+  const uInt8 * current_buffer  = console.mediaSource().currentFrameBuffer();
+  const uInt8 * previous_buffer = console.mediaSource().previousFrameBuffer();
+
+  // Each pixel is a single lookup of its pair of colours
+  const uInt8 * table = &(*m_blend_table)[0];
+  uInt8 * pixels = &screen.getArray()[0];
+  for (size_t i = 0; i < screen.arraySize(); i++)
+    pixels[i] = table[(current_buffer[i] << 8) | previous_buffer[i]];
+}
+
+std::shared_ptr<const PhosphorBlend::BlendTable> PhosphorBlend::getBlendTable(
+    const std::vector<uInt32>& palette) {
+  // Tables are shared by all instances using the same palette, and freed
+  //  along with the last of them
+  static std::mutex mutex;
+  static std::map<std::vector<uInt32>, std::weak_ptr<const BlendTable> > tables;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::shared_ptr<const BlendTable> table = tables[palette].lock();
+  if (!table) {
+    table = std::make_shared<const BlendTable>(makeBlendTable(palette));
+    tables[palette] = table;
   }
+
+  return table;
 }
-void PhosphorBlend::makeAveragePalette() {
+
+PhosphorBlend::BlendTable PhosphorBlend::makeBlendTable(const std::vector<uInt32>& palette) {
   // MGB: This is taken from fifo_controller; and before then from somewhere else
-  ExportScreen* es = m_osystem->p_export_screen;
+  BlendTable table(256 * 256);
 
-  // Precompute the average RGB values for phosphor-averaged colors c1 and c2
+  // Blending is symmetric, so only half of the pairs need searching
   for (int c1 = 0; c1 < 256; c1++) {
-    for (int c2 = 0; c2 < 256; c2++) {
-      int r1, g1, b1;
-      int r2, g2, b2;
-      es->get_rgb_from_palette(c1, r1, g1, b1);
-      es->get_rgb_from_palette(c2, r2, g2, b2);
-
-      uInt8 r = getPhosphor(r1, r2);
-      uInt8 g = getPhosphor(g1, g2);
-      uInt8 b = getPhosphor(b1, b2);
-      m_avg_palette[c1][c2] = makeRGB(r, g, b);
-    }
-  }
-  
-  // Also make a RGB to NTSC color map
-  for (int r = 0; r < 256; r += 4) {
-    for (int g = 0; g < 256; g += 4) {  
-      for (int b = 0; b < 256; b += 4) {
-        // For each RGB point, we find its closest NTSC match
-        int minDist = 256 * 3 + 1;
-        int minIndex = -1;
-
-        for (int c1 = 0; c1 < 256; c1++) {
-          // Get the RGB corresponding to c1
-          int r1, g1, b1;
-          es->get_rgb_from_palette(c1, r1, g1, b1);
-
-          int dist = abs(r1 - r) + abs(g1 - g) + abs(b1 - b);
-          if (dist < minDist) {
-            minDist = dist;
-            minIndex = c1;
-          }
-        }
-
-        m_rgb_ntsc[r >> 2][g >> 2][b >> 2] = minIndex;
-      }
+    for (int c2 = 0; c2 <= c1; c2++) {
+      uInt32 rgb1 = palette[c1], rgb2 = palette[c2];
+
+      uInt8 r = getPhosphor((rgb1 >> 16) & 0xFF, (rgb2 >> 16) & 0xFF);
+      uInt8 g = getPhosphor((rgb1 >> 8) & 0xFF, (rgb2 >> 8) & 0xFF);
+      uInt8 b = getPhosphor(rgb1 & 0xFF, rgb2 & 0xFF);
+
+      uInt8 colour = rgbToNTSC(palette, r, g, b);
+      table[(c1 << 8) | c2] = colour;
+      table[(c2 << 8) | c1] = colour;
     }
   }
+
+  return table;
 }
 
 uInt8 PhosphorBlend::getPhosphor(uInt8 v1, uInt8 v2) {
@@ -116,21 +120,33 @@ uInt8 PhosphorBlend::getPhosphor(uInt8 v1, uInt8 v2) {
     v2 = tmp;
   }
 
-  uInt32 blendedValue = ((v1 - v2) * m_phosphor_blend_ratio) / 100 + v2;
+  uInt32 blendedValue = ((v1 - v2) * PHOSPHOR_BLEND_RATIO) / 100 + v2;
   if (blendedValue > 255) return 255;
   else return (uInt8) blendedValue;
 }
 
-uInt32 PhosphorBlend::makeRGB(uInt8 r, uInt8 g, uInt8 b) {
-  return (r << 16) | (g << 8) | b;
-}
-
 /** Converts a RGB value to an 8-bit format */
-uInt8 PhosphorBlend::rgbToNTSC(uInt32 rgb) {
-  int r = (rgb >> 16) & 0xFF;
-  int g = (rgb >> 8) & 0xFF;
-  int b = rgb & 0xFF;
+uInt8 PhosphorBlend::rgbToNTSC(const std::vector<uInt32>& palette, int r, int g, int b) {
+  // Colours are matched at a 6-bit resolution per channel
+  r &= ~3;
+  g &= ~3;
+  b &= ~3;
+
+  // Find the closest palette colour, preferring the lowest index on ties
+  int minDist = 256 * 3 + 1;
+  int minIndex = -1;
+
+  for (int c = 0; c < 256; c++) {
+    int r1 = (palette[c] >> 16) & 0xFF;
+    int g1 = (palette[c] >> 8) & 0xFF;
+    int b1 = palette[c] & 0xFF;
+
+    int dist = abs(r1 - r) + abs(g1 - g) + abs(b1 - b);
+    if (dist < minDist) {
+      minDist = dist;
+      minIndex = c;
+    }
+  }
 
-  return m_rgb_ntsc[r >> 2][g >> 2][b >> 2];
+  return minIndex;
 }
-
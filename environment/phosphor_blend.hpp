@@ -37,31 +37,39 @@
 #include "emucore/OSystem.hxx"
 #include "ale_interface.hpp"
 
+#include <memory>
+#include <vector>
+
 namespace ale {
 
 class PhosphorBlend {
   public:
     PhosphorBlend(OSystem *);
 
+    /** Blends the current and previous frames into 'screen' */
     void process(ALEScreen& screen);
 
   private:
-    void makeAveragePalette();
-    uInt8 getPhosphor(uInt8 v1, uInt8 v2);
-    uInt32 makeRGB(uInt8 r, uInt8 g, uInt8 b);
+    /** Closest palette colour to the blend of each (current, previous) pair of
+      *  colours, indexed by current * 256 + previous */
+    typedef std::vector<uInt8> BlendTable;
+
+    /** Returns the table for the given palette, building it only if no instance
+      *  using the same palette has done so already */
+    static std::shared_ptr<const BlendTable> getBlendTable(const std::vector<uInt32>& palette);
+    static BlendTable makeBlendTable(const std::vector<uInt32>& palette);
+
+    static uInt8 getPhosphor(uInt8 v1, uInt8 v2);
     /** Converts a RGB value to an 8-bit format */
-    uInt8 rgbToNTSC(uInt32 rgb);
+    static uInt8 rgbToNTSC(const std::vector<uInt32>& palette, int r, int g, int b);
     
   private:
     OSystem * m_osystem;
 
-    uInt8 m_rgb_ntsc[64][64][64];
-
-    uInt32 m_avg_palette[256][256];
-    uInt8 m_phosphor_blend_ratio;
+    // Built on first use, as colour averaging is often disabled
+    std::shared_ptr<const BlendTable> m_blend_table;
 };
 
 } // namespace ale
 
 #endif // __PHOSPHOR_BLEND_HPP__
-
@@ -0,0 +1,151 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  rewind_buffer.cpp
+ *
+ *  A bounded history of recent emulator states and actions, for rewinding.
+ **************************************************************************** */
+
+#include "rewind_buffer.hpp"
+#include "state_delta.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace ale;
+
+RewindBuffer::RewindBuffer(int max_frames, int interval):
+  m_max_frames(max_frames),
+  m_interval(interval),
+  m_snapshot_size(0),
+  m_first(0),
+  m_next(0) {
+
+  if (max_frames < 0 || interval < 1)
+    throw std::invalid_argument("rewind buffer needs a positive interval");
+  if (max_frames == 0) return;
+
+  // Dropping a whole group must still leave 'max_frames' of history
+  int slots = (max_frames + interval - 1) / interval + 1;
+  slots = ((slots + GROUP_SIZE - 1) / GROUP_SIZE + 1) * GROUP_SIZE;
+  m_slots.resize(slots);
+}
+
+bool RewindBuffer::checkpointDue(int frame) const {
+  return enabled() && (m_next == m_first || frame >= slot(m_next - 1).frame + m_interval);
+}
+
+void RewindBuffer::addCheckpoint(int frame, const uInt8 *snapshot, size_t size) {
+  if (m_next > m_first && size != m_snapshot_size)
+    clear();
+  m_snapshot_size = size;
+
+  // Make room by dropping the oldest group
+  if (m_next - m_first == static_cast<long>(m_slots.size()))
+    m_first += GROUP_SIZE;
+
+  Slot& s = slot(m_next);
+  s.frame = frame;
+  s.data.clear();
+  s.actions.clear();
+  if (m_next % GROUP_SIZE == 0)
+    s.data.assign(snapshot, snapshot + size);
+  else
+    encodeDelta(&m_last[0], snapshot, size, s.data);
+
+  m_last.assign(snapshot, snapshot + size);
+  m_next++;
+}
+
+void RewindBuffer::addActions(Action player_a_action, Action player_b_action) {
+  if (m_next == m_first) return;
+
+  std::vector<uInt8>& actions = slot(m_next - 1).actions;
+  actions.push_back(static_cast<uInt8>(player_a_action));
+  actions.push_back(static_cast<uInt8>(player_b_action));
+}
+
+int RewindBuffer::oldestFrame() const {
+  return m_next == m_first ? -1 : slot(m_first).frame;
+}
+
+long RewindBuffer::find(int frame) const {
+  long index = m_next - 1;
+  while (index > m_first && slot(index).frame > frame) index--;
+  return index;
+}
+
+void RewindBuffer::materialize(long index, uInt8 *out) const {
+  long start = index - index % GROUP_SIZE;
+  std::copy(slot(start).data.begin(), slot(start).data.end(), out);
+
+  for (long i = start + 1; i <= index; i++) {
+    const std::vector<uInt8>& delta = slot(i).data;
+    if (!delta.empty())
+      applyDelta(&delta[0], delta.size(), out, m_snapshot_size);
+  }
+}
+
+int RewindBuffer::restoreCheckpoint(int frame, int start, uInt8 *snapshot, size_t size,
+                                    std::vector<uInt8> &actions) const {
+  if (m_next == m_first || frame < oldestFrame())
+    throw std::out_of_range("frame precedes the rewind history");
+  if (size != m_snapshot_size)
+    throw std::invalid_argument("buffer does not match the rewind snapshots");
+
+  long index = find(std::min(start, frame));
+  int start_frame = slot(index).frame;
+
+  // Each snapshot's actions lead up to the next snapshot
+  size_t replayed = static_cast<size_t>(frame - start_frame) * 2;
+  actions.clear();
+  for (long i = index; i < m_next && actions.size() < replayed; i++) {
+    const std::vector<uInt8>& logged = slot(i).actions;
+    size_t count = std::min(logged.size(), replayed - actions.size());
+    actions.insert(actions.end(), logged.begin(), logged.begin() + count);
+  }
+  if (actions.size() < replayed)
+    throw std::out_of_range("frame follows the rewind history");
+
+  materialize(index, snapshot);
+  return start_frame;
+}
+
+void RewindBuffer::truncate(int frame) {
+  if (m_next == m_first) return;
+  if (frame < oldestFrame()) {
+    clear();
+    return;
+  }
+
+  long index = find(frame);
+  Slot& s = slot(index);
+  size_t kept = static_cast<size_t>(frame - s.frame) * 2;
+  if (s.actions.size() > kept)
+    s.actions.resize(kept);
+
+  // The newest remaining snapshot is the base of the next delta
+  if (index != m_next - 1) {
+    m_next = index + 1;
+    materialize(index, &m_last[0]);
+  }
+}
+
+void RewindBuffer::clear() {
+  m_first = m_next = 0;
+}
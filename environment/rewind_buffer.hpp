@@ -0,0 +1,108 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  rewind_buffer.hpp
+ *
+ *  A bounded history of recent emulator states and actions, for rewinding.
+ **************************************************************************** */
+
+#ifndef __REWIND_BUFFER_HPP__
+#define __REWIND_BUFFER_HPP__
+
+#include "emucore/m6502/src/bspf/src/bspf.hxx"
+#include "common/Constants.h"
+
+#include <vector>
+
+namespace ale {
+
+/** Records a compact snapshot every 'interval' frames, and the actions applied on each
+  *  frame after it. Snapshots are grouped: the first of a group is kept in full and the
+  *  others as deltas from their predecessor, and the oldest group is dropped once the
+  *  ring is full. Any frame since the oldest snapshot can then be rebuilt by restoring
+  *  the snapshot before it and replaying the actions. Memory stays bounded: slots are
+  *  reused without being freed. */
+class RewindBuffer {
+  public:
+    /** Creates a buffer that can go back at least 'max_frames' frames; a 'max_frames'
+      *  of 0 disables it. */
+    RewindBuffer(int max_frames = 0, int interval = 1);
+
+    bool enabled() const { return m_max_frames > 0; }
+    int maxFrames() const { return m_max_frames; }
+    int interval() const { return m_interval; }
+
+    /** Whether a snapshot should be recorded before emulating 'frame'. */
+    bool checkpointDue(int frame) const;
+
+    /** Records the snapshot taken before emulating 'frame'. */
+    void addCheckpoint(int frame, const uInt8 *snapshot, size_t size);
+
+    /** Records the actions applied on the frame after the last one recorded. */
+    void addActions(Action player_a_action, Action player_b_action);
+
+    /** Earliest frame that can be rebuilt, or -1 when empty. */
+    int oldestFrame() const;
+
+    /** Writes the latest snapshot taken at or before 'start' (or the oldest one) into
+      *  'snapshot', and the actions from there to 'frame' into 'actions' (player A and B
+      *  alternating). Returns the frame the snapshot was taken at. Throws
+      *  std::out_of_range if 'frame' precedes oldestFrame() or follows the actions. */
+    int restoreCheckpoint(int frame, int start, uInt8 *snapshot, size_t size,
+                          std::vector<uInt8> &actions) const;
+
+    /** Forgets everything recorded after 'frame', e.g. after rewinding to it. */
+    void truncate(int frame);
+
+    /** Forgets everything, e.g. when the state jumps. */
+    void clear();
+
+  private:
+    struct Slot {
+      int frame;                  // Frame the snapshot was taken at
+      std::vector<uInt8> data;    // The snapshot, or its delta from the previous one
+      std::vector<uInt8> actions; // Actions applied since, two per frame
+    };
+
+    Slot &slot(long index) { return m_slots[index % m_slots.size()]; }
+    const Slot &slot(long index) const { return m_slots[index % m_slots.size()]; }
+
+    /** Index of the latest snapshot taken at or before 'frame' */
+    long find(int frame) const;
+
+    /** Rebuilds snapshot 'index' into 'out' from the first snapshot of its group */
+    void materialize(long index, uInt8 *out) const;
+
+    /** Snapshots per group: one in full, the others as deltas */
+    static const int GROUP_SIZE = 8;
+
+    int m_max_frames;
+    int m_interval;
+    size_t m_snapshot_size;
+
+    // Snapshot n lives in slot n % slots; snapshots [m_first, m_next) are valid, and
+    //  m_first is always the start of a group
+    std::vector<Slot> m_slots;
+    long m_first;
+    long m_next;
+    std::vector<uInt8> m_last; // The newest snapshot, which the next delta is taken from
+};
+
+} // namespace ale
+
+#endif // __REWIND_BUFFER_HPP__
@@ -0,0 +1,247 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  screen_preprocessor.cpp
+ *
+ *  Turns palette-indexed screens into cropped, resized grayscale or RGB
+ *  observations.
+ **************************************************************************** */
+
+#include "screen_preprocessor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace ale;
+
+ScreenPreprocessor::ScreenPreprocessor(int screen_height, int screen_width):
+  m_screen_height(screen_height),
+  m_screen_width(screen_width),
+  m_channels(1) {
+
+  memset(m_channel_table, 0, sizeof(m_channel_table));
+}
+
+void ScreenPreprocessor::configure(const ScreenPreprocessing &config,
+                                   const uInt8 rgb_palette[256][3], const uInt8 luminance[256]) {
+  ScreenPreprocessing resolved = config;
+
+  // Zero-sized crops extend to the edge of the screen
+  if (resolved.crop_height == 0) resolved.crop_height = m_screen_height - resolved.crop_top;
+  if (resolved.crop_width == 0) resolved.crop_width = m_screen_width - resolved.crop_left;
+
+  if (resolved.crop_top < 0 || resolved.crop_left < 0 ||
+      resolved.crop_height <= 0 || resolved.crop_width <= 0 ||
+      resolved.crop_top + resolved.crop_height > m_screen_height ||
+      resolved.crop_left + resolved.crop_width > m_screen_width)
+    throw std::invalid_argument("screen preprocessing crop lies outside the screen");
+
+  if (resolved.output_height <= 0 || resolved.output_width <= 0)
+    throw std::invalid_argument("screen preprocessing output must not be empty");
+
+  m_config = resolved;
+  m_channels = m_config.grayscale ? 1 : 3;
+
+  for (int c = 0; c < 256; c++) {
+    if (m_config.grayscale)
+      m_channel_table[0][c] = luminance[c];
+    else {
+      m_channel_table[0][c] = rgb_palette[c][0];
+      m_channel_table[1][c] = rgb_palette[c][1];
+      m_channel_table[2][c] = rgb_palette[c][2];
+    }
+  }
+
+  makeTaps(m_config.crop_height, m_config.output_height, m_row_taps);
+  makeTaps(m_config.crop_width, m_config.output_width, m_column_taps);
+
+  m_intensity.resize(m_config.crop_width * m_channels);
+  m_rows.resize(m_config.crop_height * m_config.output_width * m_channels);
+  m_accumulator.resize(m_config.output_width * m_channels);
+
+  // Rows that no output row samples (e.g. when shrinking bilinearly) are never resampled
+  m_row_needed.assign(m_config.crop_height, 0);
+  for (size_t t = 0; t < m_row_taps.index.size(); t++)
+    if (m_row_taps.weight[t] != 0)
+      m_row_needed[m_row_taps.index[t]] = 1;
+}
+
+size_t ScreenPreprocessor::outputSize() const {
+  return static_cast<size_t>(m_config.output_height) * m_config.output_width * m_channels;
+}
+
+void ScreenPreprocessor::process(const uInt8 *current, const uInt8 *previous, uInt8 *output) {
+  if (!m_config.max_pool) previous = NULL;
+
+  const int channels = m_channels;
+  const int output_width = m_config.output_width;
+  const int row_size = output_width * channels;
+
+  // Horizontal pass: convert each cropped row to intensities and resample it
+  for (int r = 0; r < m_config.crop_height; r++) {
+    if (!m_row_needed[r]) continue;
+
+    size_t offset = static_cast<size_t>(m_config.crop_top + r) * m_screen_width + m_config.crop_left;
+    convertRow(current + offset, previous != NULL ? previous + offset : NULL);
+
+    // Work from locals: the compiler cannot tell that the uInt32 stores below
+    //  leave the members alone
+    uInt32* row = &m_rows[r * row_size];
+    const uInt8* intensity = &m_intensity[0];
+    const int* index = &m_column_taps.index[0];
+    const uInt32* weight = &m_column_taps.weight[0];
+    const int taps = m_column_taps.size;
+
+    if (channels == 1) {
+      for (int o = 0; o < output_width; o++, index += taps, weight += taps) {
+        uInt32 sum = 0;
+        for (int t = 0; t < taps; t++)
+          sum += intensity[index[t]] * weight[t];
+        row[o] = sum;
+      }
+    }
+    else {
+      for (int o = 0; o < output_width; o++, index += taps, weight += taps) {
+        for (int c = 0; c < channels; c++) {
+          uInt32 sum = 0;
+          for (int t = 0; t < taps; t++)
+            sum += intensity[index[t] * channels + c] * weight[t];
+          row[o * channels + c] = sum;
+        }
+      }
+    }
+  }
+
+  // Vertical pass: combine the resampled rows, rounding to the nearest value
+  const uInt32 half = 1u << (2 * WEIGHT_BITS - 1);
+  for (int o = 0; o < m_config.output_height; o++) {
+    uInt32* accumulator = &m_accumulator[0];
+    std::fill(accumulator, accumulator + row_size, half);
+
+    for (int t = o * m_row_taps.size; t < (o + 1) * m_row_taps.size; t++) {
+      uInt32 weight = m_row_taps.weight[t];
+      if (weight == 0) continue;
+      const uInt32* row = &m_rows[m_row_taps.index[t] * row_size];
+      for (int x = 0; x < row_size; x++)
+        accumulator[x] += row[x] * weight;
+    }
+
+    uInt8* out = output + o * row_size;
+    for (int x = 0; x < row_size; x++)
+      out[x] = static_cast<uInt8>(accumulator[x] >> (2 * WEIGHT_BITS));
+  }
+}
+
+void ScreenPreprocessor::convertRow(const uInt8 *current, const uInt8 *previous) {
+  uInt8* intensity = &m_intensity[0];
+  const int channels = m_channels;
+  const int width = m_config.crop_width;
+
+  for (int c = 0; c < channels; c++) {
+    const uInt8* table = m_channel_table[c];
+
+    if (previous == NULL) {
+      for (int x = 0; x < width; x++)
+        intensity[x * channels + c] = table[current[x]];
+    }
+    else {
+      for (int x = 0; x < width; x++)
+        intensity[x * channels + c] = std::max(table[current[x]], table[previous[x]]);
+    }
+  }
+}
+
+void ScreenPreprocessor::makeTaps(int source_size, int output_size, Taps &taps) const {
+  const double scale = static_cast<double>(source_size) / output_size;
+  // Area averaging only makes sense when shrinking
+  const bool area = m_config.interpolation == ScreenPreprocessing::AREA && source_size >= output_size;
+  const uInt32 one = 1u << WEIGHT_BITS;
+
+  std::vector<std::vector<int> > indices(output_size);
+  std::vector<std::vector<uInt32> > weights(output_size);
+  size_t max_taps = 1;
+
+  for (int o = 0; o < output_size; o++) {
+    std::vector<int> index;
+    std::vector<double> weight;
+
+    if (area) {
+      double start = o * scale;
+      double end = std::min((o + 1) * scale, static_cast<double>(source_size));
+      for (int i = static_cast<int>(std::floor(start)); i < end; i++) {
+        double overlap = std::min(end, i + 1.0) - std::max(start, static_cast<double>(i));
+        if (overlap > 0) {
+          index.push_back(i);
+          weight.push_back(overlap / scale);
+        }
+      }
+    }
+    else {
+      // Sample at the output pixel's centre, as in the usual half-pixel convention
+      double centre = (o + 0.5) * scale - 0.5;
+      centre = std::max(0.0, std::min(centre, source_size - 1.0));
+      int i0 = static_cast<int>(std::floor(centre));
+      int i1 = std::min(i0 + 1, source_size - 1);
+      double frac = centre - i0;
+
+      index.push_back(i0);
+      weight.push_back(1.0 - frac);
+      if (i1 != i0 && frac > 0) {
+        index.push_back(i1);
+        weight.push_back(frac);
+      }
+    }
+
+    // Quantize the weights, giving any rounding error to the largest one so that
+    //  constant regions stay exactly constant
+    std::vector<uInt32> quantized(weight.size());
+    uInt32 total = 0;
+    size_t largest = 0;
+    for (size_t t = 0; t < weight.size(); t++) {
+      quantized[t] = static_cast<uInt32>(std::floor(weight[t] * one + 0.5));
+      total += quantized[t];
+      if (weight[t] > weight[largest]) largest = t;
+    }
+    quantized[largest] += one - total;
+
+    for (size_t t = 0; t < index.size(); t++) {
+      if (quantized[t] == 0) continue;
+      indices[o].push_back(index[t]);
+      weights[o].push_back(quantized[t]);
+    }
+    max_taps = std::max(max_taps, indices[o].size());
+  }
+
+  // Lay the taps out with a fixed stride so that the resampling loops are regular
+  taps.size = static_cast<int>(max_taps);
+  taps.index.assign(output_size * max_taps, 0);
+  taps.weight.assign(output_size * max_taps, 0);
+  for (int o = 0; o < output_size; o++) {
+    for (size_t t = 0; t < max_taps; t++) {
+      size_t k = o * max_taps + t;
+      if (t < indices[o].size()) {
+        taps.index[k] = indices[o][t];
+        taps.weight[k] = weights[o][t];
+      }
+      else
+        taps.index[k] = indices[o].back();
+    }
+  }
+}
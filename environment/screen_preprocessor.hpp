@@ -0,0 +1,94 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  screen_preprocessor.hpp
+ *
+ *  Turns palette-indexed screens into cropped, resized grayscale or RGB
+ *  observations.
+ **************************************************************************** */
+
+#ifndef __SCREEN_PREPROCESSOR_HPP__
+#define __SCREEN_PREPROCESSOR_HPP__
+
+#include "emucore/m6502/src/bspf/src/bspf.hxx"
+#include "ale_interface.hpp"
+
+#include <vector>
+
+namespace ale {
+
+class ScreenPreprocessor {
+  public:
+    /** Creates a preprocessor for screens of the given dimensions, using the
+      *  default configuration. */
+    ScreenPreprocessor(int screen_height, int screen_width);
+
+    /** Sets up the preprocessing. The tables give the RGB value and luminance
+      *  of every palette index. Throws std::invalid_argument if the configuration
+      *  does not fit the screen. */
+    void configure(const ScreenPreprocessing &config,
+                   const uInt8 rgb_palette[256][3], const uInt8 luminance[256]);
+
+    const ScreenPreprocessing &config() const { return m_config; }
+
+    /** Number of bytes in a processed observation. */
+    size_t outputSize() const;
+
+    /** Processes a screen into 'output'. 'previous' is only read when max-pooling,
+      *  and holds the frame preceding 'current'. */
+    void process(const uInt8 *current, const uInt8 *previous, uInt8 *output);
+
+  private:
+    /** Resampling taps along one axis: output i is the weighted sum of the source
+      *  samples index[i * size .. (i + 1) * size). Weights sum to 1 << WEIGHT_BITS;
+      *  outputs with fewer taps are padded with zero weights. */
+    struct Taps {
+      int size;
+      std::vector<int> index;
+      std::vector<uInt32> weight;
+    };
+
+    /** Computes the taps that resize 'source_size' samples into 'output_size' */
+    void makeTaps(int source_size, int output_size, Taps &taps) const;
+
+    /** Converts one cropped source row to per-channel intensities in m_intensity */
+    void convertRow(const uInt8 *current, const uInt8 *previous);
+
+  private:
+    static const int WEIGHT_BITS = 11;
+
+    int m_screen_height;
+    int m_screen_width;
+    int m_channels;
+
+    ScreenPreprocessing m_config;
+
+    uInt8 m_channel_table[3][256]; // Intensity of each palette index, per channel
+
+    Taps m_row_taps;    // Vertical resampling
+    Taps m_column_taps; // Horizontal resampling
+
+    std::vector<uInt8> m_intensity;   // One converted source row
+    std::vector<uInt32> m_rows;       // Horizontally resampled source rows
+    std::vector<char> m_row_needed;   // Whether a source row contributes to the output
+    std::vector<uInt32> m_accumulator; // One output row before rounding
+};
+
+} // namespace ale
+
+#endif // __SCREEN_PREPROCESSOR_HPP__
@@ -0,0 +1,506 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  snapshot_store.cpp
+ *
+ *  An on-disk archive of compact snapshots, shared between processes.
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+
+#include <zlib/zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// Segments are memory mapped where POSIX maps exist; on Windows the records are read
+//  into memory instead, and written through the C runtime's POSIX-style file calls
+#ifdef WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace ale;
+
+// Layout of a record, within a segment: the header below, then the (possibly compressed)
+//  snapshot, padded to a multiple of 8 bytes. The header checksum lets readers tell a
+//  record that is still being written from a complete one
+#define RECORD_MAGIC 0x43455258  // "XREC"
+#define RECORD_HEADER_SIZE 32
+#define RECORD_COMPRESSED 1
+
+namespace {
+
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t flags;
+  uint64_t key;
+  uint32_t stored_size;     // Bytes following the header, before padding
+  uint32_t snapshot_size;   // Bytes once decompressed
+  uint32_t data_checksum;   // Adler-32 of the stored bytes
+  uint32_t header_checksum; // Adler-32 of the fields above
+};
+
+uint32_t headerChecksum(const RecordHeader &header) {
+  return adler32(1, reinterpret_cast<const Bytef*>(&header), offsetof(RecordHeader, header_checksum));
+}
+
+size_t paddedSize(size_t size) {
+  return (size + 7) & ~static_cast<size_t>(7);
+}
+
+std::string systemError(const std::string &what, const std::string &path) {
+  return what + " " + path + ": " + strerror(errno);
+}
+
+/** Whether a complete, valid record header starts at 'data' */
+bool validHeader(const char *data, size_t available) {
+  if (available < RECORD_HEADER_SIZE) return false;
+  RecordHeader header;
+  memcpy(&header, data, RECORD_HEADER_SIZE);
+  return header.magic == RECORD_MAGIC && header.header_checksum == headerChecksum(header);
+}
+
+size_t fileSize(const std::string &path) {
+  std::error_code error;
+  uintmax_t size = std::filesystem::file_size(path, error);
+  if (error)
+    throw std::runtime_error("cannot read snapshot segment " + path + ": " + error.message());
+  return static_cast<size_t>(size);
+}
+
+#ifdef WIN32
+int openAppend(const std::string &path) {
+  return _open(path.c_str(), _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+long long appendRecord(int fd, const char *data, size_t size) {
+  if (_write(fd, data, static_cast<unsigned int>(size)) != static_cast<int>(size)) return -1;
+  return _lseeki64(fd, 0, SEEK_CUR);
+}
+void closeFile(int fd) { _close(fd); }
+void syncFile(int fd) { _commit(fd); }
+#else
+int openAppend(const std::string &path) {
+  return open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0666);
+}
+long long appendRecord(int fd, const char *data, size_t size) {
+  if (write(fd, data, size) != static_cast<ssize_t>(size)) return -1;
+  return lseek(fd, 0, SEEK_CUR);
+}
+void closeFile(int fd) { close(fd); }
+void syncFile(int fd) {
+#if defined(__APPLE__)
+  // fsync() leaves the data in the drive's cache on macOS
+  if (fcntl(fd, F_FULLFSYNC) != 0) fsync(fd);
+#else
+  fdatasync(fd);
+#endif
+}
+#endif
+
+} // namespace
+
+class SnapshotStore::Impl {
+
+    public:
+
+        Impl(const std::string &directory, bool compress, size_t segment_size);
+        ~Impl();
+
+        bool put(uint64_t key, const void *snapshot, size_t size);
+        size_t snapshotSize(uint64_t key) const;
+        size_t get(uint64_t key, void *buffer, size_t size) const;
+        const void *view(uint64_t key, size_t &size) const;
+        size_t refresh();
+        void sync();
+
+        bool contains(uint64_t key) const { return m_index.count(key) != 0; }
+        size_t size() const { return m_index.size(); }
+
+    private:
+
+        struct Segment {
+          int number;
+          std::string path;
+          const char *map;   // Read-only map, reserved up to the segment size
+          size_t map_length;
+          size_t scanned;    // Bytes indexed so far
+        };
+
+        std::string segmentPath(int number) const;
+
+        /** Adds the segments created since the last call, in order */
+        void findSegments();
+
+        /** Returns bytes 'begin' to 'end' of a segment, which stay valid while the store
+          *  is open: a map of at least 'end' bytes (earlier maps are kept), or a copy */
+        const char *load(Segment &segment, size_t begin, size_t end);
+
+        /** Indexes the complete records of a segment beyond those already seen */
+        size_t scanSegment(size_t index);
+
+        /** Returns the header of a stored record, checking its data */
+        const RecordHeader &record(const char *data) const;
+
+        /** Opens the segment new records go to, starting another if it is full */
+        void openWriteSegment(size_t record_size);
+
+        std::string m_directory;
+        bool m_compress;
+        size_t m_segment_size;
+
+        std::vector<Segment> m_segments;
+        std::vector<std::pair<const char*, size_t> > m_retired_maps;
+        std::vector<std::unique_ptr<char[]> > m_copies; // Records read without maps
+        std::unordered_map<uint64_t, const char*> m_index; // Record of each key
+
+        int m_write_fd;
+        int m_write_number; // Segment m_write_fd appends to, or -1
+        std::vector<char> m_record; // A record being written
+};
+
+SnapshotStore::Impl::Impl(const std::string &directory, bool compress, size_t segment_size):
+  m_directory(directory),
+  m_compress(compress),
+  m_segment_size(std::max<size_t>(segment_size, RECORD_HEADER_SIZE)),
+  m_write_fd(-1),
+  m_write_number(-1) {
+
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error)
+    throw std::runtime_error("cannot create snapshot store " + directory + ": " + error.message());
+
+  refresh();
+}
+
+SnapshotStore::Impl::~Impl() {
+#ifndef WIN32
+  for (size_t i = 0; i < m_segments.size(); i++)
+    if (m_segments[i].map != NULL)
+      munmap(const_cast<char*>(m_segments[i].map), m_segments[i].map_length);
+  for (size_t i = 0; i < m_retired_maps.size(); i++)
+    munmap(const_cast<char*>(m_retired_maps[i].first), m_retired_maps[i].second);
+#endif
+  if (m_write_fd >= 0)
+    closeFile(m_write_fd);
+}
+
+std::string SnapshotStore::Impl::segmentPath(int number) const {
+  char name[32];
+  snprintf(name, sizeof(name), "/segment-%06d.snap", number);
+  return m_directory + name;
+}
+
+void SnapshotStore::Impl::findSegments() {
+  std::error_code error;
+  std::filesystem::directory_iterator entries(m_directory, error);
+  if (error)
+    throw std::runtime_error("cannot read snapshot store " + m_directory + ": " + error.message());
+
+  std::vector<int> numbers;
+  for (; entries != std::filesystem::directory_iterator(); entries.increment(error)) {
+    std::string name = entries->path().filename().string();
+    int number;
+    char tail;
+    if (sscanf(name.c_str(), "segment-%d.sna%c", &number, &tail) == 2 && tail == 'p' &&
+        (m_segments.empty() || number > m_segments.back().number))
+      numbers.push_back(number);
+  }
+
+  std::sort(numbers.begin(), numbers.end());
+  for (size_t i = 0; i < numbers.size(); i++) {
+    Segment segment;
+    segment.number = numbers[i];
+    segment.path = segmentPath(numbers[i]);
+    segment.map = NULL;
+    segment.map_length = 0;
+    segment.scanned = 0;
+    m_segments.push_back(segment);
+  }
+}
+
+const char *SnapshotStore::Impl::load(Segment &segment, size_t begin, size_t end) {
+#ifdef WIN32
+  std::unique_ptr<char[]> copy(new char[std::max<size_t>(end - begin, 1)]);
+  FILE* file = fopen(segment.path.c_str(), "rb");
+  bool read = file != NULL && fseek(file, static_cast<long>(begin), SEEK_SET) == 0 &&
+              fread(copy.get(), 1, end - begin, file) == end - begin;
+  if (file != NULL) fclose(file);
+  if (!read)
+    throw std::runtime_error(systemError("cannot read snapshot segment", segment.path));
+
+  m_copies.push_back(std::move(copy));
+  return m_copies.back().get();
+#else
+  if (segment.map == NULL || end > segment.map_length) {
+    // Reserving the whole segment lets it grow without remapping; pages past the end of
+    //  the file are only touched once records are written there
+    size_t length = std::max(end, m_segment_size);
+    int fd = open(segment.path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error(systemError("cannot open snapshot segment", segment.path));
+    void* map = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+      throw std::runtime_error(systemError("cannot map snapshot segment", segment.path));
+
+    if (segment.map != NULL)
+      m_retired_maps.push_back(std::make_pair(segment.map, segment.map_length));
+    segment.map = static_cast<const char*>(map);
+    segment.map_length = length;
+  }
+  return segment.map + begin;
+#endif
+}
+
+size_t SnapshotStore::Impl::scanSegment(size_t index) {
+  Segment& segment = m_segments[index];
+  size_t file_size = fileSize(segment.path);
+  if (file_size <= segment.scanned) return 0;
+  const char* data = load(segment, segment.scanned, file_size);
+  size_t available = file_size - segment.scanned;
+
+  size_t added = 0;
+  size_t offset = 0;
+  while (offset + RECORD_HEADER_SIZE <= available) {
+    RecordHeader header;
+    memcpy(&header, data + offset, RECORD_HEADER_SIZE);
+
+    if (!validHeader(data + offset, available - offset)) {
+      // Records start on 8-byte boundaries, so a damaged one is skipped by looking for
+      //  the next valid header. Without one, this is a record still being written
+      size_t next = offset + 8;
+      while (next + RECORD_HEADER_SIZE <= available && !validHeader(data + next, available - next))
+        next += 8;
+      if (next + RECORD_HEADER_SIZE > available) break;
+
+      std::cerr << "Warning: skipping " << next - offset << " corrupt bytes at offset "
+                << segment.scanned + offset << " of " << segment.path << std::endl;
+      offset = next;
+      continue;
+    }
+
+    // Stop at a record that is still being written
+    size_t record_size = RECORD_HEADER_SIZE + paddedSize(header.stored_size);
+    if (offset + record_size > available) break;
+
+    if (m_index.insert(std::make_pair(header.key, data + offset)).second)
+      added++;
+    offset += record_size;
+  }
+
+  segment.scanned += offset;
+  return added;
+}
+
+size_t SnapshotStore::Impl::refresh() {
+  findSegments();
+
+  // Writers may still be appending to any segment below their own segment size
+  size_t added = 0;
+  for (size_t i = 0; i < m_segments.size(); i++)
+    added += scanSegment(i);
+  return added;
+}
+
+const RecordHeader &SnapshotStore::Impl::record(const char *data) const {
+  const RecordHeader& header = *reinterpret_cast<const RecordHeader*>(data);
+
+  if (adler32(1, reinterpret_cast<const Bytef*>(data + RECORD_HEADER_SIZE), header.stored_size) !=
+      header.data_checksum)
+    throw std::runtime_error("snapshot store record is corrupt");
+  return header;
+}
+
+size_t SnapshotStore::Impl::snapshotSize(uint64_t key) const {
+  std::unordered_map<uint64_t, const char*>::const_iterator it = m_index.find(key);
+  if (it == m_index.end()) return 0;
+
+  return reinterpret_cast<const RecordHeader*>(it->second)->snapshot_size;
+}
+
+size_t SnapshotStore::Impl::get(uint64_t key, void *buffer, size_t size) const {
+  std::unordered_map<uint64_t, const char*>::const_iterator it = m_index.find(key);
+  if (it == m_index.end()) return 0;
+
+  const RecordHeader& header = record(it->second);
+  if (header.snapshot_size > size)
+    throw std::invalid_argument("buffer is too small for the stored snapshot");
+
+  const char* data = reinterpret_cast<const char*>(&header) + RECORD_HEADER_SIZE;
+  if (header.flags & RECORD_COMPRESSED) {
+    uLongf length = header.snapshot_size;
+    if (uncompress(static_cast<Bytef*>(buffer), &length, reinterpret_cast<const Bytef*>(data),
+                   header.stored_size) != Z_OK || length != header.snapshot_size)
+      throw std::runtime_error("snapshot store record is corrupt");
+  }
+  else
+    memcpy(buffer, data, header.snapshot_size);
+
+  return header.snapshot_size;
+}
+
+const void *SnapshotStore::Impl::view(uint64_t key, size_t &size) const {
+  std::unordered_map<uint64_t, const char*>::const_iterator it = m_index.find(key);
+  if (it == m_index.end()) return NULL;
+
+  const RecordHeader& header = record(it->second);
+  if (header.flags & RECORD_COMPRESSED) return NULL;
+
+  size = header.snapshot_size;
+  return reinterpret_cast<const char*>(&header) + RECORD_HEADER_SIZE;
+}
+
+void SnapshotStore::Impl::openWriteSegment(size_t record_size) {
+  if (m_write_fd < 0 && !m_segments.empty())
+    m_write_number = m_segments.back().number;
+
+  while (true) {
+    if (m_write_fd < 0) {
+      if (m_write_number < 0) m_write_number = 0;
+      std::string path = segmentPath(m_write_number);
+      m_write_fd = openAppend(path);
+      if (m_write_fd < 0)
+        throw std::runtime_error(systemError("cannot open snapshot segment", path));
+    }
+
+    // Other processes append too, so check the actual size
+    size_t file_size = fileSize(segmentPath(m_write_number));
+    if (file_size == 0 || file_size + record_size <= m_segment_size) return;
+
+    closeFile(m_write_fd);
+    m_write_fd = -1;
+    m_write_number++;
+  }
+}
+
+bool SnapshotStore::Impl::put(uint64_t key, const void *snapshot, size_t size) {
+  if (contains(key)) return false;
+
+  RecordHeader header;
+  header.magic = RECORD_MAGIC;
+  header.flags = 0;
+  header.key = key;
+  header.snapshot_size = static_cast<uint32_t>(size);
+  header.stored_size = static_cast<uint32_t>(size);
+
+  m_record.resize(RECORD_HEADER_SIZE + paddedSize(std::max<size_t>(size, compressBound(size))));
+  Bytef* data = reinterpret_cast<Bytef*>(&m_record[RECORD_HEADER_SIZE]);
+
+  // Only keep the compressed snapshot if it is smaller
+  uLongf compressed = compressBound(size);
+  if (m_compress && compress2(data, &compressed, static_cast<const Bytef*>(snapshot), size,
+                              Z_BEST_SPEED) == Z_OK && compressed < size) {
+    header.flags |= RECORD_COMPRESSED;
+    header.stored_size = static_cast<uint32_t>(compressed);
+  }
+  else
+    memcpy(data, snapshot, size);
+
+  header.data_checksum = adler32(1, data, header.stored_size);
+  header.header_checksum = headerChecksum(header);
+  memcpy(&m_record[0], &header, RECORD_HEADER_SIZE);
+
+  size_t record_size = RECORD_HEADER_SIZE + paddedSize(header.stored_size);
+  memset(&m_record[RECORD_HEADER_SIZE + header.stored_size], 0,
+         record_size - RECORD_HEADER_SIZE - header.stored_size);
+
+  // A single append lands whole, even with other processes appending to the segment
+  openWriteSegment(record_size);
+  long long end = appendRecord(m_write_fd, &m_record[0], record_size);
+  if (end < 0)
+    throw std::runtime_error(systemError("cannot write snapshot segment", segmentPath(m_write_number)));
+
+  // Index the new record where it landed; refresh() skips over it later
+  if (m_segments.empty() || m_segments.back().number < m_write_number)
+    findSegments();
+  size_t index = m_segments.size() - 1;
+  while (m_segments[index].number != m_write_number) index--;
+  size_t begin = static_cast<size_t>(end) - record_size;
+  m_index.insert(std::make_pair(key, load(m_segments[index], begin, static_cast<size_t>(end))));
+  return true;
+}
+
+void SnapshotStore::Impl::sync() {
+  if (m_write_fd >= 0)
+    syncFile(m_write_fd);
+}
+
+
+SnapshotStore::SnapshotStore(const std::string &directory, bool compress, size_t segment_size):
+  m_pimpl(new SnapshotStore::Impl(directory, compress, segment_size)) {
+}
+
+
+SnapshotStore::~SnapshotStore() {
+  delete m_pimpl;
+}
+
+
+bool SnapshotStore::put(uint64_t key, const void *snapshot, size_t size) {
+  return m_pimpl->put(key, snapshot, size);
+}
+
+
+bool SnapshotStore::contains(uint64_t key) const {
+  return m_pimpl->contains(key);
+}
+
+
+size_t SnapshotStore::snapshotSize(uint64_t key) const {
+  return m_pimpl->snapshotSize(key);
+}
+
+
+size_t SnapshotStore::get(uint64_t key, void *buffer, size_t size) const {
+  return m_pimpl->get(key, buffer, size);
+}
+
+
+const void *SnapshotStore::view(uint64_t key, size_t &size) const {
+  return m_pimpl->view(key, size);
+}
+
+
+size_t SnapshotStore::refresh() {
+  return m_pimpl->refresh();
+}
+
+
+size_t SnapshotStore::size() const {
+  return m_pimpl->size();
+}
+
+
+void SnapshotStore::sync() {
+  m_pimpl->sync();
+}
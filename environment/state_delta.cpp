@@ -0,0 +1,202 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  state_delta.cpp
+ *
+ *  Deltas between snapshots, and chains of them.
+ **************************************************************************** */
+
+#include "state_delta.hpp"
+#include "ale_interface.hpp"
+#include "ale_state.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace ale;
+
+// Unchanged stretches shorter than this are folded into the surrounding runs, which
+//  costs less than starting a new run
+static const size_t MIN_GAP = 3;
+
+static void putVarint(size_t value, std::vector<uint8_t> &out) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+static size_t getVarint(const uint8_t *&in, const uint8_t *end) {
+  size_t value = 0;
+  for (int shift = 0; in < end && shift < 64; shift += 7) {
+    uint8_t byte = *in++;
+    value |= static_cast<size_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return value;
+  }
+  throw std::invalid_argument("state delta is corrupt");
+}
+
+/** Returns the first position at or after 'i' where the two buffers differ */
+static size_t nextDifference(const uint8_t *a, const uint8_t *b, size_t i, size_t size) {
+  // Skip identical stretches a word at a time
+  while (i + 8 <= size) {
+    uint64_t wa, wb;
+    memcpy(&wa, a + i, 8);
+    memcpy(&wb, b + i, 8);
+    if (wa != wb) break;
+    i += 8;
+  }
+  while (i < size && a[i] == b[i]) i++;
+  return i;
+}
+
+void ale::encodeDelta(const uint8_t *base, const uint8_t *target, size_t size,
+                      std::vector<uint8_t> &runs) {
+  size_t position = 0; // End of the previous run
+  size_t i = nextDifference(base, target, 0, size);
+
+  while (i < size) {
+    // Extend the run until a long enough unchanged stretch
+    size_t end = i + 1;
+    while (end < size) {
+      if (base[end] != target[end]) { end++; continue; }
+      size_t next = nextDifference(base, target, end, size);
+      if (next == size || next - end >= MIN_GAP) break;
+      end = next;
+    }
+
+    putVarint(i - position, runs);
+    putVarint(end - i, runs);
+    runs.insert(runs.end(), target + i, target + end);
+
+    position = end;
+    i = nextDifference(base, target, end, size);
+  }
+}
+
+void ale::applyDelta(const uint8_t *runs, size_t runs_size, uint8_t *state, size_t size) {
+  const uint8_t *in = runs;
+  const uint8_t *end = runs + runs_size;
+  size_t position = 0;
+
+  while (in < end) {
+    size_t gap = getVarint(in, end);
+    size_t length = getVarint(in, end);
+    if (gap > size - position || length > size - position - gap ||
+        length > static_cast<size_t>(end - in))
+      throw std::invalid_argument("state delta does not fit the snapshot");
+
+    position += gap;
+    memcpy(state + position, in, length);
+    position += length;
+    in += length;
+  }
+}
+
+
+StateDelta::StateDelta():
+  m_snapshot_size(0) {
+}
+
+StateDelta::StateDelta(const void *base, const void *target, size_t size):
+  m_snapshot_size(size) {
+
+  if (ALEState::hasScreens(base, size) || ALEState::hasScreens(target, size))
+    throw std::invalid_argument("state deltas cannot be taken between snapshots with screens");
+  encodeDelta(static_cast<const uint8_t*>(base), static_cast<const uint8_t*>(target),
+              size, m_runs);
+}
+
+void StateDelta::apply(const void *base, void *out, size_t size) const {
+  if (size != m_snapshot_size)
+    throw std::invalid_argument("state delta was made for snapshots of another size");
+
+  if (out != base)
+    memcpy(out, base, size);
+  if (!m_runs.empty())
+    applyDelta(&m_runs[0], m_runs.size(), static_cast<uint8_t*>(out), size);
+}
+
+
+DeltaChain::DeltaChain(size_t keyframe_interval):
+  m_keyframe_interval(keyframe_interval),
+  m_snapshot_size(0),
+  m_offsets(1, 0) {
+
+  if (keyframe_interval < 1)
+    throw std::invalid_argument("keyframe interval must be at least 1");
+}
+
+void DeltaChain::push(const void *snapshot, size_t size) {
+  // Compressed screens would make the sizes vary from one snapshot to the next
+  if (ALEState::hasScreens(snapshot, size))
+    throw std::invalid_argument("snapshots in a chain cannot hold screens");
+  if (size == 0 || (m_snapshot_size != 0 && size != m_snapshot_size))
+    throw std::invalid_argument("all the snapshots of a chain must have the same size");
+  m_snapshot_size = size;
+
+  const uint8_t *bytes = static_cast<const uint8_t*>(snapshot);
+  if (this->size() % m_keyframe_interval == 0)
+    m_data.insert(m_data.end(), bytes, bytes + size);
+  else
+    encodeDelta(&m_last[0], bytes, size, m_data);
+
+  m_offsets.push_back(m_data.size());
+  m_last.assign(bytes, bytes + size);
+}
+
+void DeltaChain::materialize(size_t index, void *out, size_t size) const {
+  if (index >= this->size())
+    throw std::out_of_range("no such snapshot in the chain");
+  if (size != m_snapshot_size)
+    throw std::invalid_argument("buffer does not match the chain's snapshot size");
+
+  // Start from the keyframe and replay the deltas that follow it
+  size_t keyframe = index - index % m_keyframe_interval;
+  memcpy(out, &m_data[m_offsets[keyframe]], size);
+
+  for (size_t i = keyframe + 1; i <= index; i++) {
+    size_t runs_size = m_offsets[i + 1] - m_offsets[i];
+    if (runs_size > 0)
+      applyDelta(&m_data[m_offsets[i]], runs_size, static_cast<uint8_t*>(out), size);
+  }
+}
+
+void DeltaChain::truncate(size_t length) {
+  if (length >= size()) return;
+  if (length == 0) {
+    clear();
+    return;
+  }
+
+  // The last snapshot kept becomes the base of the next delta
+  std::vector<uint8_t> last(m_snapshot_size);
+  materialize(length - 1, &last[0], m_snapshot_size);
+  m_last.swap(last);
+
+  m_offsets.resize(length + 1);
+  m_data.resize(m_offsets.back());
+}
+
+void DeltaChain::clear() {
+  m_snapshot_size = 0;
+  m_data.clear();
+  m_offsets.assign(1, 0);
+  m_last.clear();
+}
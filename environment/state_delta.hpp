@@ -0,0 +1,46 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  state_delta.hpp
+ *
+ *  Encoding of the differences between two snapshots of the same size, shared
+ *  by StateDelta and DeltaChain.
+ **************************************************************************** */
+
+#ifndef __STATE_DELTA_HPP__
+#define __STATE_DELTA_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace ale {
+
+/** Appends to 'runs' the runs of bytes of 'target' that differ from 'base'. Each run
+  *  is the gap since the end of the previous run and the run's length, both as
+  *  varints, followed by the new bytes. */
+void encodeDelta(const uint8_t *base, const uint8_t *target, size_t size,
+                 std::vector<uint8_t> &runs);
+
+/** Applies the runs produced by encodeDelta() to 'state', in place. Throws
+  *  std::invalid_argument if they do not fit in 'size' bytes. */
+void applyDelta(const uint8_t *runs, size_t runs_size, uint8_t *state, size_t size);
+
+} // namespace ale
+
+#endif // __STATE_DELTA_HPP__
@@ -34,7 +34,14 @@
 
 #include "stella_environment.hpp"
 #include "../emucore/m6502/src/System.hxx"
+#include "../emucore/Deserializer.hxx"
 #include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
 
 using namespace ale;
 
@@ -42,8 +49,13 @@ StellaEnvironment::StellaEnvironment(OSystem* osystem, RomSettings* settings):
   m_osystem(osystem),
   m_settings(settings),
   m_phosphor_blend(osystem),
+  m_preprocessor(m_osystem->console().mediaSource().height(),
+        m_osystem->console().mediaSource().width()),
   m_screen(m_osystem->console().mediaSource().height(),
-        m_osystem->console().mediaSource().width()) {
+        m_osystem->console().mediaSource().width()),
+  m_player_a_action(PLAYER_A_NOOP),
+  m_player_b_action(PLAYER_B_NOOP),
+  m_random(m_osystem->rng().next()) {
 
   // Determine whether this is a paddle-based game
   if (m_osystem->console().properties().get(Controller_Left) == "PADDLES" ||
@@ -55,6 +67,8 @@ StellaEnvironment::StellaEnvironment(OSystem* osystem, RomSettings* settings):
   }
 
   m_cartridge_md5 = m_osystem->console().properties().get(Cartridge_MD5);
+  m_rom_key = std::hash<std::string>()(m_cartridge_md5);
+  m_transition_cache = NULL;
   
   m_num_reset_steps = atoi(m_osystem->settings().getString("system_reset_steps").c_str());
   m_use_starting_actions = m_osystem->settings().getBool("use_starting_actions");
@@ -63,55 +77,161 @@ StellaEnvironment::StellaEnvironment(OSystem* osystem, RomSettings* settings):
   m_colour_averaging = !m_osystem->settings().getBool("disable_color_averaging");
 
   m_backward_compatible_save = m_osystem->settings().getBool("backward_compatible_save");
+  m_num_saved_states = 0;
   m_stochastic_start = m_osystem->settings().getBool("use_environment_distribution");
+  m_cache_reset_states = m_osystem->settings().getBool("cache_reset_states");
+  m_snapshot_screens = m_osystem->settings().getBool("snapshot_screens");
+  setRewindBuffer(m_osystem->settings().getInt("rewind_frames"),
+                  m_osystem->settings().getInt("rewind_interval"));
+
+  // A reset holds RESET for a number of frames, then applies the ROM's starting actions
+  m_reset_actions.assign(std::max(m_num_reset_steps, 0), RESET);
+  if (m_use_starting_actions) {
+    ActionVect starting_actions = m_settings->getStartingActions();
+    m_reset_actions.insert(m_reset_actions.end(), starting_actions.begin(), starting_actions.end());
+  }
+
+  setFrameSkip(m_osystem->settings().getInt("frame_skip"));
+  setRepeatActionProbability(m_osystem->settings().getFloat("repeat_action_probability"));
+  m_max_pool_frames = m_osystem->settings().getBool("max_pool_frames");
+
+  // The legacy 'fast_tia_update' flag never renders anything
+  m_render_screen = m_osystem->settings().getBool("render_screen") &&
+                    !m_osystem->settings().getBool("fast_tia_update");
+  m_render_skipped_frames = m_osystem->settings().getBool("render_skipped_frames");
+  m_headless_frames = 0;
+  m_last_frame_rendered = false;
+  m_screen_pending = false;
+  m_previous_step_valid = false;
+
+  makePaletteTables();
+  m_preprocessor.configure(ScreenPreprocessing(), m_rgb_palette, m_luminance);
+}
+
+void StellaEnvironment::setFrameSkip(int frame_skip) {
+  if (frame_skip < 1)
+    throw std::invalid_argument("frame_skip must be at least 1");
+  m_frame_skip = frame_skip;
+}
+
+void StellaEnvironment::setRepeatActionProbability(float probability) {
+  if (probability < 0.0f || probability > 1.0f)
+    throw std::invalid_argument("repeat_action_probability must lie in [0, 1]");
+  m_repeat_action_probability = probability;
 }
 
 /** Resets the system to its start state. */
 void StellaEnvironment::reset() {
-  // RNG for generating environments
-  Random randGen;
-
   // Reset the paddles
   m_state.resetVariables(m_osystem->event());
 
-  // Reset the emulator
-  m_osystem->console().system().reset();
+  // Sticky actions do not carry over from the previous episode
+  m_player_a_action = PLAYER_A_NOOP;
+  m_player_b_action = PLAYER_B_NOOP;
 
   // NOOP for 60 steps in the deterministic environment setting, or some random amount otherwise 
   int noopSteps;
   if (m_stochastic_start)
-    noopSteps = 60 + rand() % NUM_RANDOM_ENVIRONMENTS;
+    noopSteps = 60 + m_random.next() % NUM_RANDOM_ENVIRONMENTS;
   else
     noopSteps = 60;
 
-  emulate(PLAYER_A_NOOP, PLAYER_B_NOOP, noopSteps);
-  // reset for n steps
-  emulate(RESET, PLAYER_B_NOOP, m_num_reset_steps);
+  // The cached states skip everything but the frames making up the first observation
+  if (m_cache_reset_states && m_reset_actions.size() >= RESET_REPLAY_FRAMES)
+    restoreResetState(noopSteps - 60);
+  else
+    emulateReset(noopSteps);
 
-  // reset the rom (after emulating, in case the NOOPs led to reward)
-  m_settings->reset();
-  
-  // Apply necessary actions specified by the rom itself
-  if (m_use_starting_actions) {
-    ActionVect startingActions = m_settings->getStartingActions();
-    for (size_t i = 0; i < startingActions.size(); i++)
-      emulate(startingActions[i], PLAYER_B_NOOP);
+  // Parse screen and RAM into their respective data structures
+  if (m_last_frame_rendered)
+    processScreen();
+  processRAM();
+
+  m_frame_stack.clear();
+  pushFrame();
+
+  m_rewind.clear();
+}
+
+void StellaEnvironment::setCacheResetStates(bool cache) {
+  m_cache_reset_states = cache;
+  if (!cache)
+    m_reset_states.clear();
+}
+
+void StellaEnvironment::emulateReset(int noop_steps) {
+  // Reset the emulator
+  m_osystem->console().system().reset();
+
+  // Only the frames making up the first observation need to be drawn
+  skipRendering(noop_steps + static_cast<int>(m_reset_actions.size()));
+
+  emulate(PLAYER_A_NOOP, PLAYER_B_NOOP, noop_steps);
+  emulateResetActions(0, m_reset_actions.size());
+}
+
+void StellaEnvironment::emulateResetActions(size_t begin, size_t end) {
+  for (size_t i = begin; i <= end; i++) {
+    // reset the rom after the RESET frames (after emulating, in case the NOOPs led to reward)
+    if (i == static_cast<size_t>(m_num_reset_steps))
+      m_settings->reset();
+    if (i < end)
+      emulate(m_reset_actions[i], PLAYER_B_NOOP);
   }
 }
 
+void StellaEnvironment::restoreResetState(int extra_noop_steps) {
+  if (m_reset_states.empty())
+    buildResetStates();
+
+  // Restoring a state must not rewind the frame counter
+  int frame_number = m_state.getFrameNumber();
+  m_state.load(m_osystem, m_settings, m_cartridge_md5, m_reset_states[extra_noop_steps]);
+  m_state.setFrameNumber(frame_number);
+
+  // The frame buffers are not part of the state, so the last frames are replayed to draw them
+  size_t begin = m_reset_actions.size() - RESET_REPLAY_FRAMES;
+  skipRendering(RESET_REPLAY_FRAMES);
+  emulateResetActions(begin, m_reset_actions.size());
+}
+
+void StellaEnvironment::buildResetStates() {
+  int num_states = m_stochastic_start ? NUM_RANDOM_ENVIRONMENTS : 1;
+  size_t replay_begin = m_reset_actions.size() - RESET_REPLAY_FRAMES;
+  int frame_number = m_state.getFrameNumber();
+
+  // None of these frames are observed
+  m_osystem->console().system().reset();
+  skipRendering(std::numeric_limits<int>::max());
+  emulate(PLAYER_A_NOOP, PLAYER_B_NOOP, 60);
+
+  // All the start states share their NOOP prefix: branch off after each extra NOOP
+  m_reset_states.reserve(num_states);
+  for (int i = 0; i < num_states; i++) {
+    ALEState noop_state = m_state.save(m_osystem, m_settings, m_cartridge_md5);
+
+    emulateResetActions(0, replay_begin);
+    m_reset_states.push_back(m_state.save(m_osystem, m_settings, m_cartridge_md5));
+
+    if (i + 1 < num_states) {
+      m_state.load(m_osystem, m_settings, m_cartridge_md5, noop_state);
+      emulate(PLAYER_A_NOOP, PLAYER_B_NOOP);
+    }
+  }
+
+  m_state.setFrameNumber(frame_number);
+}
+
 /** Save/restore the environment state. */
 void StellaEnvironment::save() {
-  // Store the current state into a new object
-  ALEState new_state = m_state.save(m_osystem, m_settings, m_cartridge_md5);
+  if (m_backward_compatible_save) // 0.2, 0.3: overwrite on save
+    m_num_saved_states = 0;
 
-  if (m_backward_compatible_save) { // 0.2, 0.3: overwrite on save
-    while (!m_saved_states.empty())
-      m_saved_states.pop();
-    m_saved_states.push(new_state);
-  }
-  else { // 0.4 and above: put it on the stack
-    m_saved_states.push(new_state);
-  }
+  // 0.4 and above: put it on the stack, into a buffer left by an earlier state if there is one
+  if (m_num_saved_states == m_saved_states.size())
+    m_saved_states.push_back(std::vector<uInt8>(m_state.rawSize(m_osystem, m_settings)));
+  m_state.saveRaw(m_osystem, m_settings, &m_saved_states[m_num_saved_states][0]);
+  m_num_saved_states++;
 }
 
 /** Get a copy of the underlying environment state. */
@@ -121,8 +241,7 @@ ALEState *StellaEnvironment::cloneState() const {
     // handling it. should be fine.
     ALEState *state = const_cast<ALEState *>(&m_state);
 
-    // note: there is an unnecessary copy, due to state->save returning a full object, 
-    //       which we can avoid later if performance is an issue.
+    // The saved state is moved, not copied, into the new object
     ALEState *rval = new ALEState(state->save(m_osystem, m_settings, m_cartridge_md5));
 
     return rval;
@@ -132,7 +251,16 @@ ALEState *StellaEnvironment::cloneState() const {
 void StellaEnvironment::restoreState(const ALEState &state) {
 
     // Deserialize it into 'm_state'
-    m_state.load(m_osystem, m_settings, m_cartridge_md5, state);
+    backUp();
+    try {
+      m_state.load(m_osystem, m_settings, m_cartridge_md5, state);
+    }
+    catch (...) {
+      rollBack();
+      throw;
+    }
+    processRAM();
+    m_rewind.clear();
 }
 
 /** Destroy a cloned state. */
@@ -140,26 +268,265 @@ void StellaEnvironment::destroyState(const ALEState *state) const {
     if (state != NULL) delete state;
 }
 
+// Frame buffers in snapshots: "XSCR", the frame size and the packed size, then the
+//  current and previous frames packed by packFrame()
+#define SCREENS_MAGIC 0x52435358
+#define SCREENS_HEADER_SIZE 12
+
+/** Largest size of 'size' bytes once packed by packDelta() */
+static size_t packedBound(size_t size) {
+  size_t words = (size + 7) / 8;
+  return (words + 7) / 8 + words * 8;
+}
+
+/** Packs the 8-byte words of 'data' that differ from those of 'reference' (or are
+  *  nonzero, without a reference): a bitmap of the differing words, then their XOR
+  *  with the reference. A partial last word is padded with zeros */
+static size_t packDelta(const uInt8 *data, const uInt8 *reference, size_t size, uInt8 *out) {
+  static const uInt8 zeros[64] = { 0 };
+  size_t words = (size + 7) / 8;
+  uInt8* bitmap = out;
+  uInt8* packed = out + (words + 7) / 8;
+  memset(bitmap, 0, (words + 7) / 8);
+
+  for (size_t w = 0; w < words; w++) {
+    size_t offset = w * 8;
+
+    // Skip groups of eight unchanged words at once
+    if (w % 8 == 0 && offset + 64 <= size &&
+        memcmp(data + offset, reference != NULL ? reference + offset : zeros, 64) == 0) {
+      w += 7;
+      continue;
+    }
+
+    unsigned long long word = 0, base = 0;
+    if (offset + 8 <= size) {
+      memcpy(&word, data + offset, 8);
+      if (reference != NULL) memcpy(&base, reference + offset, 8);
+    }
+    else {
+      memcpy(&word, data + offset, size - offset);
+      if (reference != NULL) memcpy(&base, reference + offset, size - offset);
+    }
+
+    word ^= base;
+    if (word != 0) {
+      bitmap[w / 8] |= static_cast<uInt8>(1 << (w % 8));
+      memcpy(packed, &word, 8);
+      packed += 8;
+    }
+  }
+
+  return packed - out;
+}
+
+/** Unpacks 'size' bytes packed by packDelta() against the same reference, which may
+  *  overlap 'data' if it lies at least 64 bytes behind; returns the number of bytes read */
+static size_t unpackDelta(const uInt8 *in, size_t in_size, const uInt8 *reference,
+                          uInt8 *data, size_t size) {
+  size_t words = (size + 7) / 8;
+  size_t bitmap_size = (words + 7) / 8;
+  if (bitmap_size > in_size)
+    throw std::invalid_argument("snapshot screens are truncated");
+
+  const uInt8* bitmap = in;
+  size_t changed = 0;
+  for (size_t i = 0; i < bitmap_size; i++)
+    for (uInt8 bits = bitmap[i]; bits != 0; bits &= bits - 1)
+      changed++;
+  if (changed > (in_size - bitmap_size) / 8)
+    throw std::invalid_argument("snapshot screens are truncated");
+
+  const uInt8* packed = in + bitmap_size;
+  for (size_t w = 0; w < words; w++) {
+    size_t offset = w * 8;
+
+    if (w % 8 == 0 && bitmap[w / 8] == 0 && offset + 64 <= size) {
+      if (reference != NULL)
+        memcpy(data + offset, reference + offset, 64);
+      else
+        memset(data + offset, 0, 64);
+      w += 7;
+      continue;
+    }
+
+    bool full = offset + 8 <= size;
+    unsigned long long word = 0;
+    if (reference != NULL) {
+      if (full)
+        memcpy(&word, reference + offset, 8);
+      else
+        memcpy(&word, reference + offset, size - offset);
+    }
+
+    if (bitmap[w / 8] & (1 << (w % 8))) {
+      unsigned long long delta;
+      memcpy(&delta, packed, 8);
+      packed += 8;
+      word ^= delta;
+    }
+    if (full)
+      memcpy(data + offset, &word, 8);
+    else
+      memcpy(data + offset, &word, size - offset);
+  }
+
+  return packed - in;
+}
+
+/** Largest size of a frame once packed by packFrame() */
+static size_t frameBound(size_t width, size_t frame_size) {
+  return packedBound(width) + packedBound(frame_size - width);
+}
+
+/** Packs a frame relative to itself one row up: Atari screens mostly repeat vertically,
+  *  so most words match the ones above */
+static size_t packFrame(const uInt8 *frame, size_t width, size_t frame_size, uInt8 *out) {
+  size_t packed_size = packDelta(frame, NULL, width, out);
+  return packed_size + packDelta(frame + width, frame, frame_size - width, out + packed_size);
+}
+
+/** Unpacks a frame packed by packFrame(), rebuilding each row from the one above it */
+static size_t unpackFrame(const uInt8 *in, size_t in_size, uInt8 *frame, size_t width,
+                          size_t frame_size) {
+  size_t read = unpackDelta(in, in_size, NULL, frame, width);
+  return read + unpackDelta(in + read, in_size - read, frame, frame + width, frame_size - width);
+}
+
+size_t StellaEnvironment::snapshotSize() const {
+  size_t size = m_state.snapshotSize(m_osystem, m_settings);
+  if (m_snapshot_screens) {
+    const MediaSource& media_source = m_osystem->console().mediaSource();
+    size += SCREENS_HEADER_SIZE +
+            2 * frameBound(media_source.width(), media_source.height() * media_source.width());
+  }
+  return size;
+}
+
+size_t StellaEnvironment::serializeInto(void *buffer, size_t size) const {
+  size_t used = m_state.saveSnapshot(m_osystem, m_settings, m_cartridge_md5, buffer, size);
+  if (m_snapshot_screens)
+    used += saveFrameBuffers(static_cast<char*>(buffer) + used, size - used);
+  return used;
+}
+
+void StellaEnvironment::restoreFrom(const void *buffer, size_t size) {
+  // Any screens are checked first, as the frame buffers are not part of the backup
+  size_t used = ALEState::snapshotEnd(buffer, size);
+  bool screens = size > used;
+  if (screens)
+    unpackFrameBuffers(static_cast<const char*>(buffer) + used, size - used);
+
+  backUp();
+  try {
+    m_state.loadSnapshot(m_osystem, m_settings, m_cartridge_md5, buffer, size);
+  }
+  catch (...) {
+    rollBack();
+    throw;
+  }
+  if (screens)
+    loadFrameBuffers();
+  processRAM();
+  m_rewind.clear();
+}
+
+void StellaEnvironment::backUp() {
+  if (m_backup.empty())
+    m_backup.resize(m_state.rawSize(m_osystem, m_settings));
+  m_state.saveRaw(m_osystem, m_settings, &m_backup[0]);
+}
+
+void StellaEnvironment::rollBack() {
+  m_state.loadRaw(m_osystem, m_settings, &m_backup[0]);
+}
+
+size_t StellaEnvironment::saveFrameBuffers(char *buffer, size_t size) const {
+  MediaSource& media_source = m_osystem->console().mediaSource();
+  size_t width = media_source.width();
+  size_t frame_size = media_source.height() * width;
+
+  // Packing needs the worst case to fit, as the caller sized the buffer from snapshotSize()
+  if (size < SCREENS_HEADER_SIZE + 2 * frameBound(width, frame_size))
+    throw std::invalid_argument("snapshot buffer is too small");
+
+  const uInt8* current = media_source.currentFrameBuffer();
+  const uInt8* previous = media_source.previousFrameBuffer();
+
+  uInt8* packed = reinterpret_cast<uInt8*>(buffer + SCREENS_HEADER_SIZE);
+  size_t packed_size = packFrame(current, width, frame_size, packed);
+  packed_size += packFrame(previous, width, frame_size, packed + packed_size);
+
+  Serializer header(buffer, SCREENS_HEADER_SIZE, Serializer::Compact);
+  header.putInt(SCREENS_MAGIC);
+  header.putInt(static_cast<int>(frame_size));
+  header.putInt(static_cast<int>(packed_size));
+
+  return SCREENS_HEADER_SIZE + packed_size;
+}
+
+void StellaEnvironment::unpackFrameBuffers(const char *buffer, size_t size) {
+  const MediaSource& media_source = m_osystem->console().mediaSource();
+  size_t width = media_source.width();
+  size_t frame_size = media_source.height() * width;
+
+  if (size < SCREENS_HEADER_SIZE)
+    throw std::invalid_argument("snapshot screens are truncated");
+
+  Deserializer header(buffer, SCREENS_HEADER_SIZE, Serializer::Compact);
+  if (static_cast<uInt32>(header.getInt()) != SCREENS_MAGIC ||
+      static_cast<size_t>(header.getInt()) != frame_size)
+    throw std::invalid_argument("snapshot screens are corrupt");
+  size_t packed_size = static_cast<uInt32>(header.getInt());
+  if (packed_size > size - SCREENS_HEADER_SIZE)
+    throw std::invalid_argument("snapshot screens are truncated");
+  if (packed_size < size - SCREENS_HEADER_SIZE)
+    throw std::invalid_argument("snapshot has trailing bytes after its screens");
+
+  const uInt8* packed = reinterpret_cast<const uInt8*>(buffer + SCREENS_HEADER_SIZE);
+  m_restored_frames.resize(2 * frame_size);
+  size_t read = unpackFrame(packed, packed_size, &m_restored_frames[0], width, frame_size);
+  read += unpackFrame(packed + read, packed_size - read, &m_restored_frames[frame_size],
+                      width, frame_size);
+  if (read != packed_size)
+    throw std::invalid_argument("snapshot screens are corrupt");
+}
+
+void StellaEnvironment::loadFrameBuffers() {
+  MediaSource& media_source = m_osystem->console().mediaSource();
+  size_t frame_size = m_restored_frames.size() / 2;
+  std::copy(m_restored_frames.begin(), m_restored_frames.begin() + frame_size,
+            media_source.currentFrameBuffer());
+  std::copy(m_restored_frames.begin() + frame_size, m_restored_frames.end(),
+            media_source.previousFrameBuffer());
+
+  // Both frame buffers hold drawn frames again
+  m_last_frame_rendered = true;
+  processScreen();
+}
+
+unsigned long long StellaEnvironment::stateHash() const {
+  return m_state.stateHash(m_osystem, m_settings, m_hash_buffer);
+}
+
 bool StellaEnvironment::load() {
 
-  if (m_saved_states.empty()) return false;  
+  if (m_num_saved_states == 0) return false;
 
-  // Get the state on top of the stack
-  ALEState& target_state = m_saved_states.top(); 
- 
-  // Deserialize it into 'm_state'
-  m_state.load(m_osystem, m_settings, m_cartridge_md5, target_state);
+  // Copy the state on top of the stack into 'm_state'
+  m_state.loadRaw(m_osystem, m_settings, &m_saved_states[m_num_saved_states - 1][0]);
+  m_rewind.clear();
 
   if (m_backward_compatible_save) { // 0.2, 0.3: persistent save 
   }
   else { // 0.4 and above: take it off the stack
-    m_saved_states.pop();
+    m_num_saved_states--;
   }
 
   return true;
 }
 
-void StellaEnvironment::noopIllegalActions(Action & player_a_action, Action & player_b_action) {
+void StellaEnvironment::noopIllegalActions(Action & player_a_action, Action & player_b_action) const {
   if (player_a_action < (Action)PLAYER_B_NOOP && 
         !m_settings->isLegal(player_a_action)) {
     player_a_action = (Action)PLAYER_A_NOOP;
@@ -185,14 +552,363 @@ reward_t StellaEnvironment::act(Action player_a_action, Action player_b_action)
   if (isTerminal())
     return 0;
 
+  int frames;
+  reward_t reward = step(player_a_action, player_b_action, true, frames);
+
+  // Only the last frame is observed; step() drew it even if the episode ended early
+  if (m_last_frame_rendered)
+    processScreen();
+  processRAM();
+  pushFrame();
+
+  return reward;
+}
+
+void StellaEnvironment::rollout(const Action *actions, size_t n, RolloutResult &result,
+                                double discount, bool render) {
+  result.reward = 0;
+  result.discounted_reward = 0;
+  result.steps = 0;
+  result.frames = 0;
+
+  double weight = 1.0;
+  m_previous_step_valid = false;
+  for (size_t i = 0; i < n && !isTerminal(); i++) {
+    // The observation takes in the frames of the last steps, and should the episode end
+    //  before the last action, those of the step it ended on
+    bool observe = render && (n - 1 - i) * m_frame_skip < static_cast<size_t>(observedFrames());
+    int frames;
+    reward_t reward = step(actions[i], PLAYER_B_NOOP, observe, frames, render);
+
+    result.reward += reward;
+    result.discounted_reward += weight * reward;
+    result.steps++;
+    result.frames += frames;
+    weight *= discount;
+  }
+  result.terminal = isTerminal();
+  if (result.steps == 0) return;
+
+  // As for act(), but once for the whole sequence
+  if (m_last_frame_rendered)
+    processScreen();
+  processRAM();
+  pushFrame();
+}
+
+reward_t StellaEnvironment::step(Action player_a_action, Action player_b_action, bool observe,
+                                 int &frames, bool observe_terminal) {
   // Convert illegal actions into NOOPs; actions such as reset are always legal
   noopIllegalActions(player_a_action, player_b_action);
-  
-  // Emulate in the emulator
-  emulate(player_a_action, player_b_action);
-  m_state.incrementFrame(); 
 
-  return m_settings->getReward();
+  // Deterministic steps may have been emulated before, here or by another environment
+  bool use_cache = m_transition_cache != NULL && canCacheTransition();
+  unsigned long long key = 0, check = 0;
+  if (use_cache) {
+    key = transitionKey(player_a_action, player_b_action, check);
+    if (m_transition_buffer.empty())
+      m_transition_buffer.resize(m_state.snapshotSize(m_osystem, m_settings));
+
+    TransitionCache::Transition transition;
+    if (m_transition_cache->lookup(key, check, &m_transition_buffer[0],
+                                   m_transition_buffer.size(), transition)) {
+      m_player_a_action = player_a_action;
+      m_player_b_action = player_b_action;
+
+      recordRewindCheckpoint();
+      for (int frame = 0; frame < transition.frames; frame++)
+        m_rewind.addActions(player_a_action, player_b_action);
+
+      applyTransition(transition);
+      frames = transition.frames;
+      m_previous_step_valid = false;
+      return transition.reward;
+    }
+  }
+
+  // Only the frames making up the observation need to be drawn, if any
+  if (observe)
+    skipRendering(m_frame_skip);
+  else
+    m_headless_frames = m_frame_skip;
+
+  // Should the episode end on a frame that is not drawn, the step is emulated again from
+  //  here to draw the frames observed at its end, as with full rendering
+  bool redraw = (observe ? m_headless_frames > 0 : observe_terminal) && m_render_screen &&
+                !m_render_skipped_frames;
+  if (redraw) {
+    // In a rollout the step before was not drawn either, and its last frame may be observed
+    if (observe_terminal) {
+      m_previous_step_snapshot.swap(m_step_snapshot);
+      m_previous_step_actions.swap(m_step_actions);
+    }
+    if (m_step_snapshot.empty())
+      m_step_snapshot.resize(m_state.snapshotSize(m_osystem, m_settings));
+    m_state.saveSnapshot(m_osystem, m_settings, m_cartridge_md5,
+                         &m_step_snapshot[0], m_step_snapshot.size());
+    m_step_actions.clear();
+  }
+
+  reward_t sum_rewards = 0;
+  frames = 0;
+  for (int frame = 0; frame < m_frame_skip; frame++) {
+    // With sticky actions, the previous actions are sometimes applied again instead
+    if (m_repeat_action_probability <= 0.0f ||
+        m_random.nextDouble() >= m_repeat_action_probability) {
+      m_player_a_action = player_a_action;
+      m_player_b_action = player_b_action;
+    }
+
+    // Emulate in the emulator
+    recordRewindCheckpoint();
+    emulate(m_player_a_action, m_player_b_action);
+    m_state.incrementFrame(); 
+    m_rewind.addActions(m_player_a_action, m_player_b_action);
+    if (redraw) {
+      m_step_actions.push_back(static_cast<uInt8>(m_player_a_action));
+      m_step_actions.push_back(static_cast<uInt8>(m_player_b_action));
+    }
+
+    // Sanity check rewards
+    reward_t reward = m_settings->getReward();
+    assert(reward <= m_settings->maxReward());
+    assert(reward >= m_settings->minReward());
+    sum_rewards += reward;
+    frames++;
+
+    if (isTerminal()) break;
+  }
+
+  // The frames observed at the end of the step are its last ones, and the frame before
+  //  it when the episode ended on its first frame
+  int drawn = observe ? std::max(frames - (m_frame_skip - observedFrames()), 0) : 0;
+  if (redraw && drawn < std::min(frames, observedFrames()) && (observe || isTerminal()))
+    redrawStep(frames);
+  m_previous_step_valid = redraw && observe_terminal;
+
+  if (use_cache) {
+    TransitionCache::Transition transition;
+    transition.reward = sum_rewards;
+    transition.frames = frames;
+    transition.terminal = m_settings->isTerminal();
+    m_state.saveSnapshot(m_osystem, m_settings, m_cartridge_md5,
+                         &m_transition_buffer[0], m_transition_buffer.size());
+    m_transition_cache->insert(key, check, &m_transition_buffer[0],
+                               m_transition_buffer.size(), transition);
+  }
+
+  return sum_rewards;
+}
+
+void StellaEnvironment::redrawStep(int frames) {
+  // The last frame of the previous step is observed too; in a rollout it was not drawn,
+  //  so that step is replayed as well
+  if (frames < observedFrames() && m_previous_step_valid) {
+    m_state.loadSnapshot(m_osystem, m_settings, m_cartridge_md5,
+                         &m_previous_step_snapshot[0], m_previous_step_snapshot.size());
+    int previous_frames = static_cast<int>(m_previous_step_actions.size() / 2);
+    skipRendering(previous_frames + frames);
+    replayFrames(m_previous_step_actions, previous_frames);
+    replayFrames(m_step_actions, frames);
+    return;
+  }
+
+  m_state.loadSnapshot(m_osystem, m_settings, m_cartridge_md5,
+                       &m_step_snapshot[0], m_step_snapshot.size());
+
+  // Every frame swaps the frame buffers, drawn or not. When the last frame of the previous
+  //  step is observed again, it has to be where the replayed frame leaves the previous one
+  if (frames < observedFrames()) {
+    MediaSource& media_source = m_osystem->console().mediaSource();
+    size_t frame_size = media_source.height() * media_source.width();
+    std::swap_ranges(media_source.currentFrameBuffer(),
+                     media_source.currentFrameBuffer() + frame_size,
+                     media_source.previousFrameBuffer());
+  }
+
+  skipRendering(frames);
+  replayFrames(m_step_actions, frames);
+}
+
+void StellaEnvironment::replayFrames(const std::vector<uInt8> &actions, int frames) {
+  for (int frame = 0; frame < frames; frame++) {
+    m_player_a_action = static_cast<Action>(actions[frame * 2]);
+    m_player_b_action = static_cast<Action>(actions[frame * 2 + 1]);
+    emulate(m_player_a_action, m_player_b_action);
+    m_state.incrementFrame();
+  }
+}
+
+void StellaEnvironment::setRewindBuffer(int max_frames, int interval) {
+  // Also keep the frames drawn again to rebuild the screen of the oldest one
+  m_rewind = RewindBuffer(max_frames > 0 ? max_frames + 2 : 0, interval);
+}
+
+void StellaEnvironment::recordRewindCheckpoint() {
+  if (!m_rewind.checkpointDue(m_state.getFrameNumber())) return;
+
+  if (m_rewind_snapshot.empty())
+    m_rewind_snapshot.resize(m_state.snapshotSize(m_osystem, m_settings));
+  size_t size = m_state.saveSnapshot(m_osystem, m_settings, m_cartridge_md5,
+                                     &m_rewind_snapshot[0], m_rewind_snapshot.size());
+  m_rewind.addCheckpoint(m_state.getFrameNumber(), &m_rewind_snapshot[0], size);
+}
+
+int StellaEnvironment::rewindableFrames() const {
+  // The frames before the target are replayed to draw its screen again
+  int oldest = m_rewind.oldestFrame();
+  return oldest < 0 ? 0 : std::max(m_state.getFrameNumber() - oldest - observedFrames(), 0);
+}
+
+bool StellaEnvironment::rewind(int frames) {
+  if (frames < 0 || frames > rewindableFrames()) return false;
+  if (frames == 0) return true;
+
+  // Start far enough back for the observed frames to be drawn again
+  int target = m_state.getFrameNumber() - frames;
+  m_rewind.restoreCheckpoint(target, target - observedFrames(), &m_rewind_snapshot[0],
+                             m_rewind_snapshot.size(), m_rewind_actions);
+  m_state.loadSnapshot(m_osystem, m_settings, m_cartridge_md5,
+                       &m_rewind_snapshot[0], m_rewind_snapshot.size());
+
+  int replayed = static_cast<int>(m_rewind_actions.size() / 2);
+  skipRendering(replayed);
+  for (int frame = 0; frame < replayed; frame++) {
+    m_player_a_action = static_cast<Action>(m_rewind_actions[frame * 2]);
+    m_player_b_action = static_cast<Action>(m_rewind_actions[frame * 2 + 1]);
+    emulate(m_player_a_action, m_player_b_action);
+    m_state.incrementFrame();
+  }
+  m_rewind.truncate(target);
+
+  if (m_last_frame_rendered)
+    processScreen();
+  processRAM();
+
+  // The stacked frames came after the state returned to
+  m_frame_stack.clear();
+  pushFrame();
+  return true;
+}
+
+bool StellaEnvironment::canCacheTransition() const {
+  // Sticky actions draw random numbers, and cached successors hold no screen
+  if (m_repeat_action_probability > 0.0f || m_render_screen)
+    return false;
+
+  // The frame limits depend on the episode frame number, which the key leaves out
+  return !frameLimitAhead();
+}
+
+bool StellaEnvironment::frameLimitAhead() const {
+  int last_frame = m_state.getEpisodeFrameNumber() + m_frame_skip;
+  return (m_max_num_frames_per_episode > 0 && last_frame >= m_max_num_frames_per_episode) ||
+         (m_settings->maxFrames() > 0 && last_frame >= m_settings->maxFrames());
+}
+
+unsigned long long StellaEnvironment::transitionKey(Action player_a_action,
+                                                    Action player_b_action,
+                                                    unsigned long long &check) const {
+  unsigned long long key = stateHash() ^ m_rom_key;
+  key ^= (static_cast<unsigned long long>(player_a_action) |
+          static_cast<unsigned long long>(player_b_action) << 8 |
+          static_cast<unsigned long long>(m_frame_skip) << 16) * 0x9e3779b97f4a7c15ULL;
+
+  key ^= key >> 31;
+  key *= 0xbf58476d1ce4e5b9ULL;
+  key ^= key >> 29;
+
+  // The packed state stateHash() left behind, hashed again from another seed: a cached
+  //  transition is only taken for the wrong source if both hashes collide
+  check = ALEState::hashBytes(&m_hash_buffer[0], m_hash_buffer.size(),
+                              key ^ 0x94d049bb133111ebULL);
+  return key;
+}
+
+void StellaEnvironment::applyTransition(const TransitionCache::Transition &transition) {
+  // The successor carries the frame numbers it was first reached with
+  int frame_number = m_state.getFrameNumber() + transition.frames;
+  int episode_frame_number = m_state.getEpisodeFrameNumber() + transition.frames;
+
+  m_state.loadSnapshot(m_osystem, m_settings, m_cartridge_md5,
+                       &m_transition_buffer[0], m_transition_buffer.size());
+  m_state.setFrameNumber(frame_number);
+  m_state.setEpisodeFrameNumber(episode_frame_number);
+
+  // Nothing was drawn, as when emulating without rendering
+  m_last_frame_rendered = false;
+}
+
+bool StellaEnvironment::lockstepKey(Action player_a_action, unsigned long long &key) const {
+  // Sticky actions draw from each environment's own random stream
+  if (m_repeat_action_probability > 0.0f || isTerminal() || frameLimitAhead())
+    return false;
+
+  Action player_b_action = PLAYER_B_NOOP;
+  noopIllegalActions(player_a_action, player_b_action);
+
+  // Which frames are drawn, and how the screen is built from them
+  unsigned long long drawing =
+    (m_render_screen ? 1 : 0) | (m_render_skipped_frames ? 2 : 0) |
+    (m_max_pool_frames ? 4 : 0) | (m_colour_averaging ? 8 : 0) |
+    (m_preprocessor.config().max_pool ? 16 : 0);
+
+  // What was drawn before the step: the screen may still show the previous frame (when
+  //  pooling or averaging), lines that a short frame left undrawn, or a kept screen
+  const MediaSource& media_source = m_osystem->console().mediaSource();
+  size_t frame_size = media_source.height() * media_source.width();
+  drawing |= (m_last_frame_rendered ? 32 : 0) | (m_screen_pending ? 64 : 0);
+  unsigned long long screens =
+    ALEState::hashBytes(media_source.currentFrameBuffer(), frame_size, drawing);
+  screens = ALEState::hashBytes(media_source.previousFrameBuffer(), frame_size, screens);
+  if (!m_screen_pending) {
+    const std::vector<pixel_t> &screen = m_screen.getArray();
+    screens = ALEState::hashBytes(&screen[0], screen.size() * sizeof(pixel_t), screens);
+  }
+
+  unsigned long long check;
+  key = transitionKey(player_a_action, player_b_action, check) ^
+        screens * 0xc2b2ae3d27d4eb4fULL;
+  return true;
+}
+
+void StellaEnvironment::followStep(const StellaEnvironment &leader, const void *snapshot,
+                                   size_t size, int frames) {
+  // As for a cached transition, the frame numbers go on from this environment's own
+  int frame_number = m_state.getFrameNumber() + frames;
+  int episode_frame_number = m_state.getEpisodeFrameNumber() + frames;
+
+  m_player_a_action = leader.m_player_a_action;
+  m_player_b_action = leader.m_player_b_action;
+  recordRewindCheckpoint();
+  for (int frame = 0; frame < frames; frame++)
+    m_rewind.addActions(m_player_a_action, m_player_b_action);
+
+  m_state.loadSnapshot(m_osystem, m_settings, m_cartridge_md5, snapshot, size);
+  m_state.setFrameNumber(frame_number);
+  m_state.setEpisodeFrameNumber(episode_frame_number);
+
+  // The leader's frame buffers, and its screen if it kept one from an earlier frame
+  MediaSource& media_source = m_osystem->console().mediaSource();
+  const MediaSource& leader_source = leader.m_osystem->console().mediaSource();
+  size_t frame_size = media_source.height() * media_source.width();
+  std::copy(leader_source.currentFrameBuffer(), leader_source.currentFrameBuffer() + frame_size,
+            media_source.currentFrameBuffer());
+  std::copy(leader_source.previousFrameBuffer(), leader_source.previousFrameBuffer() + frame_size,
+            media_source.previousFrameBuffer());
+  m_last_frame_rendered = leader.m_last_frame_rendered;
+  m_screen_pending = leader.m_screen_pending;
+  if (!m_screen_pending)
+    m_screen.getArray() = leader.m_screen.getArray();
+
+  if (m_last_frame_rendered)
+    processScreen();
+  processRAM();
+  pushFrame();
+}
+
+size_t StellaEnvironment::serializeEmulatorInto(void *buffer, size_t size) const {
+  return m_state.saveSnapshot(m_osystem, m_settings, m_cartridge_md5, buffer, size);
 }
 
 bool StellaEnvironment::isTerminal() const {
@@ -213,7 +929,7 @@ void StellaEnvironment::emulate(Action player_a_action, Action player_b_action,
       // Update paddle position at every step
       m_state.applyActionPaddles(event, player_a_action, player_b_action);
 
-      m_osystem->console().mediaSource().update();
+      updateMediaSource();
       m_settings->step(m_osystem->console().system());
     }
   }
@@ -222,14 +938,36 @@ void StellaEnvironment::emulate(Action player_a_action, Action player_b_action,
     m_state.setActionJoysticks(event, player_a_action, player_b_action);
 
     for (size_t t = 0; t < num_steps; t++) {
-      m_osystem->console().mediaSource().update();
+      updateMediaSource();
       m_settings->step(m_osystem->console().system());
     }
   }
+}
 
-  // Parse screen and RAM into their respective data structures
-  processScreen();
-  processRAM();
+int StellaEnvironment::observedFrames() const {
+  // Colour averaging and max-pooling also look at the previous frame
+  return (m_max_pool_frames || m_colour_averaging || m_preprocessor.config().max_pool) ? 2 : 1;
+}
+
+void StellaEnvironment::skipRendering(int num_frames) {
+  m_headless_frames = std::max(num_frames - observedFrames(), 0);
+}
+
+void StellaEnvironment::updateMediaSource() {
+  MediaSource& media_source = m_osystem->console().mediaSource();
+
+  bool render = m_render_screen && (m_render_skipped_frames || m_headless_frames == 0);
+  if (m_headless_frames > 0)
+    m_headless_frames--;
+
+  // Frames that are not drawn leave stale data in the frame buffers, so build the
+  //  current screen first in case it ends up being kept
+  if (!render && m_screen_pending)
+    updateScreen();
+
+  media_source.enableRendering(render);
+  media_source.update();
+  m_last_frame_rendered = render;
 }
 
 /** Accessor methods for the environment state. */
@@ -242,7 +980,90 @@ const ALEState& StellaEnvironment::getState() const {
 }
 
 void StellaEnvironment::processScreen() {
-  if (!m_colour_averaging) {
+  // The screen is only built from the frame buffer once it is asked for
+  m_screen_pending = true;
+}
+
+const ALEScreen &StellaEnvironment::getScreen() const {
+  if (m_screen_pending)
+    updateScreen();
+  return m_screen;
+}
+
+void StellaEnvironment::getScreenPalette(uInt8 *buffer) const {
+  const uInt8* pixels = screenPixels();
+  std::copy(pixels, pixels + m_screen.arraySize(), buffer);
+}
+
+void StellaEnvironment::getScreenRGB(uInt8 *buffer) const {
+  const uInt8* pixels = screenPixels();
+  for (size_t i = 0; i < m_screen.arraySize(); i++) {
+    const uInt8* rgb = m_rgb_palette[pixels[i]];
+    buffer[0] = rgb[0];
+    buffer[1] = rgb[1];
+    buffer[2] = rgb[2];
+    buffer += 3;
+  }
+}
+
+void StellaEnvironment::getScreenGrayscale(uInt8 *buffer) const {
+  const uInt8* pixels = screenPixels();
+  for (size_t i = 0; i < m_screen.arraySize(); i++)
+    buffer[i] = m_luminance[pixels[i]];
+}
+
+void StellaEnvironment::setScreenPreprocessing(const ScreenPreprocessing &config) {
+  m_preprocessor.configure(config, m_rgb_palette, m_luminance);
+
+  // Stacked frames of the old size are meaningless; start over from the current screen
+  setFrameStackDepth(m_frame_stack.depth());
+}
+
+void StellaEnvironment::setFrameStackDepth(int depth) {
+  m_frame_stack.configure(m_preprocessor.outputSize(), depth);
+  pushFrame();
+}
+
+void StellaEnvironment::pushFrame() {
+  if (!m_frame_stack.enabled()) return;
+
+  getPreprocessedScreen(m_frame_stack.beginFrame());
+  m_frame_stack.endFrame();
+}
+
+void StellaEnvironment::getPreprocessedScreen(uInt8 *buffer) const {
+  // Max-pooling needs both frame buffers to hold drawn frames
+  if (m_preprocessor.config().max_pool && m_last_frame_rendered) {
+    MediaSource& media_source = m_osystem->console().mediaSource();
+    m_preprocessor.process(media_source.currentFrameBuffer(), media_source.previousFrameBuffer(), buffer);
+  }
+  else
+    m_preprocessor.process(screenPixels(), NULL, buffer);
+}
+
+const uInt8* StellaEnvironment::screenPixels() const {
+  // Without colour averaging or max-pooling, the screen is the frame buffer itself
+  if (m_screen_pending && !m_max_pool_frames && !m_colour_averaging)
+    return m_osystem->console().mediaSource().currentFrameBuffer();
+
+  return &getScreen().getArray()[0];
+}
+
+void StellaEnvironment::updateScreen() const {
+  m_screen_pending = false;
+
+  if (m_max_pool_frames) {
+    // Keep the brighter of the two most recent frames for each pixel
+    uInt8* current_buffer = m_osystem->console().mediaSource().currentFrameBuffer();
+    uInt8* previous_buffer = m_osystem->console().mediaSource().previousFrameBuffer();
+    std::vector<pixel_t>& pixels = m_screen.getArray();
+    for (size_t i = 0; i < pixels.size(); i++) {
+      uInt8 cv = current_buffer[i];
+      uInt8 pv = previous_buffer[i];
+      pixels[i] = m_luminance[pv] > m_luminance[cv] ? pv : cv;
+    }
+  }
+  else if (!m_colour_averaging) {
     // Copy screen over and we're done! 
     int size = m_osystem->console().mediaSource().width() * m_osystem->console().mediaSource().height();
     assert(size == m_screen.getArray().size());
@@ -264,3 +1085,17 @@ void StellaEnvironment::processRAM() {
   }
 }
 
+
+void StellaEnvironment::makePaletteTables() {
+  ExportScreen* es = m_osystem->p_export_screen;
+
+  // ITU-R BT.601 luma, as used for grayscale conversion
+  for (int c = 0; c < 256; c++) {
+    int r, g, b;
+    es->get_rgb_from_palette(c, r, g, b);
+    m_rgb_palette[c][0] = static_cast<uInt8>(r);
+    m_rgb_palette[c][1] = static_cast<uInt8>(g);
+    m_rgb_palette[c][2] = static_cast<uInt8>(b);
+    m_luminance[c] = static_cast<uInt8>((299 * r + 587 * g + 114 * b) / 1000);
+  }
+}
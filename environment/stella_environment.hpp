@@ -38,11 +38,14 @@
 #include "ale_interface.hpp"
 #include "ale_state.hpp"
 #include "phosphor_blend.hpp"
+#include "frame_stack.hpp"
+#include "screen_preprocessor.hpp"
+#include "rewind_buffer.hpp"
 #include "emucore/OSystem.hxx"
 #include "emucore/Event.hxx"
+#include "emucore/Random.hxx"
 #include "games/RomSettings.hpp"
 
-#include <stack>
 
 namespace ale {
 
@@ -63,16 +66,52 @@ class StellaEnvironment {
     /** Get a copy of the underlying environment state. */
     ALEState *cloneState() const;
 
-    /** Restore the environment to a previously saved state. */
+    /** Restore the environment to a previously saved state. Throws std::invalid_argument,
+      *  leaving the environment unchanged, if the state is corrupt. */
     void restoreState(const ALEState &state);
 
     /** Destroy a cloned state. */
     void destroyState(const ALEState *state) const;
 
+    /** Compact snapshots of the environment state, written to and read from
+      *  caller-provided memory without allocating; see ALEState::saveSnapshot(). With
+      *  setSnapshotScreens(), the frame buffers follow the emulator state and snapshotSize()
+      *  is the largest size a snapshot may take. restoreFrom() leaves the environment
+      *  unchanged when it throws. */
+    size_t snapshotSize() const;
+    size_t serializeInto(void *buffer, size_t size) const;
+    void restoreFrom(const void *buffer, size_t size);
+
+    /** A 64-bit hash of the environment state; see ALEState::stateHash(). */
+    unsigned long long stateHash() const;
+
     /** Applies the given actions (e.g. updating paddle positions when the paddle is used)
-      *  and performs one simulation step in Stella. Returns the resultant reward. */
+      *  and performs one simulation step in Stella. With frame skipping, the actions are
+      *  repeated for up to getFrameSkip() frames, stopping early on a terminal state.
+      *  Returns the reward summed over the emulated frames. */
     reward_t act(Action player_a_action, Action player_b_action);
 
+    /** Applies the given actions for player A, with player B idle, as successive calls to
+      *  act() would, stopping at a terminal state. The screen, RAM and frame stack are only
+      *  updated after the last action, and only its observed frames are drawn if 'render'
+      *  is set (none otherwise). Rewards of action i are discounted by discount^i. */
+    void rollout(const Action *actions, size_t n, RolloutResult &result,
+                 double discount, bool render);
+
+    /** Keeps a history of at least the last 'max_frames' emulated frames, as a snapshot
+      *  every 'interval' frames and the actions applied since, in a ring of fixed size.
+      *  A 'max_frames' of 0 disables it. Resets and restored states start a new history. */
+    void setRewindBuffer(int max_frames, int interval);
+
+    /** Returns to the state 'frames' emulated frames ago, by restoring the latest snapshot
+      *  before it and replaying the recorded actions; the history after it is dropped.
+      *  Returns false, changing nothing, if the history does not go back that far. */
+    bool rewind(int frames);
+
+    /** Number of frames rewind() can go back, leaving out the oldest recorded frames
+      *  that are only kept to draw the observed frames of the target again. */
+    int rewindableFrames() const;
+
     /** Returns true once we reach a terminal state */
     bool isTerminal() const;
 
@@ -81,38 +120,233 @@ class StellaEnvironment {
     const ALEState &getState() const;
 
     /** Returns the current screen after processing (e.g. colour averaging) */
-    const ALEScreen &getScreen() const { return m_screen; }
+    const ALEScreen &getScreen() const;
+
+    /** Write the current screen into a caller-provided buffer, as palette indices
+      *  (height x width bytes), interleaved RGB (height x width x 3 bytes) or
+      *  grayscale (height x width bytes). */
+    void getScreenPalette(uInt8 *buffer) const;
+    void getScreenRGB(uInt8 *buffer) const;
+    void getScreenGrayscale(uInt8 *buffer) const;
+
+    /** Configures the preprocessing applied by getPreprocessedScreen(). */
+    void setScreenPreprocessing(const ScreenPreprocessing &config);
+    const ScreenPreprocessing &getScreenPreprocessing() const { return m_preprocessor.config(); }
+
+    /** Writes the current screen, cropped, converted and resized, into a caller-provided
+      *  buffer of preprocessedScreenSize() bytes. */
+    void getPreprocessedScreen(uInt8 *buffer) const;
+    size_t preprocessedScreenSize() const { return m_preprocessor.outputSize(); }
+
+    /** Keeps the last 'depth' preprocessed screens in a ring buffer, updated on every
+      *  act() and restarted with the first screen of each episode; 0 disables it. The
+      *  stack is not part of saved states. */
+    void setFrameStackDepth(int depth);
+    int getFrameStackDepth() const { return m_frame_stack.depth(); }
+    const FrameStack &getFrameStack() const { return m_frame_stack; }
     const ALERAM &getRAM() const { return m_ram; }
 
     int getFrameNumber() const { return m_state.getFrameNumber(); } 
     int getEpisodeFrameNumber() const { return m_state.getEpisodeFrameNumber(); }
 
+    /** Number of frames each action is repeated for; must be at least 1. */
+    void setFrameSkip(int frame_skip);
+    int getFrameSkip() const { return m_frame_skip; }
+
+    /** Probability of ignoring the new action and repeating the previous one, drawn
+      *  independently for every emulated frame ("sticky actions"). */
+    void setRepeatActionProbability(float probability);
+    float getRepeatActionProbability() const { return m_repeat_action_probability; }
+
+    /** When enabled, each pixel of the screen is the brighter of the last two frames,
+      *  which removes the flicker of objects drawn on alternate frames. This takes
+      *  precedence over colour averaging. */
+    void setMaxPoolFrames(bool max_pool) { m_max_pool_frames = max_pool; }
+    bool getMaxPoolFrames() const { return m_max_pool_frames; }
+
+    /** Restarts the random number stream used for sticky actions and stochastic
+      *  starts. By default it is derived from the system's seed. */
+    void setRandomSeed(uInt32 seed) { m_random.seed(seed); }
+
+    /** Enables or disables drawing the screen. When disabled, the game is still emulated
+      *  exactly (including collisions) but getScreen() is no longer updated; this is meant
+      *  for agents that only observe the RAM. */
+    void setScreenRendering(bool render) { m_render_screen = render; }
+    bool getScreenRendering() const { return m_render_screen; }
+
+    /** By default, only the frames that make up an observation are drawn: the last frame of
+      *  an action repeat (or the last two, with colour averaging or max-pooling). Enabling
+      *  this draws every emulated frame, e.g. for recording videos. */
+    void setRenderSkippedFrames(bool render) { m_render_skipped_frames = render; }
+    bool getRenderSkippedFrames() const { return m_render_skipped_frames; }
+
+    /** When enabled, the emulator state reached by reset() is computed once and restored
+      *  on later resets instead of being emulated again. With stochastic starts, all
+      *  NUM_RANDOM_ENVIRONMENTS start states are precomputed on the first reset. */
+    void setCacheResetStates(bool cache);
+    bool getCacheResetStates() const { return m_cache_reset_states; }
+
+    /** When enabled, snapshots also hold the last two frame buffers, so that the screen is
+      *  valid as soon as one is restored. Each frame is XORed with itself one row up, by
+      *  8-byte words, and stored as a bitmap of the words that differ followed by their
+      *  XORed values. Snapshots holding screens are restored whatever this setting. */
+    void setSnapshotScreens(bool include) { m_snapshot_screens = include; }
+    bool getSnapshotScreens() const { return m_snapshot_screens; }
+
+    /** Sets the cache that act() consults and fills when its outcome only depends on the
+      *  emulator state (see canCacheTransition()); NULL disables it. */
+    void setTransitionCache(TransitionCache *cache) { m_transition_cache = cache; }
+    TransitionCache *getTransitionCache() const { return m_transition_cache; }
+
+    /** Environments of the same ROM whose keys are equal take the same step on
+      *  act(player_a_action, PLAYER_B_NOOP): the key covers the emulator state, the action,
+      *  the settings deciding which frames are emulated and drawn, and the frame buffers
+      *  and screen from before the step, which the screen after it may still show. Returns
+      *  false when something else may decide the step (sticky actions, the episode frame
+      *  limit, a terminal state). */
+    bool lockstepKey(Action player_a_action, unsigned long long &key) const;
+
+    /** Takes the step that 'leader', whose lockstep key was equal to this environment's,
+      *  took in act() over 'frames' frames, without emulating it: 'snapshot' is the
+      *  leader's state afterwards (see serializeEmulatorInto()), and its screen is copied. */
+    void followStep(const StellaEnvironment &leader, const void *snapshot, size_t size,
+                    int frames);
+
+    /** As serializeInto(), but never with the frame buffers. */
+    size_t serializeEmulatorInto(void *buffer, size_t size) const;
+
   private:
-    /** Actually emulates the emulator for a given number of steps. */
+    /** Emulates one action (with frame skipping) without processing the screen and RAM;
+      *  the frames to observe are drawn if 'observe' is set, or if 'observe_terminal' is
+      *  and the episode ends during the step. 'frames' receives the number of frames
+      *  emulated. */
+    reward_t step(Action player_a_action, Action player_b_action, bool observe, int &frames,
+                  bool observe_terminal = false);
+
+    /** Emulates the last step, 'frames' frames from m_step_snapshot with m_step_actions,
+      *  again, drawing the frames to observe at its end; also the step before it, kept in
+      *  a rollout, when its last frame is observed too */
+    void redrawStep(int frames);
+
+    /** Emulates 'frames' frames again with the actions recorded for them */
+    void replayFrames(const std::vector<uInt8> &actions, int frames);
+
+    /** Actually emulates the emulator for a given number of steps. The screen and RAM
+      *  are not updated; see processScreen() and processRAM(). */
     void emulate(Action player_a_action, Action player_b_action, size_t num_steps = 1);
 
+    /** Whether act() can use the transition cache: nothing but the emulator state and the
+      *  actions may decide its outcome, and nothing it does may be missing from the cached
+      *  successor snapshot. */
+    bool canCacheTransition() const;
+
+    /** Whether an episode frame limit may be reached by the next act() */
+    bool frameLimitAhead() const;
+
+    /** Key of the transition from the current state under the given actions, and in
+      *  'check' a second hash of the state that the transition cache also compares */
+    unsigned long long transitionKey(Action player_a_action, Action player_b_action,
+                                     unsigned long long &check) const;
+
+    /** Writes the current and previous frame buffers after a snapshot; returns the
+      *  number of bytes written */
+    size_t saveFrameBuffers(char *buffer, size_t size) const;
+
+    /** Unpacks the frame buffers written by saveFrameBuffers() into m_restored_frames,
+      *  throwing std::invalid_argument if they are corrupt, before anything is restored */
+    void unpackFrameBuffers(const char *buffer, size_t size);
+
+    /** Restores the frame buffers unpacked by unpackFrameBuffers() */
+    void loadFrameBuffers();
+
+    /** Adds a snapshot to the rewind history, if one is due */
+    void recordRewindCheckpoint();
+
+    /** Saves a raw copy of the emulator before restoring a state from outside, which
+      *  rollBack() puts back should the state turn out to be corrupt part-way through */
+    void backUp();
+    void rollBack();
+
+    /** Restores the successor of a cached transition in place of emulating it */
+    void applyTransition(const TransitionCache::Transition &transition);
+
+    /** Emulates a reset from the system reset on, with 'noop_steps' NOOPs before RESET */
+    void emulateReset(int noop_steps);
+
+    /** Emulates m_reset_actions[begin, end), resetting the ROM settings once the RESET
+      *  frames are over */
+    void emulateResetActions(size_t begin, size_t end);
+
+    /** Restores the cached start state with 'extra_noop_steps' stochastic NOOPs and
+      *  replays the frames making up the first observation */
+    void restoreResetState(int extra_noop_steps);
+
+    /** Computes the cached start states */
+    void buildResetStates();
+
+    /** Number of frames making up an observation: 2 when the previous frame is pooled or
+      *  averaged with the current one, 1 otherwise */
+    int observedFrames() const;
+
+    /** Marks all but the observed frames of the next 'num_frames' frames as not to be drawn */
+    void skipRendering(int num_frames);
+
+    /** Emulates one frame, drawing it only if it may be observed */
+    void updateMediaSource();
+
     /** Drops illegal actions, such as the fire button in skiing. Note that this is different
       *   from the minimal set of actions. */
-    void noopIllegalActions(Action& player_a_action, Action& player_b_action);
+    void noopIllegalActions(Action& player_a_action, Action& player_b_action) const;
 
-    /** Processes the current emulator screen and saves it in m_screen */
+    /** Marks the current emulator screen as the one to observe; m_screen is only
+      *  built from it when needed */
     void processScreen();
+
+    /** Processes the current emulator screen and saves it in m_screen */
+    void updateScreen() const;
+
+    /** Returns the pixels of the current screen, reading the frame buffer directly
+      *  when it needs no processing */
+    const uInt8* screenPixels() const;
+    /** Appends the current preprocessed screen to the frame stack, if enabled */
+    void pushFrame();
+
     /** Processes the emulator RAM and saves it in m_ram */
     void processRAM();
 
+    /** Builds the per-colour RGB and luminance tables of the console palette */
+    void makePaletteTables();
+
   private:
     OSystem * m_osystem;
     RomSettings * m_settings;
-    PhosphorBlend m_phosphor_blend; // For performing phosphor colour averaging, if so desired
+    mutable PhosphorBlend m_phosphor_blend; // For performing phosphor colour averaging, if so desired
+    mutable ScreenPreprocessor m_preprocessor; // For producing compact observations
+    FrameStack m_frame_stack; // The most recent preprocessed screens
     std::string m_cartridge_md5; // Necessary for saving and loading emulator state
+    mutable std::vector<char> m_hash_buffer; // The packed state, when hashing it
 
-    std::stack<ALEState> m_saved_states; // States are saved on a stack
+    // Raw states (see ALEState::saveRaw()) are saved on a stack; the buffers above the top
+    //  are kept for the next saves
+    std::vector<std::vector<uInt8> > m_saved_states;
+    size_t m_num_saved_states; // Number of states on the stack
+    std::vector<uInt8> m_backup; // The emulator before a restore, see backUp()
+    std::vector<uInt8> m_restored_frames; // The current and previous frames being restored
     
     ALEState m_state; // Current environment state
-    ALEScreen m_screen; // The current ALE screen (possibly colour-averaged)
+    mutable ALEScreen m_screen; // The current ALE screen (possibly colour-averaged)
+    mutable bool m_screen_pending; // Whether m_screen is out of date with the frame buffer
     ALERAM m_ram; // The current ALE RAM
 
     bool m_use_paddles;  // Whether this game uses paddles
+
+    Action m_player_a_action; // Last actions applied, repeated when actions are sticky
+    Action m_player_b_action;
+
+    Random m_random; // Draws sticky actions and stochastic starts
+
+    uInt8 m_rgb_palette[256][3]; // RGB value of each colour of the console palette
+    uInt8 m_luminance[256]; // Brightness of each colour of the console palette
     
     /** Parameters loaded from Settings. */
     bool m_use_starting_actions; // Whether we run a set of starting actions after reset 
@@ -120,6 +354,35 @@ class StellaEnvironment {
     bool m_colour_averaging; // Whether to average frames
     bool m_stochastic_start; // Whether to "draw" the environment from a random distribution
     int m_max_num_frames_per_episode; // Maxmimum number of frames per episode 
+    int m_frame_skip; // Number of frames each action is repeated for
+    float m_repeat_action_probability; // Probability of repeating the previous action
+    bool m_max_pool_frames; // Whether to max-pool the last two frames
+    bool m_render_screen; // Whether to draw the screen at all
+    bool m_render_skipped_frames; // Whether to also draw frames that are never observed
+
+    int m_headless_frames; // Number of upcoming frames that need not be drawn
+    bool m_last_frame_rendered; // Whether the most recent frame was drawn
+
+    /** Frames replayed after restoring a cached start state, which redraw the screen. */
+    static const size_t RESET_REPLAY_FRAMES = 2;
+
+    bool m_cache_reset_states; // Whether reset() restores cached start states
+    bool m_snapshot_screens; // Whether snapshots hold the frame buffers
+    ActionVect m_reset_actions; // RESET frames followed by the starting actions
+    std::vector<ALEState> m_reset_states; // Start states, indexed by the number of extra NOOPs
+
+    RewindBuffer m_rewind; // Recent snapshots and actions
+    std::vector<uInt8> m_rewind_snapshot; // A snapshot, read from or for m_rewind
+    std::vector<uInt8> m_rewind_actions; // The actions replayed by rewind()
+
+    TransitionCache *m_transition_cache; // Outcomes of act(), shared with other environments
+    std::vector<char> m_transition_buffer; // A successor snapshot, read from or for the cache
+    std::vector<uInt8> m_step_snapshot; // The state before the step, should it be redrawn
+    std::vector<uInt8> m_step_actions; // The actions applied on each frame of the step
+    std::vector<uInt8> m_previous_step_snapshot; // The same for the step before, in a rollout
+    std::vector<uInt8> m_previous_step_actions;
+    bool m_previous_step_valid; // Whether the two above hold the step just before this one
+    unsigned long long m_rom_key; // Tells the transitions of different ROMs apart
 
     bool m_backward_compatible_save; // Enable the save/load mechanism from ALE 0.2 (no stack)
 };
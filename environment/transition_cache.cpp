@@ -0,0 +1,361 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  transition_cache.cpp
+ *
+ *  A sharded cache of emulator transitions, shared between environments and threads.
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+using namespace ale;
+
+class TransitionCache::Impl {
+
+    public:
+
+        Impl(size_t capacity, size_t num_shards);
+
+        bool lookup(uint64_t key, uint64_t check, void *snapshot, size_t size,
+                    Transition &transition);
+        void insert(uint64_t key, uint64_t check, const void *snapshot, size_t size,
+                    const Transition &transition);
+        void clear();
+
+        size_t capacity() const { return m_num_shards * m_sets_per_shard * WAYS; }
+        size_t size() const;
+
+        uint64_t hits() const { return m_hits.load(std::memory_order_relaxed); }
+        uint64_t misses() const { return m_misses.load(std::memory_order_relaxed); }
+
+    private:
+
+        // Slots a key may be stored in
+        static const size_t WAYS = 8;
+        // Times a lookup racing an insertion into the same slot retries before missing
+        static const int READ_ATTEMPTS = 4;
+
+        // A transition, read without locks. The sequence number is odd while an insertion
+        // writes the slot and moves on with every write, so a reader can tell that its
+        // copy may be torn and retry (a seqlock). All fields, the snapshot words
+        // included, are atomics accessed with relaxed ordering, fenced around the copies.
+        struct Slot {
+            std::atomic<uint32_t> sequence;
+            std::atomic<bool> filled;
+            std::atomic<unsigned char> referenced; // CLOCK reference bit
+            std::atomic<uint64_t> key;
+            std::atomic<uint64_t> check; // Second hash of the source, see lookup()
+            std::atomic<reward_t> reward;
+            std::atomic<int> frames;
+            std::atomic<bool> terminal;
+        };
+
+        // Sets of WAYS slots; the snapshots are laid out back to back
+        struct Shard {
+            std::mutex mutex; // Serializes insertions and clearing
+            std::unique_ptr<Slot[]> slots;
+            std::unique_ptr<std::atomic<uint64_t>[]> snapshot_words;
+            std::atomic<std::atomic<uint64_t> *> snapshots; // Allocated on first insertion
+            std::unique_ptr<unsigned char[]> hands; // Next eviction candidate in each set
+            std::atomic<size_t> used; // Slots filled
+        };
+
+        Shard &shard(uint64_t key) { return m_shards[(key >> 32) % m_num_shards]; }
+        size_t set(uint64_t key) const { return static_cast<size_t>(key % m_sets_per_shard); }
+
+        /** Fixes the snapshot size on first use, and checks it afterwards */
+        void checkSize(size_t size);
+
+        /** Copies the transition in a slot if it is stored under 'key' and 'check' */
+        bool read(const Slot &slot, const std::atomic<uint64_t> *words, uint64_t key,
+                  uint64_t check, void *snapshot, size_t size, Transition &transition) const;
+
+        /** Writes a slot; the shard must be locked */
+        void write(Slot &slot, std::atomic<uint64_t> *words, uint64_t key, uint64_t check,
+                   const void *snapshot, size_t size, const Transition &transition);
+
+        /** Picks the slot to overwrite in a full set (CLOCK) */
+        size_t evict(Shard &shard, size_t set);
+
+        size_t m_num_shards;
+        size_t m_sets_per_shard;
+        std::unique_ptr<Shard[]> m_shards;
+
+        std::atomic<size_t> m_snapshot_size; // 0 until the first insertion
+        std::atomic<uint64_t> m_hits;
+        std::atomic<uint64_t> m_misses;
+};
+
+/** Copies 'size' bytes out of atomic words, the last one possibly partial */
+static void loadWords(const std::atomic<uint64_t> *words, unsigned char *out, size_t size) {
+  size_t full = size / sizeof(uint64_t);
+  for (size_t i = 0; i < full; i++) {
+    uint64_t word = words[i].load(std::memory_order_relaxed);
+    memcpy(out + i * sizeof(uint64_t), &word, sizeof(uint64_t));
+  }
+  if (size % sizeof(uint64_t) != 0) {
+    uint64_t word = words[full].load(std::memory_order_relaxed);
+    memcpy(out + full * sizeof(uint64_t), &word, size % sizeof(uint64_t));
+  }
+}
+
+/** Copies 'size' bytes into atomic words, padding the last one with zeros */
+static void storeWords(const unsigned char *in, std::atomic<uint64_t> *words, size_t size) {
+  size_t full = size / sizeof(uint64_t);
+  for (size_t i = 0; i < full; i++) {
+    uint64_t word;
+    memcpy(&word, in + i * sizeof(uint64_t), sizeof(uint64_t));
+    words[i].store(word, std::memory_order_relaxed);
+  }
+  if (size % sizeof(uint64_t) != 0) {
+    uint64_t word = 0;
+    memcpy(&word, in + full * sizeof(uint64_t), size % sizeof(uint64_t));
+    words[full].store(word, std::memory_order_relaxed);
+  }
+}
+
+TransitionCache::Impl::Impl(size_t capacity, size_t num_shards):
+  m_num_shards(num_shards),
+  m_snapshot_size(0),
+  m_hits(0),
+  m_misses(0) {
+
+  if (capacity == 0 || num_shards == 0)
+    throw std::invalid_argument("transition cache needs at least one slot and one shard");
+  if (num_shards > capacity)
+    m_num_shards = capacity;
+
+  size_t slots_per_shard = (capacity + m_num_shards - 1) / m_num_shards;
+  m_sets_per_shard = (slots_per_shard + WAYS - 1) / WAYS;
+  m_shards.reset(new Shard[m_num_shards]);
+  for (size_t i = 0; i < m_num_shards; i++) {
+    Shard &s = m_shards[i];
+    s.slots.reset(new Slot[m_sets_per_shard * WAYS]());
+    s.snapshots.store(NULL, std::memory_order_relaxed);
+    s.hands.reset(new unsigned char[m_sets_per_shard]());
+    s.used.store(0, std::memory_order_relaxed);
+  }
+}
+
+void TransitionCache::Impl::checkSize(size_t size) {
+  size_t expected = 0;
+  if (!m_snapshot_size.compare_exchange_strong(expected, size) && expected != size)
+    throw std::invalid_argument("transition cache holds snapshots of another size");
+}
+
+bool TransitionCache::Impl::read(const Slot &slot, const std::atomic<uint64_t> *words,
+                                 uint64_t key, uint64_t check, void *snapshot, size_t size,
+                                 Transition &transition) const {
+  unsigned char *out = static_cast<unsigned char *>(snapshot);
+  for (int attempt = 0; attempt < READ_ATTEMPTS; attempt++) {
+    uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence & 1) continue;
+    if (!slot.filled.load(std::memory_order_relaxed) ||
+        slot.key.load(std::memory_order_relaxed) != key)
+      return false;
+
+    bool matches = slot.check.load(std::memory_order_relaxed) == check;
+    loadWords(words, out, size);
+    transition.reward = slot.reward.load(std::memory_order_relaxed);
+    transition.frames = slot.frames.load(std::memory_order_relaxed);
+    transition.terminal = slot.terminal.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) == sequence) return matches;
+  }
+  return false;
+}
+
+bool TransitionCache::Impl::lookup(uint64_t key, uint64_t check, void *snapshot, size_t size,
+                                   Transition &transition) {
+  Shard &s = shard(key);
+  size_t first = set(key) * WAYS;
+  for (size_t way = 0; way < WAYS; way++) {
+    Slot &slot = s.slots[first + way];
+    // Cheap unsynchronized filter; read() validates the match
+    if (slot.key.load(std::memory_order_relaxed) != key) continue;
+
+    // A slot is only filled once the snapshots are allocated and the size fixed
+    std::atomic<uint64_t> *snapshots = s.snapshots.load(std::memory_order_acquire);
+    size_t snapshot_size = m_snapshot_size.load(std::memory_order_relaxed);
+    if (snapshots == NULL) break;
+    if (size != snapshot_size)
+      throw std::invalid_argument("transition cache holds snapshots of another size");
+
+    size_t words = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    if (read(slot, &snapshots[(first + way) * words], key, check, snapshot, size,
+             transition)) {
+      slot.referenced.store(1, std::memory_order_relaxed);
+      m_hits.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  m_misses.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void TransitionCache::Impl::write(Slot &slot, std::atomic<uint64_t> *words, uint64_t key,
+                                  uint64_t check, const void *snapshot, size_t size,
+                                  const Transition &transition) {
+  uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  storeWords(static_cast<const unsigned char *>(snapshot), words, size);
+  slot.key.store(key, std::memory_order_relaxed);
+  slot.check.store(check, std::memory_order_relaxed);
+  slot.reward.store(transition.reward, std::memory_order_relaxed);
+  slot.frames.store(transition.frames, std::memory_order_relaxed);
+  slot.terminal.store(transition.terminal, std::memory_order_relaxed);
+  slot.filled.store(true, std::memory_order_relaxed);
+
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+size_t TransitionCache::Impl::evict(Shard &s, size_t set) {
+  Slot *slots = &s.slots[set * WAYS];
+  unsigned char &hand = s.hands[set];
+
+  // Give every recently used slot a second chance
+  for (size_t n = 0; n < WAYS && slots[hand].referenced.load(std::memory_order_relaxed); n++) {
+    slots[hand].referenced.store(0, std::memory_order_relaxed);
+    hand = static_cast<unsigned char>((hand + 1) % WAYS);
+  }
+
+  size_t way = hand;
+  hand = static_cast<unsigned char>((hand + 1) % WAYS);
+  return way;
+}
+
+void TransitionCache::Impl::insert(uint64_t key, uint64_t check, const void *snapshot,
+                                   size_t size, const Transition &transition) {
+  checkSize(size);
+
+  Shard &s = shard(key);
+  std::lock_guard<std::mutex> lock(s.mutex);
+
+  size_t words = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  std::atomic<uint64_t> *snapshots = s.snapshots.load(std::memory_order_relaxed);
+  if (snapshots == NULL) {
+    s.snapshot_words.reset(new std::atomic<uint64_t>[m_sets_per_shard * WAYS * words]());
+    snapshots = s.snapshot_words.get();
+    s.snapshots.store(snapshots, std::memory_order_release);
+  }
+
+  // Replace the key's transition, or fill a free slot of its set, or evict one
+  size_t first = set(key) * WAYS;
+  size_t way = WAYS;
+  for (size_t i = 0; i < WAYS && way == WAYS; i++) {
+    const Slot &slot = s.slots[first + i];
+    if (slot.filled.load(std::memory_order_relaxed) &&
+        slot.key.load(std::memory_order_relaxed) == key)
+      way = i;
+  }
+  if (way == WAYS) {
+    for (size_t i = 0; i < WAYS && way == WAYS; i++) {
+      if (!s.slots[first + i].filled.load(std::memory_order_relaxed)) {
+        way = i;
+        s.used.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    if (way == WAYS) way = evict(s, set(key));
+    s.slots[first + way].referenced.store(0, std::memory_order_relaxed);
+  }
+
+  write(s.slots[first + way], &snapshots[(first + way) * words], key, check, snapshot, size,
+        transition);
+}
+
+void TransitionCache::Impl::clear() {
+  for (size_t i = 0; i < m_num_shards; i++) {
+    Shard &s = m_shards[i];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    for (size_t j = 0; j < m_sets_per_shard * WAYS; j++) {
+      Slot &slot = s.slots[j];
+      if (!slot.filled.load(std::memory_order_relaxed)) continue;
+
+      uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+      slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      slot.filled.store(false, std::memory_order_relaxed);
+      slot.sequence.store(sequence + 2, std::memory_order_release);
+    }
+    s.used.store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t TransitionCache::Impl::size() const {
+  size_t total = 0;
+  for (size_t i = 0; i < m_num_shards; i++)
+    total += m_shards[i].used.load(std::memory_order_relaxed);
+  return total;
+}
+
+
+TransitionCache::TransitionCache(size_t capacity, size_t num_shards):
+  m_pimpl(new TransitionCache::Impl(capacity, num_shards)) {
+}
+
+
+TransitionCache::~TransitionCache() {
+  delete m_pimpl;
+}
+
+
+bool TransitionCache::lookup(uint64_t key, uint64_t check, void *snapshot, size_t size,
+                             Transition &transition) {
+  return m_pimpl->lookup(key, check, snapshot, size, transition);
+}
+
+
+void TransitionCache::insert(uint64_t key, uint64_t check, const void *snapshot, size_t size,
+                             const Transition &transition) {
+  m_pimpl->insert(key, check, snapshot, size, transition);
+}
+
+
+void TransitionCache::clear() {
+  m_pimpl->clear();
+}
+
+
+size_t TransitionCache::capacity() const {
+  return m_pimpl->capacity();
+}
+
+
+size_t TransitionCache::size() const {
+  return m_pimpl->size();
+}
+
+
+uint64_t TransitionCache::hits() const {
+  return m_pimpl->hits();
+}
+
+
+uint64_t TransitionCache::misses() const {
+  return m_pimpl->misses();
+}
@@ -33,9 +33,22 @@
  * *****************************************************************************
  */
 #include "RomSettings.hpp"
+#include "../emucore/RawState.hxx"
 
 using namespace ale;
 
+namespace {
+
+// Gives rom settings the save() and load() that RawState::copySerialized() calls
+struct SerializedSettings {
+  RomSettings &settings;
+
+  bool save(Serializer &ser) { settings.saveState(ser); return true; }
+  bool load(Deserializer &ser) { settings.loadState(ser); return true; }
+};
+
+}  // namespace
+
 bool RomSettings::isLegal(const Action& a) const {
   return true;
 }
@@ -64,3 +77,9 @@ ActionVect& RomSettings::getAllActions() {
 ActionVect RomSettings::getStartingActions() {
     return ActionVect();
 }
+
+void RomSettings::copyRaw(RawState &state) {
+  // Games only keep a few counters, which go through their serialized state
+  SerializedSettings serialized = { *this };
+  state.copySerialized(serialized);
+}
@@ -42,6 +42,7 @@
 namespace ale {
 
 class System;
+class RawState;
 
 
 // rom support interface
@@ -76,6 +77,10 @@ struct RomSettings {
     // loads the state of the rom settings
     virtual void loadState(Deserializer & ser) = 0;
 
+    // saves, loads or measures the raw state of the rom settings (see RawState);
+    //  by default through saveState() and loadState()
+    virtual void copyRaw(RawState & state);
+
     // is an action legal (default: yes)
     virtual bool isLegal(const Action &a) const;
 
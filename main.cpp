@@ -127,7 +127,7 @@ int main(int argc, char* argv[]) {
 
         // Create the game controller
         std::string controller_type = theOSystem->settings().getString("game_controller");
-        std::auto_ptr<ALEController> controller(createController(theOSystem, controller_type));
+        std::unique_ptr<ALEController> controller(createController(theOSystem, controller_type));
 
         controller->run();
 
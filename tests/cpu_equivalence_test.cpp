@@ -0,0 +1,139 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  cpu_equivalence_test.cpp
+ *
+ *  Checks that the predecoding processor (cpu=fast) runs exactly as the
+ *  reference one (cpu=high): the registers and cycle count after every
+ *  instruction, and the RAM, screen and state after every frame, over ROMs
+ *  exercising the TIA, the RIOT timer and bank switching. The data bus is
+ *  traced against cpu=low, whose accesses the predecoding processor shares:
+ *  the reference one also makes dummy reads, e.g. of the byte after an
+ *  implied instruction, which only change the bus.
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "emucore/Console.hxx"
+#include "emucore/OSystem.hxx"
+#include "emucore/Serializer.hxx"
+#include "emucore/m6502/src/M6502.hxx"
+#include "emucore/m6502/src/System.hxx"
+#include "test_support.hpp"
+
+#include <memory>
+#include <random>
+
+using namespace ale;
+
+namespace {
+
+const int TRACED_INSTRUCTIONS = 100000;
+const int COMPARED_FRAMES = 1500;
+
+std::unique_ptr<ALEInterface> load(const std::string &rom, const std::string &cpu) {
+  test::ScopedConfig config("cpu=" + cpu + "\n");
+  std::unique_ptr<ALEInterface> ale(new ALEInterface(rom));
+  ale->setRandomSeed(1);
+  return ale;
+}
+
+System &systemOf(ALEInterface &ale) {
+  return const_cast<OSystem &>(ale.osystem()).console().system();
+}
+
+// The processor's registers and execution status, without its name
+std::string registers(System &system) {
+  Serializer out(64, Serializer::Compact);
+  system.m6502().save(out);
+  return out.get_str();
+}
+
+// Steps the processors one instruction at a time
+void compareInstructions(const std::string &rom) {
+  std::unique_ptr<ALEInterface> reference = load(rom, "high");
+  std::unique_ptr<ALEInterface> low = load(rom, "low");
+  std::unique_ptr<ALEInterface> fast = load(rom, "fast");
+  System &expected = systemOf(*reference);
+  System &bus = systemOf(*low);
+  System &actual = systemOf(*fast);
+
+  for (int i = 0; i < TRACED_INSTRUCTIONS; i++) {
+    expected.m6502().execute(1);
+    bus.m6502().execute(1);
+    actual.m6502().execute(1);
+
+    bool same = TEST_CHECK(actual.m6502().getPC() == expected.m6502().getPC()) &&
+                TEST_CHECK(registers(actual) == registers(expected)) &&
+                TEST_CHECK(actual.cycles() == expected.cycles()) &&
+                TEST_CHECK(actual.getDataBusState() == bus.getDataBusState());
+    // The TIA, RIOT and cartridge too, every so often
+    if (same && i % 64 == 0)
+      same = TEST_CHECK(fast->stateHash() == reference->stateHash()) &&
+             TEST_CHECK(fast->stateHash() == low->stateHash());
+    if (!same) {
+      fprintf(stderr, "%s: first difference after %d instructions\n", rom.c_str(), i + 1);
+      return;
+    }
+  }
+}
+
+// Plays both processors through frames with the same actions
+void compareFrames(const std::string &rom) {
+  std::unique_ptr<ALEInterface> reference = load(rom, "high");
+  std::unique_ptr<ALEInterface> fast = load(rom, "fast");
+  System &expected = systemOf(*reference);
+  System &actual = systemOf(*fast);
+
+  ActionVect actions = reference->getLegalActionSet();
+  std::mt19937 rng(2);
+  for (int frame = 0; frame < COMPARED_FRAMES; frame++) {
+    Action action = actions[rng() % actions.size()];
+    bool same = TEST_CHECK(fast->act(action) == reference->act(action)) &&
+                TEST_CHECK(fast->getRAM().equals(reference->getRAM())) &&
+                TEST_CHECK(fast->getScreen().equals(reference->getScreen())) &&
+                TEST_CHECK(fast->stateHash() == reference->stateHash()) &&
+                TEST_CHECK(registers(actual) == registers(expected)) &&
+                TEST_CHECK(actual.cycles() == expected.cycles()) &&
+                TEST_CHECK(fast->gameOver() == reference->gameOver());
+    if (!same) {
+      fprintf(stderr, "%s: first difference at frame %d\n", rom.c_str(), frame);
+      return;
+    }
+    if (reference->gameOver()) {
+      reference->resetGame();
+      fast->resetGame();
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  test::TempDir dir;
+  std::vector<std::string> roms;
+  roms.push_back(dir.write("pong.bin", test::gameRom()));
+  roms.push_back(dir.write("breakout.bin", test::vblankGameRom()));
+  roms.push_back(dir.write("boxing.bin", test::timerLoopRom((1 << test::TIMER_LOOP_COUNT) - 1)));
+  roms.push_back(dir.write("freeway.bin", test::bankSwitchRom()));
+
+  for (size_t i = 0; i < roms.size(); i++) {
+    compareInstructions(roms[i]);
+    compareFrames(roms[i]);
+  }
+  return test::finish("cpu_equivalence_test");
+}
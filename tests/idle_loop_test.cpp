@@ -0,0 +1,115 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  idle_loop_test.cpp
+ *
+ *  Checks that skipping idle loops (cpu=fast, idle_loop_skip=true) changes
+ *  nothing but the speed: the state, RAM, screen, registers and cycle count
+ *  after every frame match cpu=low, for all 63 combinations of the timer and
+ *  input wait loops of timerLoopRom() and for the synthetic games. This covers
+ *  finding the loops, fast-forwarding them and the RIOT's stablePeekCycles().
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "emucore/Console.hxx"
+#include "emucore/OSystem.hxx"
+#include "emucore/Serializer.hxx"
+#include "emucore/m6502/src/M6502.hxx"
+#include "emucore/m6502/src/System.hxx"
+#include "test_support.hpp"
+
+#include <memory>
+#include <random>
+
+using namespace ale;
+
+namespace {
+
+const int COMPARED_FRAMES = 300;
+
+std::unique_ptr<ALEInterface> load(const std::string &rom, const std::string &settings) {
+  test::ScopedConfig config(settings);
+  std::unique_ptr<ALEInterface> ale(new ALEInterface(rom));
+  ale->setRandomSeed(3);
+  return ale;
+}
+
+System &systemOf(ALEInterface &ale) {
+  return const_cast<OSystem &>(ale.osystem()).console().system();
+}
+
+// The processor's registers and execution status, without its name
+std::string registers(System &system) {
+  Serializer out(64, Serializer::Compact);
+  system.m6502().save(out);
+  return out.get_str();
+}
+
+// Plays both emulators through frames with the same actions; returns the number of
+//  instructions skipped
+unsigned long long compareFrames(const std::string &rom) {
+  std::unique_ptr<ALEInterface> reference = load(rom, "cpu=low\n");
+  std::unique_ptr<ALEInterface> skipping = load(rom, "cpu=fast\nidle_loop_skip=true\n");
+  System &expected = systemOf(*reference);
+  System &actual = systemOf(*skipping);
+
+  // The legal actions include the fire button, which ends the input wait loop
+  ActionVect actions = reference->getLegalActionSet();
+  std::mt19937 rng(4);
+  for (int frame = 0; frame < COMPARED_FRAMES; frame++) {
+    Action action = actions[rng() % actions.size()];
+    bool same = TEST_CHECK(skipping->act(action) == reference->act(action)) &&
+                TEST_CHECK(skipping->getRAM().equals(reference->getRAM())) &&
+                TEST_CHECK(skipping->getScreen().equals(reference->getScreen())) &&
+                TEST_CHECK(skipping->stateHash() == reference->stateHash()) &&
+                TEST_CHECK(registers(actual) == registers(expected)) &&
+                TEST_CHECK(actual.cycles() == expected.cycles()) &&
+                TEST_CHECK(skipping->gameOver() == reference->gameOver());
+    if (!same) {
+      fprintf(stderr, "%s: first difference at frame %d\n", rom.c_str(), frame);
+      break;
+    }
+    if (reference->gameOver()) {
+      reference->resetGame();
+      skipping->resetGame();
+    }
+  }
+  return skipping->idleLoopStats().skipped_instructions;
+}
+
+}  // namespace
+
+int main() {
+  test::TempDir dir;
+
+  for (int loops = 1; loops < (1 << test::TIMER_LOOP_COUNT); loops++) {
+    std::string rom = dir.write("pong.bin", test::timerLoopRom(loops));
+    unsigned long long skipped = compareFrames(rom);
+
+    // The TIM64T and T1024T loops read a value that holds for several iterations, so
+    //  they are skipped. The TIM8T and TIM1T ones see the timer change on every
+    //  iteration, and the input loop only runs while fire stays pressed
+    if ((loops & (1 | 2 | 8)) && !TEST_CHECK(skipped > 0))
+      fprintf(stderr, "no instructions skipped with the wait loops %d\n", loops);
+  }
+
+  compareFrames(dir.write("pong.bin", test::gameRom()));
+  compareFrames(dir.write("pong.bin", test::vblankGameRom()));
+  compareFrames(dir.write("pong.bin", test::bankSwitchRom()));
+  return test::finish("idle_loop_test");
+}
@@ -0,0 +1,151 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  lockstep_test.cpp
+ *
+ *  Checks that VectorALE's lockstep mode returns exactly what stepping each
+ *  environment on its own does, including when environments reach the same
+ *  state with different frames on screen, as after broadcastFrom().
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "test_support.hpp"
+
+#include <random>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+const size_t NUM_ENVS = 8;
+const int NUM_STEPS = 360;
+
+// Settings that decide which frames an observation is built from
+struct Config {
+  int frame_skip;
+  bool max_pool_frames;
+  bool preprocess_max_pool;
+  bool render;
+};
+
+void setUp(VectorALE &batch, const Config &config) {
+  batch.setAutoReset(true);
+  for (size_t i = 0; i < NUM_ENVS; i++) {
+    ALEInterface &env = batch.environment(i);
+    env.setFrameSkip(config.frame_skip);
+    env.setMaxPoolFrames(config.max_pool_frames);
+    env.setScreenRendering(config.render);
+  }
+  if (config.preprocess_max_pool) {
+    ScreenPreprocessing preprocessing;
+    preprocessing.output_height = 84;
+    preprocessing.output_width = 84;
+    preprocessing.max_pool = true;
+    batch.setScreenPreprocessing(preprocessing);
+  }
+  batch.setFrameStacking(2);
+  batch.setRandomSeed(7);
+  batch.resetAll();
+}
+
+void compare(const std::string &rom, const Config &config) {
+  VectorALE plain(rom, NUM_ENVS, 1);
+  VectorALE lockstep(rom, NUM_ENVS, 1);
+  lockstep.setLockstep(true);
+  setUp(plain, config);
+  setUp(lockstep, config);
+
+  ActionVect actions = plain.environment(0).getMinimalActionSet();
+  size_t observation_size = plain.observationSize();
+  size_t stacked_size = plain.environment(0).stackedObservationSize();
+  std::vector<Action> step_actions(NUM_ENVS);
+  std::vector<reward_t> plain_rewards(NUM_ENVS), lockstep_rewards(NUM_ENVS);
+  std::vector<unsigned char> plain_terminals(NUM_ENVS), lockstep_terminals(NUM_ENVS);
+  std::vector<pixel_t> plain_screens(NUM_ENVS * observation_size);
+  std::vector<pixel_t> lockstep_screens(NUM_ENVS * observation_size);
+  std::vector<byte_t> plain_ram(NUM_ENVS * plain.ramSize());
+  std::vector<byte_t> lockstep_ram(NUM_ENVS * plain.ramSize());
+  std::vector<uint8_t> plain_stacks(NUM_ENVS * stacked_size);
+  std::vector<uint8_t> lockstep_stacks(NUM_ENVS * stacked_size);
+
+  std::mt19937 rng(config.frame_skip);
+  for (int step = 0; step < NUM_STEPS; step++) {
+    // Half of the environments follow the same actions, the others their own, so that
+    //  some reach the state of the group having drawn other frames. Every so often all
+    //  take on the state of the first one, keeping the frames they drew, and move together
+    int phase = step % 60;
+    if (phase == 30) {
+      plain.broadcastFrom(0);
+      lockstep.broadcastFrom(0);
+    }
+    Action shared = actions[rng() % actions.size()];
+    for (size_t i = 0; i < NUM_ENVS; i++) {
+      bool together = phase >= 30 || i % 2 == 0;
+      step_actions[i] = together ? shared : actions[rng() % actions.size()];
+    }
+
+    plain.step(&step_actions[0], &plain_rewards[0], &plain_terminals[0], &plain_screens[0],
+               &plain_ram[0]);
+    lockstep.step(&step_actions[0], &lockstep_rewards[0], &lockstep_terminals[0],
+                  &lockstep_screens[0], &lockstep_ram[0]);
+    plain.getStackedObservations(&plain_stacks[0]);
+    lockstep.getStackedObservations(&lockstep_stacks[0]);
+
+    bool same = TEST_CHECK(lockstep_rewards == plain_rewards) &&
+                TEST_CHECK(lockstep_terminals == plain_terminals) &&
+                TEST_CHECK(lockstep_screens == plain_screens) &&
+                TEST_CHECK(lockstep_ram == plain_ram) &&
+                TEST_CHECK(lockstep_stacks == plain_stacks);
+    for (size_t i = 0; same && i < NUM_ENVS; i++) {
+      const ALEInterface &expected = plain.environment(i);
+      const ALEInterface &actual = lockstep.environment(i);
+      same = TEST_CHECK(actual.stateHash() == expected.stateHash()) &&
+             TEST_CHECK(actual.getFrameNumber() == expected.getFrameNumber()) &&
+             TEST_CHECK(actual.getEpisodeFrameNumber() == expected.getEpisodeFrameNumber()) &&
+             TEST_CHECK(actual.getScreen().equals(expected.getScreen()));
+    }
+    if (!same) {
+      fprintf(stderr, "%s with frame skip %d, max pool %d, preprocessing max pool %d, "
+              "render %d: first difference at step %d\n", rom.c_str(), config.frame_skip,
+              config.max_pool_frames, config.preprocess_max_pool, config.render, step);
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  test::TempDir dir;
+
+  const Config configs[] = {
+    { 1, false, false, true },
+    { 1, true, false, true },
+    { 1, false, true, true },
+    { 1, true, false, false },
+    { 4, true, true, true },
+  };
+  // Both ROMs draw what the joystick reads; the F8 one fills whole frames with it, so
+  //  that frames drawn before a step show through pooling
+  for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+    compare(dir.write("pong.bin", test::bankSwitchRom()), configs[i]);
+    compare(dir.write("pong.bin", test::gameRom()), configs[i]);
+  }
+  return test::finish("lockstep_test");
+}
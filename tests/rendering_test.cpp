@@ -0,0 +1,150 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  rendering_test.cpp
+ *
+ *  Checks that frames which are not drawn (skipped frames, or all of them with
+ *  rendering off) emulate exactly as drawn ones: same RAM, rewards, terminals
+ *  and state, collisions included, and the same observed screens, also when
+ *  an episode ends on a frame that would not have been drawn.
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "test_support.hpp"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+// Steps an emulator drawing every frame, one drawing the observed frames only and a
+// headless one with the same actions, comparing them after each step
+void compareRendering(const std::string &rom, int frame_skip, bool max_pool) {
+  std::unique_ptr<ALEInterface> every_frame;
+  {
+    test::ScopedConfig config("render_skipped_frames=true\n");
+    every_frame.reset(new ALEInterface(rom));
+  }
+  ALEInterface observed(rom);
+  ALEInterface headless(rom);
+  headless.setScreenRendering(false);
+
+  ALEInterface *envs[] = {every_frame.get(), &observed, &headless};
+  for (ALEInterface *env : envs) {
+    env->setRandomSeed(7);
+    env->setFrameSkip(frame_skip);
+    env->setMaxPoolFrames(max_pool);
+    env->resetGame();
+  }
+
+  ActionVect actions = observed.getLegalActionSet();
+  std::mt19937 rng(frame_skip);
+  for (int step = 0; step < 2400 / frame_skip; step++) {
+    Action action = actions[rng() % actions.size()];
+    reward_t reward = every_frame->act(action);
+    TEST_CHECK(observed.act(action) == reward);
+    TEST_CHECK(headless.act(action) == reward);
+
+    TEST_CHECK(observed.getScreen().equals(every_frame->getScreen()));
+    for (ALEInterface *env : {&observed, &headless}) {
+      TEST_CHECK(env->getRAM().equals(every_frame->getRAM()));
+      TEST_CHECK(env->stateHash() == every_frame->stateHash());
+      TEST_CHECK(env->gameOver() == every_frame->gameOver());
+      TEST_CHECK(env->getFrameNumber() == every_frame->getFrameNumber());
+    }
+
+    if (every_frame->gameOver()) {
+      for (ALEInterface *env : envs) env->resetGame();
+    }
+  }
+}
+
+// Ends episodes on every frame of an action repeat through the episode frame limit, and
+//  checks that the screens observed at the end are those drawing every frame shows
+void compareTerminalFrames(const std::string &rom, int frame_skip, bool max_pool) {
+  for (int last = 1; last <= frame_skip; last++) {
+    std::string limit = "max_num_frames_per_episode=" +
+                        std::to_string(50 * frame_skip + last) + "\n";
+    std::unique_ptr<ALEInterface> every_frame;
+    std::unique_ptr<ALEInterface> observed;
+    {
+      test::ScopedConfig config(limit + "render_skipped_frames=true\n");
+      every_frame.reset(new ALEInterface(rom));
+    }
+    {
+      test::ScopedConfig config(limit);
+      observed.reset(new ALEInterface(rom));
+    }
+
+    ScreenPreprocessing preprocessing;
+    preprocessing.max_pool = true;
+    for (ALEInterface *env : {every_frame.get(), observed.get()}) {
+      env->setRandomSeed(7);
+      env->setFrameSkip(frame_skip);
+      env->setMaxPoolFrames(max_pool);
+      env->setScreenPreprocessing(preprocessing);
+      env->resetGame();
+    }
+
+    ActionVect actions = observed->getLegalActionSet();
+    std::mt19937 rng(last);
+    while (!every_frame->gameOver()) {
+      Action action = actions[rng() % actions.size()];
+      TEST_CHECK(observed->act(action) == every_frame->act(action));
+    }
+
+    std::vector<uint8_t> expected(every_frame->preprocessedScreenSize());
+    std::vector<uint8_t> actual(observed->preprocessedScreenSize());
+    every_frame->getPreprocessedScreen(&expected[0]);
+    observed->getPreprocessedScreen(&actual[0]);
+    bool same = TEST_CHECK(observed->gameOver()) &&
+                TEST_CHECK(observed->getFrameNumber() == every_frame->getFrameNumber()) &&
+                TEST_CHECK(observed->stateHash() == every_frame->stateHash()) &&
+                TEST_CHECK(observed->getScreen().equals(every_frame->getScreen())) &&
+                TEST_CHECK(actual == expected);
+    if (!same)
+      fprintf(stderr, "frame skip %d, max pool %d: episode ending on frame %d of a step\n",
+              frame_skip, max_pool, last);
+  }
+}
+
+}  // namespace
+
+int main() {
+  test::TempDir dir;
+  // The game draws during vertical blank, so collisions latch on undrawn lines
+  std::string rom = dir.write("pong.bin", test::vblankGameRom());
+
+  for (int frame_skip : {1, 4}) {
+    compareRendering(rom, frame_skip, false);
+    compareRendering(rom, frame_skip, true);
+  }
+
+  // This kernel overruns its frame every other frame, leaving lines of the frame before
+  //  last on screen, which only drawing every frame reproduces. The F8 one draws whole frames
+  std::string full_frames_rom = dir.write("pong.bin", test::bankSwitchRom());
+  for (int frame_skip : {3, 4}) {
+    compareTerminalFrames(full_frames_rom, frame_skip, false);
+    compareTerminalFrames(full_frames_rom, frame_skip, true);
+  }
+  return test::finish("rendering_test");
+}
@@ -0,0 +1,93 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  rewind_test.cpp
+ *
+ *  Checks that rewinding, as far back as the history goes, returns the RAM,
+ *  state and screen seen at that frame.
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "test_support.hpp"
+
+#include <map>
+#include <random>
+
+using namespace ale;
+
+namespace {
+
+struct Observation {
+  uint64_t state_hash;
+  ALERAM ram;
+  std::vector<pixel_t> screen;
+};
+
+void testRewind(const std::string &rom, bool max_pool, int interval) {
+  ALEInterface ale(rom);
+  ale.setRandomSeed(5);
+  ale.setMaxPoolFrames(max_pool);
+  ale.setRewindBuffer(200, interval);
+  ale.resetGame();
+
+  // Record what each frame looked like, with one frame per step
+  std::map<int, Observation> observed;
+  ActionVect actions = ale.getMinimalActionSet();
+  std::mt19937 rng(interval);
+  for (int step = 0; step <= 500; step++) {
+    if (step > 0)
+      ale.act(actions[rng() % actions.size()]);
+    if (ale.gameOver()) break;
+
+    Observation &o = observed[ale.getFrameNumber()];
+    o.state_hash = ale.stateHash();
+    o.ram = ale.getRAM();
+    o.screen = ale.getScreen().getArray();
+  }
+
+  // The history holds at least the frames asked for
+  TEST_CHECK(ale.rewindableFrames() >= 200);
+  TEST_CHECK(!ale.rewind(ale.rewindableFrames() + 1));
+
+  for (int frames : {1, 7, 60, 0}) {
+    // 0 stands for as far back as possible
+    if (frames == 0) frames = ale.rewindableFrames();
+    if (!TEST_CHECK(ale.rewind(frames))) continue;
+
+    std::map<int, Observation>::const_iterator it = observed.find(ale.getFrameNumber());
+    if (!TEST_CHECK(it != observed.end())) continue;
+    TEST_CHECK(ale.stateHash() == it->second.state_hash);
+    TEST_CHECK(ale.getRAM().equals(it->second.ram));
+    TEST_CHECK(ale.getScreen().getArray() == it->second.screen);
+  }
+}
+
+}  // namespace
+
+int main() {
+  test::TempDir dir;
+  // The F8 program draws every line of each frame, so its screens only depend on the
+  //  frames replayed by rewind(); the kernel of gameRom() overruns its frame
+  std::string rom = dir.write("pong.bin", test::bankSwitchRom());
+
+  for (int interval : {1, 16, 60}) {
+    testRewind(rom, false, interval);
+    testRewind(rom, true, interval);
+  }
+  return test::finish("rewind_test");
+}
@@ -0,0 +1,139 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  rollout_test.cpp
+ *
+ *  Checks that rollout() and rolloutFrom() end where a loop of act() does, with
+ *  the same rewards, RAM and screen, including when the episode ends before the
+ *  last action.
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "test_support.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+const double DISCOUNT = 0.9;
+
+struct Config {
+  int frame_skip;
+  bool render;
+  bool max_pool;  // Observing the previous frame too
+};
+
+void setUp(ALEInterface &ale, const Config &config) {
+  ale.setRandomSeed(3);
+  ale.setFrameSkip(config.frame_skip);
+  ale.setMaxPoolFrames(config.max_pool);
+  ale.resetGame();
+}
+
+// What rollout() should give, by acting one action at a time
+RolloutResult actAll(ALEInterface &ale, const std::vector<Action> &actions) {
+  RolloutResult result = {0, 0.0, 0, 0, false};
+  double weight = 1.0;
+  int start = ale.getFrameNumber();
+  for (size_t i = 0; i < actions.size() && !ale.gameOver(); i++) {
+    reward_t reward = ale.act(actions[i]);
+    result.reward += reward;
+    result.discounted_reward += weight * reward;
+    result.steps++;
+    weight *= DISCOUNT;
+  }
+  result.frames = ale.getFrameNumber() - start;
+  result.terminal = ale.gameOver();
+  return result;
+}
+
+void compare(ALEInterface &rolled, ALEInterface &acted, const RolloutResult &result,
+             const RolloutResult &expected, bool render) {
+  TEST_CHECK(result.reward == expected.reward);
+  TEST_CHECK(result.discounted_reward == expected.discounted_reward);
+  TEST_CHECK(result.steps == expected.steps);
+  TEST_CHECK(result.frames == expected.frames);
+  TEST_CHECK(result.terminal == expected.terminal);
+  TEST_CHECK(rolled.stateHash() == acted.stateHash());
+  TEST_CHECK(rolled.getRAM().equals(acted.getRAM()));
+  TEST_CHECK(rolled.getFrameNumber() == acted.getFrameNumber());
+  TEST_CHECK(rolled.getEpisodeFrameNumber() == acted.getEpisodeFrameNumber());
+  TEST_CHECK(rolled.gameOver() == acted.gameOver());
+  if (render) TEST_CHECK(rolled.getScreen().equals(acted.getScreen()));
+}
+
+void testRollouts(const std::string &rom, const Config &config, int frame_limit) {
+  // Episodes short enough for rollouts to end on every kind of frame of a step
+  test::ScopedConfig settings("max_num_frames_per_episode=" + std::to_string(frame_limit) +
+                              "\n");
+  ALEInterface rolled(rom), acted(rom);
+  setUp(rolled, config);
+  setUp(acted, config);
+  ActionVect legal = rolled.getMinimalActionSet();
+  std::mt19937 rng(config.frame_skip * 4 + config.render * 2 + config.max_pool);
+
+  int terminals = 0;
+  for (int rollout = 0; rollout < 100; rollout++) {
+    std::vector<Action> actions(1 + rng() % 12);
+    for (Action &action : actions) action = legal[rng() % legal.size()];
+
+    RolloutResult result;
+    rolled.rollout(&actions[0], actions.size(), &result, DISCOUNT, config.render);
+    RolloutResult expected = actAll(acted, actions);
+    compare(rolled, acted, result, expected, config.render);
+
+    if (rolled.gameOver()) {
+      if (result.steps < static_cast<int>(actions.size())) terminals++;
+      rolled.resetGame();
+      acted.resetGame();
+    }
+  }
+  // Some of them stopped before their last action
+  TEST_CHECK(terminals > 0);
+
+  // From a snapshot, in another environment than the one it was taken in
+  std::vector<char> snapshot(acted.snapshotSize());
+  snapshot.resize(acted.serializeInto(&snapshot[0], snapshot.size()));
+  std::vector<Action> actions(30);
+  for (Action &action : actions) action = legal[rng() % legal.size()];
+  RolloutResult result;
+  rolled.rolloutFrom(&snapshot[0], snapshot.size(), &actions[0], actions.size(), &result,
+                     DISCOUNT, config.render);
+  RolloutResult expected = actAll(acted, actions);
+  compare(rolled, acted, result, expected, config.render);
+}
+
+}  // namespace
+
+int main() {
+  test::TempDir dir;
+  // The 4K game alternates short and overlong frames, so the rows one of them leaves
+  //  undrawn keep whatever was drawn there last, depending on which frames were drawn.
+  //  The F8 program draws the same lines every frame, and its screen changes every frame
+  std::string rom = dir.write("pong.bin", test::bankSwitchRom());
+  for (int frame_skip : {1, 4}) {
+    for (Config config : {Config{frame_skip, false, false}, Config{frame_skip, true, false},
+                          Config{frame_skip, true, true}})
+      testRollouts(rom, config, 151);
+  }
+  return test::finish("rollout_test");
+}
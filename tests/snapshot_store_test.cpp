@@ -0,0 +1,126 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  snapshot_store_test.cpp
+ *
+ *  Checks the on-disk snapshot store: reads, views, stores opened again or by
+ *  another instance, and recovery from damaged and partially written records.
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "test_support.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+std::vector<char> snapshotOf(uint64_t key, size_t size) {
+  std::vector<char> snapshot(size);
+  for (size_t i = 0; i < size; i++) snapshot[i] = static_cast<char>((key * 131 + i / 16) & 0xFF);
+  return snapshot;
+}
+
+bool holds(const SnapshotStore &store, uint64_t key, size_t size) {
+  std::vector<char> buffer(size);
+  return store.get(key, &buffer[0], buffer.size()) == size && buffer == snapshotOf(key, size);
+}
+
+std::string readFile(const std::string &path) {
+  std::ifstream in(path.c_str(), std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string &path, const std::string &data,
+               std::ios::openmode mode = std::ios::trunc) {
+  std::ofstream out(path.c_str(), std::ios::binary | mode);
+  out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+void testReads(bool compress) {
+  test::TempDir dir;
+  SnapshotStore store(dir.path(), compress);
+  for (uint64_t key = 1; key <= 20; key++)
+    TEST_CHECK(store.put(key, &snapshotOf(key, 500)[0], 500));
+  TEST_CHECK(!store.put(1, &snapshotOf(1, 500)[0], 500));
+  TEST_CHECK(store.size() == 20);
+  TEST_CHECK(store.snapshotSize(3) == 500 && store.snapshotSize(99) == 0);
+
+  for (uint64_t key = 1; key <= 20; key++) {
+    TEST_CHECK(holds(store, key, 500));
+
+    // Compressed records can only be read through get()
+    size_t size = 0;
+    const void *view = store.view(key, size);
+    if (compress)
+      TEST_CHECK(view == NULL);
+    else
+      TEST_CHECK(view != NULL && size == 500 &&
+                 std::vector<char>(static_cast<const char *>(view),
+                                   static_cast<const char *>(view) + size) == snapshotOf(key, 500));
+  }
+
+  // Another instance sees the records, and this one sees its additions after refresh()
+  SnapshotStore other(dir.path(), compress);
+  TEST_CHECK(other.size() == 20 && holds(other, 7, 500));
+  TEST_CHECK(other.put(21, &snapshotOf(21, 500)[0], 500));
+  TEST_CHECK(store.refresh() == 1 && holds(store, 21, 500));
+}
+
+void testDamagedRecords() {
+  test::TempDir dir;
+  {
+    SnapshotStore store(dir.path());
+    for (uint64_t key = 1; key <= 5; key++) store.put(key, &snapshotOf(key, 100)[0], 100);
+    store.sync();
+  }
+
+  // Records take 32 bytes of header and 104 of data; damage the header of the second
+  std::string segment = dir.path() + "/segment-000000.snap";
+  std::string data = readFile(segment);
+  TEST_CHECK(data.size() == 5 * 136);
+  std::string damaged = data;
+  damaged[136 + 8] ^= 0x5A;
+  writeFile(segment, damaged);
+  {
+    SnapshotStore store(dir.path());
+    TEST_CHECK(store.size() == 4);
+    TEST_CHECK(!store.contains(2));
+    for (uint64_t key : {1, 3, 4, 5}) TEST_CHECK(holds(store, key, 100));
+  }
+
+  // A record still being written is picked up once complete
+  writeFile(segment, data.substr(0, 4 * 136 + 50));
+  SnapshotStore store(dir.path());
+  TEST_CHECK(store.size() == 4 && !store.contains(5));
+  writeFile(segment, data.substr(4 * 136 + 50), std::ios::app);
+  TEST_CHECK(store.refresh() == 1);
+  TEST_CHECK(holds(store, 5, 100));
+}
+
+}  // namespace
+
+int main() {
+  testReads(false);
+  testReads(true);
+  testDamagedRecords();
+  return test::finish("snapshot_store_test");
+}
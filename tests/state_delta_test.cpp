@@ -0,0 +1,163 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  state_delta_test.cpp
+ *
+ *  Checks that state deltas and delta chains give back the snapshots they were
+ *  made from, across keyframes and truncations, and that snapshots holding
+ *  screens are rejected.
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "test_support.hpp"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+typedef std::vector<char> Snapshot;
+
+Snapshot snapshotOf(const ALEInterface &ale) {
+  Snapshot snapshot(ale.snapshotSize());
+  snapshot.resize(ale.serializeInto(&snapshot[0], snapshot.size()));
+  return snapshot;
+}
+
+// The snapshots along a random trajectory, one per step
+std::vector<Snapshot> trajectory(ALEInterface &ale, int steps, unsigned seed) {
+  ActionVect actions = ale.getMinimalActionSet();
+  std::mt19937 rng(seed);
+  std::vector<Snapshot> snapshots;
+  for (int i = 0; i < steps; i++) {
+    if (ale.gameOver()) ale.resetGame();
+    ale.act(actions[rng() % actions.size()]);
+    snapshots.push_back(snapshotOf(ale));
+  }
+  return snapshots;
+}
+
+bool rejects(DeltaChain &chain, const Snapshot &snapshot) {
+  try {
+    chain.push(&snapshot[0], snapshot.size());
+  } catch (const std::invalid_argument &) {
+    return true;
+  }
+  return false;
+}
+
+void testDeltas(ALEInterface &ale) {
+  std::vector<Snapshot> snapshots = trajectory(ale, 20, 1);
+  size_t size = snapshots[0].size();
+  for (size_t i = 1; i < snapshots.size(); i++) {
+    StateDelta delta(&snapshots[i - 1][0], &snapshots[i][0], size);
+    TEST_CHECK(delta.snapshotSize() == size && delta.encodedSize() < size);
+    Snapshot out(size);
+    delta.apply(&snapshots[i - 1][0], &out[0], size);
+    TEST_CHECK(out == snapshots[i]);
+
+    // In place, and backwards
+    out = snapshots[i];
+    StateDelta(&snapshots[i][0], &snapshots[i - 1][0], size).apply(&out[0], &out[0], size);
+    TEST_CHECK(out == snapshots[i - 1]);
+  }
+  TEST_CHECK(StateDelta(&snapshots[3][0], &snapshots[3][0], size).empty());
+}
+
+void testChain(ALEInterface &ale, size_t interval) {
+  std::vector<Snapshot> snapshots = trajectory(ale, 50, 2);
+  size_t size = snapshots[0].size();
+  DeltaChain chain(interval);
+  for (const Snapshot &snapshot : snapshots) chain.push(&snapshot[0], snapshot.size());
+  TEST_CHECK(chain.size() == snapshots.size() && chain.snapshotSize() == size);
+  if (interval > 1) TEST_CHECK(chain.encodedSize() < snapshots.size() * size);
+
+  // Every snapshot comes back, whether a keyframe or a delta, and restores the state
+  Snapshot out(size);
+  for (size_t i = 0; i < snapshots.size(); i++) {
+    chain.materialize(i, &out[0], size);
+    TEST_CHECK(out == snapshots[i]);
+  }
+  ale.restoreFrom(&out[0], size);
+  TEST_CHECK(snapshotOf(ale) == snapshots.back());
+
+  // After a truncation, the chain goes on from the last snapshot kept, as if it had
+  //  only been given those
+  chain.truncate(interval + 2);
+  TEST_CHECK(chain.size() == interval + 2);
+  ale.restoreFrom(&snapshots[interval + 1][0], size);
+  std::vector<Snapshot> more = trajectory(ale, 2 * interval + 3, 3);
+  std::vector<Snapshot> expected(snapshots.begin(), snapshots.begin() + interval + 2);
+  expected.insert(expected.end(), more.begin(), more.end());
+  for (const Snapshot &snapshot : more) chain.push(&snapshot[0], snapshot.size());
+  TEST_CHECK(chain.size() == expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    chain.materialize(i, &out[0], size);
+    TEST_CHECK(out == expected[i]);
+  }
+
+  bool thrown = false;
+  try {
+    chain.materialize(chain.size(), &out[0], size);
+  } catch (const std::out_of_range &) {
+    thrown = true;
+  }
+  TEST_CHECK(thrown);
+
+  Snapshot shorter(snapshots[0].begin(), snapshots[0].end() - 1);
+  TEST_CHECK(rejects(chain, shorter));
+  chain.clear();
+  TEST_CHECK(chain.size() == 0 && chain.snapshotSize() == 0);
+}
+
+void testScreens(ALEInterface &ale) {
+  // Snapshots with screens differ in size as the screens compress differently, so
+  //  chains and deltas refuse them, even the first one
+  ale.setSnapshotScreens(true);
+  std::vector<Snapshot> snapshots = trajectory(ale, 2, 4);
+  ale.setSnapshotScreens(false);
+  DeltaChain chain;
+  TEST_CHECK(rejects(chain, snapshots[0]));
+  TEST_CHECK(chain.size() == 0);
+
+  bool thrown = false;
+  snapshots[1].resize(snapshots[0].size());
+  try {
+    StateDelta(&snapshots[0][0], &snapshots[1][0], snapshots[0].size());
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  TEST_CHECK(thrown);
+}
+
+}  // namespace
+
+int main() {
+  test::TempDir dir;
+  ALEInterface ale(dir.write("pong.bin", test::gameRom()));
+  ale.setRandomSeed(5);
+  ale.resetGame();
+  testDeltas(ale);
+  for (size_t interval : {1, 4, 32}) testChain(ale, interval);
+  testScreens(ale);
+  return test::finish("state_delta_test");
+}
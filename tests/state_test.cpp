@@ -0,0 +1,222 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  state_test.cpp
+ *
+ *  Checks that the raw states of saveState() and the compact snapshots of
+ *  serializeInto() restore the emulator they were taken from, so that it
+ *  goes on exactly as it did the first time, and that corrupt snapshots are
+ *  rejected without changing it.
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+// What an emulator does over a number of steps from where it is
+struct Trajectory {
+  std::vector<unsigned long long> hashes;
+  std::vector<reward_t> rewards;
+  ALERAM ram;
+  int frame_number;
+  int episode_frame_number;
+};
+
+Trajectory play(ALEInterface &ale, const ActionVect &actions, unsigned seed) {
+  Trajectory trajectory;
+  std::mt19937 rng(seed);
+  for (int i = 0; i < 50 && !ale.gameOver(); i++) {
+    trajectory.rewards.push_back(ale.act(actions[rng() % actions.size()]));
+    trajectory.hashes.push_back(ale.stateHash());
+  }
+  trajectory.ram = ale.getRAM();
+  trajectory.frame_number = ale.getFrameNumber();
+  trajectory.episode_frame_number = ale.getEpisodeFrameNumber();
+  return trajectory;
+}
+
+bool same(const Trajectory &a, const Trajectory &b) {
+  return TEST_CHECK(a.hashes == b.hashes) && TEST_CHECK(a.rewards == b.rewards) &&
+         TEST_CHECK(a.ram.equals(b.ram)) && TEST_CHECK(a.frame_number == b.frame_number) &&
+         TEST_CHECK(a.episode_frame_number == b.episode_frame_number);
+}
+
+void testRestore(const std::string &rom, const std::string &cpu) {
+  test::ScopedConfig config("cpu=" + cpu + "\n");
+  ALEInterface ale(rom);
+  ale.setRandomSeed(3);
+  ale.resetGame();
+  ActionVect actions = ale.getMinimalActionSet();
+  play(ale, actions, 1);
+
+  // A saved state, and a snapshot of the same
+  TEST_CHECK(!ale.loadState());
+  ale.saveState();
+  std::vector<char> snapshot(ale.snapshotSize());
+  snapshot.resize(ale.serializeInto(&snapshot[0], snapshot.size()));
+  unsigned long long hash = ale.stateHash();
+  Trajectory first = play(ale, actions, 2);
+
+  // The saved state stays until the next save, and both replay what followed them
+  std::vector<char> restored(snapshot.size());
+  for (int i = 0; i < 2; i++) {
+    TEST_CHECK(ale.loadState());
+    TEST_CHECK(ale.stateHash() == hash);
+    TEST_CHECK(ale.serializeInto(&restored[0], restored.size()) == snapshot.size());
+    TEST_CHECK(restored == snapshot);
+    same(play(ale, actions, 2), first);
+  }
+  ale.restoreFrom(&snapshot[0], snapshot.size());
+  same(play(ale, actions, 2), first);
+
+  // Saving again replaces the state, in the memory of the previous one
+  ale.saveState();
+  Trajectory second = play(ale, actions, 3);
+  TEST_CHECK(ale.loadState());
+  same(play(ale, actions, 3), second);
+}
+
+// Whether restoring a corrupt snapshot throws, leaving the emulator as it was
+void checkRejected(ALEInterface &ale, const std::vector<char> &corrupt) {
+  std::vector<char> before(ale.snapshotSize()), after(ale.snapshotSize());
+  before.resize(ale.serializeInto(&before[0], before.size()));
+  unsigned long long hash = ale.stateHash();
+  bool thrown = false;
+  try {
+    ale.restoreFrom(&corrupt[0], corrupt.size());
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  if (!TEST_CHECK(thrown))
+    return;
+  TEST_CHECK(ale.stateHash() == hash);
+  after.resize(ale.serializeInto(&after[0], after.size()));
+  TEST_CHECK(after == before);
+}
+
+void testCorrupt(const std::string &rom) {
+  ALEInterface ale(rom);
+  ale.setRandomSeed(3);
+  ale.resetGame();
+  ActionVect actions = ale.getMinimalActionSet();
+  play(ale, actions, 1);
+  std::vector<char> snapshot(ale.snapshotSize());
+  snapshot.resize(ale.serializeInto(&snapshot[0], snapshot.size()));
+
+  // The RIOT's RAM comes after its length; one longer would overflow it. The CPU, TIA and
+  //  banks are restored before the RIOT, so there is something to roll back
+  ALERAM ram = ale.getRAM();
+  std::vector<char>::iterator found = std::search(
+      snapshot.begin(), snapshot.end(), ram.array(), ram.array() + ram.size(),
+      [](char a, byte_t b) { return static_cast<byte_t>(a) == b; });
+  if (TEST_CHECK(found - snapshot.begin() >= 4)) {
+    std::vector<char> corrupt(snapshot);
+    TEST_CHECK(corrupt[found - snapshot.begin() - 4] == static_cast<char>(ram.size()));
+    corrupt[found - snapshot.begin() - 4]++;
+    play(ale, actions, 2);
+    checkRejected(ale, corrupt);
+  }
+
+  // Whatever byte is damaged, a restore either succeeds or changes nothing
+  std::mt19937 rng(4);
+  for (int i = 0; i < 200; i++) {
+    std::vector<char> corrupt(snapshot);
+    corrupt[rng() % corrupt.size()] ^= static_cast<char>(1 + rng() % 255);
+    play(ale, actions, i);
+    std::vector<char> before(ale.snapshotSize());
+    before.resize(ale.serializeInto(&before[0], before.size()));
+    try {
+      ale.restoreFrom(&corrupt[0], corrupt.size());
+    } catch (const std::invalid_argument &) {
+      std::vector<char> after(ale.snapshotSize());
+      after.resize(ale.serializeInto(&after[0], after.size()));
+      TEST_CHECK(after == before);
+    }
+    ale.restoreFrom(&snapshot[0], snapshot.size());
+  }
+}
+
+// Snapshots with screens give back the screen along with the state, in this environment
+//  and in a fresh one, and corrupt screens are rejected before anything is restored
+void testScreens(const std::string &rom) {
+  ALEInterface ale(rom), other(rom);
+  for (ALEInterface *env : {&ale, &other}) {
+    env->setRandomSeed(3);
+    env->setSnapshotScreens(true);
+    env->resetGame();
+  }
+  ActionVect actions = ale.getMinimalActionSet();
+  play(ale, actions, 1);
+  std::vector<char> snapshot(ale.snapshotSize());
+  snapshot.resize(ale.serializeInto(&snapshot[0], snapshot.size()));
+  ALEScreen screen = ale.getScreen();
+  unsigned long long hash = ale.stateHash();
+  play(ale, actions, 2);
+  TEST_CHECK(!ale.getScreen().equals(screen));
+
+  for (ALEInterface *env : {&ale, &other}) {
+    env->restoreFrom(&snapshot[0], snapshot.size());
+    TEST_CHECK(env->stateHash() == hash);
+    TEST_CHECK(env->getScreen().equals(screen));
+    std::vector<char> again(env->snapshotSize());
+    again.resize(env->serializeInto(&again[0], again.size()));
+    TEST_CHECK(again == snapshot);
+  }
+
+  // A trailing byte, truncated screens and a damaged screens header, which follows the
+  //  emulator state
+  other.setSnapshotScreens(false);
+  std::vector<char> state(other.snapshotSize());
+  size_t screens_start = other.serializeInto(&state[0], state.size());
+  play(ale, actions, 2);
+  std::vector<char> trailing(snapshot);
+  trailing.push_back(0);
+  std::vector<char> truncated(snapshot.begin(), snapshot.end() - 1);
+  std::vector<char> damaged(snapshot);
+  damaged[screens_start] ^= 0x5A;
+  for (const std::vector<char> *corrupt : {&trailing, &truncated, &damaged}) {
+    ALEScreen before = ale.getScreen();
+    checkRejected(ale, *corrupt);
+    TEST_CHECK(ale.getScreen().equals(before));
+  }
+}
+
+}  // namespace
+
+int main() {
+  test::TempDir dir;
+  // The 4K game keeps no cartridge state; the F8 program's bank is part of it, and the
+  //  timer loops keep theirs in the RIOT
+  for (const std::vector<uint8_t> &rom : {test::gameRom(), test::bankSwitchRom(),
+                                          test::timerLoopRom((1 << test::TIMER_LOOP_COUNT) - 1)}) {
+    for (const char *cpu : {"low", "high", "fast"})
+      testRestore(dir.write("pong.bin", rom), cpu);
+    testCorrupt(dir.write("pong.bin", rom));
+  }
+  testScreens(dir.write("pong.bin", test::gameRom()));
+  return test::finish("state_test");
+}
@@ -0,0 +1,56 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  test_roms.cpp
+ *
+ *  Writes the synthetic 4K and F8 ROMs to a directory, for the build to
+ *  recompile them for recompiled_equivalence_test.
+ **************************************************************************** */
+
+#include "test_support.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+bool writeRom(const std::string &path, const std::vector<uint8_t> &rom) {
+  std::ofstream out(path.c_str(), std::ios::binary);
+  out.write(reinterpret_cast<const char *>(&rom[0]), static_cast<std::streamsize>(rom.size()));
+  if (!out) {
+    fprintf(stderr, "cannot write %s\n", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <directory>\n", argv[0]);
+    return 1;
+  }
+  std::string dir = argv[1];
+  return writeRom(dir + "/pong.bin", test::gameRom()) &&
+         writeRom(dir + "/freeway.bin", test::bankSwitchRom()) ? 0 : 1;
+}
@@ -0,0 +1,316 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  test_support.cpp
+ *
+ *  Synthetic ROMs, scratch directories and checks shared by the tests and
+ *  benchmarks.
+ **************************************************************************** */
+
+#include "test_support.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <random>
+#include <stdexcept>
+
+namespace ale {
+namespace test {
+
+namespace {
+
+const size_t BANK_SIZE = 4096;
+const uint16_t ORIGIN = 0xF000;
+
+// Code of the game (at $F000), as assembled for the 4K image
+const uint8_t GAME_CODE[] = {
+  0x78, 0xd8, 0xa2, 0xff, 0x9a, 0xa9, 0x00, 0x95, 0x00, 0xca, 0xd0, 0xfb, 0xa9, 0x28, 0x85, 0x80,
+  0xa9, 0x64, 0x85, 0x83, 0xa9, 0x3c, 0x85, 0x84, 0xa9, 0x14, 0x85, 0x85, 0xa9, 0x1e, 0x85, 0x06,
+  0xa9, 0x46, 0x85, 0x07, 0xa9, 0x84, 0x85, 0x08, 0xa9, 0x21, 0x85, 0x0a, 0xa9, 0x10, 0x85, 0x04,
+  0xa9, 0x02, 0x85, 0x02, 0x85, 0x00, 0x85, 0x02, 0x85, 0x02, 0x85, 0x02, 0xa9, 0x00, 0x85, 0x00,
+  0xa9, 0x2b, 0x8d, 0x96, 0x02, 0xe6, 0x81, 0xa5, 0x81, 0x4a, 0x85, 0x09, 0xad, 0x80, 0x02, 0xa8,
+  0x29, 0x80, 0xd0, 0x02, 0xe6, 0x80, 0x98, 0x29, 0x40, 0xd0, 0x02, 0xc6, 0x80, 0x98, 0x29, 0x10,
+  0xd0, 0x02, 0xc6, 0x83, 0x98, 0x29, 0x20, 0xd0, 0x02, 0xe6, 0x83, 0xa5, 0x80, 0xc9, 0x96, 0x90,
+  0x04, 0xa9, 0x00, 0x85, 0x80, 0xe6, 0x82, 0xa5, 0x82, 0xc9, 0x96, 0x90, 0x04, 0xa9, 0x00, 0x85,
+  0x82, 0xe6, 0x86, 0xe6, 0x86, 0xa5, 0x86, 0xc9, 0x98, 0x90, 0x04, 0xa9, 0x00, 0x85, 0x86, 0x24,
+  0x07, 0x10, 0x02, 0xe6, 0x8e, 0x24, 0x06, 0x10, 0x08, 0xa5, 0x81, 0x29, 0x0f, 0xd0, 0x02, 0xe6,
+  0x8d, 0x85, 0x2c, 0xa5, 0x80, 0xa2, 0x00, 0x20, 0x2d, 0xf1, 0xa5, 0x82, 0xa2, 0x01, 0x20, 0x2d,
+  0xf1, 0xa5, 0x86, 0xa2, 0x04, 0x20, 0x2d, 0xf1, 0xa5, 0x82, 0xa2, 0x02, 0x20, 0x2d, 0xf1, 0x85,
+  0x02, 0x85, 0x2a, 0xad, 0x84, 0x02, 0xd0, 0xfb, 0x85, 0x02, 0xa9, 0x00, 0x85, 0x01, 0xa0, 0xc0,
+  0x98, 0x38, 0xe5, 0x83, 0xc9, 0x0a, 0xb0, 0x04, 0xa9, 0x3c, 0xd0, 0x02, 0xa9, 0x00, 0x85, 0x90,
+  0x98, 0x38, 0xe5, 0x84, 0xc9, 0x0e, 0xb0, 0x04, 0xa9, 0x7e, 0xd0, 0x02, 0xa9, 0x00, 0x85, 0x02,
+  0x85, 0x1c, 0xa5, 0x90, 0x85, 0x1b, 0x98, 0x29, 0xf0, 0x85, 0x0e, 0x98, 0x38, 0xe5, 0x85, 0xc9,
+  0x04, 0xa9, 0x00, 0x2a, 0x49, 0x01, 0x0a, 0x85, 0x1f, 0x85, 0x1d, 0x98, 0x45, 0x81, 0x85, 0x0f,
+  0x88, 0xd0, 0xbd, 0x85, 0x02, 0xa9, 0x02, 0x85, 0x01, 0xa9, 0x00, 0x85, 0x1b, 0x85, 0x1c, 0x85,
+  0x1f, 0x85, 0x1d, 0xa2, 0x1e, 0x85, 0x02, 0xca, 0xd0, 0xfb, 0x4c, 0x30, 0xf0, 0x85, 0x02, 0x38,
+  0xe9, 0x0f, 0xb0, 0xfc, 0x49, 0x07, 0x0a, 0x0a, 0x0a, 0x0a, 0x95, 0x20, 0x95, 0x10, 0x60
+};
+
+// The game drawing the ball and playfield during vertical blank too
+const uint8_t VBLANK_GAME_CODE[] = {
+  0x78, 0xd8, 0xa2, 0xff, 0x9a, 0xa9, 0x00, 0x95, 0x00, 0xca, 0xd0, 0xfb, 0xa9, 0x28, 0x85, 0x80,
+  0xa9, 0x64, 0x85, 0x83, 0xa9, 0x3c, 0x85, 0x84, 0xa9, 0x14, 0x85, 0x85, 0xa9, 0x1e, 0x85, 0x06,
+  0xa9, 0x46, 0x85, 0x07, 0xa9, 0x84, 0x85, 0x08, 0xa9, 0x21, 0x85, 0x0a, 0xa9, 0x10, 0x85, 0x04,
+  0xa9, 0x02, 0x85, 0x02, 0x85, 0x00, 0x85, 0x02, 0x85, 0x02, 0x85, 0x02, 0xa9, 0x00, 0x85, 0x00,
+  0xa9, 0x2b, 0x8d, 0x96, 0x02, 0xe6, 0x81, 0xa5, 0x81, 0x4a, 0x85, 0x09, 0xad, 0x80, 0x02, 0xa8,
+  0x29, 0x80, 0xd0, 0x02, 0xe6, 0x80, 0x98, 0x29, 0x40, 0xd0, 0x02, 0xc6, 0x80, 0x98, 0x29, 0x10,
+  0xd0, 0x02, 0xc6, 0x83, 0x98, 0x29, 0x20, 0xd0, 0x02, 0xe6, 0x83, 0xa5, 0x80, 0xc9, 0x96, 0x90,
+  0x04, 0xa9, 0x00, 0x85, 0x80, 0xe6, 0x82, 0xa5, 0x82, 0xc9, 0x96, 0x90, 0x04, 0xa9, 0x00, 0x85,
+  0x82, 0xe6, 0x86, 0xe6, 0x86, 0xa5, 0x86, 0xc9, 0x98, 0x90, 0x04, 0xa9, 0x00, 0x85, 0x86, 0x24,
+  0x07, 0x10, 0x02, 0xe6, 0x8e, 0x24, 0x06, 0x10, 0x08, 0xa5, 0x81, 0x29, 0x0f, 0xd0, 0x02, 0xe6,
+  0x8d, 0x85, 0x2c, 0xa5, 0x80, 0xa2, 0x00, 0x20, 0x35, 0xf1, 0xa5, 0x82, 0xa2, 0x01, 0x20, 0x35,
+  0xf1, 0xa5, 0x86, 0xa2, 0x04, 0x20, 0x35, 0xf1, 0xa5, 0x82, 0xa2, 0x02, 0x20, 0x35, 0xf1, 0x85,
+  0x02, 0x85, 0x2a, 0xad, 0x84, 0x02, 0xd0, 0xfb, 0x85, 0x02, 0xa9, 0x00, 0x85, 0x1f, 0x85, 0x0f,
+  0x85, 0x01, 0xa0, 0xc0, 0x98, 0x38, 0xe5, 0x83, 0xc9, 0x0a, 0xb0, 0x04, 0xa9, 0x3c, 0xd0, 0x02,
+  0xa9, 0x00, 0x85, 0x90, 0x98, 0x38, 0xe5, 0x84, 0xc9, 0x0e, 0xb0, 0x04, 0xa9, 0x7e, 0xd0, 0x02,
+  0xa9, 0x00, 0x85, 0x02, 0x85, 0x1c, 0xa5, 0x90, 0x85, 0x1b, 0x98, 0x29, 0xf0, 0x85, 0x0e, 0x98,
+  0x38, 0xe5, 0x85, 0xc9, 0x04, 0xa9, 0x00, 0x2a, 0x49, 0x01, 0x0a, 0x85, 0x1f, 0x85, 0x1d, 0x98,
+  0x45, 0x81, 0x85, 0x0f, 0x88, 0xd0, 0xbd, 0x85, 0x02, 0xa9, 0x02, 0x85, 0x01, 0x85, 0x1f, 0xa9,
+  0xff, 0x85, 0x0f, 0xa9, 0x00, 0x85, 0x1b, 0x85, 0x1c, 0x85, 0x1d, 0xa2, 0x1e, 0x85, 0x02, 0xca,
+  0xd0, 0xfb, 0x4c, 0x30, 0xf0, 0x85, 0x02, 0x38, 0xe9, 0x0f, 0xb0, 0xfc, 0x49, 0x07, 0x0a, 0x0a,
+  0x0a, 0x0a, 0x95, 0x20, 0x95, 0x10, 0x60
+};
+
+// Assembles a program at $F000 byte by byte
+class Assembler {
+  public:
+    uint16_t here() const { return static_cast<uint16_t>(ORIGIN + m_code.size()); }
+
+    void emit(std::initializer_list<int> bytes) {
+      for (int b : bytes) m_code.push_back(static_cast<uint8_t>(b));
+    }
+
+    void branch(int opcode, uint16_t target) {
+      emit({opcode, (target - (here() + 2)) & 0xFF});
+    }
+
+    void jump(uint16_t target) { emit({0x4C, target & 0xFF, target >> 8}); }
+
+    const std::vector<uint8_t> &code() const { return m_code; }
+
+  private:
+    std::vector<uint8_t> m_code;
+};
+
+// Lays out a 4K bank holding 'code' at $F000, with both vectors pointing at it
+std::vector<uint8_t> bank(const uint8_t *code, size_t size, uint8_t filler) {
+  std::vector<uint8_t> image(BANK_SIZE, filler);
+  std::copy(code, code + size, image.begin());
+  image[0xFFC] = image[0xFFE] = ORIGIN & 0xFF;
+  image[0xFFD] = image[0xFFF] = ORIGIN >> 8;
+  return image;
+}
+
+// Starts a frame with three lines of VSYNC, blanked
+void startFrame(Assembler &a) {
+  a.emit({0xA9, 0x02, 0x85, 0x01, 0x85, 0x00,  // LDA #2; STA VBLANK; STA VSYNC
+          0x85, 0x02, 0x85, 0x02, 0x85, 0x02,  // STA WSYNC (x3)
+          0xA9, 0x00, 0x85, 0x00});            // LDA #0; STA VSYNC
+}
+
+// Sets up the stack and clears the RAM and TIA
+void clearMemory(Assembler &a) {
+  a.emit({0x78, 0xD8, 0xA2, 0xFF, 0x9A,        // SEI; CLD; LDX #$FF; TXS
+          0xA9, 0x00});                        // LDA #0
+  uint16_t clear = a.here();
+  a.emit({0x95, 0x00, 0xCA});                  // STA 0,X; DEX
+  a.branch(0xD0, clear);                       // BNE
+}
+
+// The F8 program, as mapped in bank 0 or 1
+std::vector<uint8_t> bankSwitchProgram(int bank) {
+  Assembler a;
+  clearMemory(a);
+  uint16_t frame = a.here();
+  startFrame(a);
+  a.emit({0xA9, 43, 0x8D, 0x96, 0x02,          // LDA #43; STA TIM64T
+          0xE6, 0x80,                          // INC $80
+          0xAD, 0x80, 0x02, 0x85, 0x81,        // LDA SWCHA; STA $81
+          0xA5, 0x0C, 0x30, 0x02, 0xE6, 0x82}); // LDA INPT4; BMI +2; INC $82
+  uint16_t wait = a.here();
+  a.emit({0xAD, 0x84, 0x02});                  // LDA INTIM
+  a.branch(0xD0, wait);                        // BNE
+  a.emit({0x85, 0x02, 0xA9, 0x00, 0x85, 0x01,  // STA WSYNC; LDA #0; STA VBLANK
+          0xA0, 192});                         // LDY #192
+  // Each bank draws a line with its own registers, then hands over to the other one
+  uint16_t line = a.here();
+  if (bank == 0) {
+    a.emit({0x85, 0x02, 0x98, 0x45, 0x80,      // STA WSYNC; TYA; EOR $80
+            0x85, 0x09, 0xA5, 0x81, 0x85, 0x0E, // STA COLUBK; LDA $81; STA PF1
+            0xAD, 0xF9, 0xFF});                // LDA $FFF9 (bank 1)
+  } else {
+    a.emit({0x85, 0x02, 0x98, 0x45, 0x82,      // STA WSYNC; TYA; EOR $82
+            0x85, 0x08, 0xA5, 0x80, 0x85, 0x0F, // STA COLUPF; LDA $80; STA PF2
+            0xAD, 0xF8, 0xFF});                // LDA $FFF8 (bank 0)
+  }
+  a.emit({0x88});                              // DEY
+  a.branch(0xD0, line);                        // BNE
+  a.emit({0xA9, 0x02, 0x85, 0x01, 0xA2, 30});  // LDA #2; STA VBLANK; LDX #30
+  uint16_t overscan = a.here();
+  a.emit({0x85, 0x02, 0xCA});                  // STA WSYNC; DEX
+  a.branch(0xD0, overscan);                    // BNE
+  a.jump(frame);
+  return a.code();
+}
+
+}  // namespace
+
+std::vector<uint8_t> gameRom() {
+  return bank(GAME_CODE, sizeof(GAME_CODE), 0xFF);
+}
+
+std::vector<uint8_t> vblankGameRom() {
+  return bank(VBLANK_GAME_CODE, sizeof(VBLANK_GAME_CODE), 0xFF);
+}
+
+std::vector<uint8_t> timerLoopRom(int loops) {
+  Assembler a;
+  a.emit({0x78, 0xD8, 0xA2, 0xFF, 0x9A});      // SEI; CLD; LDX #$FF; TXS
+  uint16_t frame = a.here();
+  a.emit({0xA9, 0x02, 0x85, 0x00, 0x85, 0x02, 0x85, 0x02, 0x85, 0x02,
+          0xA9, 0x00, 0x85, 0x00});            // VSYNC
+  a.emit({0xA9, 43, 0x8D, 0x96, 0x02});        // LDA #43; STA TIM64T
+  uint16_t wait = a.here();
+  if (loops & 1) {
+    a.emit({0xAD, 0x84, 0x02});                // LDA INTIM
+    a.branch(0xD0, wait);                      // BNE
+  }
+  a.emit({0xE6, 0x80,                          // INC $80
+          0xA9, 3, 0x8D, 0x97, 0x02});         // LDA #3; STA T1024T
+  wait = a.here();
+  if (loops & 2) {
+    a.emit({0x2C, 0x85, 0x02});                // BIT TIMINT
+    a.branch(0x10, wait);                      // BPL
+  }
+  a.emit({0xE6, 0x81,                          // INC $81
+          0xA9, 100, 0x8D, 0x95, 0x02});       // LDA #100; STA TIM8T
+  wait = a.here();
+  if (loops & 4) {
+    a.emit({0xAE, 0x84, 0x02, 0xE0, 3});       // LDX INTIM; CPX #3
+    a.branch(0xB0, wait);                      // BCS
+  }
+  a.emit({0x86, 0x82,                          // STX $82
+          0xA5, 0x80, 0x85, 0x09,              // LDA $80; STA COLUBK
+          0xA9, 60, 0x8D, 0x96, 0x02});        // LDA #60; STA TIM64T
+  wait = a.here();
+  if (loops & 8) {
+    a.emit({0xAD, 0x84, 0x02, 0x29, 0xF0, 0xAA}); // LDA INTIM; AND #$F0; TAX
+    a.branch(0xD0, wait);                      // BNE
+  }
+  a.emit({0xA9, 2, 0x8D, 0x94, 0x02});         // LDA #2; STA TIM1T
+  wait = a.here();
+  if (loops & 16) {
+    a.emit({0xAD, 0x84, 0x02});                // LDA INTIM
+    a.branch(0x10, wait);                      // BPL
+  }
+  a.emit({0x85, 0x83});                        // STA $83
+  wait = a.here();
+  if (loops & 32) {
+    a.emit({0xA5, 0x0C});                      // LDA INPT4
+    a.branch(0x10, wait);                      // BPL, while fire is pressed
+  }
+  a.emit({0xE6, 0x84});                        // INC $84
+  a.jump(frame);
+  return bank(&a.code()[0], a.code().size(), 0xEA);
+}
+
+std::vector<uint8_t> bankSwitchRom() {
+  std::vector<uint8_t> image;
+  for (int b = 0; b < 2; b++) {
+    std::vector<uint8_t> program = bankSwitchProgram(b);
+    std::vector<uint8_t> mapped = bank(&program[0], program.size(), 0xEA);
+    image.insert(image.end(), mapped.begin(), mapped.end());
+  }
+  return image;
+}
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+TempDir::TempDir() {
+  std::random_device device;
+  std::filesystem::path base = std::filesystem::temp_directory_path();
+  for (int attempt = 0; attempt < 100; attempt++) {
+    char name[32];
+    snprintf(name, sizeof(name), "xitari-test-%08x", device());
+    std::filesystem::path path = base / name;
+    if (std::filesystem::create_directory(path)) {
+      m_path = path.string();
+      return;
+    }
+  }
+  throw std::runtime_error("cannot create a temporary directory");
+}
+
+TempDir::~TempDir() {
+  std::error_code error;
+  std::filesystem::remove_all(m_path, error);
+}
+
+std::string TempDir::write(const std::string &name, const std::vector<uint8_t> &data) const {
+  return write(name, std::string(data.begin(), data.end()));
+}
+
+std::string TempDir::write(const std::string &name, const std::string &data) const {
+  std::string path = (std::filesystem::path(m_path) / name).string();
+  std::ofstream out(path.c_str(), std::ios::binary);
+  out.write(data.data(), static_cast<std::streamsize>(data.size()));
+  if (!out) throw std::runtime_error("cannot write " + path);
+  return path;
+}
+
+ScopedConfig::ScopedConfig(const std::string &settings):
+  m_previous(std::filesystem::current_path().string()) {
+
+  m_dir.write("stellarc", settings);
+  std::filesystem::current_path(m_dir.path());
+}
+
+ScopedConfig::~ScopedConfig() {
+  std::filesystem::current_path(m_previous);
+}
+
+namespace {
+int failures = 0;
+int checks = 0;
+}
+
+bool check(bool ok, const char *expression, const char *file, int line) {
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures <= 20) fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+  }
+  return ok;
+}
+
+int finish(const char *test_name) {
+  printf("%s: %d checks, %d failures\n", test_name, checks, failures);
+  return failures == 0 ? 0 : 1;
+}
+
+}  // namespace test
+}  // namespace ale
@@ -0,0 +1,107 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  test_support.hpp
+ *
+ *  Synthetic ROMs, scratch directories and checks shared by the tests and
+ *  benchmarks. The ROMs are small programs assembled here, so that the tests
+ *  do not depend on commercial images.
+ **************************************************************************** */
+
+#ifndef __TEST_SUPPORT_HPP__
+#define __TEST_SUPPORT_HPP__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ale {
+namespace test {
+
+/** A 4K game in the style of Pong: two paddles moved by the joystick and a ball, drawn
+  *  by a kernel that updates the playfield, players and ball on every line. */
+std::vector<uint8_t> gameRom();
+
+/** The same game, also drawing the ball and playfield during vertical blank, where
+  *  nothing is displayed but collisions are still latched. */
+std::vector<uint8_t> vblankGameRom();
+
+/** Number of timer wait loops timerLoopRom() can include. */
+const int TIMER_LOOP_COUNT = 6;
+
+/** A 4K program waiting on the RIOT timer and the fire button in as many differently
+  *  shaped busy loops, each included when its bit is set in 'loops': LDA INTIM / BNE,
+  *  BIT TIMINT / BPL, LDX INTIM / CPX / BCS, LDA INTIM / AND / TAX / BNE, LDA INTIM /
+  *  BPL reading past the expiry of TIM1T, and LDA INPT4 / BPL. */
+std::vector<uint8_t> timerLoopRom(int loops);
+
+/** An 8K F8 program whose kernel switches banks on every line, both banks mapping the
+  *  same code with different colour registers. */
+std::vector<uint8_t> bankSwitchRom();
+
+/** 64-bit FNV-1a hash of 'size' bytes, continuing from 'hash'. */
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+/** A scratch directory, removed with its contents on destruction. */
+class TempDir {
+  public:
+    TempDir();
+    ~TempDir();
+
+    const std::string &path() const { return m_path; }
+
+    /** Writes 'data' to the file 'name' in the directory and returns its path. ROMs
+      *  are matched to their game by file name, e.g. "pong.bin". */
+    std::string write(const std::string &name, const std::vector<uint8_t> &data) const;
+    std::string write(const std::string &name, const std::string &data) const;
+
+  private:
+    TempDir(const TempDir &);
+    TempDir &operator=(const TempDir &);
+
+    std::string m_path;
+};
+
+/** Runs in a scratch working directory holding a stellarc with the given settings
+  *  (one "key=value" per line), which emulators created in the scope load. The
+  *  previous working directory is restored on destruction. */
+class ScopedConfig {
+  public:
+    explicit ScopedConfig(const std::string &settings);
+    ~ScopedConfig();
+
+  private:
+    ScopedConfig(const ScopedConfig &);
+    ScopedConfig &operator=(const ScopedConfig &);
+
+    TempDir m_dir;
+    std::string m_previous;
+};
+
+/** Records a failed check; returns 'ok'. */
+bool check(bool ok, const char *expression, const char *file, int line);
+
+/** Prints a summary and returns the exit status of the test. */
+int finish(const char *test_name);
+
+}  // namespace test
+}  // namespace ale
+
+#define TEST_CHECK(expression) ale::test::check((expression), #expression, __FILE__, __LINE__)
+
+#endif // __TEST_SUPPORT_HPP__
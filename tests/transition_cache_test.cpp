@@ -0,0 +1,215 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  transition_cache_test.cpp
+ *
+ *  Checks the transition cache: storage and eviction, lookups that never see
+ *  torn entries while other threads insert, and environments replaying cached
+ *  steps exactly.
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "test_support.hpp"
+
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+const size_t SNAPSHOT_SIZE = 443; // Not a multiple of the word size
+
+// Fills a snapshot whose bytes all derive from the key and version, so a mix of two
+// insertions can be told apart
+void fill(std::vector<unsigned char> &snapshot, uint64_t key, int version) {
+  for (size_t i = 0; i < snapshot.size(); i++)
+    snapshot[i] = static_cast<unsigned char>(key * 31 + version * 7 + i);
+}
+
+bool consistent(const std::vector<unsigned char> &snapshot, uint64_t key,
+                const TransitionCache::Transition &transition) {
+  std::vector<unsigned char> expected(snapshot.size());
+  fill(expected, key, transition.frames);
+  return snapshot == expected && transition.reward == transition.frames * 3 &&
+         transition.terminal == (transition.frames % 2 == 1);
+}
+
+// The second hash stored with each key; any function of the key will do here
+uint64_t checkOf(uint64_t key) { return ~key; }
+
+// Keys spread over the shards and sets, as hashes are
+uint64_t keyOf(uint64_t i) { return i * 0x9E3779B97F4A7C15ULL; }
+
+TransitionCache::Transition outcome(int version) {
+  TransitionCache::Transition transition;
+  transition.frames = version;
+  transition.reward = version * 3;
+  transition.terminal = version % 2 == 1;
+  return transition;
+}
+
+void testStorage() {
+  TransitionCache cache(100, 4);
+  TEST_CHECK(cache.capacity() >= 100);
+  TEST_CHECK(cache.size() == 0);
+
+  std::vector<unsigned char> in(SNAPSHOT_SIZE), out(SNAPSHOT_SIZE);
+  TransitionCache::Transition transition;
+  TEST_CHECK(!cache.lookup(42, checkOf(42), &out[0], out.size(), transition));
+
+  fill(in, 42, 1);
+  cache.insert(42, checkOf(42), &in[0], in.size(), outcome(1));
+  TEST_CHECK(cache.lookup(42, checkOf(42), &out[0], out.size(), transition));
+  TEST_CHECK(consistent(out, 42, transition) && transition.frames == 1);
+
+  // Another source whose key collides is told apart by the check
+  TEST_CHECK(!cache.lookup(42, checkOf(43), &out[0], out.size(), transition));
+
+  // Replacing keeps a single entry
+  fill(in, 42, 2);
+  cache.insert(42, checkOf(42), &in[0], in.size(), outcome(2));
+  TEST_CHECK(cache.lookup(42, checkOf(42), &out[0], out.size(), transition));
+  TEST_CHECK(consistent(out, 42, transition) && transition.frames == 2);
+  TEST_CHECK(cache.size() == 1);
+
+  bool thrown = false;
+  try {
+    cache.insert(43, checkOf(43), &in[0], in.size() - 1, outcome(1));
+  } catch (std::invalid_argument &) {
+    thrown = true;
+  }
+  TEST_CHECK(thrown);
+
+  // Filling past the capacity evicts, and whatever is found is intact
+  for (uint64_t i = 0; i < 1000; i++) {
+    fill(in, keyOf(i), 4);
+    cache.insert(keyOf(i), checkOf(keyOf(i)), &in[0], in.size(), outcome(4));
+  }
+  TEST_CHECK(cache.size() <= cache.capacity());
+  size_t found = 0;
+  for (uint64_t i = 0; i < 1000; i++) {
+    if (cache.lookup(keyOf(i), checkOf(keyOf(i)), &out[0], out.size(), transition)) {
+      found++;
+      TEST_CHECK(consistent(out, keyOf(i), transition));
+    }
+  }
+  TEST_CHECK(found == cache.size());
+
+  cache.clear();
+  TEST_CHECK(cache.size() == 0);
+  TEST_CHECK(!cache.lookup(42, checkOf(42), &out[0], out.size(), transition));
+}
+
+// Readers check every entry they find while a writer keeps overwriting the same keys
+void testConcurrentLookups() {
+  const uint64_t keys = 64;
+  const int readers_count = 3;
+  // Room for all the keys, so that each one stays once written
+  TransitionCache cache(keys * 4, 2);
+  std::atomic<int> ready(0);
+  std::atomic<bool> done(false);
+
+  std::thread writer([&]() {
+    // Only start once the readers are looking, so that they race the insertions
+    while (ready < readers_count) std::this_thread::yield();
+    std::vector<unsigned char> snapshot(SNAPSHOT_SIZE);
+    for (int version = 0; version < 20000; version++) {
+      uint64_t key = keyOf(version % keys);
+      fill(snapshot, key, version);
+      cache.insert(key, checkOf(key), &snapshot[0], snapshot.size(), outcome(version));
+    }
+    done = true;
+  });
+
+  std::atomic<int> torn(0), found_after(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < readers_count; r++) {
+    readers.push_back(std::thread([&, r]() {
+      std::vector<unsigned char> snapshot(SNAPSHOT_SIZE);
+      TransitionCache::Transition transition;
+      std::mt19937 rng(r);
+      ready++;
+      // A fixed number of lookups once the writer is done, which all find their key
+      for (int after = 0; after < 1000;) {
+        bool finished = done;
+        uint64_t key = keyOf(rng() % keys);
+        if (cache.lookup(key, checkOf(key), &snapshot[0], snapshot.size(), transition)) {
+          if (!consistent(snapshot, key, transition)) torn++;
+          if (finished) found_after++;
+        }
+        if (finished) after++;
+      }
+    }));
+  }
+
+  writer.join();
+  for (size_t r = 0; r < readers.size(); r++) readers[r].join();
+  TEST_CHECK(torn == 0);
+  TEST_CHECK(found_after == readers_count * 1000);
+  TEST_CHECK(cache.size() == keys);
+}
+
+// Environments sharing a cache step as emulated ones
+void testCachedSteps(const std::string &rom) {
+  TransitionCache cache(1 << 12);
+  ALEInterface plain(rom), first(rom), second(rom);
+  ALEInterface *envs[] = {&plain, &first, &second};
+  for (ALEInterface *env : envs) {
+    env->setRandomSeed(3);
+    env->setScreenRendering(false);
+    env->setFrameSkip(2);
+    env->resetGame();
+  }
+  first.setTransitionCache(&cache);
+  second.setTransitionCache(&cache);
+
+  ActionVect actions = plain.getMinimalActionSet();
+  for (int pass = 0; pass < 2; pass++) {
+    std::mt19937 rng(11);
+    for (int step = 0; step < 600; step++) {
+      Action action = actions[rng() % actions.size()];
+      reward_t reward = plain.act(action);
+      // The second environment replays the steps the first one cached
+      for (ALEInterface *env : {&first, &second}) {
+        TEST_CHECK(env->act(action) == reward);
+        TEST_CHECK(env->stateHash() == plain.stateHash());
+        TEST_CHECK(env->getRAM().equals(plain.getRAM()));
+        TEST_CHECK(env->gameOver() == plain.gameOver());
+        TEST_CHECK(env->getFrameNumber() == plain.getFrameNumber());
+      }
+    }
+    for (ALEInterface *env : envs) env->resetGame();
+  }
+  TEST_CHECK(cache.hits() > 0);
+}
+
+}  // namespace
+
+int main() {
+  test::TempDir dir;
+  std::string rom = dir.write("pong.bin", test::gameRom());
+
+  testStorage();
+  testConcurrentLookups();
+  testCachedSteps(rom);
+  return test::finish("transition_cache_test");
+}
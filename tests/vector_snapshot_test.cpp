@@ -0,0 +1,201 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  vector_snapshot_test.cpp
+ *
+ *  Checks that VectorALE's snapshotAll(), restoreAll(), broadcast() and
+ *  broadcastFrom() save and restore what serializeInto() and restoreFrom() do
+ *  for each environment on its own, and that the environments go on as they
+ *  did from the states saved.
+ **************************************************************************** */
+
+#include "ale_interface.hpp"
+#include "test_support.hpp"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+const size_t NUM_ENVS = 6;
+
+typedef std::vector<char> Snapshot;
+
+Snapshot snapshotOf(const ALEInterface &ale) {
+  Snapshot snapshot(ale.snapshotSize());
+  snapshot.resize(ale.serializeInto(&snapshot[0], snapshot.size()));
+  return snapshot;
+}
+
+// Where an environment is, and what it shows
+struct Observed {
+  Snapshot snapshot;
+  ALERAM ram;
+  ALEScreen screen;
+  int frame_number;
+  int episode_frame_number;
+  bool game_over;
+
+  explicit Observed(const ALEInterface &ale)
+      : snapshot(snapshotOf(ale)), ram(ale.getRAM()), screen(ale.getScreen()),
+        frame_number(ale.getFrameNumber()), episode_frame_number(ale.getEpisodeFrameNumber()),
+        game_over(ale.gameOver()) {}
+};
+
+// Snapshots without screens leave the screen of the environment restored as it was
+bool same(const Observed &a, const Observed &b, bool screens = true) {
+  return TEST_CHECK(a.snapshot == b.snapshot) && TEST_CHECK(a.ram.equals(b.ram)) &&
+         TEST_CHECK(!screens || a.screen.equals(b.screen)) &&
+         TEST_CHECK(a.frame_number == b.frame_number) &&
+         TEST_CHECK(a.episode_frame_number == b.episode_frame_number) &&
+         TEST_CHECK(a.game_over == b.game_over);
+}
+
+// Steps every environment with its own random actions; environment i of two batches
+//  given the same seed takes the same actions
+void play(VectorALE &batch, int steps, unsigned seed, std::vector<reward_t> *rewards = NULL) {
+  ActionVect legal = batch.environment(0).getMinimalActionSet();
+  std::mt19937 rng(seed);
+  std::vector<Action> actions(NUM_ENVS);
+  std::vector<reward_t> step_rewards(NUM_ENVS);
+  for (int t = 0; t < steps; t++) {
+    for (Action &action : actions) action = legal[rng() % legal.size()];
+    batch.step(&actions[0], &step_rewards[0], NULL, NULL, NULL);
+    if (rewards) rewards->insert(rewards->end(), step_rewards.begin(), step_rewards.end());
+  }
+}
+
+std::vector<Observed> observe(const VectorALE &batch) {
+  std::vector<Observed> observed;
+  for (size_t i = 0; i < NUM_ENVS; i++) observed.push_back(Observed(batch.environment(i)));
+  return observed;
+}
+
+void setUp(VectorALE &batch, bool screens) {
+  batch.setAutoReset(true);
+  for (size_t i = 0; i < NUM_ENVS; i++) {
+    batch.environment(i).setFrameSkip(3);
+    batch.environment(i).setSnapshotScreens(screens);
+  }
+  batch.setRandomSeed(11);
+  batch.resetAll();
+}
+
+void testSnapshots(const std::string &rom, bool screens) {
+  // Episodes end, and the environments are reset, after the snapshots are taken
+  test::ScopedConfig settings("max_num_frames_per_episode=150\n");
+  VectorALE batch(rom, NUM_ENVS, 3);
+  setUp(batch, screens);
+  play(batch, 40, 1);
+
+  // The arena holds each environment's own snapshot, end to end
+  std::vector<Observed> saved = observe(batch);
+  std::vector<char> arena(batch.snapshotArenaSize());
+  std::vector<size_t> offsets(NUM_ENVS + 1);
+  size_t total = batch.snapshotAll(&arena[0], arena.size(), &offsets[0]);
+  TEST_CHECK(offsets[0] == 0 && offsets[NUM_ENVS] == total && total <= arena.size());
+  for (size_t i = 0; i < NUM_ENVS; i++) {
+    Snapshot snapshot(arena.begin() + offsets[i], arena.begin() + offsets[i + 1]);
+    TEST_CHECK(snapshot == saved[i].snapshot);
+  }
+
+  bool thrown = false;
+  try {
+    batch.snapshotAll(&arena[0], total - 1, &offsets[0]);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  TEST_CHECK(thrown);
+  batch.snapshotAll(&arena[0], arena.size(), &offsets[0]);
+
+  // Restoring them all brings back every environment, which then goes on as the first
+  //  time
+  std::vector<reward_t> first_rewards, rewards;
+  play(batch, 60, 2, &first_rewards);
+  std::vector<Observed> first = observe(batch);
+  TEST_CHECK(first[0].frame_number > first[0].episode_frame_number);
+  batch.restoreAll(&arena[0], &offsets[0]);
+  std::vector<Observed> restored = observe(batch);
+  for (size_t i = 0; i < NUM_ENVS; i++) same(restored[i], saved[i], screens);
+  play(batch, 60, 2, &rewards);
+  TEST_CHECK(rewards == first_rewards);
+  std::vector<Observed> again = observe(batch);
+  for (size_t i = 0; i < NUM_ENVS; i++) same(again[i], first[i]);
+
+  // The same as restoring each one on its own, in another batch
+  VectorALE other(rom, NUM_ENVS, 1);
+  setUp(other, screens);
+  for (size_t i = 0; i < NUM_ENVS; i++)
+    other.environment(i).restoreFrom(&saved[i].snapshot[0], saved[i].snapshot.size());
+  batch.restoreAll(&arena[0], &offsets[0]);
+  std::vector<Observed> alone = observe(other), together = observe(batch);
+  for (size_t i = 0; i < NUM_ENVS; i++) same(alone[i], together[i], screens);
+}
+
+void testBroadcast(const std::string &rom, bool screens) {
+  VectorALE batch(rom, NUM_ENVS, 3), single(rom, 1, 1);
+  setUp(batch, screens);
+  play(batch, 30, 3);
+  ALEInterface &source = batch.environment(2);
+  Observed saved(source);
+
+  // Every environment takes the state of the one copied, as restoreFrom() gives it
+  ALEInterface &alone = single.environment(0);
+  single.setAutoReset(true);
+  alone.setFrameSkip(3);
+  alone.setSnapshotScreens(screens);
+  alone.restoreFrom(&saved.snapshot[0], saved.snapshot.size());
+  Observed expected(alone);
+  batch.broadcastFrom(2);
+  same(Observed(source), saved);
+  for (size_t i = 0; i < NUM_ENVS; i++) same(Observed(batch.environment(i)), expected, screens);
+
+  // Given the same actions, they all go on alike, as the environment restored on its own
+  std::vector<Action> actions(NUM_ENVS);
+  std::vector<reward_t> rewards(NUM_ENVS);
+  ActionVect legal = alone.getMinimalActionSet();
+  std::mt19937 rng(4);
+  for (int t = 0; t < 50; t++) {
+    Action action = legal[rng() % legal.size()];
+    actions.assign(NUM_ENVS, action);
+    batch.step(&actions[0], &rewards[0], NULL, NULL, NULL);
+    single.step(&action, &rewards[0], NULL, NULL, NULL);
+  }
+  Observed after(alone);
+  for (size_t i = 0; i < NUM_ENVS; i++) same(Observed(batch.environment(i)), after);
+
+  // broadcast() spreads a snapshot taken anywhere
+  batch.broadcast(&saved.snapshot[0], saved.snapshot.size());
+  for (size_t i = 0; i < NUM_ENVS; i++) same(Observed(batch.environment(i)), expected, screens);
+}
+
+}  // namespace
+
+int main() {
+  test::TempDir dir;
+  std::string rom = dir.write("pong.bin", test::bankSwitchRom());
+  for (bool screens : {false, true}) {
+    testSnapshots(rom, screens);
+    testBroadcast(rom, screens);
+  }
+  return test::finish("vector_snapshot_test");
+}
@@ -0,0 +1,631 @@
+/* *****************************************************************************
+ * Xitari
+ *
+ * Copyright 2014 Google Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * *****************************************************************************
+ *  xitari_recompile.cpp
+ *
+ *  Recompiles ROMs ahead of time into C++ processors for the fast core (see
+ *  M6502Recompiled). For each ROM the code reachable from the reset vectors
+ *  is traced through every bank, following the bank switches it can predict,
+ *  and emitted as straight-line instruction bodies taken from M6502Fast.ins.
+ *  Everything else is left to the interpreter at run time.
+ *
+ *  Usage: xitari_recompile -i M6502Fast.ins -o <directory> [-t <type>] <rom>...
+ *
+ *  Writes <directory>/<rom name>.cpp for each ROM, and
+ *  <directory>/recompiled_roms.cpp, which defines registerRecompiledProcessors().
+ **************************************************************************** */
+
+#include "emucore/Cart.hxx"
+#include "emucore/MD5.hxx"
+#include "emucore/m6502/src/M6502.hxx"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ale;
+
+namespace {
+
+// Gives access to the processor's opcode tables
+struct Opcodes : public M6502 {
+  using M6502::ourAddressingModeTable;
+  using M6502::ourInstructionMnemonicTable;
+};
+
+// How a type of cartridge shows its ROM to the processor
+struct Layout {
+  std::string name;     // Name of the cartridge class
+  uInt32 image_size;    // Bytes of the ROM the cartridge keeps, 0 for any
+  uInt32 bank_size;     // Bytes of ROM visible at once, mirrored over 4K
+  uInt32 hotspot;       // Window offset switching to bank 0, or 0 if none
+  uInt32 ram_size;      // Window offsets hidden by cartridge RAM ports
+};
+
+bool findLayout(const std::string &type, Layout &layout) {
+  static const struct { const char *type; Layout layout; } layouts[] = {
+    { "2K",   { "Cartridge2K",   2048, 2048, 0, 0 } },
+    { "4K",   { "Cartridge4K",   4096, 4096, 0, 0 } },
+    { "F8",   { "CartridgeF8",   8192, 4096, 0xFF8, 0 } },
+    { "F8SC", { "CartridgeF8SC", 8192, 4096, 0xFF8, 0x100 } },
+    { "F6",   { "CartridgeF6",   16384, 4096, 0xFF6, 0 } },
+    { "F6SC", { "CartridgeF6SC", 16384, 4096, 0xFF6, 0x100 } },
+    { "F4",   { "CartridgeF4",   32768, 4096, 0xFF4, 0 } },
+    { "F4SC", { "CartridgeF4SC", 32768, 4096, 0xFF4, 0x100 } },
+  };
+
+  for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+    if (type == layouts[i].type) {
+      layout = layouts[i].layout;
+      return true;
+    }
+  }
+  return false;
+}
+
+// What an instruction does to the flow of control
+enum Flow {
+  NEXT,      // Continues with the following instruction
+  BRANCH,    // Continues with the following instruction or its target
+  JUMP,      // Continues with its target
+  DYNAMIC,   // Continues wherever the processor state says
+  SWITCH     // Continues with the following instruction, maybe in another bank
+};
+
+struct Instruction {
+  uInt32 offset;      // In the ROM image
+  uInt8 opcode;
+  uInt32 size;        // Bytes decoded ahead of the body, as M6502Fast does
+  uInt16 operand;
+  Flow flow;
+  int target;         // Window offset of the target, -1 if unknown
+  int switch_bank;    // Bank a SWITCH instruction selects, -1 if unknown
+};
+
+bool byOffset(const Instruction &a, const Instruction &b) {
+  return a.offset < b.offset;
+}
+
+class Recompiler {
+  public:
+    Recompiler(const std::map<int, std::string> &bodies, const std::vector<uInt8> &rom,
+               const Layout &layout):
+      m_bodies(bodies),
+      m_rom(rom),
+      m_layout(layout),
+      m_banks(rom.size() / layout.bank_size),
+      m_index(rom.size(), 0) {}
+
+    /** Traces the code reachable from the reset and break vectors of every bank */
+    void trace();
+
+    /** Writes the processor's translation unit */
+    void write(std::ostream &out, const std::string &source, const std::string &md5) const;
+
+    size_t instructions() const { return m_code.size(); }
+
+  private:
+    static uInt32 operandSize(uInt8 opcode);
+
+    /** Decodes the instruction at a window offset of a bank, if it can be compiled */
+    bool decode(uInt32 bank, uInt32 offset, Instruction &instruction) const;
+
+    /** Whether a window offset holds ROM seen by the processor */
+    bool isCode(uInt32 offset) const;
+
+    /** Window offset of a vector's target, or -1 if it is not in the cartridge */
+    int vector(uInt32 bank, uInt32 offset) const;
+
+    void writeInstruction(std::ostream &out, const Instruction &instruction) const;
+    void writeGoto(std::ostream &out, uInt32 bank, int target, const char *indent) const;
+
+    std::string label(uInt32 offset) const;
+
+  private:
+    const std::map<int, std::string> &m_bodies;
+    const std::vector<uInt8> &m_rom;
+    Layout m_layout;
+    uInt32 m_banks;
+
+    std::vector<Instruction> m_code;  // Sorted by offset once traced
+    std::vector<uInt16> m_index;      // One plus the index in m_code of each ROM byte
+};
+
+uInt32 Recompiler::operandSize(uInt8 opcode) {
+  // JSR fetches its own operand, between its stack accesses
+  if (opcode == 0x20) return 0;
+
+  switch (Opcodes::ourAddressingModeTable[opcode]) {
+    case M6502::Absolute:
+    case M6502::AbsoluteX:
+    case M6502::AbsoluteY:
+    case M6502::Indirect:
+      return 2;
+    case M6502::Immediate:
+    case M6502::Relative:
+    case M6502::Zero:
+    case M6502::ZeroX:
+    case M6502::ZeroY:
+    case M6502::IndirectX:
+    case M6502::IndirectY:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+bool Recompiler::isCode(uInt32 offset) const {
+  if (offset >= m_layout.bank_size || offset < 2 * m_layout.ram_size) return false;
+  // Fetching a hotspot switches banks
+  return m_layout.hotspot == 0 || offset < m_layout.hotspot || offset >= m_layout.hotspot + m_banks;
+}
+
+int Recompiler::vector(uInt32 bank, uInt32 offset) const {
+  const uInt8 *bytes = &m_rom[bank * m_layout.bank_size];
+  uInt32 window = m_layout.bank_size - 1;
+  uInt16 address = bytes[offset & window] | (bytes[(offset + 1) & window] << 8);
+  if ((address & 0x1000) == 0) return -1;
+  return address & window;
+}
+
+bool Recompiler::decode(uInt32 bank, uInt32 offset, Instruction &instruction) const {
+  const uInt8 *bytes = &m_rom[bank * m_layout.bank_size];
+  uInt8 opcode = bytes[offset];
+  if (Opcodes::ourAddressingModeTable[opcode] == M6502::Invalid) return false;
+  if (m_bodies.find(opcode) == m_bodies.end()) return false;
+
+  uInt32 size = 1 + operandSize(opcode);
+  uInt32 length = (opcode == 0x20) ? 3 : size;
+  for (uInt32 i = 0; i < length; i++)
+    if (!isCode(offset + i)) return false;
+
+  instruction.offset = bank * m_layout.bank_size + offset;
+  instruction.opcode = opcode;
+  instruction.size = size;
+  instruction.operand = (length > 1) ? bytes[offset + 1] : 0;
+  if (length > 2) instruction.operand |= bytes[offset + 2] << 8;
+  instruction.flow = NEXT;
+  instruction.target = -1;
+  instruction.switch_bank = -1;
+
+  uInt32 window = m_layout.bank_size - 1;
+  switch (opcode) {
+    case 0x00:  // BRK
+    case 0x40:  // RTI
+    case 0x60:  // RTS
+    case 0x6C:  // JMP (indirect)
+      instruction.flow = DYNAMIC;
+      return true;
+
+    case 0x20:  // JSR
+    case 0x4C:  // JMP
+      instruction.flow = JUMP;
+      if (instruction.operand & 0x1000) instruction.target = instruction.operand & window;
+      return true;
+  }
+
+  M6502::AddressingMode mode = Opcodes::ourAddressingModeTable[opcode];
+  if (mode == M6502::Relative) {
+    instruction.flow = BRANCH;
+    int target = static_cast<int>(offset) + 2 + static_cast<Int8>(instruction.operand);
+    if (target >= 0 && target < static_cast<int>(m_layout.bank_size))
+      instruction.target = target;
+  }
+  else if (m_layout.hotspot != 0) {
+    // Accesses that may reach a hotspot end the straight-line code
+    if (mode == M6502::Absolute || mode == M6502::Indirect) {
+      uInt32 address = instruction.operand & 0x1FFF;
+      uInt32 hotspot = 0x1000 | m_layout.hotspot;
+      if (address >= hotspot && address < hotspot + m_banks) {
+        instruction.flow = SWITCH;
+        instruction.switch_bank = address - hotspot;
+      }
+    }
+    else if (mode == M6502::AbsoluteX || mode == M6502::AbsoluteY ||
+             mode == M6502::IndirectX || mode == M6502::IndirectY) {
+      instruction.flow = SWITCH;
+    }
+  }
+  return true;
+}
+
+void Recompiler::trace() {
+  std::vector<std::pair<uInt32, uInt32> > pending;  // Bank and window offset
+  for (uInt32 bank = 0; bank < m_banks; bank++) {
+    int reset = vector(bank, 0xFFC);
+    int brk = vector(bank, 0xFFE);
+    if (reset >= 0) pending.push_back(std::make_pair(bank, reset));
+    if (brk >= 0) pending.push_back(std::make_pair(bank, brk));
+  }
+
+  while (!pending.empty()) {
+    uInt32 bank = pending.back().first;
+    uInt32 offset = pending.back().second;
+    pending.pop_back();
+
+    Instruction instruction;
+    if (m_index[bank * m_layout.bank_size + offset] != 0 || !decode(bank, offset, instruction))
+      continue;
+
+    m_code.push_back(instruction);
+    m_index[instruction.offset] = 1;
+
+    uInt32 next = offset + ((instruction.opcode == 0x20) ? 3 : instruction.size);
+    switch (instruction.flow) {
+      case NEXT:
+        pending.push_back(std::make_pair(bank, next));
+        break;
+      case BRANCH:
+        pending.push_back(std::make_pair(bank, next));
+        if (instruction.target >= 0) pending.push_back(std::make_pair(bank, instruction.target));
+        break;
+      case JUMP:
+        if (instruction.target >= 0) pending.push_back(std::make_pair(bank, instruction.target));
+        // Subroutines usually return
+        if (instruction.opcode == 0x20) pending.push_back(std::make_pair(bank, next));
+        break;
+      case SWITCH:
+        pending.push_back(std::make_pair(bank, next));
+        if (instruction.switch_bank >= 0)
+          pending.push_back(std::make_pair(static_cast<uInt32>(instruction.switch_bank), next));
+        break;
+      case DYNAMIC:
+        break;
+    }
+  }
+
+  // Instructions are laid out in ROM order so that straight-line code falls through
+  std::sort(m_code.begin(), m_code.end(), byOffset);
+
+  if (m_code.size() > 0xFFFE) throw std::runtime_error("too many instructions to recompile");
+  for (size_t i = 0; i < m_code.size(); i++)
+    m_index[m_code[i].offset] = static_cast<uInt16>(i + 1);
+}
+
+std::string Recompiler::label(uInt32 offset) const {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "i%05x", offset);
+  return buffer;
+}
+
+void Recompiler::writeGoto(std::ostream &out, uInt32 bank, int target, const char *indent) const {
+  if (target < 0 || m_index[bank * m_layout.bank_size + target] == 0) {
+    out << indent << "continue;\n";
+    return;
+  }
+  out << indent << "M6502_RECOMPILED_NEXT(" << label(bank * m_layout.bank_size + target) << ")\n";
+}
+
+void Recompiler::writeInstruction(std::ostream &out, const Instruction &instruction) const {
+  uInt32 bank = instruction.offset / m_layout.bank_size;
+  uInt32 offset = instruction.offset % m_layout.bank_size;
+  uInt8 last = m_rom[instruction.offset + instruction.size - 1];
+
+  char line[512];
+  snprintf(line, sizeof(line),
+           "%s:  // bank %u, %03x: %s $%04x\n"
+           "  IR = 0x%02x;\n"
+           "  mySystem->incrementCycles(myInstructionSystemCycleTable[0x%02x]);\n"
+           "  mySystem->setDataBusState(0x%02x);\n"
+           "  myLastAccessWasRead = true;\n"
+           "  instructionOperand = 0x%04x;\n"
+           "  ++PC;\n",
+           label(instruction.offset).c_str(), bank, offset,
+           Opcodes::ourInstructionMnemonicTable[instruction.opcode], instruction.operand,
+           instruction.opcode, instruction.opcode, last, instruction.operand);
+  out << line << m_bodies.find(instruction.opcode)->second;
+
+  uInt32 next = offset + ((instruction.opcode == 0x20) ? 3 : instruction.size);
+  int following = (next < m_layout.bank_size) ? static_cast<int>(next) : -1;
+
+  switch (instruction.flow) {
+    case NEXT:
+      writeGoto(out, bank, following, "  ");
+      break;
+    case BRANCH:
+      if (instruction.target >= 0 && m_index[bank * m_layout.bank_size + instruction.target] != 0) {
+        snprintf(line, sizeof(line), "  if((PC & 0x%03x) == 0x%03x)\n  {\n",
+                 m_layout.bank_size - 1, instruction.target);
+        out << line;
+        writeGoto(out, bank, instruction.target, "    ");
+        out << "  }\n";
+      }
+      writeGoto(out, bank, following, "  ");
+      break;
+    case JUMP:
+      writeGoto(out, bank, instruction.target, "  ");
+      break;
+    case SWITCH:
+    case DYNAMIC:
+      out << "  continue;\n";
+      break;
+  }
+  out << "\n";
+}
+
+void Recompiler::write(std::ostream &out, const std::string &source, const std::string &md5) const {
+  out << "// Generated by xitari_recompile from " << source << "; do not edit.\n"
+      << "//\n"
+      << "// " << m_code.size() << " instructions of a " << m_rom.size() << "-byte "
+      << m_layout.name << " image, MD5 " << md5 << ".\n\n"
+      << "#include \"emucore/m6502/src/M6502Recompiled.hxx\"\n"
+      << "#include \"emucore/" << m_layout.name.substr(9).insert(0, "Cart") << ".hxx\"\n"
+      << "#include \"emucore/M6532.hxx\"\n"
+      << "#include \"emucore/TIA.hxx\"\n\n"
+      << "#ifndef NOTSAMEPAGE\n"
+      << "  #define NOTSAMEPAGE(_addr1, _addr2) (((_addr1) ^ (_addr2)) & 0xff00)\n"
+      << "#endif\n\n"
+      << "// Continue with the given instruction, unless execution should stop\n"
+      << "#define M6502_RECOMPILED_NEXT(label) \\\n"
+      << "  if(myExecutionStatus || (number == 0)) \\\n"
+      << "    continue; \\\n"
+      << "  --number; \\\n"
+      << "  goto label;\n\n"
+      << "namespace ale {\n\n"
+      << "namespace {\n\n"
+      << "// Calls the TIA, the M6532 and the cartridge without virtual dispatch, so that the\n"
+      << "//  cartridge's bankswitching hotspot checks are inlined into the code below\n"
+      << "class Bus\n"
+      << "{\n"
+      << "  public:\n"
+      << "    Bus(" << m_layout.name << "& cartridge, TIA& tia, M6532& riot)\n"
+      << "      : myCartridge(&cartridge), myTIA(&tia), myRiot(&riot)\n"
+      << "    {\n"
+      << "    }\n\n"
+      << "    uInt8 peek(Device& device, uInt16 address)\n"
+      << "    {\n"
+      << "      if(&device == myTIA)\n"
+      << "        return myTIA->TIA::peek(address);\n"
+      << "      else if(&device == myRiot)\n"
+      << "        return myRiot->M6532::peek(address);\n"
+      << "      else if(&device == myCartridge)\n"
+      << "        return myCartridge->" << m_layout.name << "::peek(address);\n"
+      << "      else\n"
+      << "        return device.peek(address);\n"
+      << "    }\n\n"
+      << "    void poke(Device& device, uInt16 address, uInt8 value)\n"
+      << "    {\n"
+      << "      if(&device == myTIA)\n"
+      << "        myTIA->TIA::poke(address, value);\n"
+      << "      else if(&device == myRiot)\n"
+      << "        myRiot->M6532::poke(address, value);\n"
+      << "      else if(&device == myCartridge)\n"
+      << "        myCartridge->" << m_layout.name << "::poke(address, value);\n"
+      << "      else\n"
+      << "        device.poke(address, value);\n"
+      << "    }\n\n"
+      << "  private:\n"
+      << "    " << m_layout.name << "* myCartridge;\n"
+      << "    TIA* myTIA;\n"
+      << "    M6532* myRiot;\n"
+      << "};\n\n";
+
+  out << "const uInt16 ourBlocks[" << m_index.size() << "] = {";
+  for (size_t i = 0; i < m_index.size(); i++)
+    out << ((i % 16 == 0) ? "\n  " : " ") << m_index[i] << ",";
+  out << "\n};\n\n";
+
+  out << "class Processor : public M6502RecompiledBus<Bus>\n"
+      << "{\n"
+      << "  public:\n"
+      << "    Processor(uInt32 systemCyclesPerProcessorCycle, const Bus& bus)\n"
+      << "      : M6502RecompiledBus<Bus>(systemCyclesPerProcessorCycle, bus,\n"
+      << "            ourBlocks, " << m_index.size() << ")\n"
+      << "    {\n"
+      << "    }\n\n"
+      << "    virtual bool execute(uInt32 number);\n"
+      << "};\n\n";
+
+  out << "bool Processor::execute(uInt32 number)\n"
+      << "{\n"
+      << "  static const void* const ourLabels[" << m_code.size() + 1 << "] = {\n"
+      << "    0";
+  for (size_t i = 0; i < m_code.size(); i++)
+    out << ((i % 6 == 5) ? ",\n    " : ", ") << "&&" << label(m_code[i].offset);
+  out << "\n  };\n\n"
+      << "  // Clear all of the execution status bits except for the fatal error bit\n"
+      << "  myExecutionStatus &= FatalErrorBit;\n\n"
+      << "  uInt16 instructionOperand;\n"
+      << "  uInt16 operandAddress = 0;\n"
+      << "  uInt8 operand = 0;\n"
+      << "  uInt32 requested = number;\n"
+      << "  uInt32 interpreted = 0;\n\n"
+      << "  while(!myExecutionStatus && (number != 0))\n"
+      << "  {\n"
+      << "    uInt16 block = compiledBlock();\n"
+      << "    --number;\n"
+      << "    if(block == 0)\n"
+      << "    {\n"
+      << "      ++interpreted;\n"
+      << "      interpret();\n"
+      << "      continue;\n"
+      << "    }\n"
+      << "    goto *ourLabels[block];\n\n";
+
+  for (size_t i = 0; i < m_code.size(); i++)
+    writeInstruction(out, m_code[i]);
+
+  out << "  }\n\n"
+      << "  (void)operandAddress;\n"
+      << "  (void)operand;\n\n"
+      << "  // The interpreter counts the instructions it executed itself\n"
+      << "  myIdleLoopStatistics.instructions += requested - number - interpreted;\n\n"
+      << "  // Interrupts are handled as M6502FastBus does\n"
+      << "  if((myExecutionStatus & MaskableInterruptBit) ||\n"
+      << "      (myExecutionStatus & NonmaskableInterruptBit))\n"
+      << "  {\n"
+      << "    interruptHandler();\n"
+      << "  }\n\n"
+      << "  return (myExecutionStatus & StopExecutionBit) ||\n"
+      << "      (!(myExecutionStatus & FatalErrorBit) && (number == 0));\n"
+      << "}\n\n"
+      << "} // namespace\n\n"
+      << "M6502Fast* createRecompiledProcessor_" << md5 << "(\n"
+      << "    uInt32 systemCyclesPerProcessorCycle, Cartridge& cartridge, TIA& tia, M6532& riot)\n"
+      << "{\n"
+      << "  return new Processor(systemCyclesPerProcessorCycle,\n"
+      << "      Bus(static_cast<" << m_layout.name << "&>(cartridge), tia, riot));\n"
+      << "}\n\n"
+      << "} // namespace ale\n";
+}
+
+/** Splits M6502Fast.ins into the body of each opcode */
+std::map<int, std::string> readBodies(const std::string &path) {
+  std::ifstream in(path.c_str());
+  if (!in) throw std::runtime_error("cannot read " + path);
+
+  std::map<int, std::string> bodies;
+  std::string line;
+  std::vector<int> opcodes;  // Opcodes sharing the body being read
+  bool in_body = false;
+  while (std::getline(in, line)) {
+    if (line.compare(0, 17, "M6502_FAST_OPCODE") == 0) {
+      if (in_body) opcodes.clear();
+      in_body = false;
+      int opcode = static_cast<int>(strtol(line.c_str() + 18, NULL, 16));
+      opcodes.push_back(opcode);
+      bodies[opcode] = "";
+    }
+    else if (line.compare(0, 15, "M6502_FAST_NEXT") == 0) {
+      opcodes.clear();
+      in_body = false;
+    }
+    else if (!opcodes.empty()) {
+      in_body = true;
+      for (size_t i = 0; i < opcodes.size(); i++)
+        bodies[opcodes[i]] += line + "\n";
+    }
+  }
+
+  if (bodies.empty()) throw std::runtime_error(path + " holds no instructions");
+  return bodies;
+}
+
+std::vector<uInt8> readRom(const std::string &path) {
+  std::ifstream in(path.c_str(), std::ios::binary);
+  if (!in) throw std::runtime_error("cannot read " + path);
+  return std::vector<uInt8>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+std::string romName(const std::string &path) {
+  size_t slash = path.find_last_of("/\\");
+  std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+  size_t dot = name.find('.');
+  return (dot == std::string::npos) ? name : name.substr(0, dot);
+}
+
+void usage() {
+  std::cerr << "Usage: xitari_recompile -i M6502Fast.ins -o <directory> [-t <type>] <rom>..."
+            << std::endl;
+  exit(1);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string bodies_path, directory, type;
+  std::vector<std::string> roms;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if ((arg == "-i" || arg == "-o" || arg == "-t") && i + 1 < argc) {
+      std::string &value = (arg == "-i") ? bodies_path : (arg == "-o") ? directory : type;
+      value = argv[++i];
+    }
+    else if (arg.size() > 0 && arg[0] == '-')
+      usage();
+    else
+      roms.push_back(arg);
+  }
+  if (bodies_path.empty() || directory.empty()) usage();
+
+  try {
+    std::map<int, std::string> bodies = readBodies(bodies_path);
+    std::ostringstream declarations, registry;
+
+    for (size_t r = 0; r < roms.size(); r++) {
+      std::vector<uInt8> rom = readRom(roms[r]);
+      if (rom.empty()) throw std::runtime_error(roms[r] + " is empty");
+
+      std::string md5 = MD5(&rom[0], rom.size());
+      std::string rom_type = type.empty() ? Cartridge::autodetectType(&rom[0], rom.size()) : type;
+      std::string path = directory + "/" + romName(roms[r]) + ".cpp";
+      std::ofstream out(path.c_str());
+      if (!out) throw std::runtime_error("cannot write " + path);
+
+      // Other types switch parts of the window separately; the interpreter runs them
+      Layout layout;
+      if (!findLayout(rom_type, layout) || rom.size() < layout.image_size) {
+        out << "// Generated by xitari_recompile from " << roms[r] << "; do not edit.\n"
+            << "//\n"
+            << "// Cartridges of type " << rom_type << " cannot be recompiled.\n";
+        std::cerr << roms[r] << ": type " << rom_type << " is not supported" << std::endl;
+        continue;
+      }
+
+      // The cartridge only keeps the first copy of mirrored images
+      rom.resize(layout.image_size);
+
+      Recompiler recompiler(bodies, rom, layout);
+      recompiler.trace();
+      recompiler.write(out, roms[r], md5);
+      if (!out) throw std::runtime_error("cannot write " + path);
+
+      declarations << "M6502Fast* createRecompiledProcessor_" << md5
+                   << "(uInt32, Cartridge&, TIA&, M6532&);\n";
+      registry << "  M6502Recompiled::add(\"" << md5 << "\", \"" << layout.name << "\",\n"
+               << "      &createRecompiledProcessor_" << md5 << ");\n";
+
+      std::cerr << roms[r] << ": " << rom_type << ", " << recompiler.instructions()
+                << " instructions" << std::endl;
+    }
+
+    std::string path = directory + "/recompiled_roms.cpp";
+    std::ofstream out(path.c_str());
+    out << "// Generated by xitari_recompile; do not edit.\n\n"
+        << "#include \"emucore/m6502/src/M6502Recompiled.hxx\"\n\n"
+        << "namespace ale {\n\n"
+        << declarations.str() << (declarations.str().empty() ? "" : "\n")
+        << "void registerRecompiledProcessors()\n"
+        << "{\n"
+        << "  static bool ourRegistered = false;\n"
+        << "  if(ourRegistered)\n"
+        << "  {\n"
+        << "    return;\n"
+        << "  }\n"
+        << "  ourRegistered = true;\n\n"
+        << registry.str()
+        << "}\n\n"
+        << "} // namespace ale\n";
+    if (!out) throw std::runtime_error("cannot write " + path);
+  }
+  catch (const std::exception &e) {
+    std::cerr << "xitari_recompile: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}